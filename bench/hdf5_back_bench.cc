@@ -0,0 +1,76 @@
+// Measures the decode throughput of Hdf5Back::Query on a table of fixed
+// length columns and on a table of variable length strings and maps.
+//
+// Usage: cyclus_hdf5_bench [nrows] [path]
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "hdf5_back.h"
+#include "recorder.h"
+
+namespace {
+
+/// Records nrows rows in each of the Fixed and Variable tables of back.
+void Fill(cyclus::Hdf5Back* back, int nrows) {
+  cyclus::Recorder rec;
+  rec.RegisterBackend(back);
+  std::vector<int> shape(1, 32);
+  std::map<int, double> comp;
+  comp[922350000] = 0.04;
+  comp[922380000] = 0.96;
+  for (int i = 0; i < nrows; ++i) {
+    rec.NewDatum("Fixed")
+        ->AddVal("ResourceId", i)
+        ->AddVal("Time", i / 1000)
+        ->AddVal("Quantity", 1.5 * i)
+        ->AddVal("Units", std::string("kg"), &shape)
+        ->Record();
+    rec.NewDatum("Variable")
+        ->AddVal("ResourceId", i)
+        ->AddVal("Time", i / 1000)
+        ->AddVal("Commodity", std::string(i % 2 ? "uox" : "mox"))
+        ->AddVal("Comp", comp)
+        ->Record();
+  }
+  rec.Flush();
+}
+
+/// Returns the rows per second decoded by querying table, keeping the rows
+/// that pass conds.
+double Rate(cyclus::Hdf5Back* back, const char* table, int nrows,
+            std::vector<cyclus::Cond>* conds) {
+  clock_t start = clock();
+  cyclus::QueryResult qr = back->Query(table, conds);
+  double secs = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+  return secs > 0 ? nrows / secs : 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int nrows = argc > 1 ? atoi(argv[1]) : 100000;
+  std::string path = argc > 2 ? argv[2] : "hdf5_back_bench.h5";
+  remove(path.c_str());
+
+  cyclus::Hdf5Back back(path);
+  Fill(&back, nrows);
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("Time", ">=", nrows / 2000));
+  const char* tables[] = {"Fixed", "Variable"};
+  std::cout << "table     rows/s unconditioned  rows/s conditioned\n";
+  for (int t = 0; t < 2; ++t) {
+    double full = Rate(&back, tables[t], nrows, NULL);
+    double cond = Rate(&back, tables[t], nrows, &conds);
+    printf("%-8s  %20.0f  %18.0f\n", tables[t], full, cond);
+  }
+
+  back.Close();
+  remove(path.c_str());
+  return 0;
+}
@@ -10,8 +10,10 @@
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/uuid/string_generator.hpp>
 
+#include "convert.h"
 #include "cyclus.h"
 #include "hdf5_back.h"
+#include "parallel.h"
 #include "pyhooks.h"
 #include "pyne.h"
 #include "query_backend.h"
@@ -46,6 +48,13 @@ int EarlyExitArgs(const ArgInfo& ai);
 // Using cli flags, retrieves and sets global params for the simulation.
 void GetSimInfo(ArgInfo* ai);
 
+// Opens the database at path with the backend for its extension.
+FullBackend* OpenBackend(const std::string& path);
+
+// Opens the database at path for reading only.  Column logs get a
+// ColLogReader, since their backend rewrites the end of the file on opening.
+QueryableBackend* OpenReader(const std::string& path);
+
 static std::string usage = "Usage:   cyclus [opts] [input-file]";
 
 //-----------------------------------------------------------------------
@@ -126,13 +135,7 @@ int main(int argc, char* argv[]) {
   RecBackend::Deleter bdel;
   Recorder rec;  // Must be after backend deleter because ~Rec does flushing
 
-  std::string ext = fs::path(ai.output_path).extension().string();
-  std::string stem = fs::path(ai.output_path).stem().string();
-  if (ext == ".h5") {
-    fback = new Hdf5Back(ai.output_path.c_str());
-  } else {
-    fback = new SqliteBack(ai.output_path);
-  }
+  fback = OpenBackend(ai.output_path);
   rec.RegisterBackend(fback);
   bdel.Add(fback);
 
@@ -190,18 +193,8 @@ int main(int argc, char* argv[]) {
       std::cerr << "invalid restart spec: simid or time is invalid\n";
       return 1;
     }
-    FullBackend* rback = NULL;
-    RecBackend::Deleter bdel;
-
-    std::string ext = dbfile.extension().string();
-    if (ext == ".h5") {
-      rback = new Hdf5Back(dbfile.c_str());
-    } else {
-      rback = new SqliteBack(dbfile.c_str());
-    }
-    bdel.Add(rback);
-
-    si.Restart(rback, simid, t);
+    boost::shared_ptr<QueryableBackend> rback(OpenReader(dbfile.string()));
+    si.Restart(rback.get(), simid, t);
     si.recorder()->RegisterBackend(fback);
   }
 
@@ -276,6 +269,9 @@ int ParseCliArgs(ArgInfo* ai, int argc, char* argv[]) {
       ("py-to-json", po::value<std::string>(), "*.py input file")
       ("py-to-xml", po::value<std::string>(), "*.py input file")
       ("xml-to-py", po::value<std::string>(), "*.xml input file")
+      ("convert", po::value<std::vector<std::string> >()->multitoken(),
+       "copy all tables of one database into another, converting between "
+       "formats by extension: --convert in.sqlite out.h5")
       ;
 
   po::variables_map vm;
@@ -472,6 +468,31 @@ int EarlyExitArgs(const ArgInfo& ai) {
       std::cout << err.what() << "\n";
     }
     return 0;
+  } else if (ai.vm.count("convert")) {
+    std::vector<std::string> paths =
+        ai.vm["convert"].as<std::vector<std::string> >();
+    if (paths.size() != 2) {
+      std::cerr << "invalid convert spec: need [in-db] [out-db]\n";
+      return 1;
+    } else if (!fs::exists(paths[0])) {
+      std::cerr << "no database at " << paths[0] << "\n";
+      return 1;
+    } else if (fs::equivalent(paths[0], paths[1])) {
+      std::cerr << "cannot convert a database into itself\n";
+      return 1;
+    }
+    try {
+      boost::shared_ptr<QueryableBackend> in(OpenReader(paths[0]));
+      RecBackend::Deleter bdel;
+      FullBackend* out = OpenBackend(paths[1]);
+      bdel.Add(out);
+      Convert(in.get(), out, HardwareThreads());
+      out->Close();
+    } catch (cyclus::Error err) {
+      std::cerr << err.what() << "\n";
+      return 1;
+    }
+    return 0;
   } else if (ai.vm.count("metadata")) {
     try {
       Json::Value root = DiscoverMetadataInCyclusPath();
@@ -526,3 +547,20 @@ void GetSimInfo(ArgInfo* ai) {
     ai->output_path = ai->vm["output-path"].as<std::string>();
   }
 }
+
+FullBackend* OpenBackend(const std::string& path) {
+  std::string ext = fs::path(path).extension().string();
+  if (ext == ".h5") {
+    return new Hdf5Back(path.c_str());
+  } else if (ext == ".cyclog") {
+    return new ColLogBack(path);
+  }
+  return new SqliteBack(path);
+}
+
+QueryableBackend* OpenReader(const std::string& path) {
+  if (fs::path(path).extension().string() == ".cyclog") {
+    return new ColLogReader(path);
+  }
+  return OpenBackend(path);
+}
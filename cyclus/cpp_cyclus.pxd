@@ -113,6 +113,8 @@ cdef extern from "cyclus.h" namespace "cyclus":
         GE
         EQ
         NE
+        IN
+        BETWEEN
 
     cdef cppclass Blob:
         Blob() except +
@@ -128,6 +130,14 @@ cdef extern from "cyclus.h" namespace "cyclus":
         CmpOpCode opcode
         hold_any val
 
+    cdef cppclass Agg:
+        Agg() except +
+        Agg(std_string, std_string) except +
+
+        std_string field
+        std_string op
+        std_string name() except +
+
     cdef cppclass QueryResult:
         QueryResult() except +
 
@@ -148,8 +158,27 @@ cdef extern from "cyclus.h" namespace "cyclus":
         DbTypes dbtype
         vector[int] shape
     
+    cdef cppclass ColumnarResult:
+        ColumnarResult() except +
+
+        const vector[std_string]& fields()
+        const vector[DbTypes]& types()
+        size_t nrows()
+        int FieldIndex(std_string) except +
+        vector[T]& Column[T](int)
+        hold_any Get(int, size_t) except +
+
+    cdef cppclass QueryCursor:
+        cpp_bool Next(QueryResult*, int) except +
+
     cdef cppclass QueryableBackend:
         QueryResult Query(std_string, vector[Cond]*) except +
+        QueryResult Query(std_string, vector[std_string]&, vector[Cond]*) except +
+        ColumnarResult QueryColumnar(std_string, vector[Cond]*) except +
+        ColumnarResult QueryColumnar(std_string, vector[std_string]&, vector[Cond]*) except +
+        QueryResult Aggregate(std_string, vector[std_string]&, vector[Agg]&, vector[Cond]*) except +
+        shared_ptr[QueryCursor] Cursor(std_string, vector[Cond]*) except +
+        shared_ptr[QueryCursor] Cursor(std_string, vector[std_string]&, vector[Cond]*) except +
         map[std_string, DbTypes] ColumnTypes(std_string) except +
         list[ColumnInfo] Schema(std_string)
         set[std_string] Tables() except +
@@ -184,6 +213,57 @@ cdef extern from "hdf5_back.h" namespace "cyclus":
         Hdf5Back(std_string) except +
 
 
+cdef extern from "col_log_back.h" namespace "cyclus":
+
+    cdef cppclass ColLogBack(FullBackend):
+        ColLogBack(std_string, int) except +
+
+
+cdef extern from "partition_back.h" namespace "cyclus":
+
+    cdef cppclass PartitionBack(FullBackend):
+        PartitionBack(std_string, std_string, int, int, std_string) except +
+        int npartitions()
+
+
+cdef extern from "mem_back.h" namespace "cyclus":
+
+    cdef cppclass MemBack(FullBackend):
+        MemBack(RecBackend*) except +
+        void Export(RecBackend*) except +
+        size_t nrows(std_string)
+
+
+cdef extern from "caching_back.h" namespace "cyclus":
+
+    cdef cppclass CachingBackend(FullBackend):
+        CachingBackend(QueryableBackend*, size_t) except +
+        void Invalidate(std_string) except +
+        void Clear() except +
+        size_t bytes()
+        int hits()
+        int misses()
+
+
+cdef extern from "res_lineage.h" namespace "cyclus":
+
+    cdef cppclass ResLineage:
+        ResLineage(QueryableBackend*, int) except +
+        ResLineage(QueryableBackend*, uuid, int) except +
+        int size()
+        cpp_bool Has(int)
+        double Quantity(int) except +
+        int QualId(int) except +
+        cpp_bool IsMaterial(int) except +
+        int TimeCreated(int) except +
+        vector[int] Parents(int) except +
+        vector[int] Children(int) except +
+        vector[int] Ancestors(int) except +
+        vector[int] Descendants(int) except +
+        map[int, double] MassFracs(int) except +
+        map[int, double] Flow(int, int, int, int) except +
+
+
 cdef extern from "dynamic_module.h" namespace "cyclus":
 
     cdef cppclass AgentSpec:
@@ -275,6 +355,7 @@ cdef extern from "error.h" namespace "cyclus":
 
 cdef extern from "pyhooks.h" namespace "cyclus":
 
+    cdef cpp_bool PY_EVENT_CONSUMERS
     cdef void PyInitHooks() except +
 
 
@@ -783,10 +864,12 @@ cdef extern from "context.h" namespace "cyclus":
         uuid sim_id() except +
         int time()
         uint64_t dt()
-        const set[Trader*] traders()
+        const vector[Trader*] traders()
+        Agent* GetAgent(int) except +
         shared_ptr[Composition] GetRecipe(std_string)
         void SchedBuild(Agent*, std_string)
         void SchedBuild(Agent*, std_string, int)
+        void SchedBuild(Agent*, std_string, int, int)
         void SchedDecom(Agent*)
         void SchedDecom(Agent*, int)
         Datum* NewDatum(std_string)
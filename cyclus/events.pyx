@@ -1,6 +1,8 @@
 from __future__ import unicode_literals, print_function
+import sys
 import time
 import json
+import types
 from functools import wraps
 from collections.abc import Set, Sequence
 
@@ -8,25 +10,53 @@ import cyclus.system
 from cyclus.lazyasd import lazyobject
 from cyclus.system import asyncio
 
-# A SimState instance representing the current simuation.
-STATE = None
+# A SimState instance representing the current simuation, read and assigned
+# through the STATE property of this module.
+_STATE = None
+
+
+def set_state(state):
+    """Sets the simulation state that the event loop serves. The simulation
+    only enters the event loop while there is one.
+    """
+    global _STATE
+    from cyclus.lib import set_py_event_consumers
+    _STATE = state
+    set_py_event_consumers(state is not None)
+
+
+class _EventsModule(types.ModuleType):
+    """Makes STATE a property of this module, so that assigning to
+    cyclus.events.STATE goes through set_state.
+    """
+
+    @property
+    def STATE(self):
+        return _STATE
+
+    @STATE.setter
+    def STATE(self, state):
+        set_state(state)
+
+
+sys.modules[__name__].__class__ = _EventsModule
 
 
 def loop():
     """Adds tasks to the queue"""
-    if STATE is None:
+    if _STATE is None:
         return
-    STATE.rec.flush()
-    for action in STATE.repeating_actions:
+    _STATE.rec.flush()
+    for action in _STATE.repeating_actions:
         if callable(action):
             args = ()
         else:
             action, params = action[0], action[1]
             if isinstance(action, str):
                 action = EVENT_ACTIONS[action]
-        STATE.action_queue.put(action(STATE, **params))
-    while 'pause' in STATE.tasks or not STATE.action_queue.empty():
-        time.sleep(STATE.frequency)
+        _STATE.action_queue.put(action(_STATE, **params))
+    while 'pause' in _STATE.tasks or not _STATE.action_queue.empty():
+        time.sleep(_STATE.frequency)
 
 
 #
@@ -1580,6 +1580,13 @@ cdef dict C_NAMES = {
     }
 NAMES = C_NAMES
 
+cdef dict C_NAMES = {
+{%- for t in dbtypes %}
+    {{ ts.cython_cpp_name(t) }}: '{{ t }}',
+{%- endfor %}
+    }
+NAMES = C_NAMES
+
 cdef dict C_IDS = {
 {%- for t in dbtypes %}
     '{{ t }}': {{ ts.cython_cpp_name(t) }},
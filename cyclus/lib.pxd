@@ -27,17 +27,38 @@ cdef class _Datum:
     cdef list _fieldnames
 
 cdef object query_result_to_py(cpp_cyclus.QueryResult)
+cdef object columnar_result_to_py(cpp_cyclus.ColumnarResult&)
 cdef object single_query_result_to_py(cpp_cyclus.QueryResult qr, int row)
 
 cdef class _FullBackend:
     cdef void * ptx
 
+cdef class _QueryCursor:
+    cdef cpp_cyclus.shared_ptr[cpp_cyclus.QueryCursor] ptx
+    cdef object _back
+    cdef int _batch_size
+
 cdef class _SqliteBack(_FullBackend):
     pass
 
 cdef class _Hdf5Back(_FullBackend):
     pass
 
+cdef class _ColLogBack(_FullBackend):
+    pass
+
+cdef class _PartitionBack(_FullBackend):
+    pass
+
+cdef class _MemBack(_FullBackend):
+    cdef object _export_to
+
+cdef class _CachingBackend(_FullBackend):
+    cdef object _back
+
+cdef class _ResLineage:
+    cdef cpp_cyclus.ResLineage * ptx
+
 cdef class _Recorder:
     cdef void * ptx
 
@@ -40,6 +40,7 @@ from cyclus.cpp_stringstream cimport stringstream
 from cyclus.typesystem cimport py_to_any, db_to_py, uuid_cpp_to_py, \
     str_py_to_cpp, std_string_to_py, std_vector_std_string_to_py, \
     bool_to_py, int_to_py, std_set_std_string_to_py, uuid_cpp_to_py, \
+    uuid_py_to_cpp, \
     std_vector_std_string_to_py, C_IDS, blob_to_bytes, std_vector_int_to_py
 
 
@@ -165,6 +166,57 @@ cdef object query_result_to_py(cpp_cyclus.QueryResult qr):
     return rtn
 
 
+cdef object columnar_result_to_py(cpp_cyclus.ColumnarResult& cr):
+    """Converts a columnar query result object to a dictionary mapping fields
+    to columns and a list of field names in order. Numeric columns are copied
+    into NumPy arrays, widened to int64 and float64 as for columns built from
+    Python values; other columns are converted value by value.
+    """
+    cdef int j, ncols
+    cdef size_t i, nrows
+    cdef np.ndarray arr
+    cdef int* ivals
+    cdef np.int64_t* iout
+    cdef float* fvals
+    cdef np.float64_t* fout
+    cdef cpp_typesystem.DbTypes t
+    nrows = cr.nrows()
+    ncols = cr.fields().size()
+    cdef dict res = {}
+    cdef list fields = []
+    for j in range(ncols):
+        f = cr.fields()[j]
+        fields.append(f.decode())
+        t = cr.types()[j]
+        if t == cpp_typesystem.INT:
+            arr = np.empty(nrows, dtype=np.int64)
+            if nrows > 0:
+                ivals = cr.Column[int](j).data()
+                iout = <np.int64_t*> np.PyArray_DATA(arr)
+                for i in range(nrows):
+                    iout[i] = ivals[i]
+            col = arr
+        elif t == cpp_typesystem.DOUBLE:
+            arr = np.empty(nrows, dtype=np.float64)
+            if nrows > 0:
+                memcpy(np.PyArray_DATA(arr), cr.Column[double](j).data(),
+                       nrows * sizeof(double))
+            col = arr
+        elif t == cpp_typesystem.FLOAT:
+            arr = np.empty(nrows, dtype=np.float64)
+            if nrows > 0:
+                fvals = cr.Column[float](j).data()
+                fout = <np.float64_t*> np.PyArray_DATA(arr)
+                for i in range(nrows):
+                    fout[i] = fvals[i]
+            col = arr
+        else:
+            col = [db_to_py(cr.Get(j, i), t) for i in range(nrows)]
+        res[fields[j]] = col
+    rtn = (res, fields)
+    return rtn
+
+
 cdef object single_query_result_to_py(cpp_cyclus.QueryResult qr, int row):
     """Converts a query result object with only one row to a dictionary mapping
     fields to values and a list of field names in order.
@@ -200,7 +252,7 @@ cdef class _FullBackend:
         del cpp_ptx
         self.ptx = NULL
 
-    def query(self, table, conds=None):
+    def query(self, table, conds=None, cols=None):
         """Queries a database table.
 
         Parameters
@@ -209,6 +261,9 @@ cdef class _FullBackend:
             The table name.
         conds : iterable, optional
             A list of conditions.
+        cols : iterable of str, optional
+            The columns to return, in order. All columns are returned
+            if this is None.
 
         Returns
         -------
@@ -216,30 +271,116 @@ cdef class _FullBackend:
             Pandas DataFrame the represents the table
         """
         cdef std_string tab = str(table).encode()
-        cdef std_string field
-        cdef cpp_cyclus.QueryResult qr
+        cdef cpp_cyclus.ColumnarResult cr
         cdef std_vector[cpp_cyclus.Cond] cpp_conds
         cdef std_vector[cpp_cyclus.Cond]* conds_ptx
-        cdef std_map[std_string, cpp_cyclus.DbTypes] coltypes
+        cdef std_vector[std_string] cpp_cols
         # set up the conditions
-        if conds is None:
+        cpp_conds = conds_py_to_cpp(<cpp_cyclus.FullBackend*> self.ptx, tab,
+                                    conds)
+        if cpp_conds.size() == 0:
             conds_ptx = NULL
         else:
-            coltypes = (<cpp_cyclus.FullBackend*> self.ptx).ColumnTypes(tab)
-            for cond in conds:
-                cond0 = cond[0].encode()
-                cond1 = cond[1].encode()
-                field = std_string(<const char*> cond0)
-                if coltypes.count(field) == 0:
-                    continue  # skips non-existent columns
-                cpp_conds.push_back(cpp_cyclus.Cond(field, cond1,
-                    py_to_any(cond[2], coltypes[field])))
-            if cpp_conds.size() == 0:
-                conds_ptx = NULL
-            else:
-                conds_ptx = &cpp_conds
+            conds_ptx = &cpp_conds
         # query, convert, and return
-        qr = (<cpp_cyclus.FullBackend*> self.ptx).Query(tab, conds_ptx)
+        if cols is None:
+            cr = (<cpp_cyclus.FullBackend*> self.ptx).QueryColumnar(tab,
+                                                                    conds_ptx)
+        else:
+            for col in cols:
+                cpp_cols.push_back(str_py_to_cpp(col))
+            cr = (<cpp_cyclus.FullBackend*> self.ptx).QueryColumnar(tab,
+                    cpp_cols, conds_ptx)
+        res, fields = columnar_result_to_py(cr)
+        results = pd.DataFrame(res, columns=fields)
+        return results
+
+    def cursor(self, table, conds=None, cols=None, int batch_size=100000):
+        """Streams a database table in batches of rows, rather than reading
+        the whole table into memory at once.
+
+        Parameters
+        ----------
+        table : str
+            The table name.
+        conds : iterable, optional
+            A list of conditions.
+        cols : iterable of str, optional
+            The columns to return, in order. All columns are returned
+            if this is None.
+        batch_size : int, optional
+            The maximum number of rows in each batch.
+
+        Returns
+        -------
+        cursor : QueryCursor
+            An iterator over pandas DataFrames of at most batch_size rows.
+        """
+        cdef std_string tab = str(table).encode()
+        cdef std_vector[cpp_cyclus.Cond] cpp_conds
+        cdef std_vector[cpp_cyclus.Cond]* conds_ptx
+        cdef std_vector[std_string] cpp_cols
+        if batch_size < 1:
+            raise ValueError("batch_size must be positive")
+        cpp_conds = conds_py_to_cpp(<cpp_cyclus.FullBackend*> self.ptx, tab,
+                                    conds)
+        if cpp_conds.size() == 0:
+            conds_ptx = NULL
+        else:
+            conds_ptx = &cpp_conds
+        cdef _QueryCursor cur = QueryCursor()
+        if cols is None:
+            cur.ptx = (<cpp_cyclus.FullBackend*> self.ptx).Cursor(tab, conds_ptx)
+        else:
+            for col in cols:
+                cpp_cols.push_back(str_py_to_cpp(col))
+            cur.ptx = (<cpp_cyclus.FullBackend*> self.ptx).Cursor(tab, cpp_cols,
+                                                                  conds_ptx)
+        cur._back = self
+        cur._batch_size = batch_size
+        return cur
+
+    def aggregate(self, table, group_by, aggs, conds=None):
+        """Aggregates a database table within the backend.
+
+        Parameters
+        ----------
+        table : str
+            The table name.
+        group_by : iterable of str
+            The columns to group rows by. The whole table is aggregated if
+            this is empty.
+        aggs : iterable of (op, field) tuples
+            The aggregates to compute for each group, where op is one of
+            'COUNT', 'SUM', 'MIN', or 'MAX', e.g. ('SUM', 'Quantity').
+        conds : iterable, optional
+            A list of conditions.
+
+        Returns
+        -------
+        results : pd.DataFrame
+            One row per group, with the group_by columns followed by columns
+            named like 'SUM(Quantity)'.
+        """
+        cdef std_string tab = str(table).encode()
+        cdef cpp_cyclus.QueryResult qr
+        cdef std_vector[cpp_cyclus.Cond] cpp_conds
+        cdef std_vector[cpp_cyclus.Cond]* conds_ptx
+        cdef std_vector[std_string] cpp_group_by
+        cdef std_vector[cpp_cyclus.Agg] cpp_aggs
+        cpp_conds = conds_py_to_cpp(<cpp_cyclus.FullBackend*> self.ptx, tab,
+                                    conds)
+        if cpp_conds.size() == 0:
+            conds_ptx = NULL
+        else:
+            conds_ptx = &cpp_conds
+        for col in group_by:
+            cpp_group_by.push_back(str_py_to_cpp(col))
+        for op, field in aggs:
+            cpp_aggs.push_back(cpp_cyclus.Agg(str_py_to_cpp(op),
+                                              str_py_to_cpp(field)))
+        qr = (<cpp_cyclus.FullBackend*> self.ptx).Aggregate(tab, cpp_group_by,
+                                                            cpp_aggs, conds_ptx)
         res, fields = query_result_to_py(qr)
         results = pd.DataFrame(res, columns=fields)
         return results
@@ -285,6 +426,72 @@ class FullBackend(_FullBackend, object):
         self.close()
 
 
+# the value types of IN and BETWEEN conditions for each column type
+_IN_TYPES = {ts.INT: ts.SET_INT, ts.FLOAT: ts.SET_FLOAT,
+             ts.DOUBLE: ts.SET_DOUBLE, ts.STRING: ts.SET_STRING,
+             ts.VL_STRING: ts.SET_STRING, ts.UUID: ts.SET_UUID}
+_BETWEEN_TYPES = {ts.INT: ts.PAIR_INT_INT, ts.DOUBLE: ts.PAIR_DOUBLE_DOUBLE,
+                  ts.STRING: ts.PAIR_STRING_STRING,
+                  ts.VL_STRING: ts.PAIR_STRING_STRING}
+
+cdef std_vector[cpp_cyclus.Cond] conds_py_to_cpp(cpp_cyclus.FullBackend* back,
+                                                 std_string tab, conds):
+    """Converts a list of (field, op, value) conditions to C++ conditions,
+    skipping those on fields that the table does not have. The value of an
+    'IN' condition is a collection of values and that of a 'BETWEEN' condition
+    is a (low, high) tuple of inclusive bounds.
+    """
+    cdef std_string field
+    cdef std_vector[cpp_cyclus.Cond] cpp_conds
+    cdef std_map[std_string, cpp_cyclus.DbTypes] coltypes
+    if conds is None:
+        return cpp_conds
+    coltypes = back.ColumnTypes(tab)
+    for cond in conds:
+        cond0 = cond[0].encode()
+        cond1 = cond[1].encode()
+        field = std_string(<const char*> cond0)
+        if coltypes.count(field) == 0:
+            continue  # skips non-existent columns
+        dbtype = coltypes[field]
+        val = cond[2]
+        if cond[1] in ('IN', 'BETWEEN'):
+            valtypes = _IN_TYPES if cond[1] == 'IN' else _BETWEEN_TYPES
+            if dbtype not in valtypes:
+                raise ValueError("{0} is not supported on field {1!r} of "
+                                 "type {2}".format(cond[1], cond[0],
+                                 ts.NAMES.get(dbtype, dbtype)))
+            dbtype = valtypes[dbtype]
+            val = set(val) if cond[1] == 'IN' else tuple(val)
+        cpp_conds.push_back(cpp_cyclus.Cond(field, cond1,
+            py_to_any(val, dbtype)))
+    return cpp_conds
+
+
+cdef class _QueryCursor:
+
+    def __iter__(self):
+        return self
+
+    def __next__(self):
+        cdef cpp_cyclus.QueryResult qr
+        if self.ptx.get() == NULL:
+            raise StopIteration
+        if not self.ptx.get().Next(&qr, self._batch_size):
+            # release the table as soon as it is exhausted
+            self.ptx = cpp_cyclus.shared_ptr[cpp_cyclus.QueryCursor]()
+            self._back = None
+            raise StopIteration
+        res, fields = query_result_to_py(qr)
+        return pd.DataFrame(res, columns=fields)
+
+
+class QueryCursor(_QueryCursor, object):
+    """Iterates over the rows of a query as pandas DataFrames, see
+    FullBackend.cursor().
+    """
+
+
 cdef class _SqliteBack(_FullBackend):
 
     def __cinit__(self, path):
@@ -358,6 +565,306 @@ class Hdf5Back(_Hdf5Back, FullBackend):
     """HDF5 backend cyclus database interface."""
 
 
+cdef class _ColLogBack(_FullBackend):
+
+    def __cinit__(self, path, int seg_rows=65536):
+        """Column log backend C++ constructor"""
+        cdef std_string cpp_path = str(path).encode()
+        self.ptx = new cpp_cyclus.ColLogBack(cpp_path, seg_rows)
+
+    def __dealloc__(self):
+        """Full backend C++ destructor."""
+        if self.ptx == NULL:
+            return
+        cdef cpp_cyclus.ColLogBack * cpp_ptx = <cpp_cyclus.ColLogBack *> self.ptx
+        del cpp_ptx
+        self.ptx = NULL
+
+    def flush(self):
+        """Writes all buffered rows to the log."""
+        (<cpp_cyclus.ColLogBack*> self.ptx).Flush()
+
+    def close(self):
+        """Flushes the backend and writes the footer index of the log."""
+        (<cpp_cyclus.ColLogBack*> self.ptx).Close()
+
+    @property
+    def name(self):
+        """The path of the log."""
+        name = (<cpp_cyclus.ColLogBack*> self.ptx).Name()
+        name = name.decode()
+        return name
+
+
+class ColLogBack(_ColLogBack, FullBackend):
+    """Append-only columnar log backend cyclus database interface.
+
+    Parameters
+    ----------
+    path : str
+        The log file, which is appended to if it exists.
+    seg_rows : int, optional
+        The number of rows of a table buffered per segment.
+    """
+
+
+cdef class _PartitionBack(_FullBackend):
+
+    def __cinit__(self, path, ext='.sqlite', int window=0, int nthreads=4,
+                  time_field='Time'):
+        """Partitioned backend C++ constructor"""
+        cdef std_string cpp_path = str(path).encode()
+        cdef std_string cpp_ext = str(ext).encode()
+        cdef std_string cpp_time_field = str(time_field).encode()
+        self.ptx = new cpp_cyclus.PartitionBack(cpp_path, cpp_ext, window,
+                                                nthreads, cpp_time_field)
+
+    def __dealloc__(self):
+        """Full backend C++ destructor."""
+        if self.ptx == NULL:
+            return
+        cdef cpp_cyclus.PartitionBack * cpp_ptx = <cpp_cyclus.PartitionBack *> self.ptx
+        del cpp_ptx
+        self.ptx = NULL
+
+    def flush(self):
+        """Flushes all partitions and writes the manifest."""
+        (<cpp_cyclus.PartitionBack*> self.ptx).Flush()
+
+    def close(self):
+        """Closes all partitions and writes the manifest."""
+        (<cpp_cyclus.PartitionBack*> self.ptx).Close()
+
+    @property
+    def name(self):
+        """The directory of the partitions."""
+        name = (<cpp_cyclus.PartitionBack*> self.ptx).Name()
+        name = name.decode()
+        return name
+
+    @property
+    def npartitions(self):
+        """The number of partition files."""
+        return (<cpp_cyclus.PartitionBack*> self.ptx).npartitions()
+
+
+class PartitionBack(_PartitionBack, FullBackend):
+    """Backend writing each table, and optionally each window of time steps,
+    to its own file in a directory. Queries fan out over the partitions.
+
+    Parameters
+    ----------
+    path : str
+        The directory of the partition files and their manifest.
+    ext : str, optional
+        The extension, and so the backend, of the partition files: '.sqlite',
+        '.h5' or '.cyclog'.
+    window : int, optional
+        The number of time steps per partition, or 0 to partition by table
+        only.
+    nthreads : int, optional
+        The maximum number of partitions written at once.
+    time_field : str, optional
+        The name of the int field holding the time of a row.
+    """
+
+
+cdef class _MemBack(_FullBackend):
+
+    def __cinit__(self, _FullBackend export_to=None):
+        """In-memory backend C++ constructor"""
+        cdef cpp_cyclus.RecBackend* cpp_export_to = NULL
+        self._export_to = export_to  # keep the export backend alive
+        if export_to is not None:
+            cpp_export_to = <cpp_cyclus.RecBackend*> (
+                <cpp_cyclus.FullBackend*> export_to.ptx)
+        self.ptx = new cpp_cyclus.MemBack(cpp_export_to)
+
+    def __dealloc__(self):
+        """In-memory backend C++ destructor."""
+        if self.ptx == NULL:
+            return
+        cdef cpp_cyclus.MemBack * cpp_ptx = <cpp_cyclus.MemBack *> self.ptx
+        del cpp_ptx
+        self.ptx = NULL
+
+    def flush(self):
+        """Does nothing, data are stored as they are received."""
+        (<cpp_cyclus.MemBack*> self.ptx).Flush()
+
+    def close(self):
+        """Closes the backend, exporting its data if an export backend was
+        given.
+        """
+        (<cpp_cyclus.MemBack*> self.ptx).Close()
+
+    def export(self, _FullBackend back):
+        """Records all data held in memory to another backend."""
+        (<cpp_cyclus.MemBack*> self.ptx).Export(
+            <cpp_cyclus.RecBackend*> (<cpp_cyclus.FullBackend*> back.ptx))
+
+    def nrows(self, table):
+        """The number of rows held for a table."""
+        return (<cpp_cyclus.MemBack*> self.ptx).nrows(str_py_to_cpp(table))
+
+    @property
+    def name(self):
+        """The name of the backend."""
+        name = (<cpp_cyclus.MemBack*> self.ptx).Name()
+        name = name.decode()
+        return name
+
+
+class MemBack(_MemBack, FullBackend):
+    """Keeps all recorded data in memory by column and queries it directly.
+
+    Parameters
+    ----------
+    export_to : FullBackend, optional
+        A backend to which all data are exported when this one is closed.
+    """
+
+
+cdef class _CachingBackend(_FullBackend):
+
+    def __cinit__(self, _FullBackend back, size_t max_bytes=64 * 2**20):
+        """Caching backend C++ constructor"""
+        self._back = back  # keep the wrapped backend alive
+        self.ptx = new cpp_cyclus.CachingBackend(
+            <cpp_cyclus.QueryableBackend*> (<cpp_cyclus.FullBackend*> back.ptx),
+            max_bytes)
+
+    def __dealloc__(self):
+        """Caching backend C++ destructor."""
+        if self.ptx == NULL:
+            return
+        cdef cpp_cyclus.CachingBackend * cpp_ptx = <cpp_cyclus.CachingBackend *> self.ptx
+        del cpp_ptx
+        self.ptx = NULL
+
+    def invalidate(self, table):
+        """Drops the cached results of queries on a table."""
+        (<cpp_cyclus.CachingBackend*> self.ptx).Invalidate(str_py_to_cpp(table))
+
+    def clear(self):
+        """Drops all cached results."""
+        (<cpp_cyclus.CachingBackend*> self.ptx).Clear()
+
+    @property
+    def nbytes(self):
+        """The estimated size in bytes of the cached results."""
+        return (<cpp_cyclus.CachingBackend*> self.ptx).bytes()
+
+    @property
+    def hits(self):
+        """The number of queries answered from the cache."""
+        return (<cpp_cyclus.CachingBackend*> self.ptx).hits()
+
+    @property
+    def misses(self):
+        """The number of queries passed on to the wrapped backend."""
+        return (<cpp_cyclus.CachingBackend*> self.ptx).misses()
+
+
+class CachingBackend(_CachingBackend, FullBackend):
+    """Memoizes the query results of another backend, dropping the results of
+    a table when it receives new data.
+
+    Parameters
+    ----------
+    back : FullBackend
+        The backend to wrap.
+    max_bytes : int, optional
+        The cap on the estimated size of the cached results.
+    """
+
+
+cdef class _ResLineage:
+
+    def __cinit__(self, _FullBackend back, int batch_size=100000, simid=None):
+        """Builds the lineage indexes by streaming the backend's tables."""
+        cdef cpp_cyclus.QueryableBackend* b = \
+            <cpp_cyclus.QueryableBackend*> (<cpp_cyclus.FullBackend*> back.ptx)
+        if simid is None:
+            self.ptx = new cpp_cyclus.ResLineage(b, batch_size)
+        else:
+            self.ptx = new cpp_cyclus.ResLineage(b, uuid_py_to_cpp(simid),
+                                                 batch_size)
+
+    def __dealloc__(self):
+        if self.ptx != NULL:
+            del self.ptx
+            self.ptx = NULL
+
+    def __len__(self):
+        return self.ptx.size()
+
+    def __contains__(self, int resid):
+        return self.ptx.Has(resid)
+
+    def quantity(self, int resid):
+        """Returns the quantity of a resource state."""
+        return self.ptx.Quantity(resid)
+
+    def qual_id(self, int resid):
+        """Returns the quality id of a resource state."""
+        return self.ptx.QualId(resid)
+
+    def is_material(self, int resid):
+        """Returns whether a resource state is a material."""
+        return self.ptx.IsMaterial(resid)
+
+    def time_created(self, int resid):
+        """Returns the time step in which a resource state was created."""
+        return self.ptx.TimeCreated(resid)
+
+    def parents(self, int resid):
+        """Returns the ids of the direct parents of a resource state."""
+        return list(self.ptx.Parents(resid))
+
+    def children(self, int resid):
+        """Returns the ids of the states directly created from a resource."""
+        return list(self.ptx.Children(resid))
+
+    def ancestors(self, int resid):
+        """Returns the sorted ids of all states a resource was derived from."""
+        return list(self.ptx.Ancestors(resid))
+
+    def descendants(self, int resid):
+        """Returns the sorted ids of all states derived from a resource."""
+        return list(self.ptx.Descendants(resid))
+
+    def mass_fracs(self, int qualid):
+        """Returns a dict of the normalized mass fraction of each nuclide in a
+        composition.
+        """
+        return dict(self.ptx.MassFracs(qualid))
+
+    def flow(self, int sender=-1, int receiver=-1, int t0=0, int t1=2**31 - 1):
+        """Returns a dict of the mass of each nuclide moved from sender to
+        receiver in transactions with t0 <= Time <= t1. A sender or receiver
+        of -1 matches any agent.
+        """
+        return dict(self.ptx.Flow(sender, receiver, t0, t1))
+
+
+class ResLineage(_ResLineage, object):
+    """Resource lineage and material flow queries over the Resources,
+    Transactions and Compositions tables of a database, answered from
+    in-memory indexes.
+
+    Parameters
+    ----------
+    back : FullBackend
+        The database to index.
+    batch_size : int, optional
+        The maximum number of rows read into memory at once while indexing.
+    simid : uuid.UUID, optional
+        The simulation whose rows are indexed.  Without it all rows are read,
+        so the database must hold a single simulation.
+    """
+
+
 cdef class _Recorder:
 
     def __cinit__(self, bint inject_sim_id=True):
@@ -413,6 +920,10 @@ cdef class _Recorder:
         elif isinstance(backend, SqliteBack):
             b = <cpp_cyclus.RecBackend*> (
                 <cpp_cyclus.SqliteBack*> (<_SqliteBack> backend).ptx)
+        elif isinstance(backend, (ColLogBack, PartitionBack, MemBack,
+                                  CachingBackend)):
+            b = <cpp_cyclus.RecBackend*> (
+                <cpp_cyclus.FullBackend*> (<_FullBackend> backend).ptx)
         elif isinstance(backend, FullBackend):
             b = <cpp_cyclus.RecBackend*> ((<_FullBackend> backend).ptx)
         else:
@@ -805,6 +1316,18 @@ def py_init_hooks():
     """
     cpp_cyclus.PyInitHooks()
 
+
+def set_py_event_consumers(bint consumers):
+    """Sets whether anything consumes the events of the Python event loop,
+    which the simulation skips while nothing does.
+    """
+    cpp_cyclus.PY_EVENT_CONSUMERS = consumers
+
+
+def py_event_consumers():
+    """Returns whether the simulation enters the Python event loop."""
+    return cpp_cyclus.PY_EVENT_CONSUMERS
+
 #
 # XML
 #
@@ -1615,13 +2138,15 @@ cdef class _Context:
         c = ts.composition_from_cpp(self.ptx.GetRecipe(str_py_to_cpp(name)), basis)
         return c
 
-    def schedule_build(self, parent, proto_name, int t=-1):
+    def schedule_build(self, parent, proto_name, int t=-1, int count=1):
         """Schedules the named prototype to be built for the specified parent at
         timestep t. The default t=-1 results in the build being scheduled for the
-        next build phase (i.e. the start of the next timestep).
+        next build phase (i.e. the start of the next timestep). If count is
+        greater than one, that many agents are built together and recorded as
+        a single build schedule.
         """
         self.ptx.SchedBuild(dynamic_agent_ptr(parent),
-                            str_py_to_cpp(proto_name), t)
+                            str_py_to_cpp(proto_name), t, count)
 
     def schedule_decom(self, parent, int t=-1):
         """Schedules the given Agent to be decommissioned at the specified timestep
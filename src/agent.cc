@@ -45,7 +45,8 @@ void Agent::InfileToDb(InfileTree* qe, DbInit di) {
 void Agent::InitFrom(QueryableBackend* b) {
   QueryResult qr = b->Query("Agent", NULL);
   prototype_ = qr.GetVal<std::string>("Prototype");
-  id_ = qr.GetVal<int>("AgentId");
+  // id_ is not read back: the agent was registered in the context under it
+  // when it was constructed
   lifetime_ = qr.GetVal<int>("Lifetime");
 }
 
@@ -65,13 +66,13 @@ Agent::Agent(Context* ctx)
       lifetime_(-1),
       parent_(NULL),
       spec_("UNSPECIFIED") {
-  ctx_->agent_list_.insert(this);
+  ctx_->agent_list_.Insert(id_, this);
   MLOG(LEV_DEBUG3) << "Agent ID=" << id_ << ", ptr=" << this << " created.";
 }
 
 Agent::~Agent() {
   MLOG(LEV_DEBUG3) << "Deleting agent '" << prototype() << "' ID=" << id_;
-  context()->agent_list_.erase(this);
+  context()->agent_list_.Erase(id_, this);
 
   std::set<Agent*>::iterator it;
   if (parent_ != NULL) {
@@ -0,0 +1,295 @@
+#include "caching_back.h"
+
+#include <typeinfo>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+/// Appends the type and bytes of a condition value to key.  Returns false if
+/// the value has no exact byte representation here.
+bool AppendVal(const boost::spirit::hold_any& v, std::string* key) {
+  using boost::uuids::uuid;
+  const std::type_info& t = v.type();
+  std::string bytes;
+#define CYCLUS_CACHE_KEY_POD(T)                                         \
+  if (t == typeid(T)) {                                                 \
+    const T& x = v.cast<T>();                                           \
+    bytes = std::string(reinterpret_cast<const char*>(&x), sizeof(T));  \
+  } else
+  CYCLUS_CACHE_KEY_POD(int)
+  CYCLUS_CACHE_KEY_POD(bool)
+  CYCLUS_CACHE_KEY_POD(float)
+  CYCLUS_CACHE_KEY_POD(double)
+  CYCLUS_CACHE_KEY_POD(uuid)
+#undef CYCLUS_CACHE_KEY_POD
+  if (t == typeid(std::string)) {
+    bytes = v.cast<std::string>();
+  } else if (t == typeid(Blob)) {
+    bytes = v.cast<Blob>().str();
+  } else {
+    return false;
+  }
+  size_t len = bytes.size();
+  *key += std::string(t.name()) + '\0';
+  key->append(reinterpret_cast<const char*>(&len), sizeof(len));
+  *key += bytes;
+  return true;
+}
+
+/// Builds the cache key of a query, which starts with table + '\0' so that
+/// all keys of a table are adjacent.  Columnar queries are marked so that
+/// they are cached apart from row-wise ones.  Returns false if a condition
+/// value has no exact byte representation here.
+bool Key(const std::string& table, bool columnar,
+         const std::vector<std::string>* cols, std::vector<Cond>* conds,
+         std::string* key) {
+  *key = table + '\0';
+  if (columnar)
+    *key += '\4';
+  if (cols != NULL)
+    *key += '\3';
+  for (int i = 0; cols != NULL && i < cols->size(); ++i)
+    *key += '\2' + (*cols)[i] + '\0';
+  if (conds == NULL)
+    return true;
+  for (int i = 0; i < conds->size(); ++i) {
+    const Cond& c = (*conds)[i];
+    *key += '\1' + c.field + '\0' + c.op + '\0';
+    std::vector<boost::spirit::hold_any> vals;
+    try {
+      vals = CondOperands(c);
+    } catch (ValueError err) {
+      return false;
+    }
+    for (int k = 0; k < vals.size(); ++k) {
+      if (!AppendVal(vals[k], key))
+        return false;
+    }
+  }
+  return true;
+}
+
+/// Estimates the memory held by a row-wise result.
+size_t ResultBytes(const QueryResult& qr) {
+  size_t n = sizeof(QueryResult);
+  int ncols = qr.fields.size();
+  for (int j = 0; j < ncols; ++j)
+    n += qr.fields[j].size() + sizeof(std::string) + sizeof(DbTypes);
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    n += sizeof(QueryRow) + ncols * (sizeof(boost::spirit::hold_any) + 16);
+    for (int j = 0; j < ncols; ++j) {
+      if (qr.types[j] == STRING || qr.types[j] == VL_STRING)
+        n += qr.rows[i][j].cast<std::string>().size();
+      else if (qr.types[j] == BLOB)
+        n += qr.rows[i][j].cast<Blob>().str().size();
+    }
+  }
+  return n;
+}
+
+/// Estimates the memory held by a columnar result, whose scalar columns
+/// take only the size of their values.
+size_t ColumnarBytes(ColumnarResult* cr) {
+  size_t n = sizeof(ColumnarResult);
+  size_t nrows = cr->nrows();
+  const std::vector<DbTypes>& types = cr->types();
+  for (int j = 0; j < types.size(); ++j) {
+    n += cr->fields()[j].size() + sizeof(std::string) + sizeof(DbTypes) +
+         sizeof(TypedColumn<int>);
+    switch (types[j]) {
+      case INT:
+        n += nrows * sizeof(int);
+        break;
+      case BOOL:
+        n += nrows * sizeof(bool);
+        break;
+      case FLOAT:
+        n += nrows * sizeof(float);
+        break;
+      case DOUBLE:
+        n += nrows * sizeof(double);
+        break;
+      case UUID:
+        n += nrows * sizeof(boost::uuids::uuid);
+        break;
+      case STRING:
+      case VL_STRING: {
+        const std::vector<std::string>& v = cr->Column<std::string>(j);
+        n += nrows * sizeof(std::string);
+        for (size_t i = 0; i < v.size(); ++i)
+          n += v[i].size();
+        break;
+      }
+      case BLOB: {
+        n += nrows * (sizeof(boost::spirit::hold_any) + 16);
+        for (size_t i = 0; i < nrows; ++i)
+          n += cr->Get(j, i).cast<Blob>().str().size();
+        break;
+      }
+      default:
+        n += nrows * (sizeof(boost::spirit::hold_any) + 16);
+    }
+  }
+  return n;
+}
+
+}  // namespace
+
+CachingBackend::CachingBackend(QueryableBackend* b, size_t max_bytes)
+    : b_(b),
+      max_bytes_(max_bytes),
+      bytes_(0),
+      hits_(0),
+      misses_(0) {}
+
+QueryResult CachingBackend::Query(std::string table,
+                                  std::vector<Cond>* conds) {
+  return Fetch(table, NULL, conds);
+}
+
+QueryResult CachingBackend::Query(std::string table,
+                                  const std::vector<std::string>& cols,
+                                  std::vector<Cond>* conds) {
+  return Fetch(table, &cols, conds);
+}
+
+ColumnarResult CachingBackend::QueryColumnar(std::string table,
+                                             std::vector<Cond>* conds) {
+  return FetchColumnar(table, NULL, conds);
+}
+
+ColumnarResult CachingBackend::QueryColumnar(
+    std::string table, const std::vector<std::string>& cols,
+    std::vector<Cond>* conds) {
+  return FetchColumnar(table, &cols, conds);
+}
+
+void CachingBackend::Notify(DatumList data) {
+  std::set<std::string> tables;
+  for (DatumList::iterator it = data.begin(); it != data.end(); ++it)
+    tables.insert((*it)->title());
+  for (std::set<std::string>::iterator it = tables.begin();
+       it != tables.end(); ++it)
+    Invalidate(*it);
+  RecBackend* rb = dynamic_cast<RecBackend*>(b_);
+  if (rb != NULL)
+    rb->Notify(data);
+}
+
+std::string CachingBackend::Name() {
+  RecBackend* rb = dynamic_cast<RecBackend*>(b_);
+  return rb == NULL ? "CachingBackend" : rb->Name();
+}
+
+void CachingBackend::Flush() {
+  RecBackend* rb = dynamic_cast<RecBackend*>(b_);
+  if (rb != NULL)
+    rb->Flush();
+}
+
+void CachingBackend::Close() {
+  Clear();
+  RecBackend* rb = dynamic_cast<RecBackend*>(b_);
+  if (rb != NULL)
+    rb->Close();
+}
+
+void CachingBackend::Invalidate(std::string table) {
+  std::string prefix = table + '\0';
+  std::map<std::string, Entry>::iterator it = cache_.lower_bound(prefix);
+  while (it != cache_.end() &&
+         it->first.compare(0, prefix.size(), prefix) == 0) {
+    Evict(it++);
+  }
+}
+
+void CachingBackend::Clear() {
+  cache_.clear();
+  lru_.clear();
+  bytes_ = 0;
+}
+
+QueryResult CachingBackend::Fetch(const std::string& table,
+                                  const std::vector<std::string>* cols,
+                                  std::vector<Cond>* conds) {
+  std::string key;
+  Entry* e = NULL;
+  if (Key(table, false, cols, conds, &key)) {
+    e = Find(key);
+  } else {
+    ++misses_;
+    key.clear();
+  }
+  if (e != NULL)
+    return e->qr;
+
+  QueryResult qr = cols == NULL ? b_->Query(table, conds) :
+                                  b_->Query(table, *cols, conds);
+  if (!key.empty()) {
+    e = Insert(key, ResultBytes(qr));
+    if (e != NULL)
+      e->qr = qr;
+  }
+  return qr;
+}
+
+ColumnarResult CachingBackend::FetchColumnar(
+    const std::string& table, const std::vector<std::string>* cols,
+    std::vector<Cond>* conds) {
+  std::string key;
+  Entry* e = NULL;
+  if (Key(table, true, cols, conds, &key)) {
+    e = Find(key);
+  } else {
+    ++misses_;
+    key.clear();
+  }
+  if (e != NULL)
+    return e->cr;
+
+  ColumnarResult cr = cols == NULL ? b_->QueryColumnar(table, conds) :
+                                     b_->QueryColumnar(table, *cols, conds);
+  if (!key.empty()) {
+    e = Insert(key, ColumnarBytes(&cr));
+    if (e != NULL)
+      e->cr = cr;
+  }
+  return cr;
+}
+
+CachingBackend::Entry* CachingBackend::Find(const std::string& key) {
+  std::map<std::string, Entry>::iterator it = cache_.find(key);
+  if (it == cache_.end()) {
+    ++misses_;
+    return NULL;
+  }
+  ++hits_;
+  lru_.splice(lru_.begin(), lru_, it->second.pos);
+  return &it->second;
+}
+
+CachingBackend::Entry* CachingBackend::Insert(const std::string& key,
+                                              size_t n) {
+  n += 2 * key.size();
+  if (n > max_bytes_)
+    return NULL;
+  while (bytes_ + n > max_bytes_)
+    Evict(cache_.find(lru_.back()));
+  lru_.push_front(key);
+  Entry& e = cache_[key];
+  e.bytes = n;
+  e.pos = lru_.begin();
+  bytes_ += n;
+  return &e;
+}
+
+void CachingBackend::Evict(std::map<std::string, Entry>::iterator it) {
+  bytes_ -= it->second.bytes;
+  lru_.erase(it->second.pos);
+  cache_.erase(it);
+}
+
+}  // namespace cyclus
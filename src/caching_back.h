@@ -0,0 +1,141 @@
+#ifndef CYCLUS_SRC_CACHING_BACK_H_
+#define CYCLUS_SRC_CACHING_BACK_H_
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "query_backend.h"
+
+namespace cyclus {
+
+/// Wrapper class for QueryableBackends that memoizes query results, for
+/// small tables such as Info, Prototypes or Recipes that are read many times.
+/// Results are keyed on the table, columns and conditions of the query and
+/// evicted least recently used first once their estimated size exceeds
+/// max_bytes.  Row-wise and columnar results are cached separately, each in
+/// the form it was asked for, so QueryColumnar reads the wrapped backend's
+/// columns directly on a miss.  Queries with conditions on values other than
+/// scalars, strings, blobs and uuids (or IN/BETWEEN sets and pairs of them)
+/// bypass the cache, as do cursors and aggregates.
+///
+/// A CachingBackend can be registered with a Recorder in place of the
+/// backend it wraps: Notify drops the cached results of every table it
+/// receives data for, then passes the data on if the wrapped backend is a
+/// RecBackend.
+class CachingBackend: public FullBackend {
+ public:
+  CachingBackend(QueryableBackend* b, size_t max_bytes = 64 << 20);
+
+  virtual ~CachingBackend() {}
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
+
+  virtual QueryResult Query(std::string table,
+                            const std::vector<std::string>& cols,
+                            std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       const std::vector<std::string>& cols,
+                                       std::vector<Cond>* conds);
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  std::vector<Cond>* conds) {
+    return b_->Cursor(table, conds);
+  }
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  const std::vector<std::string>& cols,
+                                  std::vector<Cond>* conds) {
+    return b_->Cursor(table, cols, conds);
+  }
+
+  virtual QueryResult Aggregate(std::string table,
+                                const std::vector<std::string>& group_by,
+                                const std::vector<Agg>& aggs,
+                                std::vector<Cond>* conds) {
+    return b_->Aggregate(table, group_by, aggs, conds);
+  }
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
+    return b_->ColumnTypes(table);
+  }
+
+  virtual std::list<ColumnInfo> Schema(std::string table) {
+    return b_->Schema(table);
+  }
+
+  virtual std::set<std::string> Tables() { return b_->Tables(); }
+
+  /// Drops the cached results of the tables in data, then passes it on.
+  virtual void Notify(DatumList data);
+
+  /// Returns the name of the wrapped backend, or "CachingBackend".
+  virtual std::string Name();
+
+  virtual void Flush();
+
+  /// Drops all cached results and closes the wrapped backend.
+  virtual void Close();
+
+  /// Drops the cached results of queries on table.
+  void Invalidate(std::string table);
+
+  /// Drops all cached results.
+  void Clear();
+
+  /// Returns the estimated size in bytes of the cached results.
+  size_t bytes() const { return bytes_; }
+
+  /// Returns the number of queries answered from the cache.
+  int hits() const { return hits_; }
+
+  /// Returns the number of queries passed on to the wrapped backend.
+  int misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    QueryResult qr;
+    ColumnarResult cr;
+    size_t bytes;
+    std::list<std::string>::iterator pos;
+  };
+
+  /// Returns the cached row-wise result of a query, querying the wrapped
+  /// backend on a miss.  A NULL cols selects all columns.
+  QueryResult Fetch(const std::string& table,
+                    const std::vector<std::string>* cols,
+                    std::vector<Cond>* conds);
+
+  /// Returns the cached columnar result of a query, like Fetch.
+  ColumnarResult FetchColumnar(const std::string& table,
+                               const std::vector<std::string>* cols,
+                               std::vector<Cond>* conds);
+
+  /// Returns the entry cached under key, counting a hit, or NULL after
+  /// counting a miss.
+  Entry* Find(const std::string& key);
+
+  /// Makes room for and returns a new entry of n bytes under key, or NULL
+  /// if it would not fit in the cache at all.
+  Entry* Insert(const std::string& key, size_t n);
+
+  void Evict(std::map<std::string, Entry>::iterator it);
+
+  QueryableBackend* b_;
+  size_t max_bytes_;
+  size_t bytes_;
+  int hits_;
+  int misses_;
+  std::map<std::string, Entry> cache_;
+  std::list<std::string> lru_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_CACHING_BACK_H_
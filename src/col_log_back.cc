@@ -0,0 +1,1098 @@
+#include "col_log_back.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <list>
+
+#include <boost/uuid/uuid.hpp>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+/// Leading file magic, which also versions the format.
+const char kMagic[] = "CYCLOG1\n";
+
+/// Trailing magic following the footer offset of a closed file.
+const char kTrailer[] = "CYCLOGIX";
+
+const size_t kMagicLen = 8;
+
+/// Marks the start of each segment, which is followed by its length.
+const uint32_t kSegMagic = 0x47455343;
+
+const size_t kSegHeader = sizeof(uint32_t) + sizeof(uint64_t);
+
+/// column block encodings
+enum Encoding { kPlain = 0, kDelta = 1, kDict = 2 };
+
+void PutVarint(std::string* b, uint64_t x) {
+  while (x >= 0x80) {
+    b->push_back(static_cast<char>(x | 0x80));
+    x >>= 7;
+  }
+  b->push_back(static_cast<char>(x));
+}
+
+template <class T>
+void PutFixed(std::string* b, const T& x) {
+  b->append(reinterpret_cast<const char*>(&x), sizeof(T));
+}
+
+template <class T>
+void PutRaw(std::string* b, const std::vector<T>& v) {
+  if (!v.empty())
+    b->append(reinterpret_cast<const char*>(&v[0]), v.size() * sizeof(T));
+}
+
+uint64_t ZigZag(int64_t x) {
+  return (static_cast<uint64_t>(x) << 1) ^ static_cast<uint64_t>(x >> 63);
+}
+
+int64_t UnZigZag(uint64_t x) {
+  return static_cast<int64_t>(x >> 1) ^ -static_cast<int64_t>(x & 1);
+}
+
+void PutStr(std::string* b, const std::string& s) {
+  PutVarint(b, s.size());
+  b->append(s);
+}
+
+/// Reads values from a byte range, throwing an IOError on overruns.
+class ByteReader {
+ public:
+  ByteReader(const char* p, size_t n) : p_(p), end_(p + n) {}
+
+  template <class T>
+  T Fixed() {
+    T x;
+    std::memcpy(&x, Skip(sizeof(T)), sizeof(T));
+    return x;
+  }
+
+  uint64_t Varint() {
+    uint64_t x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t c = static_cast<uint8_t>(*Skip(1));
+      x |= static_cast<uint64_t>(c & 0x7f) << shift;
+      if ((c & 0x80) == 0)
+        return x;
+    }
+    throw IOError("malformed integer in column log");
+  }
+
+  int Int() { return static_cast<int>(UnZigZag(Varint())); }
+
+  std::string Str() {
+    size_t n = Varint();
+    return std::string(Skip(n), n);
+  }
+
+  template <class T>
+  void Raw(size_t n, std::vector<T>* v) {
+    size_t k = v->size();
+    v->resize(k + n);
+    if (n > 0)
+      std::memcpy(&(*v)[k], Skip(n * sizeof(T)), n * sizeof(T));
+  }
+
+  /// Returns the current position and advances past n bytes.
+  const char* Skip(size_t n) {
+    if (static_cast<size_t>(end_ - p_) < n)
+      throw IOError("truncated column log data");
+    const char* p = p_;
+    p_ += n;
+    return p;
+  }
+
+  const char* pos() const { return p_; }
+
+  size_t left() const { return end_ - p_; }
+
+ private:
+  const char* p_;
+  const char* end_;
+};
+
+// Values without dedicated column storage are serialized recursively.
+// Every overload is declared before any is defined so that the templates
+// find each other.
+void Put(std::string* b, int x) { PutVarint(b, ZigZag(x)); }
+void Put(std::string* b, double x) { PutFixed(b, x); }
+void Put(std::string* b, const std::string& x) { PutStr(b, x); }
+void Put(std::string* b, const Blob& x) { PutStr(b, x.str()); }
+template <class A, class B>
+void Put(std::string* b, const std::pair<A, B>& x);
+template <class T>
+void Put(std::string* b, const std::vector<T>& x);
+template <class T>
+void Put(std::string* b, const std::set<T>& x);
+template <class T>
+void Put(std::string* b, const std::list<T>& x);
+template <class K, class V>
+void Put(std::string* b, const std::map<K, V>& x);
+
+void Get(ByteReader* r, int* x) { *x = r->Int(); }
+void Get(ByteReader* r, double* x) { *x = r->Fixed<double>(); }
+void Get(ByteReader* r, std::string* x) { *x = r->Str(); }
+void Get(ByteReader* r, Blob* x) { *x = Blob(r->Str()); }
+template <class A, class B>
+void Get(ByteReader* r, std::pair<A, B>* x);
+template <class T>
+void Get(ByteReader* r, std::vector<T>* x);
+template <class T>
+void Get(ByteReader* r, std::set<T>* x);
+template <class T>
+void Get(ByteReader* r, std::list<T>* x);
+template <class K, class V>
+void Get(ByteReader* r, std::map<K, V>* x);
+
+template <class C>
+void PutRange(std::string* b, const C& x) {
+  PutVarint(b, x.size());
+  for (typename C::const_iterator it = x.begin(); it != x.end(); ++it)
+    Put(b, *it);
+}
+
+template <class A, class B>
+void Put(std::string* b, const std::pair<A, B>& x) {
+  Put(b, x.first);
+  Put(b, x.second);
+}
+
+template <class T>
+void Put(std::string* b, const std::vector<T>& x) { PutRange(b, x); }
+
+template <class T>
+void Put(std::string* b, const std::set<T>& x) { PutRange(b, x); }
+
+template <class T>
+void Put(std::string* b, const std::list<T>& x) { PutRange(b, x); }
+
+template <class K, class V>
+void Put(std::string* b, const std::map<K, V>& x) { PutRange(b, x); }
+
+template <class A, class B>
+void Get(ByteReader* r, std::pair<A, B>* x) {
+  Get(r, &x->first);
+  Get(r, &x->second);
+}
+
+template <class T>
+void Get(ByteReader* r, std::vector<T>* x) {
+  x->resize(r->Varint());
+  for (size_t i = 0; i < x->size(); ++i)
+    Get(r, &(*x)[i]);
+}
+
+template <class T>
+void Get(ByteReader* r, std::set<T>* x) {
+  for (size_t n = r->Varint(); n > 0; --n) {
+    T v;
+    Get(r, &v);
+    x->insert(x->end(), v);
+  }
+}
+
+template <class T>
+void Get(ByteReader* r, std::list<T>* x) {
+  for (size_t n = r->Varint(); n > 0; --n) {
+    x->push_back(T());
+    Get(r, &x->back());
+  }
+}
+
+template <class K, class V>
+void Get(ByteReader* r, std::map<K, V>* x) {
+  for (size_t n = r->Varint(); n > 0; --n) {
+    std::pair<K, V> v;
+    Get(r, &v);
+    x->insert(x->end(), v);
+  }
+}
+
+/// Calls f->Run<T>() with the C++ type T of values of the given database
+/// type that are stored in columns as hold_any.
+template <class F>
+void VisitAnyType(DbTypes type, F* f) {
+  using std::list;
+  using std::map;
+  using std::pair;
+  using std::set;
+  using std::string;
+  using std::vector;
+  switch (type) {
+    case BLOB:
+      f->template Run<Blob>();
+      break;
+    case SET_INT:
+      f->template Run<set<int> >();
+      break;
+    case SET_STRING:
+      f->template Run<set<string> >();
+      break;
+    case VECTOR_INT:
+      f->template Run<vector<int> >();
+      break;
+    case VECTOR_DOUBLE:
+      f->template Run<vector<double> >();
+      break;
+    case VECTOR_STRING:
+      f->template Run<vector<string> >();
+      break;
+    case LIST_INT:
+      f->template Run<list<int> >();
+      break;
+    case LIST_STRING:
+      f->template Run<list<string> >();
+      break;
+    case LIST_PAIR_INT_INT:
+      f->template Run<list<pair<int, int> > >();
+      break;
+    case PAIR_INT_INT:
+      f->template Run<pair<int, int> >();
+      break;
+    case PAIR_DOUBLE_DOUBLE:
+      f->template Run<pair<double, double> >();
+      break;
+    case MAP_INT_INT:
+      f->template Run<map<int, int> >();
+      break;
+    case MAP_INT_DOUBLE:
+      f->template Run<map<int, double> >();
+      break;
+    case MAP_INT_STRING:
+      f->template Run<map<int, string> >();
+      break;
+    case MAP_STRING_INT:
+      f->template Run<map<string, int> >();
+      break;
+    case MAP_STRING_DOUBLE:
+      f->template Run<map<string, double> >();
+      break;
+    case MAP_STRING_STRING:
+      f->template Run<map<string, string> >();
+      break;
+    case MAP_STRING_VECTOR_DOUBLE:
+      f->template Run<map<string, vector<double> > >();
+      break;
+    case MAP_STRING_MAP_INT_DOUBLE:
+      f->template Run<map<string, map<int, double> > >();
+      break;
+    case MAP_STRING_MAP_STRING_INT:
+      f->template Run<map<string, map<string, int> > >();
+      break;
+    case MAP_INT_MAP_STRING_DOUBLE:
+      f->template Run<map<int, map<string, double> > >();
+      break;
+    case MAP_STRING_PAIR_DOUBLE_MAP_INT_DOUBLE:
+      f->template Run<map<string, pair<double, map<int, double> > > >();
+      break;
+    case MAP_STRING_PAIR_STRING_VECTOR_DOUBLE:
+      f->template Run<map<string, pair<string, vector<double> > > >();
+      break;
+    case MAP_STRING_VECTOR_PAIR_INT_PAIR_STRING_STRING:
+      f->template Run<
+          map<string, vector<pair<int, pair<string, string> > > > >();
+      break;
+    case VECTOR_PAIR_PAIR_DOUBLE_DOUBLE_MAP_STRING_DOUBLE:
+      f->template Run<
+          vector<pair<pair<double, double>, map<string, double> > > >();
+      break;
+    default:
+      throw ValueError("the column log backend does not support this type");
+  }
+}
+
+struct AnyEncoder {
+  AnyEncoder(const std::vector<boost::spirit::hold_any>& vals, std::string* b)
+      : vals(vals), b(b) {}
+
+  template <class T>
+  void Run() {
+    for (size_t i = 0; i < vals.size(); ++i)
+      Put(b, vals[i].cast<T>());
+  }
+
+  const std::vector<boost::spirit::hold_any>& vals;
+  std::string* b;
+};
+
+struct AnyDecoder {
+  AnyDecoder(ByteReader* r, size_t n, std::vector<boost::spirit::hold_any>* vals)
+      : r(r), n(n), vals(vals) {}
+
+  template <class T>
+  void Run() {
+    vals->reserve(vals->size() + n);
+    for (size_t i = 0; i < n; ++i) {
+      T x;
+      Get(r, &x);
+      vals->push_back(boost::spirit::hold_any(x));
+    }
+  }
+
+  ByteReader* r;
+  size_t n;
+  std::vector<boost::spirit::hold_any>* vals;
+};
+
+/// Writes the value range of v followed by its values, delta encoded if they
+/// never decrease.
+void EncodeInts(const std::vector<int>& v, std::string* b, int* enc) {
+  int lo = v.empty() ? 0 : *std::min_element(v.begin(), v.end());
+  int hi = v.empty() ? 0 : *std::max_element(v.begin(), v.end());
+  PutVarint(b, ZigZag(lo));
+  PutVarint(b, ZigZag(hi));
+  if (v.size() > 1 && std::is_sorted(v.begin(), v.end())) {
+    *enc = kDelta;
+    PutVarint(b, ZigZag(v[0]));
+    for (size_t i = 1; i < v.size(); ++i)
+      PutVarint(b, static_cast<int64_t>(v[i]) - v[i - 1]);
+  } else {
+    *enc = kPlain;
+    PutRaw(b, v);
+  }
+}
+
+/// Writes v as a dictionary of distinct values and one code per value if at
+/// most half of the values are distinct, or as plain strings otherwise.
+void EncodeStrings(const std::vector<std::string>& v, std::string* b,
+                   int* enc) {
+  std::map<std::string, uint64_t> dict;
+  std::vector<const std::string*> words;
+  std::vector<uint64_t> codes;
+  codes.reserve(v.size());
+  size_t limit = v.size() / 2;
+  for (size_t i = 0; i < v.size() && words.size() <= limit; ++i) {
+    std::pair<std::map<std::string, uint64_t>::iterator, bool> ins =
+        dict.insert(std::make_pair(v[i], words.size()));
+    if (ins.second)
+      words.push_back(&ins.first->first);
+    codes.push_back(ins.first->second);
+  }
+  if (words.size() <= limit) {
+    *enc = kDict;
+    PutVarint(b, words.size());
+    for (size_t k = 0; k < words.size(); ++k)
+      PutStr(b, *words[k]);
+    for (size_t i = 0; i < codes.size(); ++i)
+      PutVarint(b, codes[i]);
+  } else {
+    *enc = kPlain;
+    for (size_t i = 0; i < v.size(); ++i)
+      PutStr(b, v[i]);
+  }
+}
+
+/// Encodes a column made by NewQueryColumn(type) as one block.
+void EncodeColumn(const QueryColumn* col, DbTypes type, std::string* b,
+                  int* enc) {
+  *enc = kPlain;
+  switch (type) {
+    case INT:
+      EncodeInts(static_cast<const TypedColumn<int>*>(col)->values, b, enc);
+      break;
+    case BOOL: {
+      const std::vector<bool>& v =
+          static_cast<const TypedColumn<bool>*>(col)->values;
+      for (size_t i = 0; i < v.size(); ++i)
+        b->push_back(v[i] ? 1 : 0);
+      break;
+    }
+    case FLOAT:
+      PutRaw(b, static_cast<const TypedColumn<float>*>(col)->values);
+      break;
+    case DOUBLE:
+      PutRaw(b, static_cast<const TypedColumn<double>*>(col)->values);
+      break;
+    case STRING:
+    case VL_STRING:
+      EncodeStrings(static_cast<const TypedColumn<std::string>*>(col)->values,
+                    b, enc);
+      break;
+    case UUID:
+      PutRaw(b,
+             static_cast<const TypedColumn<boost::uuids::uuid>*>(col)->values);
+      break;
+    default: {
+      AnyEncoder e(
+          static_cast<const TypedColumn<boost::spirit::hold_any>*>(col)->values,
+          b);
+      VisitAnyType(type, &e);
+    }
+  }
+}
+
+/// Appends the n values of a block written by EncodeColumn to out, which must
+/// have been made by NewQueryColumn(type).
+void DecodeColumn(DbTypes type, int enc, const char* data, size_t nbytes,
+                  size_t n, QueryColumn* out) {
+  ByteReader r(data, nbytes);
+  switch (type) {
+    case INT: {
+      std::vector<int>& v = static_cast<TypedColumn<int>*>(out)->values;
+      if (enc == kDelta) {
+        v.reserve(v.size() + n);
+        int64_t x = 0;
+        for (size_t i = 0; i < n; ++i) {
+          x = i == 0 ? r.Int() : x + static_cast<int64_t>(r.Varint());
+          v.push_back(static_cast<int>(x));
+        }
+      } else {
+        r.Raw(n, &v);
+      }
+      break;
+    }
+    case BOOL: {
+      std::vector<bool>& v = static_cast<TypedColumn<bool>*>(out)->values;
+      const char* p = r.Skip(n);
+      v.reserve(v.size() + n);
+      for (size_t i = 0; i < n; ++i)
+        v.push_back(p[i] != 0);
+      break;
+    }
+    case FLOAT:
+      r.Raw(n, &static_cast<TypedColumn<float>*>(out)->values);
+      break;
+    case DOUBLE:
+      r.Raw(n, &static_cast<TypedColumn<double>*>(out)->values);
+      break;
+    case STRING:
+    case VL_STRING: {
+      std::vector<std::string>& v =
+          static_cast<TypedColumn<std::string>*>(out)->values;
+      v.reserve(v.size() + n);
+      if (enc == kDict) {
+        std::vector<std::string> words(r.Varint());
+        for (size_t k = 0; k < words.size(); ++k)
+          words[k] = r.Str();
+        for (size_t i = 0; i < n; ++i) {
+          uint64_t c = r.Varint();
+          if (c >= words.size())
+            throw IOError("invalid dictionary code in column log");
+          v.push_back(words[c]);
+        }
+      } else {
+        for (size_t i = 0; i < n; ++i)
+          v.push_back(r.Str());
+      }
+      break;
+    }
+    case UUID:
+      r.Raw(n, &static_cast<TypedColumn<boost::uuids::uuid>*>(out)->values);
+      break;
+    default: {
+      AnyDecoder d(
+          &r, n, &static_cast<TypedColumn<boost::spirit::hold_any>*>(out)->values);
+      VisitAnyType(type, &d);
+    }
+  }
+}
+
+/// Returns true if columns of types a and b share a storage type.
+bool SameStorage(DbTypes a, DbTypes b) {
+  return a == b || ((a == STRING || a == VL_STRING) &&
+                    (b == STRING || b == VL_STRING));
+}
+
+/// Keeps the reader of a cursor alive after its writer replaces it.
+class ReaderCursor : public QueryCursor {
+ public:
+  ReaderCursor(boost::shared_ptr<ColLogReader> r, QueryCursor::Ptr c)
+      : r_(r), c_(c) {}
+
+  virtual bool Next(QueryResult* batch, int n) { return c_->Next(batch, n); }
+
+ private:
+  boost::shared_ptr<ColLogReader> r_;
+  QueryCursor::Ptr c_;
+};
+
+}  // namespace
+
+void EncodeSegment(const std::string& table, const ColumnarResult& cr,
+                   const Datum::Shapes& shapes, std::string* b) {
+  PutStr(b, table);
+  PutVarint(b, cr.nrows());
+  PutVarint(b, cr.fields().size());
+  std::string block;
+  for (int j = 0; j < cr.fields().size(); ++j) {
+    int enc;
+    block.clear();
+    EncodeColumn(cr.column(j), cr.types()[j], &block, &enc);
+    PutStr(b, cr.fields()[j]);
+    PutVarint(b, cr.types()[j]);
+    PutVarint(b, ZigZag(shapes[j].empty() ? -1 : shapes[j][0]));
+    b->push_back(static_cast<char>(enc));
+    PutVarint(b, block.size());
+    b->append(block);
+  }
+}
+
+std::string SegmentTable(const char* data, size_t n) {
+  ByteReader r(data, n);
+  return r.Str();
+}
+
+void DecodeSegment(const char* data, size_t n, std::string* table,
+                   ColumnarResult* cr) {
+  ByteReader r(data, n);
+  *table = r.Str();
+  size_t nrows = r.Varint();
+  ColumnarResult out;
+  for (size_t ncols = r.Varint(); ncols > 0; --ncols) {
+    std::string name = r.Str();
+    DbTypes type = static_cast<DbTypes>(r.Varint());
+    r.Int();  // shape
+    int enc = static_cast<uint8_t>(*r.Skip(1));
+    size_t nbytes = r.Varint();
+    ByteReader b(r.Skip(nbytes), nbytes);
+    if (type == INT) {
+      b.Int();  // value range
+      b.Int();
+    }
+    out.AddColumn(name, type);
+    QueryColumn* col = out.column(out.fields().size() - 1);
+    DecodeColumn(type, enc, b.pos(), b.left(), nrows, col);
+  }
+  cr->swap(out);
+}
+
+ColLogReader::ColLogReader(std::string path)
+    : path_(path), fd_(-1), base_(NULL), size_(0), data_end_(0) {
+  fd_ = open(path.c_str(), O_RDONLY);
+  if (fd_ < 0)
+    throw IOError("could not open column log " + path + ": " +
+                  std::strerror(errno));
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || st.st_size < kMagicLen) {
+    close(fd_);
+    throw IOError(path + " is not a column log");
+  }
+  size_ = st.st_size;
+  void* p = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (p == MAP_FAILED) {
+    close(fd_);
+    throw IOError("could not map column log " + path + ": " +
+                  std::strerror(errno));
+  }
+  base_ = static_cast<const char*>(p);
+  if (std::memcmp(base_, kMagic, kMagicLen) != 0) {
+    munmap(const_cast<char*>(base_), size_);
+    close(fd_);
+    throw IOError(path + " is not a column log");
+  }
+  Index();
+}
+
+ColLogReader::~ColLogReader() {
+  munmap(const_cast<char*>(base_), size_);
+  close(fd_);
+}
+
+void ColLogReader::Index() {
+  size_t tail = kMagicLen + sizeof(uint64_t);
+  bool closed = size_ >= kMagicLen + tail &&
+      std::memcmp(base_ + size_ - kMagicLen, kTrailer, kMagicLen) == 0;
+  if (closed) {
+    uint64_t off;
+    std::memcpy(&off, base_ + size_ - tail, sizeof(off));
+    if (off < kMagicLen || off > size_ - tail)
+      throw IOError("corrupt footer in column log " + path_);
+    ByteReader r(base_ + off, size_ - tail - off);
+    for (size_t n = r.Varint(); n > 0; --n) {
+      Segment s;
+      s.table = r.Str();
+      s.offset = r.Varint();
+      s.nrows = r.Varint();
+      s.parsed = false;
+      tables_[s.table].push_back(segs_.size());
+      segs_.push_back(s);
+    }
+    data_end_ = off;
+    return;
+  }
+
+  // walk the length prefixes, stopping at a partially written segment
+  size_t off = kMagicLen;
+  while (size_ - off >= kSegHeader) {
+    uint32_t magic;
+    uint64_t len;
+    std::memcpy(&magic, base_ + off, sizeof(magic));
+    std::memcpy(&len, base_ + off + sizeof(magic), sizeof(len));
+    if (magic != kSegMagic || len > size_ - off - kSegHeader)
+      break;
+    ByteReader r(base_ + off + kSegHeader, len);
+    Segment s;
+    s.table = r.Str();
+    s.nrows = r.Varint();
+    s.offset = off;
+    s.parsed = false;
+    tables_[s.table].push_back(segs_.size());
+    segs_.push_back(s);
+    off += kSegHeader + len;
+  }
+  data_end_ = off;
+}
+
+ColLogReader::Segment& ColLogReader::Seg(int i) {
+  Segment& s = segs_[i];
+  if (s.parsed)
+    return s;
+  uint32_t magic = 0;
+  uint64_t len = 0;
+  if (s.offset + kSegHeader <= data_end_) {
+    std::memcpy(&magic, base_ + s.offset, sizeof(magic));
+    std::memcpy(&len, base_ + s.offset + sizeof(magic), sizeof(len));
+  }
+  if (magic != kSegMagic || len > data_end_ - s.offset - kSegHeader)
+    throw IOError("corrupt segment in column log " + path_);
+  ByteReader r(base_ + s.offset + kSegHeader, len);
+  r.Str();  // table and row count, already indexed
+  r.Varint();
+  for (size_t ncols = r.Varint(); ncols > 0; --ncols) {
+    Column c;
+    c.name = r.Str();
+    c.type = static_cast<DbTypes>(r.Varint());
+    c.shape = r.Int();
+    c.enc = static_cast<uint8_t>(*r.Skip(1));
+    c.nbytes = r.Varint();
+    c.data = r.Skip(c.nbytes);
+    c.min = 0;
+    c.max = 0;
+    if (c.type == INT) {
+      ByteReader b(c.data, c.nbytes);
+      c.min = b.Int();
+      c.max = b.Int();
+      c.data = b.pos();
+      c.nbytes = b.left();
+    }
+    s.cols.push_back(c);
+  }
+  s.parsed = true;
+  return s;
+}
+
+const std::vector<int>& ColLogReader::TableSegs(const std::string& table) {
+  std::map<std::string, std::vector<int> >::iterator it = tables_.find(table);
+  if (it == tables_.end())
+    throw KeyError("no table named " + table + " in column log " + path_);
+  return it->second;
+}
+
+const ColLogReader::Column& ColLogReader::Col(const Segment& s,
+                                              const std::string& field) {
+  for (int j = 0; j < s.cols.size(); ++j) {
+    if (s.cols[j].name == field)
+      return s.cols[j];
+  }
+  throw KeyError("no field named " + field + " in table " + s.table);
+}
+
+bool ColLogReader::MayMatch(const Segment& s, std::vector<Cond>* conds) {
+  if (conds == NULL)
+    return true;
+  for (int k = 0; k < conds->size(); ++k) {
+    const Cond& c = (*conds)[k];
+    const Column& col = Col(s, c.field);
+    if (col.type != INT)
+      continue;
+    if (!RangeMayMatch(col.min, col.max, c))
+      return false;
+  }
+  return true;
+}
+
+void ColLogReader::Scan(int i, const std::vector<std::string>& cols,
+                        std::vector<Cond>* conds, ColumnarResult* out) {
+  typedef std::map<std::string, boost::shared_ptr<QueryColumn> > ColMap;
+  const Segment& s = Seg(i);
+  if (!MayMatch(s, conds))
+    return;
+
+  // decode the condition columns first, they are reused for projection
+  ColMap decoded;
+  std::vector<size_t> rows;
+  bool all = conds == NULL || conds->empty();
+  if (!all) {
+    rows.resize(s.nrows);
+    for (size_t r = 0; r < rows.size(); ++r)
+      rows[r] = r;
+    for (int k = 0; k < conds->size() && !rows.empty(); ++k) {
+      Cond* c = &(*conds)[k];
+      const Column& col = Col(s, c->field);
+      boost::shared_ptr<QueryColumn>& d = decoded[c->field];
+      if (d.get() == NULL) {
+        d.reset(NewQueryColumn(col.type));
+        DecodeColumn(col.type, col.enc, col.data, col.nbytes, s.nrows, d.get());
+      }
+      FilterRows(d.get(), col.type, c, &rows);
+    }
+    if (rows.empty())
+      return;
+    all = rows.size() == s.nrows;
+  }
+
+  for (int j = 0; j < cols.size(); ++j) {
+    const Column& col = Col(s, cols[j]);
+    if (!SameStorage(col.type, out->types()[j])) {
+      throw IOError("field " + cols[j] + " of table " + s.table +
+                    " changes type between segments");
+    }
+    QueryColumn* dst = out->column(j);
+    ColMap::iterator it = decoded.find(cols[j]);
+    if (it == decoded.end() && all) {
+      DecodeColumn(col.type, col.enc, col.data, col.nbytes, s.nrows, dst);
+      continue;
+    }
+    boost::shared_ptr<QueryColumn> d;
+    if (it != decoded.end()) {
+      d = it->second;
+    } else {
+      d.reset(NewQueryColumn(col.type));
+      DecodeColumn(col.type, col.enc, col.data, col.nbytes, s.nrows, d.get());
+    }
+    if (all) {
+      dst->Extend(*d);
+    } else {
+      boost::shared_ptr<QueryColumn> taken(d->Take(rows));
+      dst->Extend(*taken);
+    }
+  }
+}
+
+ColumnarResult ColLogReader::Empty(const std::string& table,
+                                   const std::vector<std::string>& cols) {
+  const Segment& s = Seg(TableSegs(table)[0]);
+  ColumnarResult cr;
+  for (int j = 0; j < cols.size(); ++j)
+    cr.AddColumn(cols[j], Col(s, cols[j]).type);
+  return cr;
+}
+
+std::vector<std::string> ColLogReader::Unique(
+    const std::string& table, const std::vector<std::string>* cols) {
+  std::vector<std::string> rtn;
+  if (cols == NULL) {
+    const Segment& s = Seg(TableSegs(table)[0]);
+    for (int j = 0; j < s.cols.size(); ++j)
+      rtn.push_back(s.cols[j].name);
+    return rtn;
+  }
+  if (cols->empty())
+    throw ValueError("column projection requires at least one column");
+  for (int k = 0; k < cols->size(); ++k) {
+    if (std::find(rtn.begin(), rtn.end(), (*cols)[k]) == rtn.end())
+      rtn.push_back((*cols)[k]);
+  }
+  return rtn;
+}
+
+void ColLogReader::Rows(const ColumnarResult& cr,
+                        const std::vector<std::string>& cols, size_t begin,
+                        size_t end, QueryResult* qr) {
+  std::vector<int> idx(cols.size());
+  qr->fields = cols;
+  qr->types.clear();
+  for (int k = 0; k < cols.size(); ++k) {
+    idx[k] = cr.FieldIndex(cols[k]);
+    qr->types.push_back(cr.types()[idx[k]]);
+  }
+  qr->rows.clear();
+  qr->rows.resize(end - begin, QueryRow(cols.size()));
+  for (size_t i = begin; i < end; ++i) {
+    QueryRow& row = qr->rows[i - begin];
+    for (int k = 0; k < idx.size(); ++k)
+      row[k] = cr.Get(idx[k], i);
+  }
+}
+
+QueryResult ColLogReader::Query(std::string table, std::vector<Cond>* conds) {
+  std::vector<std::string> cols = Unique(table, NULL);
+  ColumnarResult cr = QueryColumnar(table, cols, conds);
+  QueryResult qr;
+  Rows(cr, cols, 0, cr.nrows(), &qr);
+  return qr;
+}
+
+QueryResult ColLogReader::Query(std::string table,
+                                const std::vector<std::string>& cols,
+                                std::vector<Cond>* conds) {
+  ColumnarResult cr = QueryColumnar(table, Unique(table, &cols), conds);
+  QueryResult qr;
+  Rows(cr, cols, 0, cr.nrows(), &qr);
+  return qr;
+}
+
+QueryCursor::Ptr ColLogReader::Cursor(std::string table,
+                                      std::vector<Cond>* conds) {
+  return QueryCursor::Ptr(
+      new SegCursor(this, table, Unique(table, NULL), conds));
+}
+
+QueryCursor::Ptr ColLogReader::Cursor(std::string table,
+                                      const std::vector<std::string>& cols,
+                                      std::vector<Cond>* conds) {
+  return QueryCursor::Ptr(new SegCursor(this, table, cols, conds));
+}
+
+ColumnarResult ColLogReader::QueryColumnar(std::string table,
+                                           std::vector<Cond>* conds) {
+  return QueryColumnar(table, Unique(table, NULL), conds);
+}
+
+ColumnarResult ColLogReader::QueryColumnar(
+    std::string table, const std::vector<std::string>& cols,
+    std::vector<Cond>* conds) {
+  const std::vector<int>& segs = TableSegs(table);
+  ColumnarResult cr = Empty(table, cols);
+  for (int k = 0; k < segs.size(); ++k)
+    Scan(segs[k], cols, conds, &cr);
+  return cr;
+}
+
+std::map<std::string, DbTypes> ColLogReader::ColumnTypes(std::string table) {
+  const Segment& s = Seg(TableSegs(table)[0]);
+  std::map<std::string, DbTypes> rtn;
+  for (int j = 0; j < s.cols.size(); ++j)
+    rtn[s.cols[j].name] = s.cols[j].type;
+  return rtn;
+}
+
+std::list<ColumnInfo> ColLogReader::Schema(std::string table) {
+  const Segment& s = Seg(TableSegs(table)[0]);
+  std::list<ColumnInfo> rtn;
+  for (int j = 0; j < s.cols.size(); ++j) {
+    rtn.push_back(ColumnInfo(table, s.cols[j].name, j, s.cols[j].type,
+                             std::vector<int>(1, s.cols[j].shape)));
+  }
+  return rtn;
+}
+
+std::set<std::string> ColLogReader::Tables() {
+  std::set<std::string> rtn;
+  std::map<std::string, std::vector<int> >::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it)
+    rtn.insert(it->first);
+  return rtn;
+}
+
+ColLogReader::SegCursor::SegCursor(ColLogReader* r, const std::string& table,
+                                   const std::vector<std::string>& cols,
+                                   std::vector<Cond>* conds)
+    : r_(r),
+      table_(table),
+      segs_(r->TableSegs(table)),
+      next_(0),
+      cols_(cols),
+      unique_(r->Unique(table, &cols)),
+      has_conds_(conds != NULL),
+      pos_(0) {
+  if (conds != NULL)
+    conds_ = *conds;
+  buf_ = r_->Empty(table_, unique_);
+}
+
+bool ColLogReader::SegCursor::Next(QueryResult* batch, int n) {
+  if (n < 1)
+    throw ValueError("query cursor batch size must be positive");
+  while (pos_ >= buf_.nrows() && next_ < segs_.size()) {
+    buf_ = r_->Empty(table_, unique_);
+    r_->Scan(segs_[next_++], unique_, has_conds_ ? &conds_ : NULL, &buf_);
+    pos_ = 0;
+  }
+  size_t end = std::min(buf_.nrows(), pos_ + n);
+  Rows(buf_, cols_, std::min(pos_, end), end, batch);
+  pos_ = end;
+  return !batch->rows.empty();
+}
+
+ColLogBack::ColLogBack(std::string path, int seg_rows)
+    : path_(path), seg_rows_(seg_rows), fd_(-1), size_(0), reader_size_(0) {
+  if (seg_rows < 1)
+    throw ValueError("column log segments must hold at least one row");
+  Open();
+}
+
+ColLogBack::~ColLogBack() { Close(); }
+
+void ColLogBack::Open() {
+  index_.clear();
+  size_t end = 0;
+  struct stat st;
+  if (stat(path_.c_str(), &st) == 0 && st.st_size > 0) {
+    ColLogReader r(path_);
+    for (int i = 0; i < r.segs_.size(); ++i) {
+      IndexEntry e = {r.segs_[i].table, r.segs_[i].offset, r.segs_[i].nrows};
+      index_.push_back(e);
+    }
+    end = r.data_end();
+  }
+  fd_ = open(path_.c_str(), O_WRONLY | O_CREAT, 0644);
+  if (fd_ < 0 || ftruncate(fd_, end) != 0 ||
+      lseek(fd_, end, SEEK_SET) != end) {
+    throw IOError("could not open column log " + path_ + ": " +
+                  std::strerror(errno));
+  }
+  size_ = end;
+  if (end == 0)
+    Write(std::string(kMagic, kMagicLen));
+}
+
+void ColLogBack::Notify(DatumList data) {
+  if (fd_ < 0)
+    Open();
+  for (DatumList::iterator it = data.begin(); it != data.end(); ++it) {
+    Datum* d = *it;
+    const Datum::Vals& vals = d->vals();
+    Pending& p = pending_[d->title()];
+    ColumnarResult& cr = p.data;
+    if (cr.fields().empty()) {
+      p.shapes = d->shapes();
+      for (int j = 0; j < vals.size(); ++j)
+        cr.AddColumn(vals[j].first, DbTypeOf(vals[j].second, p.shapes[j]));
+    }
+    const std::vector<std::string>& fields = cr.fields();
+    if (vals.size() != fields.size()) {
+      throw ValueError("datum for table " + d->title() + " does not have the"
+                       " fields of the first datum recorded to it");
+    }
+    for (int j = 0; j < vals.size(); ++j) {
+      int k = j;
+      if (std::strcmp(vals[j].first, fields[j].c_str()) != 0)
+        k = cr.FieldIndex(vals[j].first);
+      cr.column(k)->Append(vals[j].second);
+    }
+    if (cr.nrows() >= seg_rows_)
+      WriteSegment(d->title(), &p);
+  }
+}
+
+void ColLogBack::WriteSegment(const std::string& table, Pending* p) {
+  ColumnarResult& cr = p->data;
+  size_t n = cr.nrows();
+  if (n == 0)
+    return;
+
+  // the length prefix is filled in once the body is encoded
+  std::string seg(kSegHeader, '\0');
+  std::memcpy(&seg[0], &kSegMagic, sizeof(kSegMagic));
+  EncodeSegment(table, cr, p->shapes, &seg);
+  uint64_t len = seg.size() - kSegHeader;
+  std::memcpy(&seg[sizeof(kSegMagic)], &len, sizeof(len));
+
+  IndexEntry e = {table, size_, n};
+  Write(seg);
+  index_.push_back(e);
+
+  ColumnarResult empty;
+  for (int j = 0; j < cr.fields().size(); ++j)
+    empty.AddColumn(cr.fields()[j], cr.types()[j]);
+  cr.swap(empty);
+}
+
+void ColLogBack::Write(const std::string& buf) {
+  const char* p = buf.data();
+  size_t left = buf.size();
+  while (left > 0) {
+    ssize_t n = write(fd_, p, left);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0) {
+      throw IOError("could not write column log " + path_ + ": " +
+                    std::strerror(errno));
+    }
+    p += n;
+    left -= n;
+  }
+  size_ += buf.size();
+}
+
+void ColLogBack::Flush() {
+  std::map<std::string, Pending>::iterator it;
+  for (it = pending_.begin(); it != pending_.end(); ++it)
+    WriteSegment(it->first, &it->second);
+}
+
+void ColLogBack::Close() {
+  if (fd_ < 0)
+    return;
+  Flush();
+  std::string footer;
+  PutVarint(&footer, index_.size());
+  for (int i = 0; i < index_.size(); ++i) {
+    PutStr(&footer, index_[i].table);
+    PutVarint(&footer, index_[i].offset);
+    PutVarint(&footer, index_[i].nrows);
+  }
+  PutFixed<uint64_t>(&footer, size_);
+  footer.append(kTrailer, kMagicLen);
+  Write(footer);
+  close(fd_);
+  fd_ = -1;
+}
+
+boost::shared_ptr<ColLogReader> ColLogBack::Reader() {
+  Flush();
+  if (reader_.get() == NULL || reader_size_ != size_) {
+    reader_.reset(new ColLogReader(path_));
+    reader_size_ = size_;
+  }
+  return reader_;
+}
+
+QueryResult ColLogBack::Query(std::string table, std::vector<Cond>* conds) {
+  return Reader()->Query(table, conds);
+}
+
+QueryResult ColLogBack::Query(std::string table,
+                              const std::vector<std::string>& cols,
+                              std::vector<Cond>* conds) {
+  return Reader()->Query(table, cols, conds);
+}
+
+QueryCursor::Ptr ColLogBack::Cursor(std::string table,
+                                    std::vector<Cond>* conds) {
+  boost::shared_ptr<ColLogReader> r = Reader();
+  return QueryCursor::Ptr(new ReaderCursor(r, r->Cursor(table, conds)));
+}
+
+QueryCursor::Ptr ColLogBack::Cursor(std::string table,
+                                    const std::vector<std::string>& cols,
+                                    std::vector<Cond>* conds) {
+  boost::shared_ptr<ColLogReader> r = Reader();
+  return QueryCursor::Ptr(new ReaderCursor(r, r->Cursor(table, cols, conds)));
+}
+
+ColumnarResult ColLogBack::QueryColumnar(std::string table,
+                                         std::vector<Cond>* conds) {
+  return Reader()->QueryColumnar(table, conds);
+}
+
+ColumnarResult ColLogBack::QueryColumnar(std::string table,
+                                         const std::vector<std::string>& cols,
+                                         std::vector<Cond>* conds) {
+  return Reader()->QueryColumnar(table, cols, conds);
+}
+
+std::map<std::string, DbTypes> ColLogBack::ColumnTypes(std::string table) {
+  return Reader()->ColumnTypes(table);
+}
+
+std::list<ColumnInfo> ColLogBack::Schema(std::string table) {
+  return Reader()->Schema(table);
+}
+
+std::set<std::string> ColLogBack::Tables() { return Reader()->Tables(); }
+
+}  // namespace cyclus
@@ -0,0 +1,271 @@
+#ifndef CYCLUS_SRC_COL_LOG_BACK_H_
+#define CYCLUS_SRC_COL_LOG_BACK_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "query_backend.h"
+
+namespace cyclus {
+
+/// Appends the rows of a table to b in the segment format of column logs:
+/// the table name and row count followed by one encoded block per column.
+/// Columns must be stored as NewQueryColumn makes them; shapes holds the
+/// shape of each column.
+void EncodeSegment(const std::string& table, const ColumnarResult& cr,
+                   const Datum::Shapes& shapes, std::string* b);
+
+/// Returns the table name of the n byte segment at data without decoding
+/// its columns.  Throws an IOError if the data is truncated.
+std::string SegmentTable(const char* data, size_t n);
+
+/// Decodes a segment written by EncodeSegment, replacing the contents of cr.
+/// Throws an IOError if the data is malformed.
+void DecodeSegment(const char* data, size_t n, std::string* table,
+                   ColumnarResult* cr);
+
+/// A read-only view of a column log file written by ColLogBack.  The file is
+/// memory mapped and only the column blocks a query needs are decoded, one
+/// segment at a time: the columns named in conditions first, then the
+/// projected columns of the segments with matching rows.  Segments whose
+/// int column ranges cannot satisfy a condition are skipped without being
+/// decoded.
+///
+/// A file that was not closed, e.g. because its writer is still running or
+/// crashed, has no footer index; its segments are then found by walking
+/// their length prefixes, and a trailing partial segment is ignored.
+class ColLogReader: public QueryableBackend {
+ public:
+  /// Maps the file at path, throwing an IOError if it cannot be read or is
+  /// not a column log.
+  ColLogReader(std::string path);
+
+  virtual ~ColLogReader();
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
+
+  virtual QueryResult Query(std::string table,
+                            const std::vector<std::string>& cols,
+                            std::vector<Cond>* conds);
+
+  /// Decodes one segment per batch rather than the whole table.
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  std::vector<Cond>* conds);
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  const std::vector<std::string>& cols,
+                                  std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       const std::vector<std::string>& cols,
+                                       std::vector<Cond>* conds);
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
+
+  virtual std::list<ColumnInfo> Schema(std::string table);
+
+  virtual std::set<std::string> Tables();
+
+  /// Returns the number of segments in the file.
+  int nsegments() const { return segs_.size(); }
+
+  /// Returns the offset just past the last complete segment, where a writer
+  /// appending to the file continues.
+  size_t data_end() const { return data_end_; }
+
+ private:
+  /// Streams the rows of a query one decoded segment at a time.
+  class SegCursor : public QueryCursor {
+   public:
+    SegCursor(ColLogReader* r, const std::string& table,
+              const std::vector<std::string>& cols, std::vector<Cond>* conds);
+
+    virtual bool Next(QueryResult* batch, int n);
+
+   private:
+    ColLogReader* r_;
+    std::string table_;
+    std::vector<int> segs_;
+    int next_;
+    std::vector<std::string> cols_;
+    std::vector<std::string> unique_;
+    std::vector<Cond> conds_;
+    bool has_conds_;
+    ColumnarResult buf_;
+    size_t pos_;
+  };
+
+  struct Column {
+    std::string name;
+    DbTypes type;
+    int shape;
+    int enc;
+    int min;  // value range of INT columns
+    int max;
+    const char* data;
+    size_t nbytes;
+  };
+
+  struct Segment {
+    std::string table;
+    size_t offset;
+    size_t nrows;
+    bool parsed;
+    std::vector<Column> cols;
+  };
+
+  /// Reads the footer index, or walks the segments if there is none.
+  void Index();
+
+  /// Parses the column headers of segs_[i] on first use and returns it.
+  Segment& Seg(int i);
+
+  /// Returns the indices of the segments of table, throwing a KeyError if
+  /// there are none.
+  const std::vector<int>& TableSegs(const std::string& table);
+
+  /// Returns the column named field of segment s, throwing a KeyError if it
+  /// has none.
+  static const Column& Col(const Segment& s, const std::string& field);
+
+  /// Returns false if the value ranges of segment s rule out all rows.
+  static bool MayMatch(const Segment& s, std::vector<Cond>* conds);
+
+  /// Appends the rows of segs_[i] matching conds to the columns of out,
+  /// which are named as in cols.
+  void Scan(int i, const std::vector<std::string>& cols,
+            std::vector<Cond>* conds, ColumnarResult* out);
+
+  /// Returns an empty result with the given columns of table.
+  ColumnarResult Empty(const std::string& table,
+                       const std::vector<std::string>& cols);
+
+  /// Returns the names of cols with duplicates removed, or all fields of
+  /// table if cols is NULL.
+  std::vector<std::string> Unique(const std::string& table,
+                                  const std::vector<std::string>* cols);
+
+  /// Copies rows [begin, end) of the named columns of cr into qr.
+  static void Rows(const ColumnarResult& cr,
+                   const std::vector<std::string>& cols, size_t begin,
+                   size_t end, QueryResult* qr);
+
+  friend class ColLogBack;
+
+  std::string path_;
+  int fd_;
+  const char* base_;
+  size_t size_;
+  size_t data_end_;
+  std::vector<Segment> segs_;
+  std::map<std::string, std::vector<int> > tables_;
+};
+
+/// A Recorder backend that appends each table to a file as a log of
+/// columnar segments.  Rows are buffered per table and encoded, once
+/// seg_rows of them have accumulated or on Flush, into a single
+/// length-prefixed segment written with one write() call.  Within a segment
+/// each column is one block: nondecreasing int columns such as ids and
+/// times are delta encoded, string columns with many repeats are dictionary
+/// encoded and other types are stored packed.  Close appends a footer
+/// indexing the segments.  There is no per-row library overhead, which
+/// makes this well suited to runs that write far more than they read.
+///
+/// Queries flush pending rows and are answered by a ColLogReader over the
+/// file.  Opening an existing log appends to it, dropping any trailing
+/// partial segment left by a crash.  Values are stored in host byte order.
+class ColLogBack: public FullBackend {
+ public:
+  /// Opens the log at path, creating it if it does not exist.
+  /// @param path the file to write
+  /// @param seg_rows the number of rows of a table buffered per segment
+  ColLogBack(std::string path, int seg_rows = 65536);
+
+  virtual ~ColLogBack();
+
+  /// Buffers the data, writing the segments of tables whose buffers are full.
+  virtual void Notify(DatumList data);
+
+  /// Returns the path of the log.
+  virtual std::string Name() { return path_; }
+
+  /// Writes all buffered rows.
+  virtual void Flush();
+
+  /// Flushes, writes the footer index and closes the file.  Recording more
+  /// data reopens the log and appends to it.
+  virtual void Close();
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
+
+  virtual QueryResult Query(std::string table,
+                            const std::vector<std::string>& cols,
+                            std::vector<Cond>* conds);
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  std::vector<Cond>* conds);
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  const std::vector<std::string>& cols,
+                                  std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       const std::vector<std::string>& cols,
+                                       std::vector<Cond>* conds);
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
+
+  virtual std::list<ColumnInfo> Schema(std::string table);
+
+  virtual std::set<std::string> Tables();
+
+ private:
+  struct Pending {
+    ColumnarResult data;
+    Datum::Shapes shapes;
+  };
+
+  struct IndexEntry {
+    std::string table;
+    size_t offset;
+    size_t nrows;
+  };
+
+  /// Opens the file for appending, truncating any footer or partial segment
+  /// and indexing the segments already in it.
+  void Open();
+
+  /// Encodes the buffered rows of table as a segment and writes it.
+  void WriteSegment(const std::string& table, Pending* p);
+
+  /// Writes all of buf at the end of the file.
+  void Write(const std::string& buf);
+
+  /// Flushes and returns a reader that sees everything written so far.
+  /// Readers are shared with the cursors made from them, which may outlive
+  /// the next write.
+  boost::shared_ptr<ColLogReader> Reader();
+
+  std::string path_;
+  int seg_rows_;
+  int fd_;
+  size_t size_;
+  std::map<std::string, Pending> pending_;
+  std::vector<IndexEntry> index_;
+  boost::shared_ptr<ColLogReader> reader_;
+  size_t reader_size_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_COL_LOG_BACK_H_
@@ -4,12 +4,51 @@
 #include "context.h"
 #include "decayer.h"
 #include "error.h"
+#include "parallel.h"
 #include "recorder.h"
 #include "pyne_decay.h"
 
 namespace cyclus {
 
-int Composition::next_id_ = 1;
+std::atomic<int> Composition::next_id_(1);
+
+std::mutex& PyneDataLock() {
+  static std::mutex mu;
+  return mu;
+}
+
+namespace {
+
+/// Guards the decay chains, which compositions decayed from a common
+/// ancestor share.
+std::mutex& ChainLock() {
+  static std::mutex mu;
+  return mu;
+}
+
+/// Evaluates the atom or mass composition from the other.
+struct Convert {
+  const CompMap* from;
+  CompMap* to;
+  bool to_atom;
+
+  void operator()() const {
+    if (to->size() != 0)
+      return;
+    std::lock_guard<std::mutex> lock(PyneDataLock());
+    CompMap::const_iterator it;
+    for (it = from->begin(); it != from->end(); ++it) {
+      Nuc nuc = it->first;
+      if (to_atom) {
+        (*to)[nuc] = it->second / pyne::atomic_mass(nuc);
+      } else {
+        (*to)[nuc] = it->second * pyne::atomic_mass(nuc);
+      }
+    }
+  }
+};
+
+}  // namespace
 
 Composition::Ptr Composition::CreateFromAtom(CompMap v) {
   if (!compmath::ValidNucs(v))
@@ -40,41 +79,41 @@ int Composition::id() {
 }
 
 const CompMap& Composition::atom() {
-  if (atom_.size() == 0) {
-    CompMap::iterator it;
-    for (it = mass_.begin(); it != mass_.end(); ++it) {
-      Nuc nuc = it->first;
-      atom_[nuc] = it->second / pyne::atomic_mass(nuc);
-    }
-  }
+  Convert c = {&mass_, &atom_, true};
+  std::call_once(atom_once_, c);
   return atom_;
 }
 
 const CompMap& Composition::mass() {
-  if (mass_.size() == 0) {
-    CompMap::iterator it;
-    for (it = atom_.begin(); it != atom_.end(); ++it) {
-      Nuc nuc = it->first;
-      mass_[nuc] = it->second * pyne::atomic_mass(nuc);
-    }
-  }
+  Convert c = {&atom_, &mass_, false};
+  std::call_once(mass_once_, c);
   return mass_;
 }
 
 Composition::Ptr Composition::Decay(int delta, uint64_t secs_per_timestep) {
   int tot_decay = prev_decay_ + delta;
-  if (decay_line_->count(tot_decay) == 1) {
-    // decay_line_ has cached, pre-computed result of this decay
-    return (*decay_line_)[tot_decay];
+  for (int pass = 0; pass < 2; ++pass) {
+    {
+      std::lock_guard<std::mutex> lock(ChainLock());
+      Chain::iterator it = decay_line_->find(tot_decay);
+      if (it != decay_line_->end()) {
+        // decay_line_ has cached, pre-computed result of this decay
+        return it->second;
+      }
+    }
+    // an agent before this one may still add it (see TaskTurns)
+    if (pass == 0)
+      TaskTurns::Wait();
   }
 
   // Calculate a new decayed composition and insert it into the decay chain.
   // It will automagically appear in the decay chain for all other compositions
   // that are a part of this decay chain because decay_line_ is a pointer that
-  // all compositions in the chain share.
+  // all compositions in the chain share.  If another thread got there first,
+  // its result is used.
   Composition::Ptr decayed = NewDecay(delta, secs_per_timestep);
-  (*decay_line_)[tot_decay] = decayed;
-  return decayed;
+  std::lock_guard<std::mutex> lock(ChainLock());
+  return decay_line_->insert(std::make_pair(tot_decay, decayed)).first->second;
 }
 
 Composition::Ptr Composition::Decay(int delta) {
@@ -82,10 +121,10 @@ Composition::Ptr Composition::Decay(int delta) {
 }
 
 void Composition::Record(Context* ctx) {
-  if (recorded_) {
+  TaskTurns::Wait();  // the first agent to record it, as in a serial run
+  if (recorded_.exchange(true)) {
     return;
   }
-  recorded_ = true;
 
   CompMap::const_iterator it;
   CompMap cm = mass();  // force lazy evaluation now
@@ -100,8 +139,8 @@ void Composition::Record(Context* ctx) {
 }
 
 Composition::Composition() : prev_decay_(0), recorded_(false) {
-  id_ = next_id_;
-  next_id_++;
+  TaskTurns::Wait();
+  id_ = next_id_++;
   decay_line_ = ChainPtr(new Chain());
 }
 
@@ -109,8 +148,8 @@ Composition::Composition(int prev_decay, ChainPtr decay_line)
     : recorded_(false),
       prev_decay_(prev_decay),
       decay_line_(decay_line) {
-  id_ = next_id_;
-  next_id_++;
+  TaskTurns::Wait();
+  id_ = next_id_++;
 }
 
 Composition::Ptr Composition::NewDecay(int delta, uint64_t secs_per_timestep) {
@@ -125,6 +164,7 @@ Composition::Ptr Composition::NewDecay(int delta, uint64_t secs_per_timestep) {
   if (atom_.size() == 0)
     return decayed;
 
+  std::lock_guard<std::mutex> lock(PyneDataLock());
   decayed->atom_ = pyne::decayers::decay(atom_, static_cast<double>(secs_per_timestep) * delta);
   return decayed;
 }
@@ -1,7 +1,9 @@
 #ifndef CYCLUS_SRC_COMPOSITION_H_
 #define CYCLUS_SRC_COMPOSITION_H_
 
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <stdint.h>
 #include <boost/shared_ptr.hpp>
 
@@ -13,6 +15,12 @@ class Context;
 
 typedef int Nuc;
 
+/// Returns the lock to hold around calls into pyne that read nuclide data,
+/// e.g. atomic masses and decay constants, which pyne loads and caches
+/// lazily, so that agents ticking concurrently (see TimeListener) can use
+/// materials.
+std::mutex& PyneDataLock();
+
 /// a raw definition of nuclides and corresponding (dimensionless quantities).
 typedef std::map<Nuc, double> CompMap;
 
@@ -97,12 +105,18 @@ class Composition {
   /// Performs a decay calculation and creates a new decayed composition.
   Ptr NewDecay(int delta, uint64_t secs_per_timestep);
 
-  static int next_id_;
+  /// the next id, taken atomically since compositions may be created by
+  /// agents ticking concurrently
+  static std::atomic<int> next_id_;
   int id_;
-  bool recorded_;
+  std::atomic<bool> recorded_;
   CompMap atom_;
   CompMap mass_;
 
+  /// guard the lazy evaluation of atom_ and mass_ from the other
+  std::once_flag atom_once_;
+  std::once_flag mass_once_;
+
   /// the total time delta this composition has been decayed from its root ancestor.
   int prev_decay_;
 };
@@ -1,6 +1,8 @@
 #include "context.h"
 
+#include <algorithm>
 #include <vector>
+#include <boost/lexical_cast.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 
 #include "error.h"
@@ -9,10 +11,28 @@
 #include "pyhooks.h"
 #include "sim_init.h"
 #include "timer.h"
+#include "trader.h"
 #include "version.h"
 
 namespace cyclus {
 
+namespace {
+
+/// Orders traders by the id of their manager, and then by address.
+struct TraderLess {
+  bool operator()(Trader* lhs, Trader* rhs) const {
+    int left = lhs->manager() == NULL ? -1 : lhs->manager()->id();
+    int right = rhs->manager() == NULL ? -1 : rhs->manager()->id();
+    if (left != right) {
+      return left < right;
+    } else {
+      return lhs < rhs;
+    }
+  }
+};
+
+}  // namespace
+
 double cy_eps = 1e-6;
 double cy_eps_rsrc = 1e-6;
 
@@ -25,6 +45,7 @@ SimInfo::SimInfo()
       branch_time(-1),
       explicit_inventory(false),
       explicit_inventory_compact(false),
+      explicit_inventory_incremental(false),
       parent_sim(boost::uuids::nil_uuid()),
       parent_type("init") {}
 
@@ -38,6 +59,7 @@ SimInfo::SimInfo(int dur, int y0, int m0, std::string handle)
       handle(handle),
       explicit_inventory(false),
       explicit_inventory_compact(false),
+      explicit_inventory_incremental(false),
       parent_sim(boost::uuids::nil_uuid()),
       parent_type("init") {}
 
@@ -51,6 +73,7 @@ SimInfo::SimInfo(int dur, int y0, int m0, std::string handle, std::string d)
       handle(handle),
       explicit_inventory(false),
       explicit_inventory_compact(false),
+      explicit_inventory_incremental(false),
       parent_sim(boost::uuids::nil_uuid()),
       parent_type("init") {}
 
@@ -67,6 +90,7 @@ SimInfo::SimInfo(int dur, boost::uuids::uuid parent_sim,
       branch_time(branch_time),
       explicit_inventory(false),
       explicit_inventory_compact(false),
+      explicit_inventory_incremental(false),
       handle(handle) {}
 
 Context::Context(Timer* ti, Recorder* rec)
@@ -84,10 +108,10 @@ Context::~Context() {
   // initiate deletion of agents that don't have parents.
   // dealloc will propagate through hierarchy as agents delete their children
   std::vector<Agent*> to_del;
-  std::set<Agent*>::iterator it;
-  for (it = agent_list_.begin(); it != agent_list_.end(); ++it) {
-    if ((*it)->parent() == NULL) {
-      to_del.push_back(*it);
+  const std::vector<Agent*>& agents = agent_list_.items();
+  for (int i = 0; i < agents.size(); ++i) {
+    if (agents[i]->parent() == NULL) {
+      to_del.push_back(agents[i]);
     }
   }
   for (int i = 0; i < to_del.size(); ++i) {
@@ -96,7 +120,7 @@ Context::~Context() {
 }
 
 void Context::DelAgent(Agent* m) {
-  int n = agent_list_.erase(m);
+  int n = agent_list_.Erase(m->id(), m);
   if (n == 1) {
     PyDelAgent(m->id());
     delete m;
@@ -104,17 +128,50 @@ void Context::DelAgent(Agent* m) {
   }
 }
 
+void Context::RegisterTrader(Trader* e) {
+  std::vector<Trader*>::iterator it =
+      std::lower_bound(traders_.begin(), traders_.end(), e, TraderLess());
+  if (it == traders_.end() || *it != e) {
+    traders_.insert(it, e);
+  }
+}
+
+void Context::UnregisterTrader(Trader* e) {
+  std::vector<Trader*>::iterator it =
+      std::lower_bound(traders_.begin(), traders_.end(), e, TraderLess());
+  if (it == traders_.end() || *it != e) {
+    it = std::find(traders_.begin(), traders_.end(), e);  // manager changed
+  }
+  if (it != traders_.end()) {
+    traders_.erase(it);
+  }
+}
+
+Agent* Context::GetAgent(int id) {
+  Agent* a = agent_list_.Get(id);
+  if (a == NULL) {
+    throw KeyError("Invalid agent id " + boost::lexical_cast<std::string>(id));
+  }
+  return a;
+}
+
 void Context::SchedBuild(Agent* parent, std::string proto_name, int t) {
+  SchedBuild(parent, proto_name, t, 1);
+}
+
+void Context::SchedBuild(Agent* parent, std::string proto_name, int t,
+                         int count) {
   if (t == -1) {
     t = time() + 1;
   }
   int pid = (parent != NULL) ? parent->id() : -1;
-  ti_->SchedBuild(parent, proto_name, t);
+  ti_->SchedBuild(parent, proto_name, t, count);
   NewDatum("BuildSchedule")
       ->AddVal("ParentId", pid)
       ->AddVal("Prototype", proto_name)
       ->AddVal("SchedTime", time())
       ->AddVal("BuildTime", t)
+      ->AddVal("Count", count)
       ->Record();
 }
 
@@ -203,6 +260,7 @@ void Context::InitSim(SimInfo si) {
   NewDatum("InfoExplicitInv")
       ->AddVal("RecordInventory", si.explicit_inventory)
       ->AddVal("RecordInventoryCompact", si.explicit_inventory_compact)
+      ->AddVal("RecordInventoryIncremental", si.explicit_inventory_incremental)
       ->Record();
 
   // TODO: when the backends get uint64_t support, the static_cast here should
@@ -228,6 +286,10 @@ int Context::time() {
   return ti_->time();
 }
 
+PhaseTimer* Context::phase_timer() {
+  return ti_ == NULL ? NULL : ti_->phase_timer();
+}
+
 void Context::RegisterTimeListener(TimeListener* tl) {
   ti_->RegisterTimeListener(tl);
 }
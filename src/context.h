@@ -4,6 +4,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 #include <stdint.h>
 
 #ifndef CYCPP
@@ -18,6 +19,7 @@
 #include "greedy_solver.h"
 #include "pyhooks.h"
 #include "recorder.h"
+#include "slot_map.h"
 
 const uint64_t kDefaultTimeStepDur = 2629846;
 
@@ -29,6 +31,7 @@ class Datum;
 class ExchangeSolver;
 class Recorder;
 class Trader;
+class PhaseTimer;
 class Timer;
 class TimeListener;
 class SimInit;
@@ -113,6 +116,12 @@ class SimInfo {
   /// every time step in a table (i.e. agent ID, Time, Quantity,
   /// Composition-object and/or reference).
   bool explicit_inventory_compact;
+
+  /// True if explicitly recorded inventories that are unchanged since they
+  /// were last recorded get a row in the ExplicitInventoryUnchanged table
+  /// (i.e. agent ID, Time, inventory name, time last recorded) instead of
+  /// being recorded again.
+  bool explicit_inventory_incremental;
 };
 
 /// A simulation context provides access to necessary simulation-global
@@ -157,20 +166,22 @@ class Context {
 
   /// Registers an agent as a participant in resource exchanges. Agents should
   /// register from their Deploy method.
-  inline void RegisterTrader(Trader* e) {
-    traders_.insert(e);
-  }
+  void RegisterTrader(Trader* e);
 
   /// Unregisters an agent as a participant in resource exchanges.
-  inline void UnregisterTrader(Trader* e) {
-    traders_.erase(e);
-  }
+  void UnregisterTrader(Trader* e);
 
-  /// @return the current set of traders registered for resource exchange.
-  inline const std::set<Trader*>& traders() const {
+  /// @return the traders currently registered for resource exchange, ordered
+  /// by the id of their manager, which makes the order in which they trade
+  /// deterministic.
+  inline const std::vector<Trader*>& traders() const {
     return traders_;
   }
 
+  /// Returns the agent, or prototype, with the given id.  Throws a KeyError
+  /// if there is none.
+  Agent* GetAgent(int id);
+
   /// Create a new agent by cloning the named prototype. The returned agent is
   /// not initialized as a simulation participant.
   ///
@@ -193,6 +204,39 @@ class Context {
     return casted;
   }
 
+  /// Creates n agents by cloning the named prototype and appends them to
+  /// agents, like calling CreateAgent n times but looking the prototype up
+  /// only once.
+  ///
+  /// @warning this method should generally NOT be used by agents.
+  template <class T>
+  void CreateAgents(std::string proto_name, int n, std::vector<T*>* agents) {
+    std::map<std::string, Agent*>::iterator it = protos_.find(proto_name);
+    if (it == protos_.end()) {
+      throw KeyError("Invalid prototype name " + proto_name);
+    }
+
+    Agent* m = it->second;
+    size_t start = agents->size();
+    agents->reserve(start + n);
+    for (int i = 0; i < n; ++i) {
+      Agent* clone = m->Clone();
+      T* casted = dynamic_cast<T*>(clone);
+      if (casted == NULL) {
+        PyDelAgent(clone->id());
+        DelAgent(clone);
+        // delete the clones already made so that none of the batch is left
+        for (size_t j = start; j < agents->size(); ++j) {
+          PyDelAgent((*agents)[j]->id());
+          DelAgent((*agents)[j]);
+        }
+        agents->resize(start);
+        throw CastError("Invalid cast for prototype " + proto_name);
+      }
+      agents->push_back(casted);
+    }
+  }
+
   /// Destructs and cleans up m (and it's children recursively).
   ///
   /// @warning this method should generally NOT be used by agents.
@@ -203,6 +247,12 @@ class Context {
   /// next build phase (i.e. the start of the next timestep).
   void SchedBuild(Agent* parent, std::string proto_name, int t = -1);
 
+  /// Schedules count agents of the named prototype to be built for the
+  /// specified parent at timestep t, or at the next build phase if t is -1.
+  /// The agents are built together, in one pass over the prototype, and the
+  /// schedule is recorded as a single BuildSchedule row.
+  void SchedBuild(Agent* parent, std::string proto_name, int t, int count);
+
   /// Schedules the given Agent to be decommissioned at the specified timestep
   /// t. The default t=-1 results in the decommission being scheduled for the
   /// next decommission phase (i.e. the end of the current timestep).
@@ -233,6 +283,10 @@ class Context {
   /// Returns the current simulation timestep.
   virtual int time();
 
+  /// Returns the timer measuring the phases of each timestep, or NULL if
+  /// there is no simulation timer.
+  PhaseTimer* phase_timer();
+
   /// Returns the duration of a single time step in seconds.
   inline uint64_t dt() {return si_.dt;};
 
@@ -301,8 +355,9 @@ class Context {
 
   std::map<std::string, Agent*> protos_;
   std::map<std::string, Composition::Ptr> recipes_;
-  std::set<Agent*> agent_list_;
-  std::set<Trader*> traders_;
+  /// all agents, including prototypes, by id
+  SlotMap<Agent> agent_list_;
+  std::vector<Trader*> traders_;
   std::map<std::string, int> n_prototypes_;
   std::map<std::string, int> n_specs_;
 
@@ -0,0 +1,151 @@
+#include "convert.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "error.h"
+#include "hdf5_back.h"
+#include "parallel.h"
+#include "partition_back.h"
+#include "recorder.h"
+
+namespace cyclus {
+
+namespace {
+
+/// Forwards Datums to a backend shared between threads, holding a lock while
+/// it is notified.  Flushing and closing are left to the owner of the
+/// backend.
+class LockedBackend : public RecBackend {
+ public:
+  LockedBackend(RecBackend* b, std::mutex* mu) : b_(b), mu_(mu) {}
+
+  virtual void Notify(DatumList data) {
+    std::lock_guard<std::mutex> lock(*mu_);
+    b_->Notify(data);
+  }
+
+  virtual std::string Name() { return b_->Name(); }
+
+  virtual void Flush() {}
+
+  virtual void Close() {}
+
+ private:
+  RecBackend* b_;
+  std::mutex* mu_;
+};
+
+/// Returns true if b stores its data with HDF5.
+template <class B>
+bool UsesHdf5(B* b) {
+  if (dynamic_cast<Hdf5Back*>(b) != NULL)
+    return true;
+  PartitionBack* p = dynamic_cast<PartitionBack*>(b);
+  return p != NULL && p->ext() == ".h5";
+}
+
+/// Converts table i of tables.
+struct ConvertTable {
+  QueryableBackend* in;
+  RecBackend* out;
+  const std::vector<std::string>* tables;
+  int batch_rows;
+  std::mutex* in_mu;
+  std::mutex* out_mu;
+
+  void operator()(int i) {
+    const std::string& table = (*tables)[i];
+    std::map<std::string, Datum::Shape> shapes;
+    QueryCursor::Ptr c;
+    {
+      std::lock_guard<std::mutex> lock(*in_mu);
+      std::list<ColumnInfo> schema = in->Schema(table);
+      std::list<ColumnInfo>::iterator it;
+      for (it = schema.begin(); it != schema.end(); ++it)
+        shapes[it->col] = it->shape;
+      c = in->Cursor(table, NULL);
+    }
+
+    try {
+      Copy(table, c, &shapes);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(*in_mu);
+      c.reset();
+      throw;
+    }
+    std::lock_guard<std::mutex> lock(*in_mu);
+    c.reset();
+  }
+
+  void Copy(const std::string& table, QueryCursor::Ptr c,
+            std::map<std::string, Datum::Shape>* shapes) {
+    // Datums keep pointers to their field names, which must therefore
+    // outlive the recorder, which records any Datums still buffered when it
+    // is destroyed.
+    std::vector<std::string> fields;
+    std::vector<Datum::Shape*> fshapes;
+
+    LockedBackend b(out, out_mu);
+    Recorder rec(false);
+    rec.set_dump_count(batch_rows);
+    rec.RegisterBackend(&b);
+
+    QueryResult batch;
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(*in_mu);
+        if (!c->Next(&batch, batch_rows))
+          break;
+      }
+      if (fields.empty()) {
+        fields = batch.fields;
+        for (int j = 0; j < fields.size(); ++j) {
+          std::map<std::string, Datum::Shape>::iterator it =
+              shapes->find(fields[j]);
+          fshapes.push_back(it == shapes->end() || it->second.empty()
+                                ? NULL : &it->second);
+        }
+      }
+      for (int i = 0; i < batch.rows.size(); ++i) {
+        Datum* d = rec.NewDatum(table);
+        for (int j = 0; j < fields.size(); ++j)
+          d->AddVal(fields[j].c_str(), batch.rows[i][j], fshapes[j]);
+        d->Record();
+      }
+    }
+    rec.Close();
+  }
+};
+
+}  // namespace
+
+void Convert(QueryableBackend* in, RecBackend* out, int nthreads,
+             int batch_rows) {
+  Convert(in, out, in->Tables(), nthreads, batch_rows);
+}
+
+void Convert(QueryableBackend* in, RecBackend* out,
+             const std::set<std::string>& tables, int nthreads,
+             int batch_rows) {
+  if (batch_rows < 1)
+    throw ValueError("conversion batches must have at least one row");
+  std::set<std::string> all = in->Tables();
+  std::set<std::string>::const_iterator it;
+  for (it = tables.begin(); it != tables.end(); ++it) {
+    if (all.count(*it) == 0)
+      throw KeyError("no table named " + *it + " to convert");
+  }
+
+  std::vector<std::string> names(tables.begin(), tables.end());
+  std::mutex in_mu;
+  std::mutex out_mu;
+  ConvertTable f = {in, out, &names, batch_rows, &in_mu, &out_mu};
+  if (UsesHdf5(in) && UsesHdf5(out))
+    f.out_mu = &in_mu;
+  ParallelFor(names.size(), nthreads, f);
+  out->Flush();
+}
+
+}  // namespace cyclus
@@ -0,0 +1,40 @@
+#ifndef CYCLUS_SRC_CONVERT_H_
+#define CYCLUS_SRC_CONVERT_H_
+
+#include <set>
+#include <string>
+
+#include "query_backend.h"
+
+namespace cyclus {
+
+/// Copies tables from a database into a Recorder backend, such as an
+/// SqliteBack run into an Hdf5Back.  Each table is streamed through a cursor
+/// in batches of rows, which are recorded as Datums with the shapes given by
+/// the schema of the input, so no table is ever held in memory whole.
+/// Different tables are converted at the same time on up to nthreads
+/// threads.  Reads from in and writes to out are each serialized by a lock,
+/// so neither backend needs to be thread safe, and reading one table
+/// overlaps with writing another.  When both are backed by HDF5, which keeps
+/// global library state, one lock serializes both.
+///
+/// The SimId column is copied as stored.  Tables without rows are not
+/// recreated, since backends create tables from their first Datum.  out is
+/// flushed but not closed.
+///
+/// @param in the database to read
+/// @param out the backend to write
+/// @param nthreads the maximum number of tables converted at once
+/// @param batch_rows the number of rows read and written at a time
+void Convert(QueryableBackend* in, RecBackend* out, int nthreads = 4,
+             int batch_rows = 10000);
+
+/// As above, but copies only the named tables.  Throws a KeyError if in has
+/// no table of one of the names.
+void Convert(QueryableBackend* in, RecBackend* out,
+             const std::set<std::string>& tables, int nthreads = 4,
+             int batch_rows = 10000);
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_CONVERT_H_
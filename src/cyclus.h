@@ -4,9 +4,11 @@
 #include "bid.h"
 #include "bid_portfolio.h"
 #include "capacity_constraint.h"
+#include "col_log_back.h"
 #include "comp_math.h"
 #include "composition.h"
 #include "context.h"
+#include "convert.h"
 #include "cyc_arithmetic.h"
 #include "cyc_limits.h"
 #include "cyc_std.h"
@@ -22,8 +24,11 @@
 #include "institution.h"
 #include "logger.h"
 #include "material.h"
+#include "mem_back.h"
 #include "mock_sim.h"
 #include "agent.h"
+#include "partition_back.h"
+#include "phase_timer.h"
 #include "pyhooks.h"
 #include "pyne.h"
 #include "pyne_decay.h"
@@ -33,7 +38,9 @@
 #include "region.h"
 #include "request.h"
 #include "request_portfolio.h"
+#include "res_lineage.h"
 #include "resource.h"
+#include "shm_back.h"
 #include "state_wrangler.h"
 #include "time_listener.h"
 #include "trade.h"
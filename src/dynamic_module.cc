@@ -104,6 +104,11 @@ bool DynamicModule::Exists(AgentSpec spec) {
   return rtn;
 }
 
+bool DynamicModule::IsPython(std::string spec) {
+  std::map<std::string, DynamicModule*>::iterator it = modules_.find(spec);
+  return it != modules_.end() && boost::starts_with(it->second->path(), "<py>");
+}
+
 void DynamicModule::CloseAll() {
   std::map<std::string, DynamicModule*>::iterator it;
   for (it = modules_.begin(); it != modules_.end(); it++) {
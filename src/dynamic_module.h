@@ -66,6 +66,10 @@ class DynamicModule {
   /// Tests that an agent spec really exists.
   static bool Exists(AgentSpec spec);
 
+  /// Returns true if the agents of the spec string made by Make come from a
+  /// Python module.
+  static bool IsPython(std::string spec);
+
   /// Closes all statically loaded dynamic modules. This should always be called
   /// before process termination.  This must be called AFTER all agents have
   /// been destructed.
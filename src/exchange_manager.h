@@ -6,6 +6,7 @@
 #include "exchange_graph.h"
 #include "exchange_solver.h"
 #include "exchange_translator.h"
+#include "phase_timer.h"
 #include "resource_exchange.h"
 #include "trade_executor.h"
 #include "trader_management.h"
@@ -27,37 +28,61 @@ namespace cyclus {
 template <class T>
 class ExchangeManager {
  public:
-  ExchangeManager(Context* ctx) : ctx_(ctx), debug_(false) {
+  ExchangeManager(Context* ctx) : ctx_(ctx), debug_(false), empty_(true) {
     debug_ = Env::GetEnv("CYCLUS_DEBUG_DRE").size() > 0;
   }
 
   /// @brief execute the full resource sequence
-  void Execute() {
+  ///
+  /// @param threads if not NULL, the threads on which the work of thread-safe
+  /// traders is done (see ExchangeThreads); the trades are the same either way
+  void Execute(const ExchangeThreads* threads = NULL) {
+    PhaseTimer* pt = ctx_->phase_timer();
+
     // collect resource exchange information
     ResourceExchange<T> exchng(ctx_);
-    exchng.AddAllRequests();
-    exchng.AddAllBids();
-    exchng.AdjustAll();
+    exchng.threads(threads);
+    {
+      PhaseScope p(pt, "Requests");
+      exchng.AddAllRequests();
+    }
+    {
+      PhaseScope p(pt, "Bids");
+      exchng.AddAllBids();
+    }
+    {
+      PhaseScope p(pt, "Preferences");
+      exchng.AdjustAll();
+    }
     CLOG(LEV_DEBUG1) << "done with info gathering";
     
     if (debug_)
       RecordDebugInfo(exchng.ex_ctx());
 
-    if (exchng.Empty())
+    empty_ = exchng.Empty();
+    if (empty_)
       return; // empty exchange, move on
 
     // translate graph
     ExchangeTranslator<T> xlator(&exchng.ex_ctx());
     CLOG(LEV_DEBUG1) << "translating graph...";
-    ExchangeGraph::Ptr graph = xlator.Translate();
+    ExchangeGraph::Ptr graph;
+    {
+      PhaseScope p(pt, "Translation");
+      graph = xlator.Translate(threads);
+    }
     CLOG(LEV_DEBUG1) << "graph translated!";
 
     // solve graph
     CLOG(LEV_DEBUG1) << "solving graph...";
-    ctx_->solver()->Solve(graph.get());
+    {
+      PhaseScope p(pt, "Solve");
+      ctx_->solver()->Solve(graph.get());
+    }
     CLOG(LEV_DEBUG1) << "graph solved!";
 
     // get trades
+    PhaseScope p(pt, "Trades");
     std::vector< Trade<T> > trades;
     xlator.BackTranslateSolution(graph->matches(), trades);
     CLOG(LEV_DEBUG1) << "trades translated!";
@@ -67,6 +92,9 @@ class ExchangeManager {
     exec.ExecuteTrades(ctx_);
   }
 
+  /// Returns true if no requests were made in the last exchange executed.
+  bool empty() const { return empty_; }
+
  private:
   void RecordDebugInfo(ExchangeContext<T>& exctx) {
     typename std::vector<typename RequestPortfolio<T>::Ptr>::iterator it;
@@ -114,6 +142,7 @@ class ExchangeManager {
 
   bool debug_;
   Context* ctx_;
+  bool empty_;
 };
 
 }  // namespace cyclus
@@ -0,0 +1,29 @@
+#ifndef CYCLUS_SRC_EXCHANGE_THREADS_H_
+#define CYCLUS_SRC_EXCHANGE_THREADS_H_
+
+#include <set>
+
+#include "parallel.h"
+
+namespace cyclus {
+
+class Recorder;
+class Trader;
+
+/// The threads on which a resource exchange may do the work of thread-safe
+/// traders (see ExchangeManager::Execute).  The requests, bids and preference
+/// adjustments of consecutive traders in safe are gathered concurrently on
+/// pool, each trader staging the Datums it records with rec (see
+/// Recorder::Stage), and the unit capacities of arcs between two traders in
+/// safe are computed concurrently too.  Everything is then put together in
+/// the order a serial exchange would use, so the exchange solved is the
+/// same.
+struct ExchangeThreads {
+  ThreadPool* pool;
+  Recorder* rec;
+  std::set<Trader*> safe;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_EXCHANGE_THREADS_H_
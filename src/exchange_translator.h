@@ -7,6 +7,7 @@
 #include "bid_portfolio.h"
 #include "error.h"
 #include "exchange_graph.h"
+#include "exchange_threads.h"
 #include "exchange_translation_context.h"
 #include "logger.h"
 #include "request.h"
@@ -18,6 +19,28 @@ namespace cyclus {
 template <class T> class ExchangeContext;
 class Trader;
 
+template <class T>
+void TranslateUnitCapacities(
+    const ExchangeTranslationContext<T>& translation_ctx, Bid<T>* bid,
+    const Arc& a, std::vector<double>* ucaps, std::vector<double>* vcaps);
+
+/// Translates the unit capacities of arcs for an ExchangeTranslator, keeping
+/// those of the request and bid nodes of arcs[i], the arc of bids[i], in
+/// ucaps[i] and vcaps[i].
+template <class T>
+struct ArcTask {
+  const ExchangeTranslationContext<T>* translation_ctx;
+  std::vector<Bid<T>*> bids;
+  std::vector<Arc> arcs;
+  std::vector<std::vector<double> > ucaps;
+  std::vector<std::vector<double> > vcaps;
+
+  void operator()(int i) {
+    TranslateUnitCapacities(*translation_ctx, bids[i], arcs[i], &ucaps[i],
+                            &vcaps[i]);
+  }
+};
+
 /// @class ExchangeTranslator
 ///
 /// @brief An ExchangeTranslator facilitates translation from a resource
@@ -40,7 +63,10 @@ class ExchangeTranslator {
   }
 
   /// @brief translate the ExchangeContext into an ExchangeGraph
-  ExchangeGraph::Ptr Translate() {
+  ///
+  /// @param threads if not NULL, the threads on which to translate the arcs
+  /// between thread-safe traders (see AddArcs)
+  ExchangeGraph::Ptr Translate(const ExchangeThreads* threads = NULL) {
     ExchangeGraph::Ptr graph(new ExchangeGraph());
 
     // add each request group
@@ -59,20 +85,22 @@ class ExchangeTranslator {
     // add each bid group
     const std::vector<typename BidPortfolio<T>::Ptr>& bidports = ex_ctx_->bids;
     typename std::vector<typename BidPortfolio<T>::Ptr>::const_iterator bp_it;
+    std::vector<Bid<T>*> bids;
     for (bp_it = bidports.begin(); bp_it != bidports.end(); ++bp_it) {
       ExchangeNodeGroup::Ptr ns = TranslateBidPortfolio(xlation_ctx_, *bp_it);
       graph->AddSupplyGroup(ns);
-
-      // add each request-bid arc
-      const std::set<Bid<T>*>& bids = (*bp_it)->bids();
-      typename std::set<Bid<T>*>::const_iterator b_it;
-      for (b_it = bids.begin(); b_it != bids.end(); ++b_it) {
-        Bid<T>* bid = *b_it;
-        Request<T>* req = bid->request();
-        AddArc(req, bid, graph);
-      }
+      bids.insert(bids.end(), (*bp_it)->bids().begin(),
+                  (*bp_it)->bids().end());
     }
 
+    // add each request-bid arc
+    if (threads != NULL) {
+      AddArcs(threads, bids, graph);
+      return graph;
+    }
+    for (int i = 0; i < bids.size(); ++i) {
+      AddArc(bids[i]->request(), bids[i], graph);
+    }
     return graph;
   }
 
@@ -95,15 +123,50 @@ class ExchangeTranslator {
     }
     // get translated arc
     Arc a = TranslateArc(xlation_ctx_, bid, pref);
-    a.unode()->prefs[a] = pref;  // request node is a.unode()
-    int n_prefs = a.unode()->prefs.size();
-    
-    CLOG(LEV_DEBUG5) << "Updating preference for one of "
-                     << req->requester()->manager()->prototype()
-                     << "'s trade nodes:";
-    CLOG(LEV_DEBUG5) << "   preference: " << a.unode()->prefs[a];
-    
-    graph->AddArc(a);
+    AddTranslatedArc(req, a, graph);
+  }
+
+  /// @brief adds the arcs of bids to a graph like AddArc, except that the
+  /// arcs whose requester and bidder are both in threads->safe are translated
+  /// concurrently beforehand.  Those traders' capacity converters may thus
+  /// be called from several threads at once.
+  void AddArcs(const ExchangeThreads* threads,
+               const std::vector<Bid<T>*>& bids, ExchangeGraph::Ptr graph) {
+    ArcTask<T> task;
+    task.translation_ctx = &xlation_ctx_;
+    std::vector<int> translated(bids.size(), -1);
+    for (int i = 0; i < bids.size(); ++i) {
+      Request<T>* req = bids[i]->request();
+      double pref = ex_ctx_->trader_prefs.at(req->requester())[req][bids[i]];
+      if (pref > 0 && threads->safe.count(req->requester()) > 0 &&
+          threads->safe.count(bids[i]->bidder()) > 0) {
+        Arc a(xlation_ctx_.request_to_node.at(req),
+              xlation_ctx_.bid_to_node.at(bids[i]));
+        a.pref(pref);
+        translated[i] = task.bids.size();
+        task.bids.push_back(bids[i]);
+        task.arcs.push_back(a);
+      }
+    }
+
+    int n = task.bids.size();
+    task.ucaps.resize(n);
+    task.vcaps.resize(n);
+    threads->pool->Run(n, task);
+
+    for (int i = 0; i < bids.size(); ++i) {
+      int k = translated[i];
+      if (k < 0) {
+        AddArc(bids[i]->request(), bids[i], graph);
+        continue;
+      }
+      Arc& a = task.arcs[k];
+      std::vector<double>& ucaps = a.unode()->unit_capacities[a];
+      ucaps.insert(ucaps.end(), task.ucaps[k].begin(), task.ucaps[k].end());
+      std::vector<double>& vcaps = a.vnode()->unit_capacities[a];
+      vcaps.insert(vcaps.end(), task.vcaps[k].begin(), task.vcaps[k].end());
+      AddTranslatedArc(bids[i]->request(), a, graph);
+    }
   }
   
   /// @brief Provide a vector of Trades given a vector of Matches
@@ -124,6 +187,20 @@ class ExchangeTranslator {
   ExchangeTranslationContext<T>& translation_ctx() { return xlation_ctx_; }
 
  private:
+  /// @brief sets the preference of a translated arc on its request node and
+  /// adds it to a graph
+  void AddTranslatedArc(Request<T>* req, const Arc& a,
+                        ExchangeGraph::Ptr graph) {
+    a.unode()->prefs[a] = a.pref();  // request node is a.unode()
+
+    CLOG(LEV_DEBUG5) << "Updating preference for one of "
+                     << req->requester()->manager()->prototype()
+                     << "'s trade nodes:";
+    CLOG(LEV_DEBUG5) << "   preference: " << a.unode()->prefs[a];
+
+    graph->AddArc(a);
+  }
+
   ExchangeContext<T>* ex_ctx_;
   ExchangeTranslationContext<T> xlation_ctx_;
 };
@@ -258,6 +335,21 @@ Arc TranslateArc(const ExchangeTranslationContext<T>& translation_ctx,
   return arc;
 }
 
+/// @brief computes the unit capacities that TranslateArc adds to the request
+/// and bid nodes of a bid's arc, but appends them to ucaps and vcaps rather
+/// than to the nodes, so that arcs sharing nodes can be translated
+/// concurrently
+template <class T>
+void TranslateUnitCapacities(
+    const ExchangeTranslationContext<T>& translation_ctx, Bid<T>* bid,
+    const Arc& a, std::vector<double>* ucaps, std::vector<double>* vcaps) {
+  typename T::Ptr offer = bid->offer();
+  AppendUnitCapacities(offer, bid->portfolio()->constraints(), a,
+                       translation_ctx, vcaps);
+  AppendUnitCapacities(offer, bid->request()->portfolio()->constraints(), a,
+                       translation_ctx, ucaps);
+}
+
 /// @brief simple translation from a Match to a Trade, given internal state
 template <class T>
 Trade<T> BackTranslateMatch(const ExchangeTranslationContext<T>&
@@ -282,12 +374,23 @@ void TranslateCapacities(
     ExchangeNode::Ptr n,
     const Arc& a,
     const ExchangeTranslationContext<T>& ctx) {
+  AppendUnitCapacities(offer, constr, a, ctx, &n->unit_capacities[a]);
+}
+
+/// @brief appends the unit capacities of a node on an arc, given a target
+/// resource and the node's constraints, to caps
+template<typename T>
+void AppendUnitCapacities(
+    typename T::Ptr offer,
+    const typename std::set< CapacityConstraint<T> >& constr,
+    const Arc& a,
+    const ExchangeTranslationContext<T>& ctx,
+    std::vector<double>* caps) {
   typename std::set< CapacityConstraint<T> >::const_iterator it;
   for (it = constr.begin(); it != constr.end(); ++it) {
     CLOG(cyclus::LEV_DEBUG1) << "Additing unit capacity: "
                              << it->convert(offer, &a, &ctx) / offer->quantity();
-    n->unit_capacities[a].push_back(it->convert(offer, &a, &ctx) /
-                                    offer->quantity());
+    caps->push_back(it->convert(offer, &a, &ctx) / offer->quantity());
   }
 }
 
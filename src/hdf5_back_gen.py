@@ -1,9 +1,9 @@
 #!/usr/bin/env python
 """This module generates HDF5 backend code found in src/hdf5_back.cc
 
-There are 8 distinct code generation options, one of which must be passed 
-as an argument to this module. They are CREATE, QUERY, VL_DATASET, 
-FILL_BUF, WRITE, VAL_TO_BUF_H, VAL_TO_BUF, and BUF_TO_VAL. Each of these 
+There are 9 distinct code generation options, one of which must be passed 
+as an argument to this module. They are CREATE, DECODE, DECODERS, VL_DATASET, 
+ENCODERS, WRITE, VAL_TO_BUF_H, VAL_TO_BUF, and BUF_TO_VAL. Each of these 
 generates a different section of Hdf5 backend code. All are invoked by 
 src/CMakeLists.txt prior to C++ compilation. However, for debugging purposes, 
 each section can be printed individually by passing that section's identifier 
@@ -12,9 +12,9 @@ routines is the function main_XXXX, where XXXX is a generation option.
 
 Example
 -------
-To generate the code found in src/hdf5_back.cc::Query, use
+To generate the column decoders used by src/hdf5_back.cc::Query, use
 
-    $ python hdf5_back_gen.py QUERY
+    $ python hdf5_back_gen.py DECODE
 
 """
 import os
@@ -1063,29 +1063,14 @@ def get_body(t, depth=0, prefix="", base_offset="buf+offset"):
 TEARDOWN_STACK = []
 VARS = []
 
-def normal_close(t):
-    """Represents the generic close to an hdf5 type code block."""
-    x = get_variable("x", depth=0, prefix="")
-    
-    tree = Block(nodes=[
-        ExprStmt(child=Assign(target=Var(name="is_row_selected"),
-                 value=FuncCall(name=Var(name="CmpConds"), 
-                                targs=[Raw(code=t.cpp)],
-                            args=[Raw(code="&"+x),
-                                  Raw(code="&(field_conds[qr.fields[j]])")]))),
-        If(cond=Var(name="is_row_selected"),
-           body=[ExprStmt(child=Assign(target=Var(name="row[j]"),
-                                       value=Var(name=x)))])])
-    
+def get_teardown():
+    """Represents the close of the HDF5 types opened by a query setup."""
+    block = Block(nodes=[])
     for i in range(len(TEARDOWN_STACK)):
         var_name = TEARDOWN_STACK.pop()
-        teardown = ExprStmt(child=FuncCall(name=Var(name="H5Tclose"),
-                                           args=[Raw(code=var_name)]))
-        tree.nodes.append(teardown)
-    return tree
-
-def get_teardown(t):
-    return normal_close(t)
+        block.nodes.append(ExprStmt(child=FuncCall(name=Var(name="H5Tclose"),
+                                                   args=[Raw(code=var_name)])))
+    return block
 
 def indent(text, prefix, predicate=None):
     """This function copied from textwrap library version 3.3.
@@ -1622,18 +1607,82 @@ def hdf5_insert(container_type, compound_var, types_sizes_dict):
         node.nodes.append(ExprStmt(child=func))
     return node
 
-def main_query():
-    """HDF5 Query: Generate Query case statement code."""
+def decode_close(t):
+    """HDF5 Decode: Represents the per-row close of a column decoder.
+
+    The decoded value is checked against the column's conditions and either
+    placed in its row or the row is deselected.
+    """
+    x = get_variable("x", depth=0, prefix="")
+    node = If(cond=FuncCall(name=Var(name="CmpConds"),
+                            targs=[Raw(code=t.cpp)],
+                            args=[Raw(code="&"+x), Raw(code="conds")]),
+              body=[ExprStmt(child=Assign(target=Var(name="rows[i][j]"),
+                                          value=Var(name=x)))],
+              el=ExprStmt(child=Assign(target=Var(name="selected[i]"),
+                                       value=Raw(code="false"))))
+    return node
+
+def decode_column(t):
+    """HDF5 Decode: Represents the DecodeColumn specialization for a type.
+
+    The HDF5 type setup happens once per column, after which the column is
+    decoded for every still-selected row of the chunk in a single tight loop.
+    """
+    setup = get_setup(t)
+    row_loop = For(adecl=DeclAssign(type=Type(cpp="hsize_t"),
+                                    target=Var(name="i"),
+                                    value=Raw(code="0")),
+                   cond=BinOp(x=Var(name="i"), op="<", y=Var(name="count")),
+                   incr=LeftUnaryOp(op="++", name=Var(name="i")),
+                   body=[If(cond=LeftUnaryOp(op="!",
+                                             name=Var(name="selected[i]")),
+                            body=[ExprStmt(child=Raw(code="continue"))]),
+                         ExprStmt(child=DeclAssign(
+                                      type=Type(cpp="size_t"),
+                                      target=Var(name="offset"),
+                                      value=BinOp(x=Var(name="i"), op="*",
+                                                  y=Var(name="rowsize")))),
+                         get_body(t),
+                         decode_close(t)])
+    teardown = get_teardown()
+    args = [Decl(type=Type(cpp="char*"), name=Var(name="buf")),
+            Decl(type=Type(cpp="hid_t"), name=Var(name="tb_type")),
+            Decl(type=Type(cpp="int"), name=Var(name="j")),
+            Decl(type=Type(cpp="size_t"), name=Var(name="rowsize")),
+            Decl(type=Type(cpp="hsize_t"), name=Var(name="count")),
+            Decl(type=Type(cpp="std::vector<Cond*>*"), name=Var(name="conds")),
+            Decl(type=Type(cpp="std::vector<bool>&"),
+                 name=Var(name="selected")),
+            Decl(type=Type(cpp="std::vector<QueryRow>&"),
+                 name=Var(name="rows"))]
+    node = FuncDef(type=Raw(code="void"),
+                   name=Var(name="Hdf5Back::DecodeColumn"),
+                   targs=[Raw(code=t.db)], args=args,
+                   body=[setup, row_loop, teardown], tspecial=True)
+    return node
+
+def main_decode():
+    """HDF5 Decode: Generate the DecodeColumn templated function definitions."""
     CPPGEN = CppGen(debug=False)
     output = ""
     for type in CANON_TYPES:
         type_node = CANON_TO_NODE[type]
-        setup = get_setup(type_node)
-        body = get_body(type_node)
-        teardown = get_teardown(type_node)
-        read_x = Block(nodes=[setup, body, teardown])
-        output += CPPGEN.visit(case_template(type_node, read_x))
-    output = indent(output, INDENT * 5)
+        output += CPPGEN.visit(decode_column(type_node))
+    return output
+
+def codec_case(t, func):
+    """Represents a case statement that returns the codec for a type."""
+    ret = Raw(code="return &Hdf5Back::{0}<{1}>".format(func, t.db))
+    return Case(cond=Var(name=t.db), body=[ExprStmt(child=ret)])
+
+def main_decoders():
+    """HDF5 DECODERS: Generate the Decoder dispatch case statements."""
+    CPPGEN = CppGen()
+    output = ""
+    for i in CANON_TYPES:
+        output += CPPGEN.visit(codec_case(CANON_TO_NODE[i], "DecodeColumn"))
+    output = indent(output, INDENT*2)
     return output
 
 io_error = Raw(code=("throw IOError(\"the type for column \'\"+"
@@ -1729,22 +1778,15 @@ def main_vl_dataset():
     output = indent(output, INDENT*2)
     return output
 
-def main_fill_buf():
-    """HDF5 FILL_BUF: Generates the FillBuf function code."""
+def main_encoders():
+    """HDF5 ENCODERS: Generate the Encoder dispatch case statements."""
     CPPGEN = CppGen()
     output = ""
     for i in CANON_TYPES:
-        node = CANON_TO_NODE[i]
-        write_to_buf = FuncCall(name=Var(name="WriteToBuf"), 
-                                targs=[Raw(code=node.db)],
-                                args=[Raw(code="buf+offset"), 
-                                      Raw(code="shapes[col]"),
-                                      Raw(code="a"), Raw(code="sizes[col]")])
-        case_body = ExprStmt(child=write_to_buf)
-        output += CPPGEN.visit(case_template(node, case_body))
-    output = indent(output, INDENT*4)
+        output += CPPGEN.visit(codec_case(CANON_TO_NODE[i], "WriteToBuf"))
+    output = indent(output, INDENT*2)
     return output
-                    
+
 vl_write_vl_string = """hasher_.Clear();
 hasher_.Update({var});
 Digest {key} = hasher_.digest();
@@ -2833,10 +2875,11 @@ def setup():
         if is_all_vl(node):
             ORIGIN_TO_VL[ORIGIN_DICT[n]] = node
             
-    MAIN_DISPATCH = {"QUERY": main_query,
+    MAIN_DISPATCH = {"DECODE": main_decode,
+                     "DECODERS": main_decoders,
                      "CREATE": main_create,
                      "VL_DATASET": main_vl_dataset,
-                     "FILL_BUF": main_fill_buf,
+                     "ENCODERS": main_encoders,
                      "WRITE": main_write,
                      "VAL_TO_BUF_H": main_val_to_buf_h,
                      "VAL_TO_BUF": main_val_to_buf,
@@ -173,6 +173,7 @@ void Material::Decay(int curr_time) {
     // Only do the decay calc if one of the nuclides would change in number
     // density more than fraction eps.
     // i.e. decay if   (1 - eps) > exp(-lambda*dt)
+    std::lock_guard<std::mutex> lock(PyneDataLock());
     CompMap::const_reverse_iterator it;
     for (it = c.rbegin(); it != c.rend(); ++it) {
       int nuc = it->first;
@@ -196,7 +197,9 @@ void Material::Decay(int curr_time) {
 double Material::DecayHeat() {
     double decay_heat = 0.;
     // Pyne decay heat operates with grams, cyclus generally in kilograms.
-    pyne::Material p_map = pyne::Material(comp_->mass(), qty_ * 1000);
+    const CompMap& mass = comp_->mass();
+    std::lock_guard<std::mutex> lock(PyneDataLock());
+    pyne::Material p_map = pyne::Material(mass, qty_ * 1000);
     std::map<int, double> dec_heat = p_map.decay_heat();
     for (auto nuc : dec_heat) {
         decay_heat += nuc.second;
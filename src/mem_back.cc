@@ -0,0 +1,174 @@
+#include "mem_back.h"
+
+#include <cstring>
+
+#include "error.h"
+#include "recorder.h"
+
+namespace cyclus {
+
+MemBack::MemBack(RecBackend* export_to) : export_to_(export_to) {}
+
+void MemBack::Notify(DatumList data) {
+  for (DatumList::iterator it = data.begin(); it != data.end(); ++it) {
+    Datum* d = *it;
+    std::map<std::string, Table>::iterator tit = tables_.find(d->title());
+    Table& t = tit == tables_.end() ? CreateTable(d) : tit->second;
+    const Datum::Vals& vals = d->vals();
+    ColumnarResult& cr = t.data;
+    const std::vector<std::string>& fields = cr.fields();
+    if (vals.size() != fields.size()) {
+      throw ValueError("datum for table " + d->title() + " does not have the"
+                       " fields of the first datum recorded to it");
+    }
+    for (int j = 0; j < vals.size(); ++j) {
+      int k = j;
+      if (std::strcmp(vals[j].first, fields[j].c_str()) != 0)
+        k = cr.FieldIndex(vals[j].first);
+      cr.column(k)->Append(vals[j].second);
+    }
+  }
+}
+
+MemBack::Table& MemBack::CreateTable(Datum* d) {
+  Table& t = tables_[d->title()];
+  order_.push_back(d->title());
+  const Datum::Vals& vals = d->vals();
+  t.shapes = d->shapes();
+  for (int j = 0; j < vals.size(); ++j)
+    t.data.AddColumn(vals[j].first, DbTypeOf(vals[j].second, t.shapes[j]));
+  return t;
+}
+
+void MemBack::Close() {
+  if (export_to_ != NULL) {
+    Export(export_to_);
+    export_to_->Flush();
+  }
+}
+
+void MemBack::Export(RecBackend* b) {
+  Recorder rec(false);
+  rec.RegisterBackend(b);
+  for (int k = 0; k < order_.size(); ++k) {
+    Table& t = tables_[order_[k]];
+    const std::vector<std::string>& fields = t.data.fields();
+    for (size_t i = 0; i < t.data.nrows(); ++i) {
+      Datum* d = rec.NewDatum(order_[k]);
+      for (int j = 0; j < fields.size(); ++j)
+        d->AddVal(fields[j].c_str(), t.data.Get(j, i), &t.shapes[j]);
+      d->Record();
+    }
+  }
+  rec.Close();
+}
+
+QueryResult MemBack::Query(std::string table, std::vector<Cond>* conds) {
+  const Table& t = GetTable(table);
+  std::vector<int> idx(t.data.fields().size());
+  for (int j = 0; j < idx.size(); ++j)
+    idx[j] = j;
+  return Rows(t, idx, Select(t, conds));
+}
+
+QueryResult MemBack::Query(std::string table,
+                           const std::vector<std::string>& cols,
+                           std::vector<Cond>* conds) {
+  const Table& t = GetTable(table);
+  std::vector<int> idx = ProjectionIndices(t.data.fields(), cols);
+  return Rows(t, idx, Select(t, conds));
+}
+
+ColumnarResult MemBack::QueryColumnar(std::string table,
+                                      std::vector<Cond>* conds) {
+  const Table& t = GetTable(table);
+  return QueryColumnar(table, t.data.fields(), conds);
+}
+
+ColumnarResult MemBack::QueryColumnar(std::string table,
+                                      const std::vector<std::string>& cols,
+                                      std::vector<Cond>* conds) {
+  const Table& t = GetTable(table);
+  std::vector<int> idx = ProjectionIndices(t.data.fields(), cols);
+  return Gather(t, idx, Select(t, conds));
+}
+
+std::map<std::string, DbTypes> MemBack::ColumnTypes(std::string table) {
+  const Table& t = GetTable(table);
+  std::map<std::string, DbTypes> rtn;
+  for (int j = 0; j < t.data.fields().size(); ++j)
+    rtn[t.data.fields()[j]] = t.data.types()[j];
+  return rtn;
+}
+
+std::list<ColumnInfo> MemBack::Schema(std::string table) {
+  const Table& t = GetTable(table);
+  std::list<ColumnInfo> rtn;
+  for (int j = 0; j < t.data.fields().size(); ++j) {
+    std::vector<int> shape = t.shapes[j];
+    if (shape.empty())
+      shape.push_back(-1);
+    rtn.push_back(ColumnInfo(table, t.data.fields()[j], j, t.data.types()[j],
+                             shape));
+  }
+  return rtn;
+}
+
+std::set<std::string> MemBack::Tables() {
+  return std::set<std::string>(order_.begin(), order_.end());
+}
+
+size_t MemBack::nrows(std::string table) const {
+  std::map<std::string, Table>::const_iterator it = tables_.find(table);
+  return it == tables_.end() ? 0 : it->second.data.nrows();
+}
+
+const MemBack::Table& MemBack::GetTable(const std::string& table) const {
+  std::map<std::string, Table>::const_iterator it = tables_.find(table);
+  if (it == tables_.end())
+    throw KeyError("no table named " + table + " in the memory backend");
+  return it->second;
+}
+
+std::vector<size_t> MemBack::Select(const Table& t,
+                                    std::vector<Cond>* conds) {
+  std::vector<size_t> rows(t.data.nrows());
+  for (size_t i = 0; i < rows.size(); ++i)
+    rows[i] = i;
+  if (conds == NULL)
+    return rows;
+  for (int k = 0; k < conds->size(); ++k) {
+    Cond* c = &(*conds)[k];
+    int j = t.data.FieldIndex(c->field);
+    FilterRows(t.data.column(j), t.data.types()[j], c, &rows);
+  }
+  return rows;
+}
+
+QueryResult MemBack::Rows(const Table& t, const std::vector<int>& cols,
+                          const std::vector<size_t>& rows) {
+  QueryResult qr;
+  for (int k = 0; k < cols.size(); ++k) {
+    qr.fields.push_back(t.data.fields()[cols[k]]);
+    qr.types.push_back(t.data.types()[cols[k]]);
+  }
+  qr.rows.resize(rows.size(), QueryRow(cols.size()));
+  for (size_t i = 0; i < rows.size(); ++i) {
+    for (int k = 0; k < cols.size(); ++k)
+      qr.rows[i][k] = t.data.Get(cols[k], rows[i]);
+  }
+  return qr;
+}
+
+ColumnarResult MemBack::Gather(const Table& t, const std::vector<int>& cols,
+                               const std::vector<size_t>& rows) {
+  ColumnarResult cr;
+  for (int k = 0; k < cols.size(); ++k) {
+    int j = cols[k];
+    cr.AddColumn(t.data.fields()[j], t.data.types()[j],
+                 t.data.column(j)->Take(rows));
+  }
+  return cr;
+}
+
+}  // namespace cyclus
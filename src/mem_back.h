@@ -0,0 +1,102 @@
+#ifndef CYCLUS_SRC_MEM_BACK_H_
+#define CYCLUS_SRC_MEM_BACK_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "query_backend.h"
+
+namespace cyclus {
+
+/// A Recorder backend that keeps all data in memory, one ColumnarResult of
+/// typed columns per table, and answers queries from it directly.  Scalar,
+/// string and uuid columns are stored contiguously by type; other types are
+/// held as boost::spirit::hold_any.  Conditions are supported on int, bool,
+/// float, double, string, uuid and blob columns.
+///
+/// Data can be copied to any other backend, such as an Hdf5Back or
+/// SqliteBack, with Export.  If an export backend is given at construction
+/// this happens when the MemBack is closed.
+class MemBack: public FullBackend {
+ public:
+  /// Creates an empty in-memory backend.
+  /// @param export_to a backend to which all data is exported on Close, or
+  /// NULL.  It is flushed but not closed and must outlive this backend.
+  MemBack(RecBackend* export_to = NULL);
+
+  virtual ~MemBack() {}
+
+  /// Appends the data to the columns of their tables.
+  virtual void Notify(DatumList data);
+
+  /// Returns "MemBack".
+  virtual std::string Name() { return "MemBack"; }
+
+  /// Data are stored immediately, so this does nothing.
+  virtual void Flush() {}
+
+  /// Exports the data to the backend given at construction, if any.
+  virtual void Close();
+
+  /// Records all rows of every table in b through a temporary Recorder,
+  /// table by table, each in the order its rows were received.  The SimId column is copied as stored.
+  void Export(RecBackend* b);
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
+
+  virtual QueryResult Query(std::string table,
+                            const std::vector<std::string>& cols,
+                            std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       const std::vector<std::string>& cols,
+                                       std::vector<Cond>* conds);
+
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
+
+  virtual std::list<ColumnInfo> Schema(std::string table);
+
+  virtual std::set<std::string> Tables();
+
+  /// Returns the number of rows stored for table, or zero for unknown tables.
+  size_t nrows(std::string table) const;
+
+ private:
+  struct Table {
+    ColumnarResult data;
+    Datum::Shapes shapes;
+  };
+
+  /// Returns the table, throwing a KeyError if it does not exist.
+  const Table& GetTable(const std::string& table) const;
+
+  /// Creates a table with the fields, types and shapes of d.
+  Table& CreateTable(Datum* d);
+
+  /// Returns the rows of t that match all conds.
+  static std::vector<size_t> Select(const Table& t, std::vector<Cond>* conds);
+
+  /// Copies the given rows and columns of t into a new row-wise result.
+  static QueryResult Rows(const Table& t, const std::vector<int>& cols,
+                          const std::vector<size_t>& rows);
+
+  /// Copies the given rows and columns of t into a new columnar result.
+  static ColumnarResult Gather(const Table& t, const std::vector<int>& cols,
+                               const std::vector<size_t>& rows);
+
+  std::map<std::string, Table> tables_;
+
+  /// table names in order of creation, for Export
+  std::vector<std::string> order_;
+
+  RecBackend* export_to_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_MEM_BACK_H_
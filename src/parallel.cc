@@ -0,0 +1,38 @@
+#include "parallel.h"
+
+namespace cyclus {
+
+thread_local TaskTurns* TaskTurns::current_ = NULL;
+thread_local int TaskTurns::index_ = 0;
+thread_local bool TaskTurns::waited_ = false;
+
+void TaskTurns::Start(int i) {
+  current_ = this;
+  index_ = i;
+  waited_ = false;
+}
+
+void TaskTurns::Finish(int i) {
+  current_ = NULL;
+  std::lock_guard<std::mutex> lock(mu_);
+  done_[i] = true;
+  while (ndone_ < done_.size() && done_[ndone_])
+    ++ndone_;
+  cv_.notify_all();
+}
+
+void TaskTurns::Abort() {
+  current_ = NULL;
+  std::lock_guard<std::mutex> lock(mu_);
+  aborted_ = true;
+  cv_.notify_all();
+}
+
+void TaskTurns::WaitTurn() {
+  waited_ = true;
+  std::unique_lock<std::mutex> lock(mu_);
+  while (!aborted_ && ndone_ < index_)
+    cv_.wait(lock);
+}
+
+}  // namespace cyclus
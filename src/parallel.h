@@ -0,0 +1,280 @@
+#ifndef CYCLUS_SRC_PARALLEL_H_
+#define CYCLUS_SRC_PARALLEL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace cyclus {
+
+/// Returns the number of threads the hardware can run concurrently, or 1 if
+/// it is unknown.
+inline int HardwareThreads() {
+  int n = std::thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+}
+
+/// Runs f(i) for each index handed out by a shared counter, recording the
+/// first exception thrown.  Used by ParallelFor.
+template <class F>
+class ParallelWorker {
+ public:
+  ParallelWorker(int n, F* f, std::atomic<int>* next, std::exception_ptr* err,
+                 std::mutex* mu)
+      : n_(n), f_(f), next_(next), err_(err), mu_(mu) {}
+
+  void operator()() {
+    for (int i = (*next_)++; i < n_; i = (*next_)++) {
+      try {
+        (*f_)(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(*mu_);
+        if (!*err_)
+          *err_ = std::current_exception();
+        *next_ = n_;  // skip the remaining indices
+      }
+    }
+  }
+
+ private:
+  int n_;
+  F* f_;
+  std::atomic<int>* next_;
+  std::exception_ptr* err_;
+  std::mutex* mu_;
+};
+
+/// Calls f(i) for every i in [0, n) on up to nthreads threads, counting the
+/// calling thread.  Indices are handed out one at a time, so calls run in
+/// an unspecified order and f must be safe to call concurrently.  If a call
+/// throws, indices not yet started are skipped and the first exception is
+/// rethrown once all threads have finished.  With nthreads <= 1 the calls
+/// run in order on the calling thread.
+template <class F>
+void ParallelFor(int n, int nthreads, F& f) {
+  if (nthreads > n)
+    nthreads = n;
+  if (nthreads <= 1) {
+    for (int i = 0; i < n; ++i)
+      f(i);
+    return;
+  }
+
+  std::atomic<int> next(0);
+  std::exception_ptr err;
+  std::mutex mu;
+  ParallelWorker<F> w(n, &f, &next, &err, &mu);
+  std::vector<std::thread> threads;
+  for (int k = 1; k < nthreads; ++k) {
+    try {
+      threads.push_back(std::thread(w));
+    } catch (const std::system_error&) {
+      break;  // run on the threads that could be started
+    }
+  }
+  w();
+  for (int k = 0; k < threads.size(); ++k)
+    threads[k].join();
+  if (err)
+    std::rethrow_exception(err);
+}
+
+/// Lets calls run concurrently by ParallelFor or a ThreadPool take ids from
+/// shared counters, e.g. resource and composition ids, in the order of
+/// their indices, so that they get the same ids as when run one after
+/// another.  Each call runs between Start and Finish (or Abort) on its
+/// thread.  Code about to take such an id calls Wait, which blocks the
+/// first time a call makes it until every call with a lower index has
+/// finished; calls that take no ids never block.
+class TaskTurns {
+ public:
+  /// Turns for calls with indices in [0, n).
+  explicit TaskTurns(int n) : done_(n, false), ndone_(0), aborted_(false) {}
+
+  /// Makes call i the one running on this thread.
+  void Start(int i);
+
+  /// Marks call i, which ran on this thread, as finished.
+  void Finish(int i);
+
+  /// Lets all waiting calls go on, e.g. after a call threw and the calls
+  /// not yet started will be skipped.
+  void Abort();
+
+  /// Blocks until the calls before the one running on this thread, if any,
+  /// have finished.
+  static void Wait() {
+    if (current_ != NULL && !waited_)
+      current_->WaitTurn();
+  }
+
+ private:
+  void WaitTurn();
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::vector<bool> done_;
+  /// the number of calls from index 0 on that have all finished
+  int ndone_;
+  bool aborted_;
+
+  static thread_local TaskTurns* current_;
+  static thread_local int index_;
+  static thread_local bool waited_;
+};
+
+/// Calls f(i) between the turns' Start and Finish, for ThreadPool::RunInTurn.
+template <class F>
+struct TurnTask {
+  F* f;
+  TaskTurns* turns;
+
+  void operator()(int i) {
+    turns->Start(i);
+    try {
+      (*f)(i);
+    } catch (...) {
+      turns->Abort();
+      throw;
+    }
+    turns->Finish(i);
+  }
+};
+
+/// A fixed set of threads that run ParallelFor-style loops, so that loops
+/// run many times, e.g. every timestep, do not pay for starting threads.
+/// Idle threads take the next index from a shared counter, so a thread that
+/// draws cheap calls takes over the remaining work of slower ones.  Only one
+/// loop runs at a time; Run must not be called concurrently or from f.
+class ThreadPool {
+ public:
+  /// Starts nthreads - 1 threads; the thread calling Run is the last one.
+  /// Threads that cannot be started are done without.
+  explicit ThreadPool(int nthreads) : job_(NULL), gen_(0), busy_(0),
+                                      stop_(false) {
+    for (int k = 1; k < nthreads; ++k) {
+      try {
+        threads_.push_back(std::thread(Looper(this)));
+      } catch (const std::system_error&) {
+        break;
+      }
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (int k = 0; k < threads_.size(); ++k)
+      threads_[k].join();
+  }
+
+  /// Returns the number of threads running loops, counting the caller.
+  int nthreads() const { return threads_.size() + 1; }
+
+  /// Calls f(i) for every i in [0, n) like Run, except that the calls take
+  /// ids in the order of their indices (see TaskTurns).
+  template <class F>
+  void RunInTurn(int n, F& f) {
+    TaskTurns turns(n);
+    TurnTask<F> task = {&f, &turns};
+    Run(n, task);
+  }
+
+  /// Calls f(i) for every i in [0, n) with the semantics of ParallelFor.
+  template <class F>
+  void Run(int n, F& f) {
+    if (threads_.empty() || n <= 1) {
+      ParallelFor(n, 1, f);
+      return;
+    }
+
+    std::atomic<int> next(0);
+    std::exception_ptr err;
+    std::mutex err_mu;
+    JobFor<F> job(ParallelWorker<F>(n, &f, &next, &err, &err_mu));
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      job_ = &job;
+      ++gen_;
+      busy_ = threads_.size();
+    }
+    wake_.notify_all();
+    job.Work();
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      while (busy_ > 0)
+        done_.wait(lock);
+      job_ = NULL;
+    }
+    if (err)
+      std::rethrow_exception(err);
+  }
+
+ private:
+  class Job {
+   public:
+    virtual ~Job() {}
+    virtual void Work() = 0;
+  };
+
+  template <class F>
+  class JobFor : public Job {
+   public:
+    explicit JobFor(const ParallelWorker<F>& w) : w_(w) {}
+    virtual void Work() { w_(); }
+
+   private:
+    ParallelWorker<F> w_;
+  };
+
+  class Looper {
+   public:
+    explicit Looper(ThreadPool* p) : p_(p) {}
+    void operator()() { p_->Loop(); }
+
+   private:
+    ThreadPool* p_;
+  };
+
+  void Loop() {
+    unsigned long seen = 0;
+    while (true) {
+      Job* job;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        while (!stop_ && gen_ == seen)
+          wake_.wait(lock);
+        if (stop_)
+          return;
+        seen = gen_;
+        job = job_;
+      }
+      job->Work();
+      {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (--busy_ == 0)
+          done_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mu_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  Job* job_;
+  unsigned long gen_;
+  int busy_;
+  bool stop_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_PARALLEL_H_
@@ -0,0 +1,458 @@
+#include "partition_back.h"
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include "col_log_back.h"
+#include "error.h"
+#include "hdf5_back.h"
+#include "parallel.h"
+#include "sqlite_back.h"
+
+namespace fs = boost::filesystem;
+
+namespace cyclus {
+
+namespace {
+
+const char kManifest[] = "manifest.txt";
+
+/// key time of partitions without a window
+const int kNoWindow = INT_MIN;
+
+/// Returns the multiple of w at or below t.
+int WindowStart(int t, int w) {
+  int q = t / w;
+  if (t % w != 0 && t < 0)
+    --q;
+  return q * w;
+}
+
+/// Notifies the backend of each partition of its group of datums.
+struct NotifyPart {
+  std::vector<FullBackend*>* backs;
+  std::vector<DatumList>* groups;
+
+  void operator()(int i) { (*backs)[i]->Notify((*groups)[i]); }
+};
+
+struct FlushPart {
+  std::vector<FullBackend*>* backs;
+
+  void operator()(int i) { (*backs)[i]->Flush(); }
+};
+
+struct ClosePart {
+  std::vector<FullBackend*>* backs;
+
+  void operator()(int i) { (*backs)[i]->Close(); }
+};
+
+/// Queries each partition, with its own copy of the conditions.
+template <class R>
+struct QueryPart {
+  std::vector<FullBackend*>* backs;
+  std::string table;
+  const std::vector<std::string>* cols;
+  std::vector<Cond>* conds;
+  std::vector<R>* results;
+
+  void operator()(int i) {
+    std::vector<Cond> c;
+    if (conds != NULL)
+      c = *conds;
+    std::vector<Cond>* cp = conds == NULL ? NULL : &c;
+    Run((*backs)[i], cp, &(*results)[i]);
+  }
+
+  void Run(FullBackend* b, std::vector<Cond>* c, QueryResult* r) {
+    *r = cols == NULL ? b->Query(table, c) : b->Query(table, *cols, c);
+  }
+
+  void Run(FullBackend* b, std::vector<Cond>* c, ColumnarResult* r) {
+    *r = cols == NULL ? b->QueryColumnar(table, c)
+                      : b->QueryColumnar(table, *cols, c);
+  }
+};
+
+/// Yields the rows of several backends one after the other, opening the
+/// cursor of each only once the previous one is exhausted.
+class ChainCursor : public QueryCursor {
+ public:
+  ChainCursor(const std::vector<FullBackend*>& backs, const std::string& table,
+              const std::vector<std::string>* cols, std::vector<Cond>* conds)
+      : backs_(backs),
+        table_(table),
+        has_cols_(cols != NULL),
+        has_conds_(conds != NULL),
+        next_(0) {
+    if (cols != NULL)
+      cols_ = *cols;
+    if (conds != NULL)
+      conds_ = *conds;
+  }
+
+  virtual bool Next(QueryResult* batch, int n) {
+    while (cur_ != NULL || next_ < backs_.size()) {
+      if (cur_ == NULL) {
+        FullBackend* b = backs_[next_++];
+        std::vector<Cond>* conds = has_conds_ ? &conds_ : NULL;
+        cur_ = has_cols_ ? b->Cursor(table_, cols_, conds)
+                         : b->Cursor(table_, conds);
+      }
+      if (cur_->Next(batch, n))
+        return true;
+      cur_.reset();
+    }
+    return false;
+  }
+
+ private:
+  std::vector<FullBackend*> backs_;
+  std::string table_;
+  std::vector<std::string> cols_;
+  std::vector<Cond> conds_;
+  bool has_cols_;
+  bool has_conds_;
+  int next_;
+  QueryCursor::Ptr cur_;
+};
+
+/// Appends the rows of cr to out, taking cr's columns if out is empty.
+void Concat(const std::string& table, ColumnarResult* out,
+            ColumnarResult* cr) {
+  if (out->fields().empty()) {
+    out->swap(*cr);
+    return;
+  }
+  if (out->fields() != cr->fields() || out->types() != cr->types()) {
+    throw ValueError("partitions of table " + table +
+                     " have different columns");
+  }
+  for (int j = 0; j < out->fields().size(); ++j)
+    out->column(j)->Extend(*cr->column(j));
+}
+
+}  // namespace
+
+PartitionBack::PartitionBack(std::string dir, std::string ext, int window,
+                             int nthreads, std::string time_field)
+    : dir_(dir),
+      ext_(ext),
+      window_(window > 0 ? window : 0),
+      nthreads_(ext == ".h5" ? 1 : nthreads),
+      time_field_(time_field),
+      dirty_(false) {
+  if (ext != ".sqlite" && ext != ".h5" && ext != ".cyclog")
+    throw ValueError("unsupported partition file extension " + ext);
+  fs::create_directories(dir_);
+  ReadManifest();
+}
+
+PartitionBack::~PartitionBack() {
+  try {
+    Close();
+  } catch (...) {
+    // destructors must not throw; Close reports errors to explicit callers
+  }
+  for (int i = 0; i < parts_.size(); ++i)
+    delete parts_[i].back;
+}
+
+void PartitionBack::Notify(DatumList data) {
+  std::vector<DatumList> groups(parts_.size());
+  for (DatumList::iterator it = data.begin(); it != data.end(); ++it) {
+    int i = PartitionOf(*it);
+    if (i >= groups.size())
+      groups.resize(i + 1);
+    groups[i].push_back(*it);
+  }
+
+  std::vector<int> idx;
+  std::vector<DatumList> nonempty;
+  for (int i = 0; i < groups.size(); ++i) {
+    if (!groups[i].empty()) {
+      idx.push_back(i);
+      nonempty.push_back(DatumList());
+      nonempty.back().swap(groups[i]);
+    }
+  }
+  std::vector<FullBackend*> backs = Backs(idx);
+  NotifyPart f = {&backs, &nonempty};
+  ParallelFor(backs.size(), nthreads_, f);
+}
+
+int PartitionBack::PartitionOf(Datum* d) {
+  int t0 = kNoWindow;
+  if (window_ > 0) {
+    const Datum::Vals& vals = d->vals();
+    for (int j = 0; j < vals.size(); ++j) {
+      if (std::strcmp(vals[j].first, time_field_.c_str()) == 0) {
+        if (vals[j].second.type() == typeid(int))
+          t0 = WindowStart(vals[j].second.cast<int>(), window_);
+        break;
+      }
+    }
+  }
+  std::map<Key, int>::iterator it = index_.find(Key(d->title(), t0));
+  if (it != index_.end())
+    return it->second;
+  return AddPartition(d->title(), t0 != kNoWindow, t0);
+}
+
+int PartitionBack::AddPartition(const std::string& table, bool windowed,
+                                int t0) {
+  Partition p;
+  p.table = table;
+  p.windowed = windowed;
+  p.t0 = windowed ? t0 : 0;
+  p.t1 = windowed ? t0 + window_ - 1 : 0;
+  std::stringstream ss;
+  ss << table;
+  if (windowed)
+    ss << "." << t0;
+  ss << ext_;
+  p.file = ss.str();
+  p.back = NULL;
+
+  int i = parts_.size();
+  parts_.push_back(p);
+  index_[Key(table, windowed ? t0 : kNoWindow)] = i;
+  tables_[table].push_back(i);
+  dirty_ = true;
+  return i;
+}
+
+FullBackend* PartitionBack::Back(int i) {
+  Partition& p = parts_.at(i);
+  if (p.back == NULL) {
+    std::string path = (fs::path(dir_) / p.file).string();
+    if (ext_ == ".h5") {
+      p.back = new Hdf5Back(path);
+    } else if (ext_ == ".cyclog") {
+      p.back = new ColLogBack(path);
+    } else {
+      p.back = new SqliteBack(path);
+    }
+  }
+  return p.back;
+}
+
+std::vector<FullBackend*> PartitionBack::Backs(const std::vector<int>& idx) {
+  std::vector<FullBackend*> backs(idx.size());
+  for (int k = 0; k < idx.size(); ++k)
+    backs[k] = Back(idx[k]);
+  return backs;
+}
+
+void PartitionBack::Flush() {
+  std::vector<FullBackend*> backs;
+  for (int i = 0; i < parts_.size(); ++i) {
+    if (parts_[i].back != NULL)
+      backs.push_back(parts_[i].back);
+  }
+  FlushPart f = {&backs};
+  ParallelFor(backs.size(), nthreads_, f);
+  if (dirty_)
+    WriteManifest();
+}
+
+void PartitionBack::Close() {
+  std::vector<FullBackend*> backs;
+  for (int i = 0; i < parts_.size(); ++i) {
+    if (parts_[i].back != NULL)
+      backs.push_back(parts_[i].back);
+  }
+  ClosePart f = {&backs};
+  ParallelFor(backs.size(), nthreads_, f);
+  for (int i = 0; i < parts_.size(); ++i) {
+    delete parts_[i].back;
+    parts_[i].back = NULL;
+  }
+  if (dirty_)
+    WriteManifest();
+}
+
+std::vector<int> PartitionBack::Partitions(const std::string& table,
+                                           std::vector<Cond>* conds) {
+  std::map<std::string, std::vector<int> >::iterator it = tables_.find(table);
+  if (it == tables_.end())
+    throw KeyError("no table named " + table + " in partitions of " + dir_);
+  if (conds == NULL)
+    return it->second;
+
+  std::vector<int> idx;
+  for (int k = 0; k < it->second.size(); ++k) {
+    const Partition& p = parts_[it->second[k]];
+    bool keep = true;
+    for (int c = 0; p.windowed && keep && c < conds->size(); ++c) {
+      const Cond& cond = (*conds)[c];
+      keep = cond.field != time_field_ || RangeMayMatch(p.t0, p.t1, cond);
+    }
+    if (keep)
+      idx.push_back(it->second[k]);
+  }
+  return idx;
+}
+
+QueryResult PartitionBack::Query(std::string table, std::vector<Cond>* conds) {
+  std::vector<int> idx = Partitions(table, conds);
+  if (idx.empty())  // still query one partition for the fields and types
+    return Back(tables_[table][0])->Query(table, conds);
+
+  std::vector<FullBackend*> backs = Backs(idx);
+  std::vector<QueryResult> results(backs.size());
+  QueryPart<QueryResult> f = {&backs, table, NULL, conds, &results};
+  ParallelFor(backs.size(), nthreads_, f);
+  QueryResult& qr = results[0];
+  for (int k = 1; k < results.size(); ++k)
+    qr.rows.insert(qr.rows.end(), results[k].rows.begin(),
+                   results[k].rows.end());
+  return qr;
+}
+
+QueryResult PartitionBack::Query(std::string table,
+                                 const std::vector<std::string>& cols,
+                                 std::vector<Cond>* conds) {
+  std::vector<int> idx = Partitions(table, conds);
+  if (idx.empty())
+    return Back(tables_[table][0])->Query(table, cols, conds);
+
+  std::vector<FullBackend*> backs = Backs(idx);
+  std::vector<QueryResult> results(backs.size());
+  QueryPart<QueryResult> f = {&backs, table, &cols, conds, &results};
+  ParallelFor(backs.size(), nthreads_, f);
+  QueryResult& qr = results[0];
+  for (int k = 1; k < results.size(); ++k)
+    qr.rows.insert(qr.rows.end(), results[k].rows.begin(),
+                   results[k].rows.end());
+  return qr;
+}
+
+QueryCursor::Ptr PartitionBack::Cursor(std::string table,
+                                       std::vector<Cond>* conds) {
+  std::vector<int> idx = Partitions(table, conds);
+  if (idx.empty())
+    idx.push_back(tables_[table][0]);
+  return QueryCursor::Ptr(new ChainCursor(Backs(idx), table, NULL, conds));
+}
+
+QueryCursor::Ptr PartitionBack::Cursor(std::string table,
+                                       const std::vector<std::string>& cols,
+                                       std::vector<Cond>* conds) {
+  std::vector<int> idx = Partitions(table, conds);
+  if (idx.empty())
+    idx.push_back(tables_[table][0]);
+  return QueryCursor::Ptr(new ChainCursor(Backs(idx), table, &cols, conds));
+}
+
+ColumnarResult PartitionBack::QueryColumnar(std::string table,
+                                            std::vector<Cond>* conds) {
+  std::vector<int> idx = Partitions(table, conds);
+  if (idx.empty())
+    return Back(tables_[table][0])->QueryColumnar(table, conds);
+
+  std::vector<FullBackend*> backs = Backs(idx);
+  std::vector<ColumnarResult> results(backs.size());
+  QueryPart<ColumnarResult> f = {&backs, table, NULL, conds, &results};
+  ParallelFor(backs.size(), nthreads_, f);
+  ColumnarResult cr;
+  for (int k = 0; k < results.size(); ++k)
+    Concat(table, &cr, &results[k]);
+  return cr;
+}
+
+ColumnarResult PartitionBack::QueryColumnar(
+    std::string table, const std::vector<std::string>& cols,
+    std::vector<Cond>* conds) {
+  std::vector<int> idx = Partitions(table, conds);
+  if (idx.empty())
+    return Back(tables_[table][0])->QueryColumnar(table, cols, conds);
+
+  std::vector<FullBackend*> backs = Backs(idx);
+  std::vector<ColumnarResult> results(backs.size());
+  QueryPart<ColumnarResult> f = {&backs, table, &cols, conds, &results};
+  ParallelFor(backs.size(), nthreads_, f);
+  ColumnarResult cr;
+  for (int k = 0; k < results.size(); ++k)
+    Concat(table, &cr, &results[k]);
+  return cr;
+}
+
+std::map<std::string, DbTypes> PartitionBack::ColumnTypes(std::string table) {
+  return Back(Partitions(table, NULL)[0])->ColumnTypes(table);
+}
+
+std::list<ColumnInfo> PartitionBack::Schema(std::string table) {
+  return Back(Partitions(table, NULL)[0])->Schema(table);
+}
+
+std::set<std::string> PartitionBack::Tables() {
+  std::set<std::string> rtn;
+  std::map<std::string, std::vector<int> >::iterator it;
+  for (it = tables_.begin(); it != tables_.end(); ++it)
+    rtn.insert(it->first);
+  return rtn;
+}
+
+void PartitionBack::ReadManifest() {
+  fs::path path = fs::path(dir_) / kManifest;
+  if (!fs::exists(path))
+    return;
+  std::ifstream in(path.string().c_str());
+  std::string ext;
+  std::string time_field;
+  int window;
+  if (!(in >> ext >> window >> time_field))
+    throw IOError("malformed partition manifest " + path.string());
+  if (ext != ext_ || window != window_ || time_field != time_field_) {
+    std::stringstream ss;
+    ss << "partitions in " << dir_ << " were written with extension " << ext
+       << ", window " << window << " and time field " << time_field;
+    throw ValueError(ss.str());
+  }
+
+  std::string table;
+  std::string t0;
+  std::string t1;
+  std::string file;
+  while (in >> table >> t0 >> t1 >> file) {
+    bool windowed = t0 != "*";
+    int i = AddPartition(table, windowed, std::atoi(t0.c_str()));
+    parts_[i].file = file;
+  }
+  if (!in.eof())
+    throw IOError("malformed partition manifest " + path.string());
+  dirty_ = false;
+}
+
+void PartitionBack::WriteManifest() {
+  fs::path path = fs::path(dir_) / kManifest;
+  fs::path tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream out(tmp.string().c_str());
+    out << ext_ << " " << window_ << " " << time_field_ << "\n";
+    for (int i = 0; i < parts_.size(); ++i) {
+      const Partition& p = parts_[i];
+      if (p.windowed) {
+        out << p.table << " " << p.t0 << " " << p.t1;
+      } else {
+        out << p.table << " * *";
+      }
+      out << " " << p.file << "\n";
+    }
+    out.close();
+    if (!out)
+      throw IOError("could not write partition manifest " + tmp.string());
+  }
+  fs::rename(tmp, path);
+  dirty_ = false;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,154 @@
+#ifndef CYCLUS_SRC_PARTITION_BACK_H_
+#define CYCLUS_SRC_PARTITION_BACK_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "query_backend.h"
+
+namespace cyclus {
+
+/// A Recorder backend that writes each table, and optionally each window of
+/// simulation time within a table, to its own file in a directory.  The
+/// partitions are independent backends chosen by file extension: SqliteBack
+/// for ".sqlite", Hdf5Back for ".h5" and ColLogBack for ".cyclog".  Datums
+/// are grouped by partition and the partitions are written and flushed on
+/// several threads at once.  HDF5 is not thread safe, so ".h5" partitions
+/// are always written by a single thread.
+///
+/// A datum is placed in a time window if window is positive and it has an
+/// int field named time_field; it then goes to the partition holding times
+/// [t0, t0 + window) with t0 a multiple of window.  Other datums go to a
+/// single partition for their table.  Partition files are named
+/// "<table><ext>" or "<table>.<t0><ext>".
+///
+/// The directory holds a manifest, "manifest.txt", rewritten on Flush and
+/// Close.  Its first line gives the extension, window and time field; each
+/// further line gives the table, first and last time ("*" for partitions
+/// without a window) and file name of a partition.  Opening an existing
+/// directory reads the manifest and appends to its partitions.
+///
+/// Queries fan out over the partitions of a table, skipping windows whose
+/// times cannot satisfy the conditions on time_field, and concatenate the
+/// results in partition order.  Partition backends are opened on first use.
+class PartitionBack: public FullBackend {
+ public:
+  /// Opens the partitioned output in dir, creating it if needed.  Throws a
+  /// ValueError if ext is not a supported extension or if dir holds a
+  /// manifest written with a different ext, window or time_field.
+  /// @param dir the directory holding the partition files
+  /// @param ext the extension, and therefore backend, of the partitions
+  /// @param window the number of time steps per partition, or 0 to
+  /// partition by table only
+  /// @param nthreads the maximum number of partitions written at once
+  /// @param time_field the name of the int field holding the time of a datum
+  PartitionBack(std::string dir, std::string ext = ".sqlite", int window = 0,
+                int nthreads = 4, std::string time_field = "Time");
+
+  virtual ~PartitionBack();
+
+  /// Passes each datum to the backend of its partition, creating new
+  /// partitions as needed.
+  virtual void Notify(DatumList data);
+
+  /// Returns the directory of the partitions.
+  virtual std::string Name() { return dir_; }
+
+  /// Flushes all open partitions and writes the manifest.
+  virtual void Flush();
+
+  /// Closes all partition backends and writes the manifest.  Recording or
+  /// querying more data reopens the partitions it needs.
+  virtual void Close();
+
+  virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
+
+  virtual QueryResult Query(std::string table,
+                            const std::vector<std::string>& cols,
+                            std::vector<Cond>* conds);
+
+  /// Streams the partitions of table one after the other.
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  std::vector<Cond>* conds);
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  const std::vector<std::string>& cols,
+                                  std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       const std::vector<std::string>& cols,
+                                       std::vector<Cond>* conds);
+
+  /// Returns the column types of the first partition of table.
+  virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
+
+  /// Returns the schema of the first partition of table.
+  virtual std::list<ColumnInfo> Schema(std::string table);
+
+  virtual std::set<std::string> Tables();
+
+  /// Returns the file extension of the partitions.
+  const std::string& ext() const { return ext_; }
+
+  /// Returns the number of partitions.
+  int npartitions() const { return parts_.size(); }
+
+  /// Returns the indices of the partitions of table that may hold rows
+  /// matching conds, in partition order.  Throws a KeyError if table has no
+  /// partitions.
+  std::vector<int> Partitions(const std::string& table,
+                              std::vector<Cond>* conds);
+
+  /// Returns the file name of partition i, relative to the directory.
+  const std::string& file(int i) const { return parts_.at(i).file; }
+
+ private:
+  struct Partition {
+    std::string table;
+    bool windowed;
+    int t0;
+    int t1;
+    std::string file;
+    FullBackend* back;
+  };
+
+  typedef std::pair<std::string, int> Key;
+
+  /// Returns the index of the partition for datum d, creating it if needed.
+  int PartitionOf(Datum* d);
+
+  /// Adds a partition, returning its index.
+  int AddPartition(const std::string& table, bool windowed, int t0);
+
+  /// Returns the backend of partition i, opening it if needed.
+  FullBackend* Back(int i);
+
+  /// Returns the backends of partitions idx, opening them if needed.
+  std::vector<FullBackend*> Backs(const std::vector<int>& idx);
+
+  /// Reads the manifest of dir_, if there is one.
+  void ReadManifest();
+
+  /// Atomically replaces the manifest with one listing all partitions.
+  void WriteManifest();
+
+  std::string dir_;
+  std::string ext_;
+  int window_;
+  int nthreads_;
+  std::string time_field_;
+  std::vector<Partition> parts_;
+  std::map<Key, int> index_;
+  std::map<std::string, std::vector<int> > tables_;
+  bool dirty_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_PARTITION_BACK_H_
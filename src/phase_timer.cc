@@ -0,0 +1,91 @@
+#include "phase_timer.h"
+
+#include "context.h"
+#include "error.h"
+
+namespace cyclus {
+
+PhaseTimer::PhaseTimer()
+    : ctx_(NULL), first_event_(true), origin_(Clock::now()), step_(0) {}
+
+PhaseTimer::~PhaseTimer() {
+  if (trace_.is_open()) {
+    trace_ << "\n]\n";
+    trace_.close();
+  }
+}
+
+void PhaseTimer::RecordTo(Context* ctx) {
+  ctx_ = ctx;
+}
+
+void PhaseTimer::TraceTo(std::string path) {
+  if (trace_.is_open())
+    trace_.close();
+  trace_.open(path.c_str());
+  if (!trace_.is_open())
+    throw IOError("could not open trace file " + path);
+  trace_ << "[";
+  first_event_ = true;
+}
+
+void PhaseTimer::Begin(const char* name) {
+  Started s;
+  s.path = stack_.empty() ? name : stack_.back().path + "/" + name;
+  s.start = Clock::now();
+  stack_.push_back(s);
+}
+
+void PhaseTimer::End() {
+  if (stack_.empty())
+    throw StateError("ending a phase that was never begun");
+  Clock::time_point end = Clock::now();
+  const Started& s = stack_.back();
+  std::chrono::duration<double> dur = end - s.start;
+  totals_[s.path] += dur.count();
+
+  if (trace_.is_open()) {
+    typedef std::chrono::microseconds us;
+    std::string name = s.path.substr(s.path.rfind('/') + 1);
+    trace_ << (first_event_ ? "\n" : ",\n")
+           << "{\"name\": \"" << name << "\", \"cat\": \"cyclus\", "
+           << "\"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": "
+           << std::chrono::duration_cast<us>(s.start - origin_).count()
+           << ", \"dur\": "
+           << std::chrono::duration_cast<us>(end - s.start).count()
+           << ", \"args\": {\"time\": " << step_ << ", \"phase\": \""
+           << s.path << "\"}}";
+    first_event_ = false;
+  }
+  stack_.pop_back();
+}
+
+void PhaseTimer::Step(int t) {
+  RecordTotals();
+  step_ = t;
+}
+
+void PhaseTimer::Close() {
+  RecordTotals();
+  ctx_ = NULL;
+  if (trace_.is_open()) {
+    trace_ << "\n]\n";
+    trace_.close();
+  }
+}
+
+void PhaseTimer::RecordTotals() {
+  if (ctx_ != NULL) {
+    std::map<std::string, double>::iterator it;
+    for (it = totals_.begin(); it != totals_.end(); ++it) {
+      ctx_->NewDatum("PhaseTimings")
+          ->AddVal("Time", step_)
+          ->AddVal("Phase", it->first)
+          ->AddVal("Seconds", it->second)
+          ->Record();
+    }
+  }
+  totals_.clear();
+}
+
+}  // namespace cyclus
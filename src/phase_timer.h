@@ -0,0 +1,103 @@
+#ifndef CYCLUS_SRC_PHASE_TIMER_H_
+#define CYCLUS_SRC_PHASE_TIMER_H_
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cyclus {
+
+class Context;
+
+/// Measures the wall-clock time spent in each phase of each time step.
+/// Phases nest, and each is identified by the path of the phases enclosing
+/// it, e.g. "MaterialExchange/Solve".  The times accumulated in a time step
+/// are recorded, once the next step starts, as rows of the PhaseTimings
+/// table with the fields Time, Phase and Seconds.  Each phase can also be
+/// written as a complete event to a Chrome trace_event JSON file, which can
+/// be opened in chrome://tracing or Perfetto.
+///
+/// A PhaseTimer does nothing until recording or tracing is turned on, so
+/// timing scopes cost a branch when profiling is off.
+class PhaseTimer {
+ public:
+  PhaseTimer();
+
+  ~PhaseTimer();
+
+  /// Turns on recording of phase times to the PhaseTimings table of ctx.
+  void RecordTo(Context* ctx);
+
+  /// Turns on writing a Chrome trace to path, throwing an IOError if it
+  /// cannot be opened.
+  void TraceTo(std::string path);
+
+  /// Returns true if recording or tracing is on.
+  bool enabled() const { return ctx_ != NULL || trace_.is_open(); }
+
+  /// Starts timing a phase nested in the phases currently started.
+  void Begin(const char* name);
+
+  /// Stops timing the phase started last.
+  void End();
+
+  /// Records the times accumulated in the current step and starts step t.
+  void Step(int t);
+
+  /// Records the times of the current step and finishes the trace file.
+  /// Recording and tracing are then off.
+  void Close();
+
+  /// Returns the seconds spent in each phase of the current step, by path.
+  const std::map<std::string, double>& totals() const { return totals_; }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Started {
+    std::string path;
+    Clock::time_point start;
+  };
+
+  /// Records and clears totals_.
+  void RecordTotals();
+
+  Context* ctx_;
+  std::ofstream trace_;
+  bool first_event_;
+  Clock::time_point origin_;
+  int step_;
+  std::vector<Started> stack_;
+  std::map<std::string, double> totals_;
+};
+
+/// Times a phase for the lifetime of the scope.
+///
+/// @code
+/// {
+///   PhaseScope p(ctx->phase_timer(), "Tick");
+///   ...
+/// }
+/// @endcode
+class PhaseScope {
+ public:
+  PhaseScope(PhaseTimer* t, const char* name)
+      : t_(t != NULL && t->enabled() ? t : NULL) {
+    if (t_ != NULL)
+      t_->Begin(name);
+  }
+
+  ~PhaseScope() {
+    if (t_ != NULL)
+      t_->End();
+  }
+
+ private:
+  PhaseTimer* t_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_PHASE_TIMER_H_
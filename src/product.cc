@@ -1,7 +1,10 @@
 #include "product.h"
 
+#include <mutex>
+
 #include "error.h"
 #include "logger.h"
+#include "parallel.h"
 
 namespace cyclus {
 
@@ -10,15 +13,25 @@ const ResourceType Product::kType = "Product";
 std::map<std::string, int> Product::qualids_;
 int Product::next_qualid_ = 1;
 
+namespace {
+
+std::mutex qualids_mu;
+
+}  // namespace
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Product::Ptr Product::Create(Agent* creator, double quantity,
                              std::string quality) {
-  if (qualids_.count(quality) == 0) {
-    qualids_[quality] = next_qualid_++;
-    creator->context()->NewDatum("Products")
-        ->AddVal("QualId", qualids_[quality])
-        ->AddVal("Quality", quality)
-        ->Record();
+  TaskTurns::Wait();  // new qualities get their ids in agent order
+  {
+    std::lock_guard<std::mutex> lock(qualids_mu);
+    if (qualids_.count(quality) == 0) {
+      qualids_[quality] = next_qualid_++;
+      creator->context()->NewDatum("Products")
+          ->AddVal("QualId", qualids_[quality])
+          ->AddVal("Quality", quality)
+          ->Record();
+    }
   }
 
   // the next lines must come after qual id setting
@@ -35,6 +48,12 @@ Product::Ptr Product::CreateUntracked(double quantity,
   return r;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+int Product::qual_id() const {
+  std::lock_guard<std::mutex> lock(qualids_mu);
+  return qualids_[quality_];
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Resource::Ptr Product::Clone() const {
   Product* g = new Product(*this);
@@ -34,10 +34,8 @@ class Product : public Resource {
   /// the simulation and is untracked.
   static Ptr CreateUntracked(double quantity, std::string quality);
 
-  /// Returns 0 (for now).
-  virtual int qual_id() const {
-    return qualids_[quality_];
-  }
+  /// Returns the id of the product's quality.
+  virtual int qual_id() const;
 
   /// Returns Product::kType.
   virtual const ResourceType type() const {
@@ -77,7 +75,8 @@ class Product : public Resource {
   /// @param quality the resource quality
   Product(Context* ctx, double quantity, std::string quality);
 
-  // map<quality, quality_id>
+  // map<quality, quality_id>, guarded by a lock since products may be
+  // created by agents ticking concurrently
   static std::map<std::string, int> qualids_;
   static int next_qualid_;
 
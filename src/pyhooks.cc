@@ -14,6 +14,20 @@ extern "C" {
 namespace cyclus {
 int PY_INTERP_COUNT = 0;
 bool PY_INTERP_INIT = false;
+bool PY_EVENT_CONSUMERS = false;
+
+namespace {
+/// Starts the interpreter unless it is running already, e.g. because
+/// cyclus was imported from Python.
+void PyNeeded(void) {
+  if (!PY_INTERP_INIT && !Py_IsInitialized()) {
+    Py_Initialize();
+    PyInitHooks();
+    atexit(PyStop);
+    PY_INTERP_INIT = true;
+  };
+};
+}  // namespace
 
 void PyInitHooks(void) {
 #if PY_MAJOR_VERSION < 3
@@ -28,12 +42,6 @@ void PyInitHooks(void) {
 };
 
 void PyStart(void) {
-  if (!PY_INTERP_INIT) {
-    Py_Initialize();
-    PyInitHooks();
-    atexit(PyStop);
-    PY_INTERP_INIT = true;
-  };
   PY_INTERP_COUNT++;
 };
 
@@ -46,28 +54,50 @@ void PyStop(void) {
   };
 };
 
-void EventLoop(void) { CyclusEventLoopHook(); };
+void EventLoop(void) {
+  if (!PY_EVENT_CONSUMERS)
+    return;
+  CyclusEventLoopHook();
+};
 
-std::string PyFindModule(std::string lib) { return CyclusPyFindModule(lib); };
+std::string PyFindModule(std::string lib) {
+  PyNeeded();
+  return CyclusPyFindModule(lib);
+};
 
 Agent* MakePyAgent(std::string lib, std::string agent, void* ctx) {
+  PyNeeded();
   return CyclusMakePyAgent(lib, agent, ctx);
 };
 
-void ClearPyAgentRefs(void) { CyclusClearPyAgentRefs(); };
+// without a running interpreter there are no Python agents to forget
+void ClearPyAgentRefs(void) {
+  if (Py_IsInitialized())
+    CyclusClearPyAgentRefs();
+};
 
-void PyDelAgent(int i) { CyclusPyDelAgent(i); };
+void PyDelAgent(int i) {
+  if (Py_IsInitialized())
+    CyclusPyDelAgent(i);
+};
 
 namespace toolkit {
-std::string PyToJson(std::string infile) { return CyclusPyToJson(infile); };
+std::string PyToJson(std::string infile) {
+  PyNeeded();
+  return CyclusPyToJson(infile);
+};
 
-std::string JsonToPy(std::string infile) { return CyclusJsonToPy(infile); };
+std::string JsonToPy(std::string infile) {
+  PyNeeded();
+  return CyclusJsonToPy(infile);
+};
 }  // namespace toolkit
 }  // namespace cyclus
 #else   // else CYCLUS_WITH_PYTHON
 namespace cyclus {
 int PY_INTERP_COUNT = 0;
 bool PY_INTERP_INIT = false;
+bool PY_EVENT_CONSUMERS = false;
 
 void PyInitHooks(void) {};
 
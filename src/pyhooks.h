@@ -15,12 +15,20 @@ extern int PY_INTERP_COUNT;
 /// Whether or not the Python interpreter has been initilized.
 extern bool PY_INTERP_INIT;
 
+/// Whether anything, e.g. the cyclus server, consumes the events of the
+/// Python event loop.  Set from Python by cyclus.events.set_state.  While
+/// this is false, EventLoop returns without entering Python.
+extern bool PY_EVENT_CONSUMERS;
+
 /// Convience function for initializing Python hooks
 void PyInitHooks(void);
 
 /// Initialize Python functionality, this is a no-op if Python was not
 /// installed along with Cyclus. This may be called many times and safely
-/// initializes the Python interpreter only once.
+/// initializes the Python interpreter only once.  The interpreter is not
+/// started until it is first needed, i.e. to find or make a Python
+/// archetype or to convert a Python input file, so simulations of C++
+/// archetypes never start it.
 void PyStart(void);
 
 /// Closes the current Python session. This is a no-op if Python was
@@ -1,12 +1,17 @@
 #ifndef CYCLUS_SRC_QUERY_BACKEND_H_
 #define CYCLUS_SRC_QUERY_BACKEND_H_
 
+#include <algorithm>
 #include <climits>
 #include <list>
 #include <map>
 #include <set>
+#include <typeinfo>
+#include <utility>
 
+#include <boost/shared_ptr.hpp>
 #include <boost/uuid/sha1.hpp>
+#include <boost/uuid/uuid.hpp>
 
 #include "blob.h"
 #include "rec_backend.h"
@@ -348,6 +353,8 @@ enum CmpOpCode {
   GE,
   EQ,
   NE,
+  IN,
+  BETWEEN,
 };
 
 /// Represents a condition used to filter rows returned by a query.
@@ -371,6 +378,10 @@ class Cond {
       opcode = EQ;
     else if (op == "!=")
       opcode = NE;
+    else if (op == "IN")
+      opcode = IN;
+    else if (op == "BETWEEN")
+      opcode = BETWEEN;
     else
       throw ValueError("operation '" + op + "' not valid for field '" + \
                        field + "'.");
@@ -379,16 +390,139 @@ class Cond {
   /// table column name
   std::string field;
 
-  /// One of: "<", ">", "<=", ">=", "==", "!="
+  /// One of: "<", ">", "<=", ">=", "==", "!=", "IN", "BETWEEN"
   std::string op;
 
   /// The CmpOpCode cooresponding to op.
   CmpOpCode opcode;
 
-  /// value supported by backend(s) in use
+  /// value supported by backend(s) in use.  For "IN" this is a std::set of
+  /// the column's type, and for "BETWEEN" a std::pair of the inclusive lower
+  /// and upper bounds, e.g. std::make_pair(10, 20) for an INT column.
   boost::spirit::hold_any val;
 };
 
+/// Returns the values a condition compares against: the members of an "IN"
+/// set, the two bounds of a "BETWEEN" or the single value of any other
+/// operation.  Only sets and pairs of int, float, double, std::string and
+/// boost::uuids::uuid are supported.
+inline std::vector<boost::spirit::hold_any> CondOperands(const Cond& c) {
+  using boost::spirit::hold_any;
+  using boost::uuids::uuid;
+  std::vector<hold_any> rtn;
+  if (c.opcode == IN) {
+#define CYCLUS_COND_IN(T)                                                  \
+    if (c.val.type() == typeid(std::set<T>)) {                             \
+      const std::set<T>& s = c.val.cast<std::set<T> >();                   \
+      for (std::set<T>::const_iterator it = s.begin(); it != s.end(); ++it) \
+        rtn.push_back(hold_any(*it));                                      \
+      return rtn;                                                          \
+    }
+    CYCLUS_COND_IN(int)
+    CYCLUS_COND_IN(float)
+    CYCLUS_COND_IN(double)
+    CYCLUS_COND_IN(std::string)
+    CYCLUS_COND_IN(uuid)
+#undef CYCLUS_COND_IN
+  } else if (c.opcode == BETWEEN) {
+#define CYCLUS_COND_BETWEEN(T)                                           \
+    if (c.val.type() == typeid(std::pair<T, T>)) {                       \
+      const std::pair<T, T>& r = c.val.cast<std::pair<T, T> >();         \
+      rtn.push_back(hold_any(r.first));                                  \
+      rtn.push_back(hold_any(r.second));                                 \
+      return rtn;                                                        \
+    }
+    CYCLUS_COND_BETWEEN(int)
+    CYCLUS_COND_BETWEEN(float)
+    CYCLUS_COND_BETWEEN(double)
+    CYCLUS_COND_BETWEEN(std::string)
+    CYCLUS_COND_BETWEEN(uuid)
+#undef CYCLUS_COND_BETWEEN
+  } else {
+    rtn.push_back(c.val);
+    return rtn;
+  }
+  throw ValueError("unsupported value type for " + c.op + " condition on "
+                   "field '" + c.field + "'.");
+}
+
+/// Returns false if no int in [lo, hi] satisfies cond, so that data known to
+/// lie in that range can be skipped.  Returns true if some int may satisfy
+/// it or if cond does not compare ints.
+inline bool RangeMayMatch(int lo, int hi, const Cond& cond) {
+  std::vector<boost::spirit::hold_any> ops = CondOperands(cond);
+  std::vector<int> v;
+  for (int i = 0; i < ops.size() && ops[i].type() == typeid(int); ++i)
+    v.push_back(ops[i].cast<int>());
+  if (v.size() != ops.size() || v.empty())
+    return true;
+  switch (cond.opcode) {
+    case LT:
+      return lo < v[0];
+    case LE:
+      return lo <= v[0];
+    case GT:
+      return hi > v[0];
+    case GE:
+      return hi >= v[0];
+    case EQ:
+    case IN:
+      for (int i = 0; i < v.size(); ++i) {
+        if (lo <= v[i] && v[i] <= hi)
+          return true;
+      }
+      return false;
+    case BETWEEN:
+      return v[0] <= hi && v[1] >= lo;
+    default:
+      return true;
+  }
+}
+
+/// Represents the aggregate functions of an aggregate query.  The AGG_ prefix
+/// keeps MIN and MAX clear of the common macros of the same name.
+enum AggOpCode {
+  AGG_COUNT = 0,
+  AGG_SUM,
+  AGG_MIN,
+  AGG_MAX,
+};
+
+/// Represents an aggregate of one column computed for each group of an
+/// aggregate query, such as the sum of the "Quantity" column.
+class Agg {
+ public:
+  Agg() {}
+
+  Agg(std::string op, std::string field)
+      : field(field),
+        op(op) {
+    if (op == "COUNT")
+      opcode = AGG_COUNT;
+    else if (op == "SUM")
+      opcode = AGG_SUM;
+    else if (op == "MIN")
+      opcode = AGG_MIN;
+    else if (op == "MAX")
+      opcode = AGG_MAX;
+    else
+      throw ValueError("aggregate '" + op + "' not valid for field '" + \
+                       field + "'.");
+  }
+
+  /// The name of the aggregate in query results, e.g. "SUM(Quantity)".
+  std::string name() const { return op + "(" + field + ")"; }
+
+  /// table column name
+  std::string field;
+
+  /// One of: "COUNT", "SUM", "MIN", "MAX"
+  std::string op;
+
+  /// The AggOpCode cooresponding to op.
+  AggOpCode opcode;
+};
+
 typedef std::vector<boost::spirit::hold_any> QueryRow;
 
 /// Meta data and results of a query.
@@ -449,6 +583,519 @@ class QueryResult {
   }
 };
 
+/// A single column of a ColumnarResult.  See TypedColumn.
+class QueryColumn {
+ public:
+  virtual ~QueryColumn() {}
+
+  /// Returns the number of values in the column.
+  virtual size_t size() const = 0;
+
+  /// Reserves space for n values.
+  virtual void Reserve(size_t n) = 0;
+
+  /// Appends a value, which must hold the column's storage type.
+  virtual void Append(const boost::spirit::hold_any& v) = 0;
+
+  /// Returns the value in row i.
+  virtual boost::spirit::hold_any Get(size_t i) const = 0;
+
+  /// Returns a deep copy of the column.
+  virtual QueryColumn* Clone() const = 0;
+
+  /// Returns a new column holding the values in the given rows, in order.
+  virtual QueryColumn* Take(const std::vector<size_t>& rows) const = 0;
+
+  /// Appends all values of other, which must have the same storage type.
+  virtual void Extend(const QueryColumn& other) = 0;
+};
+
+/// A column storing its values contiguously as a std::vector<T>.
+template <class T>
+class TypedColumn : public QueryColumn {
+ public:
+  virtual size_t size() const { return values.size(); }
+
+  virtual void Reserve(size_t n) { values.reserve(n); }
+
+  virtual void Append(const boost::spirit::hold_any& v) {
+    values.push_back(v.cast<T>());
+  }
+
+  virtual boost::spirit::hold_any Get(size_t i) const {
+    return boost::spirit::hold_any(values[i]);
+  }
+
+  virtual QueryColumn* Clone() const { return new TypedColumn<T>(*this); }
+
+  virtual QueryColumn* Take(const std::vector<size_t>& rows) const {
+    TypedColumn<T>* c = new TypedColumn<T>();
+    c->values.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i)
+      c->values.push_back(values[rows[i]]);
+    return c;
+  }
+
+  virtual void Extend(const QueryColumn& other) {
+    const std::vector<T>& v = static_cast<const TypedColumn<T>&>(other).values;
+    values.insert(values.end(), v.begin(), v.end());
+  }
+
+  std::vector<T> values;
+};
+
+/// Values of any type that has no dedicated storage are kept as hold_any.
+template <>
+inline void TypedColumn<boost::spirit::hold_any>::Append(
+    const boost::spirit::hold_any& v) {
+  values.push_back(v);
+}
+
+template <>
+inline boost::spirit::hold_any TypedColumn<boost::spirit::hold_any>::Get(
+    size_t i) const {
+  return values[i];
+}
+
+/// Creates an empty column for values of the given database type.  INT,
+/// BOOL, FLOAT, DOUBLE, STRING, VL_STRING and UUID columns have dedicated
+/// storage (int, bool, float, double, std::string and boost::uuids::uuid);
+/// all other types are stored as hold_any.
+inline QueryColumn* NewQueryColumn(DbTypes type) {
+  switch (type) {
+    case INT:
+      return new TypedColumn<int>();
+    case BOOL:
+      return new TypedColumn<bool>();
+    case FLOAT:
+      return new TypedColumn<float>();
+    case DOUBLE:
+      return new TypedColumn<double>();
+    case STRING:
+    case VL_STRING:
+      return new TypedColumn<std::string>();
+    case UUID:
+      return new TypedColumn<boost::uuids::uuid>();
+    default:
+      return new TypedColumn<boost::spirit::hold_any>();
+  }
+}
+
+/// Orders type_info objects, whose addresses may differ between shared
+/// libraries.
+struct TypeInfoLess {
+  bool operator()(const std::type_info* a, const std::type_info* b) const {
+    return a->before(*b);
+  }
+};
+
+/// Returns the database type of each recordable C++ type except strings,
+/// whose type depends on their shape.  Used by DbTypeOf.
+inline std::map<const std::type_info*, DbTypes, TypeInfoLess> DbTypeMap() {
+  using std::list;
+  using std::map;
+  using std::pair;
+  using std::set;
+  using std::string;
+  using std::vector;
+  std::map<const std::type_info*, DbTypes, TypeInfoLess> types;
+  types[&typeid(int)] = INT;
+  types[&typeid(bool)] = BOOL;
+  types[&typeid(float)] = FLOAT;
+  types[&typeid(double)] = DOUBLE;
+  types[&typeid(boost::uuids::uuid)] = UUID;
+  types[&typeid(Blob)] = BLOB;
+  types[&typeid(set<int>)] = SET_INT;
+  types[&typeid(set<string>)] = SET_STRING;
+  types[&typeid(vector<int>)] = VECTOR_INT;
+  types[&typeid(vector<double>)] = VECTOR_DOUBLE;
+  types[&typeid(vector<string>)] = VECTOR_STRING;
+  types[&typeid(list<int>)] = LIST_INT;
+  types[&typeid(list<string>)] = LIST_STRING;
+  types[&typeid(list<pair<int, int> >)] = LIST_PAIR_INT_INT;
+  types[&typeid(pair<int, int>)] = PAIR_INT_INT;
+  types[&typeid(pair<double, double>)] = PAIR_DOUBLE_DOUBLE;
+  types[&typeid(map<int, int>)] = MAP_INT_INT;
+  types[&typeid(map<int, double>)] = MAP_INT_DOUBLE;
+  types[&typeid(map<int, string>)] = MAP_INT_STRING;
+  types[&typeid(map<string, int>)] = MAP_STRING_INT;
+  types[&typeid(map<string, double>)] = MAP_STRING_DOUBLE;
+  types[&typeid(map<string, string>)] = MAP_STRING_STRING;
+  types[&typeid(map<string, vector<double> >)] = MAP_STRING_VECTOR_DOUBLE;
+  types[&typeid(map<string, map<int, double> >)] =
+      MAP_STRING_MAP_INT_DOUBLE;
+  types[&typeid(map<string, map<string, int> >)] =
+      MAP_STRING_MAP_STRING_INT;
+  types[&typeid(map<int, map<string, double> >)] =
+      MAP_INT_MAP_STRING_DOUBLE;
+  types[&typeid(map<string, pair<double, map<int, double> > >)] =
+      MAP_STRING_PAIR_DOUBLE_MAP_INT_DOUBLE;
+  types[&typeid(map<string, pair<string, vector<double> > >)] =
+      MAP_STRING_PAIR_STRING_VECTOR_DOUBLE;
+  types[&typeid(map<string, vector<pair<int, pair<string, string> > > >)] =
+      MAP_STRING_VECTOR_PAIR_INT_PAIR_STRING_STRING;
+  types[&typeid(vector<pair<pair<double, double>, map<string, double> > >)] =
+      VECTOR_PAIR_PAIR_DOUBLE_DOUBLE_MAP_STRING_DOUBLE;
+  return types;
+}
+
+/// Returns the database type of a value recorded with the given shape.
+/// Strings with a positive length are STRING and other strings VL_STRING;
+/// containers are given their fixed length types, as SqliteBack does.
+/// Throws a ValueError for types that cannot be recorded.
+inline DbTypes DbTypeOf(const boost::spirit::hold_any& v,
+                        const std::vector<int>& shape) {
+  static const std::map<const std::type_info*, DbTypes, TypeInfoLess> types =
+      DbTypeMap();
+  const std::type_info& t = v.type();
+  if (t == typeid(std::string))
+    return !shape.empty() && shape[0] > 0 ? STRING : VL_STRING;
+  std::map<const std::type_info*, DbTypes, TypeInfoLess>::const_iterator it =
+      types.find(&t);
+  if (it == types.end())
+    throw ValueError(std::string("unsupported backend type ") + t.name());
+  return it->second;
+}
+
+/// Query results stored by column rather than by row.  Each column holds
+/// its values in a single typed vector, which takes a fraction of the memory
+/// of a row of hold_any objects and can be handed to other libraries
+/// without per-value conversion.  Fields are looked up through an index
+/// rather than by scanning. Example use:
+///
+/// @code
+///
+/// ColumnarResult cr = back->QueryColumnar("Transactions", NULL);
+/// std::vector<int>& times = cr.Column<int>("Time");
+/// for (int i = 0; i < cr.nrows(); ++i) {
+///   std::cout << times[i] << "\n";
+/// }
+///
+/// @endcode
+class ColumnarResult {
+ public:
+  ColumnarResult() {}
+
+  ColumnarResult(const ColumnarResult& other) { *this = other; }
+
+  ColumnarResult(ColumnarResult&& other) { swap(other); }
+
+  ~ColumnarResult() { Reset(); }
+
+  ColumnarResult& operator=(ColumnarResult&& other) {
+    Reset();
+    swap(other);
+    return *this;
+  }
+
+  ColumnarResult& operator=(const ColumnarResult& other) {
+    if (this == &other)
+      return *this;
+    Reset();
+    fields_ = other.fields_;
+    types_ = other.types_;
+    index_ = other.index_;
+    for (int j = 0; j < other.cols_.size(); ++j)
+      cols_.push_back(other.cols_[j]->Clone());
+    return *this;
+  }
+
+  /// Appends an empty column.  Throws a ValueError if the field already
+  /// exists.
+  void AddColumn(std::string field, DbTypes type) {
+    if (index_.count(field) > 0)
+      throw ValueError("duplicate query result field " + field);
+    index_[field] = fields_.size();
+    fields_.push_back(field);
+    types_.push_back(type);
+    cols_.push_back(NewQueryColumn(type));
+  }
+
+  /// Appends col, which must be stored as NewQueryColumn(type) would and
+  /// have nrows() values, taking ownership of it.
+  void AddColumn(std::string field, DbTypes type, QueryColumn* col) {
+    if (index_.count(field) > 0) {
+      delete col;
+      throw ValueError("duplicate query result field " + field);
+    }
+    index_[field] = fields_.size();
+    fields_.push_back(field);
+    types_.push_back(type);
+    cols_.push_back(col);
+  }
+
+  /// Returns the column index of field, or throws a KeyError.
+  int FieldIndex(const std::string& field) const {
+    std::map<std::string, int>::const_iterator it = index_.find(field);
+    if (it == index_.end())
+      throw KeyError("query result has no such field " + field);
+    return it->second;
+  }
+
+  /// names of each field, in column order
+  const std::vector<std::string>& fields() const { return fields_; }
+
+  /// types of each field, in column order
+  const std::vector<DbTypes>& types() const { return types_; }
+
+  /// Returns the number of rows.
+  size_t nrows() const { return cols_.empty() ? 0 : cols_[0]->size(); }
+
+  /// Returns column j.
+  QueryColumn* column(int j) { return cols_[j]; }
+
+  const QueryColumn* column(int j) const { return cols_[j]; }
+
+  /// Returns the values of column j, which must be stored as T (see
+  /// NewQueryColumn).  Throws a ValueError otherwise.
+  template <class T>
+  std::vector<T>& Column(int j) {
+    TypedColumn<T>* c = dynamic_cast<TypedColumn<T>*>(cols_.at(j));
+    if (c == NULL) {
+      throw ValueError("query result field " + fields_[j] +
+                       " is not stored as the requested type");
+    }
+    return c->values;
+  }
+
+  template <class T>
+  std::vector<T>& Column(const std::string& field) {
+    return Column<T>(FieldIndex(field));
+  }
+
+  /// Returns the value of column j in row i.
+  boost::spirit::hold_any Get(int j, size_t i) const {
+    return cols_.at(j)->Get(i);
+  }
+
+  /// Convenience method for retrieving a value from a specific row and named
+  /// field, in the manner of QueryResult::GetVal.
+  template <class T>
+  T GetVal(const std::string& field, size_t row = 0) {
+    int j = FieldIndex(field);
+    if (row >= nrows()) {
+      throw KeyError("index larger than number of query rows for field "
+                     + field);
+    }
+    TypedColumn<T>* c = dynamic_cast<TypedColumn<T>*>(cols_[j]);
+    if (c != NULL)
+      return c->values[row];
+    return cols_[j]->Get(row).template cast<T>();
+  }
+
+  /// Appends a row given in column order.
+  void AppendRow(const QueryRow& row) {
+    for (int j = 0; j < cols_.size(); ++j)
+      cols_[j]->Append(row[j]);
+  }
+
+  /// Appends all rows of qr, which must have the same fields.  Fields and
+  /// types are taken from qr if this result has no columns yet.
+  void Append(const QueryResult& qr) {
+    if (cols_.empty()) {
+      for (int j = 0; j < qr.fields.size(); ++j)
+        AddColumn(qr.fields[j], qr.types[j]);
+    }
+    for (int j = 0; j < cols_.size(); ++j)
+      cols_[j]->Reserve(cols_[j]->size() + qr.rows.size());
+    for (int i = 0; i < qr.rows.size(); ++i)
+      AppendRow(qr.rows[i]);
+  }
+
+  /// Exchanges the contents of this result with other without copying.
+  void swap(ColumnarResult& other) {
+    fields_.swap(other.fields_);
+    types_.swap(other.types_);
+    index_.swap(other.index_);
+    cols_.swap(other.cols_);
+  }
+
+  /// Removes all columns.
+  void Reset() {
+    for (int j = 0; j < cols_.size(); ++j)
+      delete cols_[j];
+    cols_.clear();
+    fields_.clear();
+    types_.clear();
+    index_.clear();
+  }
+
+ private:
+  std::vector<std::string> fields_;
+  std::vector<DbTypes> types_;
+  std::map<std::string, int> index_;
+  std::vector<QueryColumn*> cols_;
+};
+
+/// Returns the value of a numeric (INT, BOOL, FLOAT or DOUBLE) database type
+/// as a double.  Throws a ValueError for any other type.
+inline double AggNumber(const boost::spirit::hold_any& v, DbTypes type) {
+  switch (type) {
+    case INT:
+      return v.cast<int>();
+    case BOOL:
+      return v.cast<bool>();
+    case FLOAT:
+      return v.cast<float>();
+    case DOUBLE:
+      return v.cast<double>();
+    default:
+      throw ValueError("only numeric columns may be aggregated");
+  }
+}
+
+/// Returns the fields and types of the result of an aggregate query: the
+/// group_by columns followed by one column per aggregate.  COUNT is an INT,
+/// SUM a DOUBLE, and MIN and MAX keep the type of their column.  Throws a
+/// KeyError for unknown columns and a ValueError for aggregates of
+/// non-numeric columns other than COUNT.
+inline QueryResult AggregateInfo(const std::map<std::string, DbTypes>& coltypes,
+                                 const std::vector<std::string>& group_by,
+                                 const std::vector<Agg>& aggs) {
+  QueryResult info;
+  std::map<std::string, DbTypes>::const_iterator it;
+  for (int i = 0; i < group_by.size(); ++i) {
+    it = coltypes.find(group_by[i]);
+    if (it == coltypes.end())
+      throw KeyError("query result has no such field " + group_by[i]);
+    info.fields.push_back(group_by[i]);
+    info.types.push_back(it->second);
+  }
+  for (int k = 0; k < aggs.size(); ++k) {
+    it = coltypes.find(aggs[k].field);
+    if (it == coltypes.end())
+      throw KeyError("query result has no such field " + aggs[k].field);
+    DbTypes t = it->second;
+    if (aggs[k].opcode != AGG_COUNT && t != INT && t != BOOL && t != FLOAT &&
+        t != DOUBLE) {
+      throw ValueError("cannot compute " + aggs[k].name() +
+                       " of a non-numeric column");
+    }
+    info.fields.push_back(aggs[k].name());
+    if (aggs[k].opcode == AGG_COUNT)
+      info.types.push_back(INT);
+    else if (aggs[k].opcode == AGG_SUM)
+      info.types.push_back(DOUBLE);
+    else
+      info.types.push_back(t);
+  }
+  return info;
+}
+
+/// The running aggregates of a single group of an aggregate query.
+class AggAccum {
+ public:
+  AggAccum() : count(0) {}
+
+  /// Folds one row into the group, given the numeric value of each aggregated
+  /// column in x (values of COUNT aggregates are ignored).
+  void Add(const std::vector<Agg>& aggs, const std::vector<double>& x) {
+    if (count == 0)
+      vals = x;
+    for (int k = 0; k < aggs.size(); ++k) {
+      if (count == 0) {
+        if (aggs[k].opcode == AGG_COUNT)
+          vals[k] = 0;
+        continue;
+      }
+      switch (aggs[k].opcode) {
+        case AGG_SUM:
+          vals[k] += x[k];
+          break;
+        case AGG_MIN:
+          vals[k] = std::min(vals[k], x[k]);
+          break;
+        case AGG_MAX:
+          vals[k] = std::max(vals[k], x[k]);
+          break;
+        default:
+          break;
+      }
+    }
+    ++count;
+  }
+
+  /// Appends the final aggregate values to row, as the types given by
+  /// AggregateInfo.  Aggregates of an empty group are zero.
+  void Values(const std::vector<Agg>& aggs, const std::vector<DbTypes>& types,
+              QueryRow* row) const {
+    for (int k = 0; k < aggs.size(); ++k) {
+      if (aggs[k].opcode == AGG_COUNT) {
+        row->push_back(boost::spirit::hold_any(count));
+        continue;
+      }
+      double v = count == 0 ? 0 : vals[k];
+      switch (types[k]) {
+        case INT:
+          row->push_back(boost::spirit::hold_any(static_cast<int>(v)));
+          break;
+        case BOOL:
+          row->push_back(boost::spirit::hold_any(v != 0));
+          break;
+        case FLOAT:
+          row->push_back(boost::spirit::hold_any(static_cast<float>(v)));
+          break;
+        default:
+          row->push_back(boost::spirit::hold_any(v));
+      }
+    }
+  }
+
+  /// number of rows in the group
+  int count;
+
+  /// running value of each aggregate
+  std::vector<double> vals;
+};
+
+/// Orders rows of scalar, string, uuid and blob values field by field, for
+/// grouping rows in a std::map.
+class RowLess {
+ public:
+  RowLess(const std::vector<DbTypes>& types) : types_(types) {}
+
+  bool operator()(const QueryRow& a, const QueryRow& b) const {
+    for (int j = 0; j < types_.size(); ++j) {
+      int c = Cmp(a[j], b[j], types_[j]);
+      if (c != 0)
+        return c < 0;
+    }
+    return false;
+  }
+
+ private:
+  template <class T>
+  static int Cmp3(const T& x, const T& y) {
+    return x < y ? -1 : (y < x ? 1 : 0);
+  }
+
+  static int Cmp(const boost::spirit::hold_any& x,
+                 const boost::spirit::hold_any& y, DbTypes type) {
+    switch (type) {
+      case INT:
+        return Cmp3(x.cast<int>(), y.cast<int>());
+      case BOOL:
+        return Cmp3(x.cast<bool>(), y.cast<bool>());
+      case FLOAT:
+        return Cmp3(x.cast<float>(), y.cast<float>());
+      case DOUBLE:
+        return Cmp3(x.cast<double>(), y.cast<double>());
+      case STRING:
+      case VL_STRING:
+        return x.cast<std::string>().compare(y.cast<std::string>());
+      case BLOB:
+        return x.cast<Blob>().str().compare(y.cast<Blob>().str());
+      case UUID:
+        return Cmp3(x.cast<boost::uuids::uuid>(),
+                    y.cast<boost::uuids::uuid>());
+      default:
+        throw ValueError("cannot group by a container column");
+    }
+  }
+
+  std::vector<DbTypes> types_;
+};
+
 /// Represents column information.
 struct ColumnInfo {
   ColumnInfo() {};
@@ -463,6 +1110,82 @@ struct ColumnInfo {
   std::vector<int> shape;
 };
 
+/// Returns the index in fields of each of the columns in cols, in order.
+/// Throws a KeyError if a column is not present and a ValueError if no
+/// columns are given.
+inline std::vector<int> ProjectionIndices(const std::vector<std::string>& fields,
+                                          const std::vector<std::string>& cols) {
+  if (cols.empty())
+    throw ValueError("column projection requires at least one column");
+  std::vector<int> idx(cols.size(), -1);
+  for (int k = 0; k < cols.size(); ++k) {
+    for (int i = 0; i < fields.size(); ++i) {
+      if (fields[i] == cols[k]) {
+        idx[k] = i;
+        break;
+      }
+    }
+    if (idx[k] == -1)
+      throw KeyError("query result has no such field " + cols[k]);
+  }
+  return idx;
+}
+
+/// Iterates over the rows of a query in fixed-size batches, so that results
+/// larger than memory can be processed incrementally. Cursors are obtained
+/// from QueryableBackend::Cursor and must not outlive their backend.
+///
+/// @code
+///
+/// QueryCursor::Ptr c = back->Cursor("Resources", NULL);
+/// QueryResult batch;
+/// while (c->Next(&batch, 10000)) {
+///   for (int i = 0; i < batch.rows.size(); ++i) {
+///     total += batch.GetVal<double>("Quantity", i);
+///   }
+/// }
+///
+/// @endcode
+class QueryCursor {
+ public:
+  typedef boost::shared_ptr<QueryCursor> Ptr;
+
+  virtual ~QueryCursor() {}
+
+  /// Replaces the rows of batch with at most n of the next matching rows and
+  /// sets its fields and types. Returns false, leaving batch without rows,
+  /// once the query is exhausted.
+  virtual bool Next(QueryResult* batch, int n) = 0;
+};
+
+/// A cursor over a query result that has already been read into memory.
+/// This is what backends without native cursor support return.
+class ResultCursor : public QueryCursor {
+ public:
+  explicit ResultCursor(QueryResult qr) : pos_(0) {
+    qr_.fields.swap(qr.fields);
+    qr_.types.swap(qr.types);
+    qr_.rows.swap(qr.rows);
+  }
+
+  virtual bool Next(QueryResult* batch, int n) {
+    if (n < 1)
+      throw ValueError("query cursor batch size must be positive");
+    batch->fields = qr_.fields;
+    batch->types = qr_.types;
+    batch->rows.clear();
+    for (; pos_ < qr_.rows.size() && batch->rows.size() < n; ++pos_) {
+      batch->rows.push_back(QueryRow());
+      batch->rows.back().swap(qr_.rows[pos_]);
+    }
+    return !batch->rows.empty();
+  }
+
+ private:
+  QueryResult qr_;
+  size_t pos_;
+};
+
 /// Interface implemented by backends that support rudimentary querying.
 class QueryableBackend {
  public:
@@ -472,6 +1195,133 @@ class QueryableBackend {
   /// conditions.  Conditions are AND'd together.  conds may be NULL.
   virtual QueryResult Query(std::string table, std::vector<Cond>* conds) = 0;
 
+  /// Return a set of rows from the specificed table that match all given
+  /// conditions, holding only the named columns in the order given.
+  /// Conditions may reference columns that are not returned. Backends
+  /// should override this to avoid reading unrequested columns; the default
+  /// projects the result of the full query.
+  virtual QueryResult Query(std::string table,
+                            const std::vector<std::string>& cols,
+                            std::vector<Cond>* conds) {
+    QueryResult full = Query(table, conds);
+    std::vector<int> idx = ProjectionIndices(full.fields, cols);
+    QueryResult qr;
+    for (int k = 0; k < idx.size(); ++k) {
+      qr.fields.push_back(full.fields[idx[k]]);
+      qr.types.push_back(full.types[idx[k]]);
+    }
+    // a column requested more than once is copied until its last use
+    std::vector<bool> copy(idx.size(), false);
+    for (int k = 0; k < idx.size(); ++k)
+      copy[k] = std::find(idx.begin() + k + 1, idx.end(), idx[k]) != idx.end();
+    qr.rows.resize(full.rows.size(), QueryRow(idx.size()));
+    for (int i = 0; i < full.rows.size(); ++i) {
+      for (int k = 0; k < idx.size(); ++k) {
+        if (copy[k])
+          qr.rows[i][k] = full.rows[i][idx[k]];
+        else
+          qr.rows[i][k].swap(full.rows[i][idx[k]]);
+      }
+    }
+    return qr;
+  }
+
+  /// Return a cursor that yields the rows of the specified table matching all
+  /// given conditions in batches.  conds may be NULL and is not referenced
+  /// after this returns.  Backends should override this to read rows
+  /// incrementally; the default runs the full query up front.
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  std::vector<Cond>* conds) {
+    return QueryCursor::Ptr(new ResultCursor(Query(table, conds)));
+  }
+
+  /// Return a cursor that yields only the named columns of the matching rows.
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  const std::vector<std::string>& cols,
+                                  std::vector<Cond>* conds) {
+    return QueryCursor::Ptr(new ResultCursor(Query(table, cols, conds)));
+  }
+
+  /// Return the rows of the specified table matching all given conditions,
+  /// stored by column.  Backends may override this to fill the columns
+  /// directly; the default reads the table through Cursor.
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       std::vector<Cond>* conds) {
+    return ColumnarFromCursor(Cursor(table, conds));
+  }
+
+  /// Return only the named columns of the matching rows, stored by column.
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       const std::vector<std::string>& cols,
+                                       std::vector<Cond>* conds) {
+    return ColumnarFromCursor(Cursor(table, cols, conds));
+  }
+
+  /// Return one row for each distinct combination of values of the group_by
+  /// columns among the rows matching all given conditions, holding those
+  /// values followed by the aggregates of the group (see AggregateInfo).
+  /// With no group_by columns a single row aggregates the whole table. Row
+  /// order is unspecified.  Backends should override this to aggregate
+  /// natively; the default streams the table through Cursor.
+  virtual QueryResult Aggregate(std::string table,
+                                const std::vector<std::string>& group_by,
+                                const std::vector<Agg>& aggs,
+                                std::vector<Cond>* conds) {
+    QueryResult qr = AggregateInfo(ColumnTypes(table), group_by, aggs);
+    int ngroup = group_by.size();
+    int naggs = aggs.size();
+    // read each needed column once, even if it is aggregated several times
+    std::vector<std::string> cols;
+    std::vector<int> group_idx(ngroup);
+    std::vector<int> agg_idx(naggs);
+    for (int j = 0; j < ngroup + naggs; ++j) {
+      const std::string& f = j < ngroup ? group_by[j] : aggs[j - ngroup].field;
+      int idx = std::find(cols.begin(), cols.end(), f) - cols.begin();
+      if (idx == cols.size())
+        cols.push_back(f);
+      if (j < ngroup)
+        group_idx[j] = idx;
+      else
+        agg_idx[j - ngroup] = idx;
+    }
+    std::vector<DbTypes> group_types(qr.types.begin(),
+                                     qr.types.begin() + ngroup);
+    std::map<QueryRow, AggAccum, RowLess> groups((RowLess(group_types)));
+
+    // the types of the aggregated columns themselves
+    std::map<std::string, DbTypes> coltypes = ColumnTypes(table);
+    std::vector<DbTypes> agg_types(naggs);
+    for (int k = 0; k < naggs; ++k)
+      agg_types[k] = coltypes[aggs[k].field];
+
+    QueryCursor::Ptr c = Cursor(table, cols, conds);
+    QueryResult batch;
+    QueryRow key(ngroup);
+    std::vector<double> x(naggs, 0);
+    while (c->Next(&batch, 10000)) {
+      for (int i = 0; i < batch.rows.size(); ++i) {
+        QueryRow& row = batch.rows[i];
+        for (int j = 0; j < ngroup; ++j)
+          key[j] = row[group_idx[j]];
+        for (int k = 0; k < naggs; ++k) {
+          if (aggs[k].opcode != AGG_COUNT)
+            x[k] = AggNumber(row[agg_idx[k]], agg_types[k]);
+        }
+        groups[key].Add(aggs, x);
+      }
+    }
+    if (ngroup == 0 && groups.empty())
+      groups[key] = AggAccum();
+
+    std::vector<DbTypes> out_types(qr.types.begin() + ngroup, qr.types.end());
+    std::map<QueryRow, AggAccum, RowLess>::iterator it;
+    for (it = groups.begin(); it != groups.end(); ++it) {
+      qr.rows.push_back(it->first);
+      it->second.Values(aggs, out_types, &qr.rows.back());
+    }
+    return qr;
+  }
+
   /// Return a map of column names of the specified table to the associated
   /// database type.
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) = 0;
@@ -481,6 +1331,20 @@ class QueryableBackend {
   
   /// Return a set of all table names currently in the database.
   virtual std::set<std::string> Tables() = 0;
+
+ protected:
+  /// Drains a cursor into a columnar result, one batch at a time.
+  static ColumnarResult ColumnarFromCursor(QueryCursor::Ptr c) {
+    ColumnarResult cr;
+    QueryResult batch;
+    while (c->Next(&batch, 10000))
+      cr.Append(batch);
+    if (cr.fields().empty()) {
+      for (int j = 0; j < batch.fields.size(); ++j)
+        cr.AddColumn(batch.fields[j], batch.types[j]);
+    }
+    return cr;
+  }
 };
 
 /// Interface implemented by backends that support recording and querying.
@@ -509,6 +1373,89 @@ class CondInjector: public QueryableBackend {
     return b_->Query(table, &c);
   }
 
+  virtual QueryResult Query(std::string table,
+                            const std::vector<std::string>& cols,
+                            std::vector<Cond>* conds) {
+    if (conds == NULL) {
+      return b_->Query(table, cols, &to_inject_);
+    }
+
+    std::vector<Cond> c = *conds;
+    for (int i = 0; i < to_inject_.size(); ++i) {
+      c.push_back(to_inject_[i]);
+    }
+    return b_->Query(table, cols, &c);
+  }
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  std::vector<Cond>* conds) {
+    if (conds == NULL) {
+      return b_->Cursor(table, &to_inject_);
+    }
+
+    std::vector<Cond> c = *conds;
+    for (int i = 0; i < to_inject_.size(); ++i) {
+      c.push_back(to_inject_[i]);
+    }
+    return b_->Cursor(table, &c);
+  }
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  const std::vector<std::string>& cols,
+                                  std::vector<Cond>* conds) {
+    if (conds == NULL) {
+      return b_->Cursor(table, cols, &to_inject_);
+    }
+
+    std::vector<Cond> c = *conds;
+    for (int i = 0; i < to_inject_.size(); ++i) {
+      c.push_back(to_inject_[i]);
+    }
+    return b_->Cursor(table, cols, &c);
+  }
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       std::vector<Cond>* conds) {
+    if (conds == NULL) {
+      return b_->QueryColumnar(table, &to_inject_);
+    }
+
+    std::vector<Cond> c = *conds;
+    for (int i = 0; i < to_inject_.size(); ++i) {
+      c.push_back(to_inject_[i]);
+    }
+    return b_->QueryColumnar(table, &c);
+  }
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       const std::vector<std::string>& cols,
+                                       std::vector<Cond>* conds) {
+    if (conds == NULL) {
+      return b_->QueryColumnar(table, cols, &to_inject_);
+    }
+
+    std::vector<Cond> c = *conds;
+    for (int i = 0; i < to_inject_.size(); ++i) {
+      c.push_back(to_inject_[i]);
+    }
+    return b_->QueryColumnar(table, cols, &c);
+  }
+
+  virtual QueryResult Aggregate(std::string table,
+                                const std::vector<std::string>& group_by,
+                                const std::vector<Agg>& aggs,
+                                std::vector<Cond>* conds) {
+    if (conds == NULL) {
+      return b_->Aggregate(table, group_by, aggs, &to_inject_);
+    }
+
+    std::vector<Cond> c = *conds;
+    for (int i = 0; i < to_inject_.size(); ++i) {
+      c.push_back(to_inject_[i]);
+    }
+    return b_->Aggregate(table, group_by, aggs, &c);
+  }
+
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
     return b_->ColumnTypes(table);
   }
@@ -538,6 +1485,41 @@ class PrefixInjector: public QueryableBackend {
     return b_->Query(prefix_ + table, conds);
   }
 
+  virtual QueryResult Query(std::string table,
+                            const std::vector<std::string>& cols,
+                            std::vector<Cond>* conds) {
+    return b_->Query(prefix_ + table, cols, conds);
+  }
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  std::vector<Cond>* conds) {
+    return b_->Cursor(prefix_ + table, conds);
+  }
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  const std::vector<std::string>& cols,
+                                  std::vector<Cond>* conds) {
+    return b_->Cursor(prefix_ + table, cols, conds);
+  }
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       std::vector<Cond>* conds) {
+    return b_->QueryColumnar(prefix_ + table, conds);
+  }
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       const std::vector<std::string>& cols,
+                                       std::vector<Cond>* conds) {
+    return b_->QueryColumnar(prefix_ + table, cols, conds);
+  }
+
+  virtual QueryResult Aggregate(std::string table,
+                                const std::vector<std::string>& group_by,
+                                const std::vector<Agg>& aggs,
+                                std::vector<Cond>* conds) {
+    return b_->Aggregate(prefix_ + table, group_by, aggs, conds);
+  }
+
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table) {
     return b_->ColumnTypes(table);
   }
@@ -582,6 +1564,16 @@ inline bool CmpCond(T* x, Cond* cond) {
       rtn = (*x) != cond->val.cast<T>();
       break;
     }
+    case IN: {
+      // the set is already sorted, so this is a binary search probe
+      rtn = cond->val.cast<std::set<T> >().count(*x) > 0;
+      break;
+    }
+    case BETWEEN: {
+      const std::pair<T, T>& r = cond->val.cast<std::pair<T, T> >();
+      rtn = r.first <= (*x) && (*x) <= r.second;
+      break;
+    }
   }
   return rtn;
 }
@@ -596,6 +1588,84 @@ inline bool CmpConds(T* x, std::vector<Cond*>* conds) {
   return true;
 }
 
+/// Keeps the rows whose value in col, stored as T, satisfies cond.
+template <typename T>
+inline void FilterColumn(const QueryColumn* col, Cond* cond,
+                         std::vector<size_t>* rows) {
+  // values are compared in place; CmpCond does not modify them
+  std::vector<T>& vals = const_cast<std::vector<T>&>(
+      static_cast<const TypedColumn<T>*>(col)->values);
+  size_t n = 0;
+  for (size_t k = 0; k < rows->size(); ++k) {
+    if (CmpCond<T>(&vals[(*rows)[k]], cond))
+      (*rows)[n++] = (*rows)[k];
+  }
+  rows->resize(n);
+}
+
+/// std::vector<bool> elements are not addressable, so they are copied.
+template <>
+inline void FilterColumn<bool>(const QueryColumn* col, Cond* cond,
+                               std::vector<size_t>* rows) {
+  const std::vector<bool>& vals =
+      static_cast<const TypedColumn<bool>*>(col)->values;
+  size_t n = 0;
+  for (size_t k = 0; k < rows->size(); ++k) {
+    bool x = vals[(*rows)[k]];
+    if (CmpCond<bool>(&x, cond))
+      (*rows)[n++] = (*rows)[k];
+  }
+  rows->resize(n);
+}
+
+/// Blobs have no dedicated column storage.
+template <>
+inline void FilterColumn<Blob>(const QueryColumn* col, Cond* cond,
+                               std::vector<size_t>* rows) {
+  size_t n = 0;
+  for (size_t k = 0; k < rows->size(); ++k) {
+    Blob x = col->Get((*rows)[k]).cast<Blob>();
+    if (CmpCond<Blob>(&x, cond))
+      (*rows)[n++] = (*rows)[k];
+  }
+  rows->resize(n);
+}
+
+/// Removes from rows, a list of row indices into col, those whose value does
+/// not satisfy cond.  col must be stored as NewQueryColumn(type) would.
+/// Conditions are supported on INT, BOOL, FLOAT, DOUBLE, STRING, VL_STRING,
+/// UUID and BLOB columns; other types throw a ValueError.
+inline void FilterRows(const QueryColumn* col, DbTypes type, Cond* cond,
+                       std::vector<size_t>* rows) {
+  switch (type) {
+    case INT:
+      FilterColumn<int>(col, cond, rows);
+      break;
+    case BOOL:
+      FilterColumn<bool>(col, cond, rows);
+      break;
+    case FLOAT:
+      FilterColumn<float>(col, cond, rows);
+      break;
+    case DOUBLE:
+      FilterColumn<double>(col, cond, rows);
+      break;
+    case STRING:
+    case VL_STRING:
+      FilterColumn<std::string>(col, cond, rows);
+      break;
+    case UUID:
+      FilterColumn<boost::uuids::uuid>(col, cond, rows);
+      break;
+    case BLOB:
+      FilterColumn<Blob>(col, cond, rows);
+      break;
+    default:
+      throw ValueError("conditions on field " + cond->field +
+                       " are not supported for its type");
+  }
+}
+
 /// The digest type for SHA1s.
 ///
 /// This class is a hack around a language deficiency in C++. You cannot pass
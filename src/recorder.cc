@@ -10,6 +10,19 @@
 
 namespace cyclus {
 
+namespace {
+
+/// The recorder the calling thread is staging for and where its Datum
+/// objects go.
+struct Staging {
+  Recorder* rec;
+  DatumList* staged;
+};
+
+thread_local Staging staging = {NULL, NULL};
+
+}  // namespace
+
 Recorder::Recorder() : index_(0), inject_sim_id_(true) {
   uuid_ = boost::uuids::random_generator()();
   set_dump_count(kDefaultDumpCount);
@@ -40,6 +53,9 @@ Recorder::~Recorder() {
   for (int i = 0; i < data_.size(); ++i) {
     delete data_[i];
   }
+  for (int i = 0; i < spare_.size(); ++i) {
+    delete spare_[i];
+  }
 }
 
 unsigned int Recorder::dump_count() {
@@ -51,22 +67,34 @@ boost::uuids::uuid Recorder::sim_id() {
 }
 
 void Recorder::set_dump_count(unsigned int count) {
-  for (int i = 0; i < data_.size(); ++i) {
-    delete data_[i];
+  WaitFlush();
+  FillBuffer(&data_, count);
+  FillBuffer(&spare_, 0);
+  dump_count_ = count;
+}
+
+void Recorder::FillBuffer(DatumList* buf, unsigned int count) {
+  for (int i = 0; i < buf->size(); ++i) {
+    delete (*buf)[i];
   }
-  data_.clear();
-  data_.reserve(count);
+  buf->clear();
+  buf->reserve(count);
   for (int i = 0; i < count; ++i) {
     Datum* d = new Datum(this, "");
     if (inject_sim_id_) {
       d->AddVal("SimId", uuid_);
     }
-    data_.push_back(d);
+    buf->push_back(d);
   }
-  dump_count_ = count;
 }
 
 Datum* Recorder::NewDatum(std::string title) {
+  if (staging.rec == this) {
+    Datum* d = new Datum(this, title);
+    staging.staged->push_back(d);
+    return d;
+  }
+
   Datum* d = data_[index_];
   d->title_ = title;
   if (inject_sim_id_) {
@@ -84,12 +112,15 @@ Datum* Recorder::NewDatum(std::string title) {
 }
 
 void Recorder::AddDatum(Datum* d) {
+  if (staging.rec == this)
+    return;
   if (index_ >= data_.size()) {
     NotifyBackends();
   }
 }
 
 void Recorder::Flush() {
+  WaitFlush();
   if (index_ == 0)
     return;
   DatumList tmp = data_;
@@ -102,7 +133,45 @@ void Recorder::Flush() {
   }
 }
 
+void Recorder::FlushAsync() {
+  WaitFlush();
+  if (index_ == 0)
+    return;
+  if (spare_.size() != data_.size())
+    FillBuffer(&spare_, data_.size());
+  DatumList tmp = data_;
+  tmp.resize(index_);
+  data_.swap(spare_);
+  index_ = 0;
+  flusher_ = std::thread(&Recorder::FlushBackends, this, tmp);
+}
+
+void Recorder::FlushBackends(DatumList data) {
+  try {
+    std::list<RecBackend*>::iterator it;
+    for (it = backs_.begin(); it != backs_.end(); it++) {
+      (*it)->Notify(data);
+      (*it)->Flush();
+    }
+  } catch (std::exception& err) {
+    flush_error_ = err.what();
+  } catch (...) {
+    flush_error_ = "unknown error";
+  }
+}
+
+void Recorder::WaitFlush() {
+  if (flusher_.joinable())
+    flusher_.join();
+  if (!flush_error_.empty()) {
+    std::string msg = flush_error_;
+    flush_error_.clear();
+    throw IOError("background flush of recorded data failed: " + msg);
+  }
+}
+
 void Recorder::NotifyBackends() {
+  WaitFlush();
   index_ = 0;
   std::list<RecBackend*>::iterator it;
   for (it = backs_.begin(); it != backs_.end(); it++) {
@@ -111,6 +180,7 @@ void Recorder::NotifyBackends() {
 }
 
 void Recorder::RegisterBackend(RecBackend* b) {
+  WaitFlush();
   backs_.push_back(b);
 }
 
@@ -119,4 +189,33 @@ void Recorder::Close() {
   backs_.clear();
 }
 
+void Recorder::Stage(DatumList* staged) {
+  staging.rec = this;
+  staging.staged = staged;
+}
+
+void Recorder::Unstage() {
+  staging.rec = NULL;
+  staging.staged = NULL;
+}
+
+void Recorder::Commit(DatumList* staged) {
+  for (int i = 0; i < staged->size(); ++i) {
+    Datum* s = (*staged)[i];
+    Datum* d = NewDatum(s->title_);
+    d->vals_.insert(d->vals_.end(), s->vals_.begin(), s->vals_.end());
+    d->shapes_.insert(d->shapes_.end(), s->shapes_.begin(), s->shapes_.end());
+    d->fields_.insert(d->fields_.end(), s->fields_.begin(), s->fields_.end());
+    delete s;
+    AddDatum(d);
+  }
+  staged->clear();
+}
+
+void Recorder::Discard(DatumList* staged) {
+  for (int i = 0; i < staged->size(); ++i)
+    delete (*staged)[i];
+  staged->clear();
+}
+
 }  // namespace cyclus
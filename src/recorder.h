@@ -3,6 +3,7 @@
 
 #include <list>
 #include <string>
+#include <thread>
 #include <vector>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -110,15 +111,61 @@ class Recorder {
   /// Flushes all buffered Datum objects and flushes all registered backends.
   void Flush();
 
+  /// Hands the buffered Datum objects to a background thread that notifies
+  /// and flushes all registered backends, and returns without waiting for
+  /// it.  Datum objects recorded meanwhile go to a second buffer.  Anything
+  /// that reaches the backends again first waits for the background flush
+  /// to finish, and throws an IOError if it failed.
+  ///
+  /// @warning backends are written from the background thread, so they must
+  /// not be queried until the flush is done, e.g. after the next Flush or
+  /// Close.
+  void FlushAsync();
+
   /// Flushes all buffered Datum objects and flushes all registered backends.
   /// Unregisters all backends and resets.
   void Close();
 
+  /// Makes the Datum objects created by the calling thread from now on go to
+  /// staged rather than to the backends, until Unstage is called.  This lets
+  /// several threads record at once: each stages its own Datum objects, and
+  /// the stages are then committed one after another by a single thread, in
+  /// an order that does not depend on thread scheduling.
+  ///
+  /// @param staged receives the Datum objects, which it owns until they are
+  /// committed or discarded
+  void Stage(DatumList* staged);
+
+  /// Ends staging on the calling thread.
+  void Unstage();
+
+  /// Records the Datum objects of staged in order and empties it.  Must not
+  /// be called while the calling thread is staging.
+  void Commit(DatumList* staged);
+
+  /// Deletes the Datum objects of staged without recording them and empties
+  /// it.
+  void Discard(DatumList* staged);
+
  private:
   void NotifyBackends();
   void AddDatum(Datum* d);
 
+  /// Fills buf with count reusable Datum objects.
+  void FillBuffer(DatumList* buf, unsigned int count);
+
+  /// Notifies and flushes the backends from the background flush thread.
+  void FlushBackends(DatumList data);
+
+  /// Waits for the background flush, if any, to finish.
+  void WaitFlush();
+
   DatumList data_;
+  /// the buffer being flushed in the background, or to be used next
+  DatumList spare_;
+  std::thread flusher_;
+  /// the error of the last background flush, if it failed
+  std::string flush_error_;
   int index_;
   std::list<RecBackend*> backs_;
   unsigned int dump_count_;
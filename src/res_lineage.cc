@@ -0,0 +1,295 @@
+#include "res_lineage.h"
+
+#include <algorithm>
+#include <set>
+
+#include <boost/lexical_cast.hpp>
+
+#include "error.h"
+
+namespace cyclus {
+
+namespace {
+
+/// Orders row indices by the value of their key.
+struct KeyLess {
+  explicit KeyLess(const std::vector<int>& keys) : keys(keys) {}
+  bool operator()(int i, int j) const { return keys[i] < keys[j]; }
+  const std::vector<int>& keys;
+};
+
+/// Returns the row order that stably sorts keys, or an empty vector if keys
+/// are already sorted, as they usually are since ids are recorded in order.
+std::vector<int> SortOrder(const std::vector<int>& keys) {
+  std::vector<int> order;
+  if (std::is_sorted(keys.begin(), keys.end()))
+    return order;
+  order.resize(keys.size());
+  for (int i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), KeyLess(keys));
+  return order;
+}
+
+/// Reorders v so that its i-th element is the order[i]-th one.
+template <typename T>
+void Permute(const std::vector<int>& order, std::vector<T>* v) {
+  if (order.empty())
+    return;
+  std::vector<T> tmp;
+  tmp.reserve(v->size());
+  for (int i = 0; i < order.size(); ++i)
+    tmp.push_back((*v)[order[i]]);
+  v->swap(tmp);
+}
+
+}  // namespace
+
+ResLineage::ResLineage(QueryableBackend* b, int batch_size) {
+  Load(b, NULL, batch_size);
+}
+
+ResLineage::ResLineage(QueryableBackend* b, boost::uuids::uuid simid,
+                       int batch_size) {
+  std::vector<Cond> conds;
+  conds.push_back(Cond("SimId", "==", simid));
+  Load(b, &conds, batch_size);
+}
+
+void ResLineage::Load(QueryableBackend* b, std::vector<Cond>* conds,
+                      int batch_size) {
+  if (batch_size < 1)
+    throw ValueError("lineage batch size must be positive");
+  std::set<std::string> tables = b->Tables();
+  LoadResources(b, conds, batch_size);
+  if (tables.count("Compositions") > 0)
+    LoadCompositions(b, conds, batch_size);
+  if (tables.count("Transactions") > 0)
+    LoadTransactions(b, conds, batch_size);
+}
+
+void ResLineage::LoadResources(QueryableBackend* b, std::vector<Cond>* conds,
+                               int batch_size) {
+  std::vector<std::string> cols;
+  cols.push_back("ResourceId");
+  cols.push_back("Parent1");
+  cols.push_back("Parent2");
+  cols.push_back("QualId");
+  cols.push_back("TimeCreated");
+  cols.push_back("Quantity");
+  cols.push_back("Type");
+  QueryCursor::Ptr cur = b->Cursor("Resources", cols, conds);
+  QueryResult batch;
+  while (cur->Next(&batch, batch_size)) {
+    for (int i = 0; i < batch.rows.size(); ++i) {
+      QueryRow& r = batch.rows[i];
+      ids_.push_back(r[0].cast<int>());
+      parent1_.push_back(r[1].cast<int>());
+      parent2_.push_back(r[2].cast<int>());
+      quals_.push_back(r[3].cast<int>());
+      times_.push_back(r[4].cast<int>());
+      qtys_.push_back(r[5].cast<double>());
+      mats_.push_back(r[6].cast<std::string>() == "Material");
+    }
+  }
+
+  std::vector<int> order = SortOrder(ids_);
+  Permute(order, &ids_);
+  Permute(order, &parent1_);
+  Permute(order, &parent2_);
+  Permute(order, &quals_);
+  Permute(order, &times_);
+  Permute(order, &qtys_);
+  Permute(order, &mats_);
+
+  // invert the parent links into a compressed child list
+  int n = ids_.size();
+  child_off_.assign(n + 1, 0);
+  std::vector<int> prow(2 * n);
+  for (int i = 0; i < n; ++i) {
+    prow[2 * i] = Row(parent1_[i]);
+    prow[2 * i + 1] = parent2_[i] == parent1_[i] ? -1 : Row(parent2_[i]);
+    for (int k = 2 * i; k < 2 * i + 2; ++k) {
+      if (prow[k] >= 0)
+        ++child_off_[prow[k] + 1];
+    }
+  }
+  for (int i = 0; i < n; ++i)
+    child_off_[i + 1] += child_off_[i];
+  child_rows_.resize(child_off_[n]);
+  std::vector<int> fill(child_off_.begin(), child_off_.end() - 1);
+  for (int i = 0; i < n; ++i) {
+    for (int k = 2 * i; k < 2 * i + 2; ++k) {
+      if (prow[k] >= 0)
+        child_rows_[fill[prow[k]]++] = i;
+    }
+  }
+}
+
+void ResLineage::LoadCompositions(QueryableBackend* b,
+                                  std::vector<Cond>* conds, int batch_size) {
+  std::vector<std::string> cols;
+  cols.push_back("QualId");
+  cols.push_back("NucId");
+  cols.push_back("MassFrac");
+  std::vector<int> quals;
+  QueryCursor::Ptr cur = b->Cursor("Compositions", cols, conds);
+  QueryResult batch;
+  while (cur->Next(&batch, batch_size)) {
+    for (int i = 0; i < batch.rows.size(); ++i) {
+      QueryRow& r = batch.rows[i];
+      quals.push_back(r[0].cast<int>());
+      nucs_.push_back(r[1].cast<int>());
+      fracs_.push_back(r[2].cast<double>());
+    }
+  }
+
+  std::vector<int> order = SortOrder(quals);
+  Permute(order, &quals);
+  Permute(order, &nucs_);
+  Permute(order, &fracs_);
+
+  // compositions are recorded as given, so normalize them here
+  for (int i = 0; i < quals.size();) {
+    int j = i;
+    double tot = 0;
+    for (; j < quals.size() && quals[j] == quals[i]; ++j)
+      tot += fracs_[j];
+    for (int k = i; k < j && tot > 0; ++k)
+      fracs_[k] /= tot;
+    qual_ids_.push_back(quals[i]);
+    qual_off_.push_back(i);
+    i = j;
+  }
+  qual_off_.push_back(quals.size());
+}
+
+void ResLineage::LoadTransactions(QueryableBackend* b,
+                                  std::vector<Cond>* conds, int batch_size) {
+  std::vector<std::string> cols;
+  cols.push_back("Time");
+  cols.push_back("SenderId");
+  cols.push_back("ReceiverId");
+  cols.push_back("ResourceId");
+  QueryCursor::Ptr cur = b->Cursor("Transactions", cols, conds);
+  QueryResult batch;
+  while (cur->Next(&batch, batch_size)) {
+    for (int i = 0; i < batch.rows.size(); ++i) {
+      QueryRow& r = batch.rows[i];
+      trans_times_.push_back(r[0].cast<int>());
+      senders_.push_back(r[1].cast<int>());
+      receivers_.push_back(r[2].cast<int>());
+      trans_res_.push_back(r[3].cast<int>());
+    }
+  }
+
+  std::vector<int> order = SortOrder(trans_times_);
+  Permute(order, &trans_times_);
+  Permute(order, &senders_);
+  Permute(order, &receivers_);
+  Permute(order, &trans_res_);
+}
+
+int ResLineage::Row(int resid) const {
+  std::vector<int>::const_iterator it =
+      std::lower_bound(ids_.begin(), ids_.end(), resid);
+  if (it == ids_.end() || *it != resid)
+    return -1;
+  return it - ids_.begin();
+}
+
+int ResLineage::MustRow(int resid) const {
+  int row = Row(resid);
+  if (row < 0) {
+    throw KeyError("resource state " + boost::lexical_cast<std::string>(resid)
+                   + " not found in the Resources table");
+  }
+  return row;
+}
+
+std::vector<int> ResLineage::Parents(int resid) const {
+  int row = MustRow(resid);
+  std::vector<int> rtn;
+  if (parent1_[row] > 0)
+    rtn.push_back(parent1_[row]);
+  if (parent2_[row] > 0 && parent2_[row] != parent1_[row])
+    rtn.push_back(parent2_[row]);
+  return rtn;
+}
+
+std::vector<int> ResLineage::Children(int resid) const {
+  int row = MustRow(resid);
+  std::vector<int> rtn;
+  for (int k = child_off_[row]; k < child_off_[row + 1]; ++k)
+    rtn.push_back(ids_[child_rows_[k]]);
+  return rtn;
+}
+
+std::vector<int> ResLineage::Ancestors(int resid) const {
+  std::set<int> seen;
+  std::vector<int> stack = Parents(resid);
+  while (!stack.empty()) {
+    int id = stack.back();
+    stack.pop_back();
+    int row = Row(id);
+    if (row < 0 || !seen.insert(id).second)
+      continue;  // untracked parent or already visited
+    stack.push_back(parent1_[row]);
+    stack.push_back(parent2_[row]);
+  }
+  return std::vector<int>(seen.begin(), seen.end());
+}
+
+std::vector<int> ResLineage::Descendants(int resid) const {
+  std::set<int> seen;
+  std::vector<int> stack(1, MustRow(resid));
+  while (!stack.empty()) {
+    int row = stack.back();
+    stack.pop_back();
+    for (int k = child_off_[row]; k < child_off_[row + 1]; ++k) {
+      int child = child_rows_[k];
+      if (seen.insert(ids_[child]).second)
+        stack.push_back(child);
+    }
+  }
+  return std::vector<int>(seen.begin(), seen.end());
+}
+
+std::map<int, double> ResLineage::MassFracs(int qualid) const {
+  std::map<int, double> rtn;
+  std::vector<int>::const_iterator it =
+      std::lower_bound(qual_ids_.begin(), qual_ids_.end(), qualid);
+  if (it == qual_ids_.end() || *it != qualid)
+    return rtn;
+  int k = it - qual_ids_.begin();
+  for (int i = qual_off_[k]; i < qual_off_[k + 1]; ++i)
+    rtn[nucs_[i]] += fracs_[i];
+  return rtn;
+}
+
+std::map<int, double> ResLineage::Flow(int sender, int receiver, int t0,
+                                       int t1) const {
+  std::map<int, double> rtn;
+  int begin = std::lower_bound(trans_times_.begin(), trans_times_.end(), t0) -
+              trans_times_.begin();
+  int end = std::upper_bound(trans_times_.begin(), trans_times_.end(), t1) -
+            trans_times_.begin();
+  for (int i = begin; i < end; ++i) {
+    if ((sender != -1 && senders_[i] != sender) ||
+        (receiver != -1 && receivers_[i] != receiver))
+      continue;
+    int row = Row(trans_res_[i]);
+    if (row < 0 || !mats_[row])
+      continue;
+    std::vector<int>::const_iterator it = std::lower_bound(
+        qual_ids_.begin(), qual_ids_.end(), quals_[row]);
+    if (it == qual_ids_.end() || *it != quals_[row])
+      continue;
+    int k = it - qual_ids_.begin();
+    for (int j = qual_off_[k]; j < qual_off_[k + 1]; ++j)
+      rtn[nucs_[j]] += qtys_[row] * fracs_[j];
+  }
+  return rtn;
+}
+
+}  // namespace cyclus
@@ -0,0 +1,130 @@
+#ifndef CYCLUS_SRC_RES_LINEAGE_H_
+#define CYCLUS_SRC_RES_LINEAGE_H_
+
+#include <map>
+#include <vector>
+
+#include "query_backend.h"
+
+namespace cyclus {
+
+/// Answers resource lineage and material flow queries over the Resources,
+/// Transactions and Compositions tables of a simulation's output.
+///
+/// The constructor streams each table once through QueryableBackend::Cursor
+/// into flat arrays sorted by ResourceId, QualId and transaction time, so
+/// that lookups are binary searches rather than joins.  Memory use is about
+/// 36 bytes per resource state and 16 bytes per composition entry.  For
+/// example:
+///
+/// @code
+///
+/// ResLineage lin(back);
+/// std::vector<int> anc = lin.Ancestors(resid);
+///
+/// // mass of each nuclide sent from agent 14 to agent 20 in timesteps 0-119
+/// std::map<int, double> flow = lin.Flow(14, 20, 0, 119);
+///
+/// @endcode
+class ResLineage {
+ public:
+  /// Builds the indexes from the output tables of b, reading at most
+  /// batch_size rows into memory at a time.  A missing Transactions or
+  /// Compositions table is treated as empty.  All rows are read, so b must
+  /// hold a single simulation; use the simid overload (or wrap b in a
+  /// CondInjector) otherwise.
+  ResLineage(QueryableBackend* b, int batch_size = 100000);
+
+  /// Builds the indexes from the rows of b recorded by the simulation simid.
+  ResLineage(QueryableBackend* b, boost::uuids::uuid simid,
+             int batch_size = 100000);
+
+  /// Returns the number of indexed resource states.
+  int size() const { return ids_.size(); }
+
+  /// Returns true if the resource state resid is indexed.
+  bool Has(int resid) const { return Row(resid) >= 0; }
+
+  /// Returns the quantity of the resource state resid.
+  double Quantity(int resid) const { return qtys_[MustRow(resid)]; }
+
+  /// Returns the quality (composition or product) id of resid.
+  int QualId(int resid) const { return quals_[MustRow(resid)]; }
+
+  /// Returns true if resid is a material rather than a product.
+  bool IsMaterial(int resid) const { return mats_[MustRow(resid)]; }
+
+  /// Returns the time step in which resid was created.
+  int TimeCreated(int resid) const { return times_[MustRow(resid)]; }
+
+  /// Returns the ids of the zero, one or two direct parents of resid.
+  std::vector<int> Parents(int resid) const;
+
+  /// Returns the ids of the resource states that were directly created from
+  /// resid, in ascending order.
+  std::vector<int> Children(int resid) const;
+
+  /// Returns the ids of every resource state that resid was derived from,
+  /// i.e. its parents, their parents and so on, in ascending order.
+  std::vector<int> Ancestors(int resid) const;
+
+  /// Returns the ids of every resource state derived from resid, in
+  /// ascending order.
+  std::vector<int> Descendants(int resid) const;
+
+  /// Returns the normalized mass fraction of each nuclide in the composition
+  /// qualid, which is empty for unknown ids and products.
+  std::map<int, double> MassFracs(int qualid) const;
+
+  /// Returns the mass of each nuclide moved from sender to receiver in
+  /// transactions with t0 <= Time <= t1.  A sender or receiver id of -1
+  /// matches any agent.  Products have no composition and are ignored.
+  std::map<int, double> Flow(int sender, int receiver, int t0, int t1) const;
+
+ private:
+  /// Returns the row of resid, or -1 if it is not indexed.
+  int Row(int resid) const;
+
+  /// Returns the row of resid, throwing KeyError if it is not indexed.
+  int MustRow(int resid) const;
+
+  /// Loads the tables, reading only the rows that match conds.
+  void Load(QueryableBackend* b, std::vector<Cond>* conds, int batch_size);
+
+  void LoadResources(QueryableBackend* b, std::vector<Cond>* conds,
+                     int batch_size);
+  void LoadTransactions(QueryableBackend* b, std::vector<Cond>* conds,
+                        int batch_size);
+  void LoadCompositions(QueryableBackend* b, std::vector<Cond>* conds,
+                        int batch_size);
+
+  // resource states, one row each, sorted by id
+  std::vector<int> ids_;
+  std::vector<int> parent1_;
+  std::vector<int> parent2_;
+  std::vector<int> quals_;
+  std::vector<int> times_;
+  std::vector<double> qtys_;
+  std::vector<bool> mats_;
+
+  // child rows of row i are child_rows_[child_off_[i]:child_off_[i + 1]]
+  std::vector<int> child_off_;
+  std::vector<int> child_rows_;
+
+  // composition entries of qual_ids_[k] are
+  // nucs_[qual_off_[k]:qual_off_[k + 1]] and likewise for fracs_
+  std::vector<int> qual_ids_;
+  std::vector<int> qual_off_;
+  std::vector<int> nucs_;
+  std::vector<double> fracs_;
+
+  // transactions sorted by time
+  std::vector<int> trans_times_;
+  std::vector<int> senders_;
+  std::vector<int> receivers_;
+  std::vector<int> trans_res_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_RES_LINEAGE_H_
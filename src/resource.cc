@@ -1,13 +1,21 @@
 #include "resource.h"
 
+#include "parallel.h"
+
 namespace cyclus {
 
-int Resource::nextstate_id_ = 1;
-int Resource::nextobj_id_ = 1;
+std::atomic<int> Resource::nextstate_id_(1);
+std::atomic<int> Resource::nextobj_id_(1);
+
+Resource::Resource() {
+  TaskTurns::Wait();
+  state_id_ = nextstate_id_++;
+  obj_id_ = nextobj_id_++;
+}
 
 void Resource::BumpStateId() {
-  state_id_ = nextstate_id_;
-  nextstate_id_++;
+  TaskTurns::Wait();
+  state_id_ = nextstate_id_++;
 }
 
 }  // namespace cyclus
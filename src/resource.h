@@ -1,6 +1,7 @@
 #ifndef CYCLUS_SRC_RESOURCE_H_
 #define CYCLUS_SRC_RESOURCE_H_
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <boost/shared_ptr.hpp>
@@ -23,7 +24,7 @@ class Resource {
  public:
   typedef boost::shared_ptr<Resource> Ptr;
 
-  Resource() : state_id_(nextstate_id_++), obj_id_(nextobj_id_++) {}
+  Resource();
 
   virtual ~Resource() {}
 
@@ -80,8 +81,11 @@ class Resource {
   virtual Ptr ExtractRes(double quantity) = 0;
 
  private:
-  static int nextstate_id_;
-  static int nextobj_id_;
+  /// the next ids, taken atomically since agents ticking concurrently (see
+  /// TimeListener) may create resources.  They take them in turn (see
+  /// TaskTurns), so the ids are the same as when they tick one at a time.
+  static std::atomic<int> nextstate_id_;
+  static std::atomic<int> nextobj_id_;
   int state_id_;
   int obj_id_;
 };
@@ -4,12 +4,15 @@
 #include <algorithm>
 #include <functional>
 #include <set>
+#include <vector>
 
 #include "bid_portfolio.h"
 #include "context.h"
 #include "exchange_context.h"
+#include "exchange_threads.h"
 #include "product.h"
 #include "material.h"
+#include "recorder.h"
 #include "request_portfolio.h"
 #include "trader.h"
 #include "trader_management.h"
@@ -33,6 +36,27 @@ inline static void AdjustPrefs(Trader* t, PrefMap<Product>::type& prefs) {
   t->AdjustProductPrefs(prefs);
 }
 
+/// Queries one trader of a batch for a ResourceExchange, staging the Datums
+/// it records.
+template <class Q>
+struct TraderQueryTask {
+  std::vector<Trader*>* traders;
+  std::vector<DatumList>* staged;
+  Recorder* rec;
+  Q* query;
+
+  void operator()(int i) {
+    rec->Stage(&(*staged)[i]);
+    try {
+      (*query)(i, (*traders)[i]);
+    } catch (...) {
+      rec->Unstage();
+      throw;
+    }
+    rec->Unstage();
+  }
+};
+
 /// @class ResourceExchange
 ///
 /// The ResourceExchange class manages the communication for the supply and
@@ -57,6 +81,9 @@ inline static void AdjustPrefs(Trader* t, PrefMap<Product>::type& prefs) {
 /// exchng.AddAllBids();
 /// exchng.AdjustAll();
 /// @endcode
+///
+/// Traders may be queried concurrently by giving the exchange threads to
+/// run on (see ExchangeThreads).
 template <class T>
 class ResourceExchange {
  public:
@@ -65,42 +92,43 @@ class ResourceExchange {
   /// @param ctx the simulation context
   ResourceExchange(Context* ctx) {
     sim_ctx_ = ctx;
+    threads_ = NULL;
   }
 
   inline ExchangeContext<T>& ex_ctx() {
     return ex_ctx_;
   }
 
+  /// Sets the threads on which thread-safe traders are queried, or NULL to
+  /// query all traders one at a time.
+  void threads(const ExchangeThreads* threads) { threads_ = threads; }
+
   /// @brief queries traders and collects all requests for bids
   void AddAllRequests() {
     InitTraders();
-    std::for_each(
-        traders_.begin(),
-        traders_.end(),
-        std::bind1st(std::mem_fun(&cyclus::ResourceExchange<T>::AddRequests_),
-                     this));
+    RequestQuery q = {this};
+    QueryAll(traders_, &q);
   }
 
   /// @brief queries traders and collects all responses to requests for bids
   void AddAllBids() {
     InitTraders();
-    std::for_each(
-        traders_.begin(),
-        traders_.end(),
-        std::bind1st(std::mem_fun(&cyclus::ResourceExchange<T>::AddBids_),
-                     this));
+    BidQuery q = {this};
+    QueryAll(traders_, &q);
   }
 
   /// @brief adjust preferences for requests given bid responses
   void AdjustAll() {
     InitTraders();
-    std::set<Trader*> traders = ex_ctx_.requesters;
-    std::for_each(
-        traders.begin(),
-        traders.end(),
-        std::bind1st(
-            std::mem_fun(&cyclus::ResourceExchange<T>::AdjustPrefs_),
-            this));
+    std::vector<Trader*> traders(ex_ctx_.requesters.begin(),
+                                 ex_ctx_.requesters.end());
+    // every requester's preferences are added before any are adjusted, so
+    // that traders adjusting them concurrently do not add to the map
+    for (int i = 0; i < traders.size(); ++i) {
+      ex_ctx_.trader_prefs[traders[i]];
+    }
+    PrefQuery q = {this};
+    QueryAll(traders, &q);
   }
 
   /// return true if this is an empty exchange (i.e., no requests exist,
@@ -110,38 +138,18 @@ class ResourceExchange {
  private:
   void InitTraders() {
     if (traders_.size() == 0) {
-      std::set<Trader*> orig = sim_ctx_->traders();
-      std::set<Trader*>::iterator it;
-      for (it = orig.begin(); it != orig.end(); ++it) {
-        traders_.insert(*it);
-      }
-    }
-  }
-
-  /// @brief queries a given facility agent for
-  void AddRequests_(Trader* t) {
-    std::set<typename RequestPortfolio<T>::Ptr> rp = QueryRequests<T>(t);
-    typename std::set<typename RequestPortfolio<T>::Ptr>::iterator it;
-    for (it = rp.begin(); it != rp.end(); ++it) {
-      ex_ctx_.AddRequestPortfolio(*it);
+      traders_ = sim_ctx_->traders();
     }
   }
 
-  /// @brief queries a given facility agent for
-  void AddBids_(Trader* t) {
-    std::set<typename BidPortfolio<T>::Ptr> bp =
-        QueryBids<T>(t, ex_ctx_.commod_requests);
-    typename std::set<typename BidPortfolio<T>::Ptr>::iterator it;
-    for (it = bp.begin(); it != bp.end(); ++it) {
-      ex_ctx_.AddBidPortfolio(*it);
-    }
+  /// @brief allows a trader to adjust any preferences in the system
+  void AdjustPrefs_(Trader* t) {
+    AdjustPrefs(t, ex_ctx_.trader_prefs.at(t));
   }
 
-  /// @brief allows a trader and its parents to adjust any preferences in the
-  /// system
-  void AdjustPrefs_(Trader* t) {
-    typename PrefMap<T>::type& prefs = ex_ctx_.trader_prefs[t];
-    AdjustPrefs(t, prefs);
+  /// @brief allows a trader's parents to adjust any preferences in the system
+  void AdjustParentPrefs_(Trader* t) {
+    typename PrefMap<T>::type& prefs = ex_ctx_.trader_prefs.at(t);
     Agent* m = t->manager()->parent();
     while (m != NULL) {
       AdjustPrefs(m, prefs);
@@ -149,26 +157,125 @@ class ResourceExchange {
     }
   }
 
-  struct trader_compare {
-    bool operator()(Trader* lhs, Trader* rhs) const {
-      int left = lhs->manager()->id();
-      int right = rhs->manager()->id();
-      if (left != right) {
-        return left < right;
-      } else {
-        return lhs < rhs;
+  /// Queries traders for their request portfolios, keeping those of the i-th
+  /// trader of a batch in ports[i] until they are added.
+  struct RequestQuery {
+    ResourceExchange<T>* ex;
+    std::vector<std::set<typename RequestPortfolio<T>::Ptr> > ports;
+
+    void Resize(int n) {
+      ports.clear();
+      ports.resize(n);
+    }
+
+    void operator()(int i, Trader* t) { ports[i] = QueryRequests<T>(t); }
+
+    void Add(int i) {
+      typename std::set<typename RequestPortfolio<T>::Ptr>::iterator it;
+      for (it = ports[i].begin(); it != ports[i].end(); ++it) {
+        ex->ex_ctx_.AddRequestPortfolio(*it);
       }
     }
   };
 
-  // this sorts traders (and results in iteration...) based on traders'
-  // manager id.  Iterating over traders in this order helps increase the
-  // determinism of Cyclus overall.  This allows all traders' resource
-  // exchange functions are called in a much closer to deterministic order.
-  std::set<Trader*, trader_compare> traders_;
+  /// Queries traders for their bid portfolios, like RequestQuery.
+  struct BidQuery {
+    ResourceExchange<T>* ex;
+    std::vector<std::set<typename BidPortfolio<T>::Ptr> > ports;
+
+    void Resize(int n) {
+      ports.clear();
+      ports.resize(n);
+    }
+
+    void operator()(int i, Trader* t) {
+      ports[i] = QueryBids<T>(t, ex->ex_ctx_.commod_requests);
+    }
+
+    void Add(int i) {
+      typename std::set<typename BidPortfolio<T>::Ptr>::iterator it;
+      for (it = ports[i].begin(); it != ports[i].end(); ++it) {
+        ex->ex_ctx_.AddBidPortfolio(*it);
+      }
+    }
+  };
+
+  /// Lets requesters adjust their preferences, which they do in place, and
+  /// then their parents in trader order.  Traders may share parents, which
+  /// are not thread-safe, so only the traders themselves run concurrently.
+  struct PrefQuery {
+    ResourceExchange<T>* ex;
+    std::vector<Trader*> traders;
+
+    void Resize(int n) {
+      traders.clear();
+      traders.resize(n);
+    }
+
+    void operator()(int i, Trader* t) {
+      traders[i] = t;
+      ex->AdjustPrefs_(t);
+    }
+
+    void Add(int i) { ex->AdjustParentPrefs_(traders[i]); }
+  };
+
+  /// Runs query q on traders in order, except that consecutive traders in
+  /// threads_->safe are queried concurrently before their results are added
+  /// in order.
+  template <class Q>
+  void QueryAll(const std::vector<Trader*>& traders, Q* q) {
+    std::vector<Trader*> batch;
+    for (int i = 0; i < traders.size(); ++i) {
+      if (threads_ != NULL && threads_->safe.count(traders[i]) > 0) {
+        batch.push_back(traders[i]);
+        continue;
+      }
+      QueryBatch(&batch, q);
+      batch.push_back(traders[i]);
+      QueryBatch(&batch, q);
+    }
+    QueryBatch(&batch, q);
+  }
+
+  /// Runs query q on a batch of traders, concurrently if there is more than
+  /// one, and empties the batch.
+  template <class Q>
+  void QueryBatch(std::vector<Trader*>* batch, Q* q) {
+    int n = batch->size();
+    q->Resize(n);
+    if (n == 1) {
+      (*q)(0, (*batch)[0]);
+    } else if (n > 1) {
+      std::vector<DatumList> staged(n);
+      TraderQueryTask<Q> task = {batch, &staged, threads_->rec, q};
+      try {
+        threads_->pool->RunInTurn(n, task);
+      } catch (...) {
+        for (int i = 0; i < n; ++i) {
+          threads_->rec->Discard(&staged[i]);
+        }
+        throw;
+      }
+      for (int i = 0; i < n; ++i) {
+        threads_->rec->Commit(&staged[i]);
+      }
+    }
+    for (int i = 0; i < n; ++i) {
+      q->Add(i);
+    }
+    batch->clear();
+  }
+
+  // the context keeps traders sorted by their manager id.  Iterating over
+  // traders in this order helps increase the determinism of Cyclus overall.
+  // This allows all traders' resource exchange functions are called in a
+  // much closer to deterministic order.
+  std::vector<Trader*> traders_;
 
   Context* sim_ctx_;
   ExchangeContext<T> ex_ctx_;
+  const ExchangeThreads* threads_;
 };
 
 }  // namespace cyclus
@@ -0,0 +1,282 @@
+#include "shm_back.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <new>
+#include <vector>
+
+#include "col_log_back.h"
+#include "error.h"
+
+namespace cyclus {
+
+/// The start of the shared memory object.  Positions count bytes ever
+/// written; the record at position p lives at offset p % capacity of the
+/// data that follows the header.
+struct ShmHeader {
+  char magic[8];
+  uint64_t capacity;
+  /// position of the oldest record not yet overwritten
+  std::atomic<uint64_t> tail;
+  /// end of the record being written; data before reserved - capacity may
+  /// be overwritten at any time
+  std::atomic<uint64_t> reserved;
+  /// end of the last complete record
+  std::atomic<uint64_t> head;
+  std::atomic<uint32_t> closed;
+};
+
+namespace {
+
+const char kMagic[] = "CYCSHM1\n";
+
+const size_t kHeaderSize = 64;
+
+/// Records start with a marker and the body length, both uint32_t, and are
+/// padded to a multiple of 8 bytes.  A pad marker fills the end of the ring
+/// when the next record does not fit there.
+const uint32_t kRecMagic = 0x52435943;
+const uint32_t kPadMagic = 0x50435943;
+const size_t kRecHeader = 2 * sizeof(uint32_t);
+
+uint64_t Align(uint64_t n) { return (n + 7) & ~static_cast<uint64_t>(7); }
+
+std::string ErrnoStr() { return std::strerror(errno); }
+
+}  // namespace
+
+ShmBack::ShmBack(std::string name, size_t capacity)
+    : name_(name),
+      capacity_(Align(capacity < 4096 ? 4096 : capacity)),
+      h_(NULL),
+      data_(NULL),
+      dropped_(0) {
+  static_assert(sizeof(ShmHeader) <= kHeaderSize, "shm header too large");
+  shm_unlink(name_.c_str());  // drop any ring left by an earlier run
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+    throw IOError("could not create shared memory " + name_ + ": " +
+                  ErrnoStr());
+  size_ = kHeaderSize + capacity_;
+  if (ftruncate(fd, size_) != 0) {
+    std::string err = ErrnoStr();
+    close(fd);
+    shm_unlink(name_.c_str());
+    throw IOError("could not size shared memory " + name_ + ": " + err);
+  }
+  void* p = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    shm_unlink(name_.c_str());
+    throw IOError("could not map shared memory " + name_ + ": " + ErrnoStr());
+  }
+
+  h_ = new (p) ShmHeader();
+  h_->capacity = capacity_;
+  h_->tail.store(0);
+  h_->reserved.store(0);
+  h_->head.store(0);
+  h_->closed.store(0);
+  data_ = static_cast<char*>(p) + kHeaderSize;
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(h_->magic, kMagic, sizeof(h_->magic));
+}
+
+ShmBack::~ShmBack() {
+  Close();
+  munmap(h_, size_);
+}
+
+void ShmBack::Notify(DatumList data) {
+  struct Pending {
+    ColumnarResult data;
+    Datum::Shapes shapes;
+  };
+  std::map<std::string, Pending> pending;
+  std::vector<std::string> order;
+  for (DatumList::iterator it = data.begin(); it != data.end(); ++it) {
+    Datum* d = *it;
+    const Datum::Vals& vals = d->vals();
+    Pending& p = pending[d->title()];
+    ColumnarResult& cr = p.data;
+    if (cr.fields().empty()) {
+      order.push_back(d->title());
+      p.shapes = d->shapes();
+      for (int j = 0; j < vals.size(); ++j)
+        cr.AddColumn(vals[j].first, DbTypeOf(vals[j].second, p.shapes[j]));
+    }
+    const std::vector<std::string>& fields = cr.fields();
+    if (vals.size() != fields.size()) {
+      throw ValueError("datum for table " + d->title() + " does not have the"
+                       " fields of the first datum recorded to it");
+    }
+    for (int j = 0; j < vals.size(); ++j) {
+      int k = j;
+      if (std::strcmp(vals[j].first, fields[j].c_str()) != 0)
+        k = cr.FieldIndex(vals[j].first);
+      cr.column(k)->Append(vals[j].second);
+    }
+  }
+  for (int k = 0; k < order.size(); ++k) {
+    Pending& p = pending[order[k]];
+    Publish(order[k], p.data, p.shapes);
+  }
+}
+
+void ShmBack::Publish(const std::string& table, const ColumnarResult& cr,
+                      const Datum::Shapes& shapes) {
+  std::string body;
+  EncodeSegment(table, cr, shapes, &body);
+  if (Align(kRecHeader + body.size()) <= capacity_) {
+    Write(body);
+    return;
+  } else if (cr.nrows() < 2) {
+    dropped_ += cr.nrows();
+    return;
+  }
+
+  size_t n = cr.nrows();
+  std::vector<size_t> rows[2];
+  for (size_t i = 0; i < n; ++i)
+    rows[i < n / 2 ? 0 : 1].push_back(i);
+  for (int h = 0; h < 2; ++h) {
+    ColumnarResult half;
+    for (int j = 0; j < cr.fields().size(); ++j)
+      half.AddColumn(cr.fields()[j], cr.types()[j],
+                     cr.column(j)->Take(rows[h]));
+    Publish(table, half, shapes);
+  }
+}
+
+void ShmBack::Write(const std::string& body) {
+  uint64_t need = Align(kRecHeader + body.size());
+  uint64_t start = h_->head.load(std::memory_order_relaxed);
+  uint64_t off = start % capacity_;
+  uint64_t pad = capacity_ - off < need ? capacity_ - off : 0;
+  uint64_t end = start + pad + need;
+
+  // move the tail past the records about to be overwritten
+  uint64_t tail = h_->tail.load(std::memory_order_relaxed);
+  while (tail < start && tail + capacity_ < end) {
+    uint32_t hdr[2];
+    uint64_t toff = tail % capacity_;
+    std::memcpy(hdr, data_ + toff, sizeof(hdr));
+    tail += hdr[0] == kPadMagic ? capacity_ - toff : Align(kRecHeader + hdr[1]);
+  }
+  if (tail + capacity_ < end)
+    tail = start + pad;
+  h_->tail.store(tail, std::memory_order_relaxed);
+  h_->reserved.store(end, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (pad > 0) {
+    std::memcpy(data_ + off, &kPadMagic, sizeof(kPadMagic));
+    off = 0;
+  }
+  uint32_t hdr[2] = {kRecMagic, static_cast<uint32_t>(body.size())};
+  std::memcpy(data_ + off, hdr, sizeof(hdr));
+  std::memcpy(data_ + off + kRecHeader, body.data(), body.size());
+  h_->head.store(end, std::memory_order_release);
+}
+
+void ShmBack::Close() {
+  if (h_->closed.load() != 0)
+    return;
+  h_->closed.store(1, std::memory_order_release);
+  shm_unlink(name_.c_str());
+}
+
+ShmReader::ShmReader(std::string name, bool from_start)
+    : name_(name), overruns_(0) {
+  int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    throw IOError("could not open shared memory " + name_ + ": " + ErrnoStr());
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < kHeaderSize) {
+    close(fd);
+    throw IOError("shared memory " + name_ + " is not a cyclus ring");
+  }
+  size_ = st.st_size;
+  void* p = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    throw IOError("could not map shared memory " + name_ + ": " + ErrnoStr());
+  h_ = static_cast<const ShmHeader*>(p);
+  data_ = static_cast<const char*>(p) + kHeaderSize;
+  if (std::memcmp(h_->magic, kMagic, sizeof(h_->magic)) != 0 ||
+      h_->capacity + kHeaderSize > size_) {
+    munmap(p, size_);
+    throw IOError("shared memory " + name_ + " is not a cyclus ring");
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  capacity_ = h_->capacity;
+  pos_ = from_start ? h_->tail.load(std::memory_order_acquire)
+                    : h_->head.load(std::memory_order_acquire);
+}
+
+ShmReader::~ShmReader() {
+  munmap(const_cast<ShmHeader*>(h_), size_);
+}
+
+void ShmReader::Subscribe(std::string table) {
+  tables_.insert(table);
+}
+
+bool ShmReader::Next(std::string* table, ColumnarResult* rows) {
+  while (true) {
+    uint64_t head = h_->head.load(std::memory_order_acquire);
+    if (pos_ >= head)
+      return false;
+    if (head - pos_ > capacity_) {
+      pos_ = h_->tail.load(std::memory_order_acquire);
+      ++overruns_;
+      continue;
+    }
+
+    // copy the record out, then check that it was not overwritten meanwhile
+    uint64_t off = pos_ % capacity_;
+    uint32_t hdr[2];
+    std::memcpy(hdr, data_ + off, sizeof(hdr));
+    uint64_t next = 0;
+    bool rec = false;
+    if (hdr[0] == kPadMagic) {
+      next = pos_ + capacity_ - off;
+    } else if (hdr[0] == kRecMagic && hdr[1] <= capacity_ - off - kRecHeader) {
+      buf_.assign(data_ + off + kRecHeader, hdr[1]);
+      next = pos_ + Align(kRecHeader + hdr[1]);
+      rec = true;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (h_->reserved.load(std::memory_order_relaxed) > pos_ + capacity_) {
+      pos_ = h_->tail.load(std::memory_order_acquire);
+      ++overruns_;
+      continue;
+    } else if (next == 0) {
+      throw IOError("corrupt record in shared memory " + name_);
+    }
+
+    pos_ = next;
+    if (!rec)
+      continue;
+    if (!tables_.empty() &&
+        tables_.count(SegmentTable(buf_.data(), buf_.size())) == 0) {
+      continue;
+    }
+    DecodeSegment(buf_.data(), buf_.size(), table, rows);
+    return true;
+  }
+}
+
+bool ShmReader::closed() {
+  return h_->closed.load(std::memory_order_acquire) != 0 &&
+         pos_ >= h_->head.load(std::memory_order_acquire);
+}
+
+}  // namespace cyclus
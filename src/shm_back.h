@@ -0,0 +1,127 @@
+#ifndef CYCLUS_SRC_SHM_BACK_H_
+#define CYCLUS_SRC_SHM_BACK_H_
+
+#include <stdint.h>
+
+#include <set>
+#include <string>
+
+#include "query_backend.h"
+#include "rec_backend.h"
+
+namespace cyclus {
+
+struct ShmHeader;
+
+/// A Recorder backend that publishes each batch of Datums it is notified of
+/// to a POSIX shared memory ring buffer, where any number of local processes
+/// can read them with a ShmReader while the simulation runs.  Each table of
+/// a batch becomes one record holding its rows in the column log segment
+/// format (see EncodeSegment), so readers get typed columns without going
+/// through Python or files.
+///
+/// The writer never waits for readers: once the ring is full the oldest
+/// records are overwritten, and readers that fall more than the capacity
+/// behind skip ahead and count the loss.  Batches too large for the ring
+/// are split by rows, and single rows that still do not fit are dropped.
+/// Nothing is kept once records are overwritten, so this backend is meant
+/// to be used alongside a persistent one.
+class ShmBack: public RecBackend {
+ public:
+  /// Creates, or recreates, the shared memory object name.
+  /// @param name the POSIX shared memory name, e.g. "/cyclus"
+  /// @param capacity the size of the ring in bytes
+  ShmBack(std::string name, size_t capacity = 1 << 24);
+
+  virtual ~ShmBack();
+
+  /// Publishes the data, one record per table.
+  virtual void Notify(DatumList data);
+
+  /// Returns the shared memory name.
+  virtual std::string Name() { return name_; }
+
+  /// Records are published on Notify, so this does nothing.
+  virtual void Flush() {}
+
+  /// Marks the ring as closed, so that readers know no more records will
+  /// come, and removes its name.  Readers that have it open keep reading.
+  virtual void Close();
+
+  /// Returns the number of rows dropped because they did not fit the ring.
+  uint64_t dropped() const { return dropped_; }
+
+ private:
+  /// Publishes the rows of a table, splitting them if they do not fit.
+  void Publish(const std::string& table, const ColumnarResult& cr,
+               const Datum::Shapes& shapes);
+
+  /// Copies a record body into the ring.
+  void Write(const std::string& body);
+
+  std::string name_;
+  size_t capacity_;
+  size_t size_;
+  ShmHeader* h_;
+  char* data_;
+  uint64_t dropped_;
+};
+
+/// Reads the records published by a ShmBack, possibly in another process.
+/// Reading never blocks the writer; Next returns false when there is
+/// nothing new, so consumers poll it.
+///
+/// @code
+/// ShmReader r("/cyclus");
+/// r.Subscribe("Transactions");
+/// std::string table;
+/// ColumnarResult rows;
+/// while (!r.closed()) {
+///   while (r.Next(&table, &rows)) {
+///     ...
+///   }
+///   usleep(10000);
+/// }
+/// @endcode
+class ShmReader {
+ public:
+  /// Maps the ring published under name, throwing an IOError if there is
+  /// none.
+  /// @param name the POSIX shared memory name
+  /// @param from_start read the oldest records still in the ring rather
+  /// than only those published from now on
+  ShmReader(std::string name, bool from_start = false);
+
+  ~ShmReader();
+
+  /// Restricts reading to the given table.  Tables accumulate; with none
+  /// subscribed, all tables are read.
+  void Subscribe(std::string table);
+
+  /// Decodes the next record of a subscribed table into table and rows.
+  /// Returns false if no record is available yet.
+  bool Next(std::string* table, ColumnarResult* rows);
+
+  /// Returns true once the writer has closed the ring and every record has
+  /// been read.
+  bool closed();
+
+  /// Returns the number of times the reader fell behind by more than the
+  /// capacity and skipped ahead, losing records.
+  uint64_t overruns() const { return overruns_; }
+
+ private:
+  std::string name_;
+  size_t size_;
+  const ShmHeader* h_;
+  const char* data_;
+  uint64_t capacity_;
+  uint64_t pos_;
+  uint64_t overruns_;
+  std::set<std::string> tables_;
+  std::string buf_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_SHM_BACK_H_
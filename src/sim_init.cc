@@ -1,5 +1,13 @@
 #include "sim_init.h"
 
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <set>
+#include <typeinfo>
+
+#include <boost/lexical_cast.hpp>
+
 #include "greedy_preconditioner.h"
 #include "greedy_solver.h"
 #include "prog_solver.h"
@@ -13,6 +21,162 @@ class Dummy : public Region {
   Dummy* Clone() { return NULL; }
 };
 
+namespace {
+
+void PutState(const int& x, std::string* b) {
+  b->append(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+void PutState(const bool& x, std::string* b) { b->push_back(x ? 1 : 0); }
+void PutState(const float& x, std::string* b) {
+  b->append(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+void PutState(const double& x, std::string* b) {
+  b->append(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+void PutState(const std::string& x, std::string* b) {
+  PutState(static_cast<int>(x.size()), b);
+  b->append(x);
+}
+void PutState(const Blob& x, std::string* b) { PutState(x.str(), b); }
+void PutState(const boost::uuids::uuid& x, std::string* b) {
+  b->append(reinterpret_cast<const char*>(x.data), x.size());
+}
+template <class A, class B>
+void PutState(const std::pair<A, B>& x, std::string* b);
+template <class T>
+void PutState(const std::vector<T>& x, std::string* b);
+template <class T>
+void PutState(const std::set<T>& x, std::string* b);
+template <class T>
+void PutState(const std::list<T>& x, std::string* b);
+template <class K, class V>
+void PutState(const std::map<K, V>& x, std::string* b);
+
+template <class C>
+void PutStateRange(const C& x, std::string* b) {
+  PutState(static_cast<int>(x.size()), b);
+  for (typename C::const_iterator it = x.begin(); it != x.end(); ++it)
+    PutState(*it, b);
+}
+template <class A, class B>
+void PutState(const std::pair<A, B>& x, std::string* b) {
+  PutState(x.first, b);
+  PutState(x.second, b);
+}
+template <class T>
+void PutState(const std::vector<T>& x, std::string* b) { PutStateRange(x, b); }
+template <class T>
+void PutState(const std::set<T>& x, std::string* b) { PutStateRange(x, b); }
+template <class T>
+void PutState(const std::list<T>& x, std::string* b) { PutStateRange(x, b); }
+template <class K, class V>
+void PutState(const std::map<K, V>& x, std::string* b) { PutStateRange(x, b); }
+
+typedef void (*StatePutter)(const boost::spirit::hold_any&, std::string*);
+
+template <class T>
+void PutAnyState(const boost::spirit::hold_any& v, std::string* b) {
+  PutState(v.cast<T>(), b);
+}
+
+/// Returns the encoder of values of a database type, or NULL if there is
+/// none.
+StatePutter PutterOf(DbTypes type) {
+  using std::list;
+  using std::map;
+  using std::pair;
+  using std::set;
+  using std::string;
+  using std::vector;
+  switch (type) {
+    case INT: return &PutAnyState<int>;
+    case BOOL: return &PutAnyState<bool>;
+    case FLOAT: return &PutAnyState<float>;
+    case DOUBLE: return &PutAnyState<double>;
+    case STRING:
+    case VL_STRING: return &PutAnyState<string>;
+    case UUID: return &PutAnyState<boost::uuids::uuid>;
+    case BLOB: return &PutAnyState<Blob>;
+    case SET_INT: return &PutAnyState<set<int> >;
+    case SET_STRING: return &PutAnyState<set<string> >;
+    case VECTOR_INT: return &PutAnyState<vector<int> >;
+    case VECTOR_DOUBLE: return &PutAnyState<vector<double> >;
+    case VECTOR_STRING: return &PutAnyState<vector<string> >;
+    case LIST_INT: return &PutAnyState<list<int> >;
+    case LIST_STRING: return &PutAnyState<list<string> >;
+    case LIST_PAIR_INT_INT: return &PutAnyState<list<pair<int, int> > >;
+    case PAIR_INT_INT: return &PutAnyState<pair<int, int> >;
+    case PAIR_DOUBLE_DOUBLE: return &PutAnyState<pair<double, double> >;
+    case MAP_INT_INT: return &PutAnyState<map<int, int> >;
+    case MAP_INT_DOUBLE: return &PutAnyState<map<int, double> >;
+    case MAP_INT_STRING: return &PutAnyState<map<int, string> >;
+    case MAP_STRING_INT: return &PutAnyState<map<string, int> >;
+    case MAP_STRING_DOUBLE: return &PutAnyState<map<string, double> >;
+    case MAP_STRING_STRING: return &PutAnyState<map<string, string> >;
+    case MAP_STRING_VECTOR_DOUBLE:
+      return &PutAnyState<map<string, vector<double> > >;
+    case MAP_STRING_MAP_INT_DOUBLE:
+      return &PutAnyState<map<string, map<int, double> > >;
+    case MAP_STRING_MAP_STRING_INT:
+      return &PutAnyState<map<string, map<string, int> > >;
+    case MAP_INT_MAP_STRING_DOUBLE:
+      return &PutAnyState<map<int, map<string, double> > >;
+    case MAP_STRING_PAIR_DOUBLE_MAP_INT_DOUBLE:
+      return &PutAnyState<map<string, pair<double, map<int, double> > > >;
+    case MAP_STRING_PAIR_STRING_VECTOR_DOUBLE:
+      return &PutAnyState<map<string, pair<string, vector<double> > > >;
+    case MAP_STRING_VECTOR_PAIR_INT_PAIR_STRING_STRING:
+      return &PutAnyState<
+          map<string, vector<pair<int, pair<string, string> > > > >;
+    case VECTOR_PAIR_PAIR_DOUBLE_DOUBLE_MAP_STRING_DOUBLE:
+      return &PutAnyState<
+          vector<pair<pair<double, double>, map<string, double> > > >;
+    default: return NULL;
+  }
+}
+
+/// Returns the encoder of each type that agents may record, as listed by
+/// DbTypeMap.
+std::map<const std::type_info*, StatePutter, TypeInfoLess> StatePutters() {
+  std::map<const std::type_info*, StatePutter, TypeInfoLess> p;
+  std::map<const std::type_info*, DbTypes, TypeInfoLess> types = DbTypeMap();
+  std::map<const std::type_info*, DbTypes, TypeInfoLess>::iterator it;
+  for (it = types.begin(); it != types.end(); ++it) {
+    StatePutter put = PutterOf(it->second);
+    if (put != NULL)
+      p[it->first] = put;
+  }
+  p[&typeid(std::string)] = PutterOf(STRING);
+  return p;
+}
+
+/// Writes the table names, field names and values of the data, other than
+/// their SimTime, into state so that equal states have equal bytes.
+/// Returns false if a value has a type that cannot be encoded.
+bool EncodeState(const DatumList& data, std::string* state) {
+  static const std::map<const std::type_info*, StatePutter, TypeInfoLess>
+      putters = StatePutters();
+  state->clear();
+  for (int i = 0; i < data.size(); ++i) {
+    const Datum::Vals& vals = data[i]->vals();
+    PutState(data[i]->title(), state);
+    PutState(static_cast<int>(vals.size()), state);
+    for (int j = 0; j < vals.size(); ++j) {
+      if (std::strcmp(vals[j].first, "SimTime") == 0)
+        continue;
+      std::map<const std::type_info*, StatePutter, TypeInfoLess>::const_iterator
+          it = putters.find(&vals[j].second.type());
+      if (it == putters.end())
+        return false;
+      PutState(std::string(vals[j].first), state);
+      it->second(vals[j].second, state);
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
 SimInit::SimInit() : rec_(NULL), ctx_(NULL) {}
 
 SimInit::~SimInit() {
@@ -59,6 +223,7 @@ void SimInit::InitBase(QueryableBackend* b, boost::uuids::uuid simid, int t) {
   LoadRecipes();
   LoadSolverInfo();
   LoadPrototypes();
+  LoadStateTimes();
   LoadInitialAgents();
   LoadInventories();
   LoadBuildSched();
@@ -71,19 +236,64 @@ void SimInit::InitBase(QueryableBackend* b, boost::uuids::uuid simid, int t) {
 }
 
 void SimInit::Snapshot(Context* ctx) {
+  Snapshot(ctx, NULL);
+}
+
+void SimInit::Snapshot(Context* ctx, SnapshotHistory* hist) {
   ctx->NewDatum("Snapshots")
      ->AddVal("Time", ctx->time())
      ->Record();
 
+  bool full = hist == NULL ||
+              (hist->full_every > 0 && hist->nsnaps % hist->full_every == 0);
+  std::map<int, std::pair<std::string, int> > agents;
+
   // snapshot all agent internal state
-  std::set<Agent*> mlist = ctx->agent_list_;
-  std::set<Agent*>::iterator it;
-  for (it = mlist.begin(); it != mlist.end(); ++it) {
-    Agent* m = *it;
-    if (m->enter_time() != -1) {
+  std::vector<Agent*> mlist = ctx->agent_list_.items();
+  for (int i = 0; i < mlist.size(); ++i) {
+    Agent* m = mlist[i];
+    if (m->enter_time() == -1) {
+      continue;
+    } else if (hist == NULL) {
+      SimInit::SnapAgent(m);
+      continue;
+    }
+
+    DatumList staged;
+    ctx->rec_->Stage(&staged);
+    try {
       SimInit::SnapAgent(m);
+    } catch (...) {
+      ctx->rec_->Unstage();
+      ctx->rec_->Discard(&staged);
+      throw;
+    }
+    ctx->rec_->Unstage();
+
+    std::map<int, std::pair<std::string, int> >::iterator prev =
+        hist->agents.find(m->id());
+    std::string state;
+    bool known = EncodeState(staged, &state);
+    if (!full && known && prev != hist->agents.end() &&
+        prev->second.first == state) {
+      ctx->rec_->Discard(&staged);
+      ctx->NewDatum("AgentStateUnchanged")
+          ->AddVal("AgentId", m->id())
+          ->AddVal("SimTime", ctx->time())
+          ->AddVal("Since", prev->second.second)
+          ->Record();
+      agents[m->id()].swap(prev->second);
+    } else {
+      ctx->rec_->Commit(&staged);
+      if (known) {
+        agents[m->id()] = std::make_pair(state, ctx->time());
+      }
     }
   }
+  if (hist != NULL) {
+    hist->agents.swap(agents);
+    hist->nsnaps++;
+  }
 
   // snapshot all next ids
   ctx->NewDatum("NextIds")
@@ -99,17 +309,17 @@ void SimInit::Snapshot(Context* ctx) {
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("Composition"))
-      ->AddVal("NextId", Composition::next_id_)
+      ->AddVal("NextId", Composition::next_id_.load())
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("ResourceState"))
-      ->AddVal("NextId", Resource::nextstate_id_)
+      ->AddVal("NextId", Resource::nextstate_id_.load())
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
       ->AddVal("Object", std::string("ResourceObj"))
-      ->AddVal("NextId", Resource::nextobj_id_)
+      ->AddVal("NextId", Resource::nextobj_id_.load())
       ->Record();
   ctx->NewDatum("NextIds")
       ->AddVal("Time", ctx->time())
@@ -166,6 +376,11 @@ void SimInit::LoadInfo() {
   qr = b_->Query("InfoExplicitInv", NULL);
   si_.explicit_inventory = qr.GetVal<bool>("RecordInventory");
   si_.explicit_inventory_compact = qr.GetVal<bool>("RecordInventoryCompact");
+  if (std::find(qr.fields.begin(), qr.fields.end(),
+                "RecordInventoryIncremental") != qr.fields.end()) {
+    si_.explicit_inventory_incremental =
+        qr.GetVal<bool>("RecordInventoryIncremental");
+  }
 
   ctx_->InitSim(si_);
 }
@@ -178,11 +393,14 @@ void SimInit::LoadRecipes() {
     return;
   }  // table doesn't exist (okay)
 
+  std::set<int> qualids;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    qualids.insert(qr.GetVal<int>("QualId", i));
+  }
+  std::map<int, Composition::Ptr> comps = LoadCompositions(b_, qualids);
   for (int i = 0; i < qr.rows.size(); ++i) {
     std::string recipe = qr.GetVal<std::string>("Recipe", i);
-    int stateid = qr.GetVal<int>("QualId", i);
-    Composition::Ptr c = LoadComposition(b_, stateid);
-    ctx_->AddRecipe(recipe, c);
+    ctx_->AddRecipe(recipe, comps[qr.GetVal<int>("QualId", i)]);
   }
 }
 
@@ -293,14 +511,16 @@ void SimInit::LoadSolverInfo() {
 
 void SimInit::LoadPrototypes() {
   QueryResult qr = b_->Query("Prototypes", NULL);
+  int next_id = Agent::next_id_;
   for (int i = 0; i < qr.rows.size(); ++i) {
     std::string proto = qr.GetVal<std::string>("Prototype", i);
     int agentid = qr.GetVal<int>("AgentId", i);
     std::string impl = qr.GetVal<std::string>("Spec", i);
     AgentSpec spec(impl);
 
+    Agent::next_id_ = agentid;  // so that it is registered under its id
     Agent* m = DynamicModule::Make(ctx_, spec);
-    m->id_ = agentid;
+    next_id = std::max(next_id, agentid + 1);
 
     // note that we don't filter by SimTime here because prototypes remain
     // static over the life of the simulation and we only snapshot them once
@@ -317,6 +537,27 @@ void SimInit::LoadPrototypes() {
     m->InitFrom(&pi);
     ctx_->AddPrototype(proto, m);
   }
+  // agents made before LoadNextIds, such as LoadResources' dummy, must not
+  // reuse a loaded id
+  Agent::next_id_ = next_id;
+}
+
+void SimInit::LoadStateTimes() {
+  std::vector<Cond> conds;
+  conds.push_back(Cond("SimTime", "==", t_));
+  QueryResult qr;
+  try {
+    qr = b_->Query("AgentStateUnchanged", &conds);
+  } catch (std::exception err) {return;}  // table doesn't exist (okay)
+
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    state_times_[qr.GetVal<int>("AgentId", i)] = qr.GetVal<int>("Since", i);
+  }
+}
+
+int SimInit::StateTime(int agentid) {
+  std::map<int, int>::iterator it = state_times_.find(agentid);
+  return it == state_times_.end() ? t_ : it->second;
 }
 
 void SimInit::LoadInitialAgents() {
@@ -329,47 +570,57 @@ void SimInit::LoadInitialAgents() {
   std::vector<Cond> conds;
   conds.push_back(Cond("EnterTime", "<=", t_));
   QueryResult qentry = b_->Query("AgentEntry", &conds);
+
+  // find all agents that were decommissioned before t_
+  std::set<int> exited;
+  conds.clear();
+  conds.push_back(Cond("ExitTime", "<", t_));
+  try {
+    QueryResult qexit = b_->Query("AgentExit", &conds);
+    for (int i = 0; i < qexit.rows.size(); ++i) {
+      exited.insert(qexit.GetVal<int>("AgentId", i));
+    }
+  } catch (std::exception err) {}  // table doesn't exist (okay)
+
   std::map<int, int> parentmap;  // map<agentid, parentid>
   std::map<int, Agent*> unbuilt;  // map<agentid, agent_ptr>
+  int next_id = Agent::next_id_;
   for (int i = 0; i < qentry.rows.size(); ++i) {
     if (t_ > 0 && qentry.GetVal<int>("EnterTime", i) == t_) {
       // agent is scheduled to be built already
       continue;
     }
     int id = qentry.GetVal<int>("AgentId", i);
-    std::vector<Cond> conds;
-    conds.push_back(Cond("AgentId", "==", id));
-    conds.push_back(Cond("ExitTime", "<", t_));
-    try {
-      QueryResult qexit = b_->Query("AgentExit", &conds);
-      if (qexit.rows.size() != 0) {
-        continue;  // agent was decomissioned before t_ - skip
-      }
-    } catch (std::exception err) {}  // table doesn't exist (okay)
+    if (exited.count(id) > 0) {
+      continue;  // agent was decomissioned before t_ - skip
+    }
 
     // if the agent wasn't decommissioned before t_ create and init it
 
     std::string proto = qentry.GetVal<std::string>("Prototype", i);
     std::string impl = qentry.GetVal<std::string>("Spec", i);
     AgentSpec spec(impl);
+    Agent::next_id_ = id;  // so that it is registered under its id
     Agent* m = DynamicModule::Make(ctx_, spec);
+    next_id = std::max(next_id, id + 1);
 
     // agent-kernel init
     m->prototype_ = proto;
-    m->id_ = id;
     m->enter_time_ = qentry.GetVal<int>("EnterTime", i);
     unbuilt[id] = m;
     parentmap[id] = qentry.GetVal<int>("ParentId", i);
 
     // agent-custom init
-    conds.pop_back();
-    conds.push_back(Cond("SimTime", "==", t_));
+    std::vector<Cond> conds;
+    conds.push_back(Cond("AgentId", "==", id));
+    conds.push_back(Cond("SimTime", "==", StateTime(id)));
     CondInjector ci(b_, conds);
     PrefixInjector pi(&ci, "AgentState");
     m->Agent::InitFrom(&pi);
     pi = PrefixInjector(&ci, "AgentState" + spec.Sanitize());
     m->InitFrom(&pi);
   }
+  Agent::next_id_ = next_id;  // see LoadPrototypes
 
   // construct agent hierarchy starting at roots (no parent) down
   std::map<int, Agent*>::iterator it = unbuilt.begin();
@@ -407,24 +658,50 @@ void SimInit::LoadInitialAgents() {
 }
 
 void SimInit::LoadInventories() {
+  std::set<int> agentids;
   std::map<int, Agent*>::iterator it;
   for (it = agents_.begin(); it != agents_.end(); ++it) {
-    Agent* m = it->second;
-    std::vector<Cond> conds;
-    conds.push_back(Cond("SimTime", "==", t_));
-    conds.push_back(Cond("AgentId", "==", m->id()));
-    QueryResult qr;
-    try {
-      qr = b_->Query("AgentStateInventories", &conds);
-    } catch (std::exception err) {return;}  // table doesn't exist (okay)
+    agentids.insert(it->first);
+  }
+  // agents unchanged at t_ have the inventories recorded with their state
+  std::set<int> times;
+  times.insert(t_);
+  std::map<int, int>::iterator st;
+  for (st = state_times_.begin(); st != state_times_.end(); ++st) {
+    times.insert(st->second);
+  }
+  std::vector<Cond> conds;
+  conds.push_back(Cond("SimTime", "IN", times));
+  conds.push_back(Cond("AgentId", "IN", agentids));
+  QueryResult qr;
+  try {
+    qr = b_->Query("AgentStateInventories", &conds);
+  } catch (std::exception err) {return;}  // table doesn't exist (okay)
 
-    Inventories invs;
-    for (int i = 0; i < qr.rows.size(); ++i) {
-      std::string inv_name = qr.GetVal<std::string>("InventoryName", i);
-      int state_id = qr.GetVal<int>("ResourceId", i);
-      invs[inv_name].push_back(LoadResource(ctx_, b_, state_id));
+  std::vector<int> rows;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    int agentid = qr.GetVal<int>("AgentId", i);
+    if (qr.GetVal<int>("SimTime", i) == StateTime(agentid)) {
+      rows.push_back(i);
     }
-    m->InitInv(invs);
+  }
+
+  std::set<int> state_ids;
+  for (int k = 0; k < rows.size(); ++k) {
+    state_ids.insert(qr.GetVal<int>("ResourceId", rows[k]));
+  }
+  std::map<int, Resource::Ptr> res = LoadResources(ctx_, b_, state_ids);
+
+  std::map<int, Inventories> invs;
+  for (int k = 0; k < rows.size(); ++k) {
+    int i = rows[k];
+    int agentid = qr.GetVal<int>("AgentId", i);
+    std::string inv_name = qr.GetVal<std::string>("InventoryName", i);
+    int state_id = qr.GetVal<int>("ResourceId", i);
+    invs[agentid][inv_name].push_back(res[state_id]);
+  }
+  for (it = agents_.begin(); it != agents_.end(); ++it) {
+    it->second->InitInv(invs[it->first]);
   }
 }
 
@@ -436,11 +713,15 @@ void SimInit::LoadBuildSched() {
     qr = b_->Query("BuildSchedule", &conds);
   } catch (std::exception err) {return;}  // table doesn't exist (okay)
 
+  // older databases have no Count column
+  bool counted = std::find(qr.fields.begin(), qr.fields.end(), "Count") !=
+                 qr.fields.end();
   for (int i = 0; i < qr.rows.size(); ++i) {
     int t = qr.GetVal<int>("BuildTime", i);
     int parentid = qr.GetVal<int>("ParentId", i);
     std::string proto = qr.GetVal<std::string>("Prototype", i);
-    ctx_->SchedBuild(agents_[parentid], proto, t);
+    int count = counted ? qr.GetVal<int>("Count", i) : 1;
+    ctx_->SchedBuild(agents_[parentid], proto, t, count);
   }
 }
 
@@ -512,87 +793,130 @@ Product::Ptr SimInit::BuildProduct(QueryableBackend* b, int resid) {
 }
 
 Resource::Ptr SimInit::LoadResource(Context* ctx, QueryableBackend* b, int state_id) {
+  std::set<int> state_ids;
+  state_ids.insert(state_id);
+  return LoadResources(ctx, b, state_ids)[state_id];
+}
+
+std::map<int, Resource::Ptr> SimInit::LoadResources(
+    Context* ctx, QueryableBackend* b, const std::set<int>& state_ids) {
+  std::map<int, Resource::Ptr> rtn;
+  if (state_ids.empty()) {
+    return rtn;
+  }
+
+  // get general resource object info
   std::vector<Cond> conds;
-  conds.push_back(Cond("ResourceId", "==", state_id));
+  conds.push_back(Cond("ResourceId", "IN", state_ids));
   QueryResult qr = b->Query("Resources", &conds);
-  ResourceType type = qr.GetVal<ResourceType>("Type");
-  int obj_id = qr.GetVal<int>("ObjId");
-
-  Resource::Ptr r;
-  if (type == Material::kType) {
-    r = LoadMaterial(ctx, b, state_id);
-  } else if (type == Product::kType) {
-    r = LoadProduct(ctx, b, state_id);
-  } else {
-    throw IOError("Invalid resource type in output database: " + type);
+  std::map<int, int> rows;  // map<state_id, row>
+  std::set<int> mat_ids;
+  std::set<int> mat_quals;
+  std::set<int> prod_quals;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    int state_id = qr.GetVal<int>("ResourceId", i);
+    if (rows.count(state_id) > 0) {
+      continue;
+    }
+    rows[state_id] = i;
+    ResourceType type = qr.GetVal<ResourceType>("Type", i);
+    if (type == Material::kType) {
+      mat_ids.insert(state_id);
+      mat_quals.insert(qr.GetVal<int>("QualId", i));
+    } else if (type == Product::kType) {
+      prod_quals.insert(qr.GetVal<int>("QualId", i));
+    } else {
+      throw IOError("Invalid resource type in output database: " + type);
+    }
   }
 
-  r->state_id_ = state_id;
-  r->obj_id_ = obj_id;
-  return r;
-}
-
-Material::Ptr SimInit::LoadMaterial(Context* ctx, QueryableBackend* b, int state_id) {
-  // get special material object state
-  std::vector<Cond> conds;
-  conds.push_back(Cond("ResourceId", "==", state_id));
-  QueryResult qr = b->Query("MaterialInfo", &conds);
-  int prev_decay = qr.GetVal<int>("PrevDecayTime");
+  // get special material object state and compositions
+  std::map<int, int> prev_decay;
+  std::map<int, Composition::Ptr> comps;
+  if (!mat_ids.empty()) {
+    conds.clear();
+    conds.push_back(Cond("ResourceId", "IN", mat_ids));
+    QueryResult qinfo = b->Query("MaterialInfo", &conds);
+    for (int i = 0; i < qinfo.rows.size(); ++i) {
+      prev_decay[qinfo.GetVal<int>("ResourceId", i)] =
+          qinfo.GetVal<int>("PrevDecayTime", i);
+    }
+    comps = LoadCompositions(b, mat_quals);
+  }
 
-  // get general resource object info
-  conds.clear();
-  conds.push_back(Cond("ResourceId", "==", state_id));
-  qr = b->Query("Resources", &conds);
-  double qty = qr.GetVal<double>("Quantity");
-  int stateid = qr.GetVal<int>("QualId");
+  // get special Product internal state
+  std::map<int, std::string> qualities;
+  if (!prod_quals.empty()) {
+    conds.clear();
+    conds.push_back(Cond("QualId", "IN", prod_quals));
+    QueryResult qprod = b->Query("Products", &conds);
+    for (int i = 0; i < qprod.rows.size(); ++i) {
+      int qualid = qprod.GetVal<int>("QualId", i);
+      std::string quality = qprod.GetVal<std::string>("Quality", i);
+      qualities[qualid] = quality;
+
+      // set static quality-stateid map to have same vals as db
+      Product::qualids_[quality] = qualid;
+    }
+  }
 
-  // create the composition and material
-  Composition::Ptr comp = LoadComposition(b, stateid);
   Agent* dummy = new Dummy(ctx);
-  Material::Ptr mat = Material::Create(dummy, qty, comp);
-  mat->prev_decay_time_ = prev_decay;
+  std::set<int>::const_iterator it;
+  for (it = state_ids.begin(); it != state_ids.end(); ++it) {
+    int state_id = *it;
+    if (rows.count(state_id) == 0) {
+      ctx->DelAgent(dummy);
+      throw KeyError("resource state id not found in output database: " +
+                     boost::lexical_cast<std::string>(state_id));
+    }
+    int i = rows[state_id];
+    double qty = qr.GetVal<double>("Quantity", i);
+    int qualid = qr.GetVal<int>("QualId", i);
+
+    Resource::Ptr r;
+    if (mat_ids.count(state_id) > 0) {
+      Material::Ptr mat = Material::Create(dummy, qty, comps[qualid]);
+      mat->prev_decay_time_ = prev_decay[state_id];
+      r = mat;
+    } else {
+      r = Product::Create(dummy, qty, qualities[qualid]);
+    }
+    r->state_id_ = state_id;
+    r->obj_id_ = qr.GetVal<int>("ObjId", i);
+    rtn[state_id] = r;
+  }
   ctx->DelAgent(dummy);
-
-  return mat;
+  return rtn;
 }
 
 Composition::Ptr SimInit::LoadComposition(QueryableBackend* b, int stateid) {
+  std::set<int> qualids;
+  qualids.insert(stateid);
+  return LoadCompositions(b, qualids)[stateid];
+}
+
+std::map<int, Composition::Ptr> SimInit::LoadCompositions(
+    QueryableBackend* b, const std::set<int>& qualids) {
   std::vector<Cond> conds;
-  conds.push_back(Cond("QualId", "==", stateid));
+  conds.push_back(Cond("QualId", "IN", qualids));
   QueryResult qr = b->Query("Compositions", &conds);
-  CompMap cm;
+  std::map<int, CompMap> cms;
   for (int i = 0; i < qr.rows.size(); ++i) {
+    int qualid = qr.GetVal<int>("QualId", i);
     int nucid = qr.GetVal<int>("NucId", i);
     double mass_frac = qr.GetVal<double>("MassFrac", i);
-    cm[nucid] = mass_frac;
+    cms[qualid][nucid] = mass_frac;
   }
-  Composition::Ptr c = Composition::CreateFromMass(cm);
-  c->recorded_ = true;
-  c->id_ = stateid;
-  return c;
-}
-
-Product::Ptr SimInit::LoadProduct(Context* ctx, QueryableBackend* b, int state_id) {
-  // get general resource object info
-  std::vector<Cond> conds;
-  conds.push_back(Cond("ResourceId", "==", state_id));
-  QueryResult qr = b->Query("Resources", &conds);
-  double qty = qr.GetVal<double>("Quantity");
-  int stateid = qr.GetVal<int>("QualId");
-
-  // get special Product internal state
-  conds.clear();
-  conds.push_back(Cond("QualId", "==", stateid));
-  qr = b->Query("Products", &conds);
-  std::string quality = qr.GetVal<std::string>("Quality");
 
-  // set static quality-stateid map to have same vals as db
-  Product::qualids_[quality] = stateid;
-
-  Agent* dummy = new Dummy(ctx);
-  Product::Ptr r = Product::Create(dummy, qty, quality);
-  ctx->DelAgent(dummy);
-  return r;
+  std::map<int, Composition::Ptr> rtn;
+  std::set<int>::const_iterator it;
+  for (it = qualids.begin(); it != qualids.end(); ++it) {
+    Composition::Ptr c = Composition::CreateFromMass(cms[*it]);
+    c->recorded_ = true;
+    c->id_ = *it;
+    rtn[*it] = c;
+  }
+  return rtn;
 }
 
 }  // namespace cyclus
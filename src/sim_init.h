@@ -12,6 +12,24 @@ namespace cyclus {
 
 class Context;
 
+/// What each agent's state was at the snapshots taken so far, so that a
+/// snapshot can leave out the agents whose state did not change (see
+/// SimInit::Snapshot).
+struct SnapshotHistory {
+  explicit SnapshotHistory(int full_every = 0)
+      : full_every(full_every), nsnaps(0) {}
+
+  /// every full_every-th snapshot records all agents; 0 for only the first
+  int full_every;
+
+  /// the number of snapshots taken
+  int nsnaps;
+
+  /// the encoded values of each agent's recorded state and the time it was
+  /// recorded, by agent id; states are compared byte for byte
+  std::map<int, std::pair<std::string, int> > agents;
+};
+
 /// Handles initialization of a simulation from the output database. After
 /// calling Init, Restart, or Branch, the initialized Context, Timer, and
 /// Recorder can be retrieved.
@@ -48,6 +66,14 @@ class SimInit {
   /// ctx into the simulation's output database.
   static void Snapshot(Context* ctx);
 
+  /// Records a differential snapshot of the simulation being managed by ctx.
+  /// Agents whose state is the same as at the last snapshot are not recorded
+  /// again; instead they get a row in the AgentStateUnchanged table (i.e.
+  /// agent ID, SimTime, time their state was recorded), which Restart
+  /// follows.  Agents are always recorded by the first snapshot and by every
+  /// hist->full_every-th one.
+  static void Snapshot(Context* ctx, SnapshotHistory* hist);
+
   /// Records a snapshot of the agent's current internal state into the
   /// simulation's output database.  Note that this should generally not be
   /// called directly.
@@ -82,6 +108,7 @@ class SimInit {
   void LoadRecipes();
   void LoadSolverInfo();
   void LoadPrototypes();
+  void LoadStateTimes();
   void LoadInitialAgents();
   void LoadInventories();
   void LoadBuildSched();
@@ -91,14 +118,27 @@ class SimInit {
   void* LoadPreconditioner(std::string name);
   ExchangeSolver* LoadGreedySolver(bool exclusive, std::set<std::string> tables);
   ExchangeSolver* LoadCoinSolver(bool exclusive, std::set<std::string> tables);
+  /// Returns the time at which the state the agent had at t_ was recorded.
+  int StateTime(int agentid);
+
   static Resource::Ptr LoadResource(Context* ctx, QueryableBackend* b, int resid);
-  static Material::Ptr LoadMaterial(Context* ctx, QueryableBackend* b, int resid);
-  static Product::Ptr LoadProduct(Context* ctx, QueryableBackend* b, int resid);
   static Composition::Ptr LoadComposition(QueryableBackend* b, int stateid);
 
+  /// Loads the resources with the given state ids using a fixed number of IN
+  /// queries rather than several queries per resource.
+  static std::map<int, Resource::Ptr> LoadResources(
+      Context* ctx, QueryableBackend* b, const std::set<int>& state_ids);
+
+  /// Loads the compositions with the given quality ids in a single query.
+  static std::map<int, Composition::Ptr> LoadCompositions(
+      QueryableBackend* b, const std::set<int>& qualids);
+
   // std::map<AgentId, Agent*>
   std::map<int, Agent*> agents_;
 
+  // std::map<AgentId, SimTime> for agents unchanged at t_
+  std::map<int, int> state_times_;
+
   Context* ctx_;
   Recorder* rec_;
   Timer ti_;
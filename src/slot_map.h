@@ -0,0 +1,204 @@
+#ifndef CYCLUS_SRC_SLOT_MAP_H_
+#define CYCLUS_SRC_SLOT_MAP_H_
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "error.h"
+
+namespace cyclus {
+
+/// A set of objects with distinct non-negative ids, e.g. agents, held as
+/// pointers in a contiguous array of slots in id order.  Looking an object
+/// up by its id, adding one with a greater id than all others, which is how
+/// agents are created, and removing one take constant time.  Removing an
+/// object empties its slot.  Empty slots are removed by Compact, which also
+/// happens when items is called or an object is added with a lower id than
+/// some other.
+///
+/// The slots can be walked by index while objects are added or removed
+/// within the lifetime of a Walk, which defers compaction and adding objects
+/// with lower ids than some other until it ends.  Objects added during the
+/// walk are thus visited if their ids are greater than all others and
+/// otherwise not, e.g.:
+///
+/// @code
+///
+/// SlotMap<T>::Walk w(&m);
+/// for (int i = 0; i < m.slots(); ++i) {
+///   T* x = m.slot(i);
+///   if (x != NULL) {
+///     ...
+///   }
+/// }
+///
+/// @endcode
+template <class T>
+class SlotMap {
+ public:
+  /// Defers the reordering of slots while it lives, see SlotMap.
+  class Walk {
+   public:
+    explicit Walk(SlotMap<T>* m) : m_(m) { m_->walks_++; }
+
+    ~Walk() {
+      if (--m_->walks_ == 0)
+        m_->AddPending();
+    }
+
+   private:
+    SlotMap<T>* m_;
+  };
+
+  SlotMap() : holes_(0), walks_(0) {}
+
+  /// Adds x with the given id.  Throws a KeyError if another object has the
+  /// id and a ValueError if it is negative.
+  void Insert(int id, T* x) {
+    if (id < 0) {
+      throw ValueError("negative id " + boost::lexical_cast<std::string>(id));
+    } else if (Get(id) != NULL) {
+      if (Get(id) == x)
+        return;
+      throw KeyError("duplicate id " + boost::lexical_cast<std::string>(id));
+    } else if (id >= pos_.size()) {
+      pos_.resize(id + 1, -1);
+    }
+
+    if (ids_.empty() || ids_.back() < id) {
+      pos_[id] = items_.size();
+      items_.push_back(x);
+      ids_.push_back(id);
+      return;
+    } else if (walks_ > 0) {
+      pos_[id] = kPending;
+      pending_.push_back(std::make_pair(id, x));
+      return;
+    }
+
+    Compact();
+    int i = std::lower_bound(ids_.begin(), ids_.end(), id) - ids_.begin();
+    items_.insert(items_.begin() + i, x);
+    ids_.insert(ids_.begin() + i, id);
+    for (int j = i; j < ids_.size(); ++j) {
+      pos_[ids_[j]] = j;
+    }
+  }
+
+  /// Removes the object with the given id, if it is x, and returns the
+  /// number of objects removed.
+  int Erase(int id, T* x) {
+    if (Get(id) != x || x == NULL)
+      return 0;
+    if (pos_[id] == kPending) {
+      pending_.erase(std::find(pending_.begin(), pending_.end(),
+                               std::make_pair(id, x)));
+      pos_[id] = -1;
+      return 1;
+    }
+    items_[pos_[id]] = NULL;
+    pos_[id] = -1;
+    holes_++;
+    return 1;
+  }
+
+  /// Returns the object with the given id, or NULL if there is none.
+  T* Get(int id) const {
+    if (id < 0 || id >= pos_.size() || pos_[id] == -1) {
+      return NULL;
+    } else if (pos_[id] == kPending) {
+      for (int i = 0; i < pending_.size(); ++i) {
+        if (pending_[i].first == id)
+          return pending_[i].second;
+      }
+      return NULL;
+    }
+    return items_[pos_[id]];
+  }
+
+  /// Returns the number of objects.
+  int size() const { return items_.size() - holes_ + pending_.size(); }
+
+  bool empty() const { return size() == 0; }
+
+  /// Removes all objects.
+  void clear() {
+    items_.clear();
+    ids_.clear();
+    pos_.clear();
+    pending_.clear();
+    holes_ = 0;
+  }
+
+  /// Returns the number of slots, including empty ones.
+  int slots() const { return items_.size(); }
+
+  /// Returns the object in slot i, or NULL if the slot is empty.
+  T* slot(int i) const { return items_[i]; }
+
+  /// Returns the id of the object that is or was in slot i.
+  int slot_id(int i) const { return ids_[i]; }
+
+  /// Returns the objects in id order, without empty slots.  It must not be
+  /// called during a Walk.
+  const std::vector<T*>& items() {
+    Compact();
+    return items_;
+  }
+
+  /// Removes the empty slots, moving the objects after them to lower slots.
+  /// Does nothing during a Walk.
+  void Compact() {
+    if (holes_ == 0 || walks_ > 0)
+      return;
+    int n = 0;
+    for (int i = 0; i < items_.size(); ++i) {
+      if (items_[i] != NULL) {
+        items_[n] = items_[i];
+        ids_[n] = ids_[i];
+        pos_[ids_[n]] = n;
+        n++;
+      }
+    }
+    items_.resize(n);
+    ids_.resize(n);
+    holes_ = 0;
+  }
+
+ private:
+  /// the slot of an object added during a Walk and kept in pending_
+  static const int kPending = -2;
+
+  /// Adds the objects kept in pending_ during a Walk.
+  void AddPending() {
+    std::vector<std::pair<int, T*> > pending;
+    pending.swap(pending_);
+    for (int i = 0; i < pending.size(); ++i) {
+      pos_[pending[i].first] = -1;
+      Insert(pending[i].first, pending[i].second);
+    }
+  }
+
+  /// the objects in id order, or NULL for empty slots
+  std::vector<T*> items_;
+
+  /// the id of the object in each slot
+  std::vector<int> ids_;
+
+  /// the slot of each id, or -1
+  std::vector<int> pos_;
+
+  /// objects added during a Walk with lower ids than some other
+  std::vector<std::pair<int, T*> > pending_;
+
+  int holes_;
+  int walks_;
+};
+
+}  // namespace cyclus
+
+#endif  // CYCLUS_SRC_SLOT_MAP_H_
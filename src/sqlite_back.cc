@@ -44,7 +44,7 @@ SqliteBack::~SqliteBack() {
   }
 }
 
-SqliteBack::SqliteBack(std::string path) : db_(path) {
+SqliteBack::SqliteBack(std::string path) : db_(path), ntemp_(0) {
   path_ = path;
   db_.open();
 
@@ -101,31 +101,165 @@ std::list<ColumnInfo> SqliteBack::Schema(std::string table) {
 }
 
 QueryResult SqliteBack::Query(std::string table, std::vector<Cond>* conds) {
-  QueryResult q = GetTableInfo(table);
+  QueryResult info = GetTableInfo(table);
+  return Query(table, info.fields, conds);
+}
 
-  std::stringstream sql;
-  sql << "SELECT * FROM " << table;
-  if (conds != NULL) {
-    sql << " WHERE ";
-    for (int i = 0; i < conds->size(); ++i) {
-      if (i > 0) {
-        sql << " AND ";
+QueryResult SqliteBack::Query(std::string table,
+                              const std::vector<std::string>& cols,
+                              std::vector<Cond>* conds) {
+  QueryResult q;
+  TempSets temps(this);
+  SqlStatement::Ptr stmt = Select(table, cols, conds, &q, &temps);
+  for (int i = 0; stmt->Step(); ++i) {
+    QueryRow r;
+    for (int j = 0; j < q.fields.size(); ++j) {
+      r.push_back(ColAsVal(stmt, j, q.types[j]));
+    }
+    q.rows.push_back(r);
+  }
+  return q;
+}
+
+QueryCursor::Ptr SqliteBack::Cursor(std::string table,
+                                    std::vector<Cond>* conds) {
+  QueryResult info = GetTableInfo(table);
+  return Cursor(table, info.fields, conds);
+}
+
+QueryCursor::Ptr SqliteBack::Cursor(std::string table,
+                                    const std::vector<std::string>& cols,
+                                    std::vector<Cond>* conds) {
+  StmtCursor* c = new StmtCursor(this);
+  QueryCursor::Ptr p(c);
+  c->stmt_ = Select(table, cols, conds, &c->info_, &c->temps_);
+  return p;
+}
+
+ColumnarResult SqliteBack::QueryColumnar(std::string table,
+                                         std::vector<Cond>* conds) {
+  QueryResult info = GetTableInfo(table);
+  return QueryColumnar(table, info.fields, conds);
+}
+
+ColumnarResult SqliteBack::QueryColumnar(std::string table,
+                                         const std::vector<std::string>& cols,
+                                         std::vector<Cond>* conds) {
+  QueryResult info;
+  TempSets temps(this);
+  SqlStatement::Ptr stmt = Select(table, cols, conds, &info, &temps);
+  ColumnarResult cr;
+  int nfields = info.fields.size();
+  for (int j = 0; j < nfields; ++j) {
+    cr.AddColumn(info.fields[j], info.types[j]);
+  }
+
+  // the column storage types are fixed by NewQueryColumn
+  std::vector<QueryColumn*> c(nfields);
+  for (int j = 0; j < nfields; ++j) {
+    c[j] = cr.column(j);
+  }
+  while (stmt->Step()) {
+    for (int j = 0; j < nfields; ++j) {
+      switch (info.types[j]) {
+        case INT: {
+          static_cast<TypedColumn<int>*>(c[j])->values.push_back(
+              stmt->GetInt(j));
+          break;
+        } case DOUBLE: {
+          static_cast<TypedColumn<double>*>(c[j])->values.push_back(
+              stmt->GetDouble(j));
+          break;
+        } case STRING: {
+          static_cast<TypedColumn<std::string>*>(c[j])->values.push_back(
+              stmt->GetText(j, NULL));
+          break;
+        } default: {
+          c[j]->Append(ColAsVal(stmt, j, info.types[j]));
+        }
       }
-      Cond c = (*conds)[i];
-      sql << c.field << " " << c.op << " ?";
     }
   }
-  sql << ";";
+  return cr;
+}
+
+bool SqliteBack::StmtCursor::Next(QueryResult* batch, int n) {
+  if (n < 1)
+    throw ValueError("query cursor batch size must be positive");
+  batch->fields = info_.fields;
+  batch->types = info_.types;
+  batch->rows.clear();
+  int nfields = info_.fields.size();
+  while (!done_ && batch->rows.size() < n) {
+    if (!stmt_->Step()) {
+      done_ = true;
+      break;
+    }
+    batch->rows.push_back(QueryRow());
+    QueryRow& r = batch->rows.back();
+    r.reserve(nfields);
+    for (int j = 0; j < nfields; ++j) {
+      r.push_back(back_->ColAsVal(stmt_, j, info_.types[j]));
+    }
+  }
+  return !batch->rows.empty();
+}
+
+SqlStatement::Ptr SqliteBack::Select(std::string table,
+                                     const std::vector<std::string>& cols,
+                                     std::vector<Cond>* conds,
+                                     QueryResult* q,
+                                     TempSets* temps) {
+  QueryResult info = GetTableInfo(table);
+  std::vector<int> idx = ProjectionIndices(info.fields, cols);
+
+  std::stringstream sql;
+  sql << "SELECT ";
+  for (int k = 0; k < idx.size(); ++k) {
+    if (k > 0) {
+      sql << ", ";
+    }
+    q->fields.push_back(info.fields[idx[k]]);
+    q->types.push_back(info.types[idx[k]]);
+    sql << info.fields[idx[k]];
+  }
+  sql << " FROM " << table << Where(conds, temps) << ";";
 
   SqlStatement::Ptr stmt = db_.Prepare(sql.str());
+  BindConds(conds, stmt);
+  return stmt;
+}
+
+QueryResult SqliteBack::Aggregate(std::string table,
+                                  const std::vector<std::string>& group_by,
+                                  const std::vector<Agg>& aggs,
+                                  std::vector<Cond>* conds) {
+  QueryResult q = AggregateInfo(ColumnTypes(table), group_by, aggs);
 
-  if (conds != NULL) {
-    for (int i = 0; i < conds->size(); ++i) {
-      boost::spirit::hold_any v = (*conds)[i].val;
-      Bind(v, Type(v), stmt, i+1);
+  std::stringstream groups;
+  for (int i = 0; i < group_by.size(); ++i) {
+    if (i > 0) {
+      groups << ", ";
     }
+    groups << group_by[i];
   }
+  std::stringstream sql;
+  sql << "SELECT " << groups.str();
+  for (int k = 0; k < aggs.size(); ++k) {
+    if (k > 0 || !group_by.empty()) {
+      sql << ", ";
+    }
+    sql << aggs[k].op << "(" << aggs[k].field << ")";
+  }
+  TempSets temps(this);
+  sql << " FROM " << table << Where(conds, &temps);
+  if (!group_by.empty()) {
+    sql << " GROUP BY " << groups.str();
+  }
+  sql << ";";
 
+  SqlStatement::Ptr stmt = db_.Prepare(sql.str());
+  BindConds(conds, stmt);
   for (int i = 0; stmt->Step(); ++i) {
     QueryRow r;
     for (int j = 0; j < q.fields.size(); ++j) {
@@ -136,6 +270,118 @@ QueryResult SqliteBack::Query(std::string table, std::vector<Cond>* conds) {
   return q;
 }
 
+std::string SqliteBack::Where(std::vector<Cond>* conds, TempSets* temps) {
+  if (conds == NULL || conds->empty()) {
+    return "";
+  }
+  std::vector<bool> bound = BoundSets(*conds);
+  std::stringstream sql;
+  sql << " WHERE ";
+  for (int i = 0; i < conds->size(); ++i) {
+    if (i > 0) {
+      sql << " AND ";
+    }
+    const Cond& c = (*conds)[i];
+    if (c.opcode == BETWEEN) {
+      sql << c.field << " BETWEEN ? AND ?";
+    } else if (c.opcode == IN) {
+      std::vector<boost::spirit::hold_any> vals = CondOperands(c);
+      if (bound[i]) {
+        sql << c.field << " IN (";
+        for (int k = 0; k < vals.size(); ++k) {
+          sql << (k > 0 ? ", ?" : "?");
+        }
+        sql << ")";
+      } else {
+        temps->names.push_back(TempSet(vals));
+        sql << c.field << " IN (SELECT v FROM " << temps->names.back() << ")";
+      }
+    } else {
+      sql << c.field << " " << c.op << " ?";
+    }
+  }
+  return sql.str();
+}
+
+void SqliteBack::BindConds(std::vector<Cond>* conds, SqlStatement::Ptr stmt) {
+  if (conds == NULL) {
+    return;
+  }
+  std::vector<bool> bound = BoundSets(*conds);
+  int index = 1;
+  for (int i = 0; i < conds->size(); ++i) {
+    if (!bound[i]) {
+      continue;  // values live in a temp table, see Where()
+    }
+    std::vector<boost::spirit::hold_any> vals = CondOperands((*conds)[i]);
+    for (int k = 0; k < vals.size(); ++k) {
+      Bind(vals[k], Type(vals[k]), stmt, index++);
+    }
+  }
+}
+
+std::vector<bool> SqliteBack::BoundSets(const std::vector<Cond>& conds) {
+  std::vector<bool> bound(conds.size(), true);
+  int nparams = 0;
+  for (int i = 0; i < conds.size(); ++i) {
+    if (conds[i].opcode != IN) {
+      nparams += conds[i].opcode == BETWEEN ? 2 : 1;
+    }
+  }
+  for (int i = 0; i < conds.size(); ++i) {
+    if (conds[i].opcode != IN) {
+      continue;
+    }
+    int n = CondOperands(conds[i]).size();
+    if (n > kMaxBoundOperands || nparams + n > kMaxBoundParams) {
+      bound[i] = false;
+    } else {
+      nparams += n;
+    }
+  }
+  return bound;
+}
+
+std::string SqliteBack::TempSet(
+    const std::vector<boost::spirit::hold_any>& vals) {
+  std::string name;
+  if (free_temps_.empty()) {
+    name = "CondSet" + boost::lexical_cast<std::string>(ntemp_++);
+    db_.Execute("CREATE TEMP TABLE " + name + " (v);");
+  } else {
+    name = free_temps_.back();
+    free_temps_.pop_back();
+  }
+  SqlStatement::Ptr stmt = db_.Prepare("INSERT INTO " + name + " VALUES (?);");
+  db_.Execute("BEGIN TRANSACTION;");
+  try {
+    for (int k = 0; k < vals.size(); ++k) {
+      Bind(vals[k], Type(vals[k]), stmt, 1);
+      stmt->Exec();
+    }
+  } catch (...) {
+    db_.Execute("END TRANSACTION;");
+    throw;
+  }
+  db_.Execute("END TRANSACTION;");
+  return name;
+}
+
+void SqliteBack::ReleaseTemps(const std::vector<std::string>& names) {
+  for (int i = 0; i < names.size(); ++i) {
+    db_.Execute("DELETE FROM " + names[i] + ";");
+    free_temps_.push_back(names[i]);
+  }
+}
+
+SqliteBack::TempSets::~TempSets() {
+  try {
+    back_->ReleaseTemps(names);
+  } catch (Error err) {
+    CLOG(LEV_ERROR) << "Error releasing sqlite temp tables: " << err.what();
+  }
+}
+
 std::map<std::string, DbTypes> SqliteBack::ColumnTypes(std::string table) {
   QueryResult qr = GetTableInfo(table);
   std::map<std::string, DbTypes> rtn;
@@ -330,6 +576,8 @@ void SqliteBack::Bind(boost::spirit::hold_any v, DbTypes type, SqlStatement::Ptr
       std::pair<std::string CYCLUS_COMMA std::vector<double> > > );
 
   CYCLUS_BINDVAL(LIST_PAIR_INT_INT, std::list< std::pair<int CYCLUS_COMMA int> >);
+  CYCLUS_BINDVAL(PAIR_INT_INT, std::pair<int CYCLUS_COMMA int>);
+  CYCLUS_BINDVAL(PAIR_DOUBLE_DOUBLE, std::pair<double CYCLUS_COMMA double>);
 
   CYCLUS_BINDVAL(
       MAP_STRING_MAP_STRING_INT,
@@ -434,6 +682,8 @@ boost::spirit::hold_any SqliteBack::ColAsVal(SqlStatement::Ptr stmt,
       std::pair<std::string CYCLUS_COMMA std::vector<double> > > );
 
   CYCLUS_LOADVAL(LIST_PAIR_INT_INT, std::list< std::pair<int CYCLUS_COMMA int> >);
+  CYCLUS_LOADVAL(PAIR_INT_INT, std::pair<int CYCLUS_COMMA int>);
+  CYCLUS_LOADVAL(PAIR_DOUBLE_DOUBLE, std::pair<double CYCLUS_COMMA double>);
   CYCLUS_LOADVAL(
       MAP_STRING_MAP_STRING_INT,
       std::map<std::string CYCLUS_COMMA std::map<std::string CYCLUS_COMMA int> >);
@@ -471,74 +721,12 @@ std::string SqliteBack::SqlType(boost::spirit::hold_any v) {
   }
 }
 
-struct compare {
-  bool operator()(const std::type_info* a, const std::type_info* b) const {
-    return a->before(*b);
-  }
-};
-
-static std::map<const std::type_info*, DbTypes, compare> type_map;
-
 DbTypes SqliteBack::Type(boost::spirit::hold_any v) {
-  if (type_map.size() == 0) {
-    type_map[&typeid(int)] = INT;
-    type_map[&typeid(double)] = DOUBLE;
-    type_map[&typeid(float)] = FLOAT;
-    type_map[&typeid(bool)] = BOOL;
-    type_map[&typeid(Blob)] = BLOB;
-    type_map[&typeid(boost::uuids::uuid)] = UUID;
-    type_map[&typeid(std::string)] = STRING;
-    type_map[&typeid(std::set<int>)] = SET_INT;
-    type_map[&typeid(std::set<std::string>)] = SET_STRING;
-    type_map[&typeid(std::vector<int>)] = VECTOR_INT;
-    type_map[&typeid(std::vector<double>)] = VECTOR_DOUBLE;
-    type_map[&typeid(std::vector<std::string>)] = VECTOR_STRING;
-    type_map[&typeid(std::list<int>)] = LIST_INT;
-    type_map[&typeid(std::list<std::string>)] = LIST_STRING;
-    type_map[&typeid(std::map<int, int>)] = MAP_INT_INT;
-    type_map[&typeid(std::map<int, double>)] = MAP_INT_DOUBLE;
-    type_map[&typeid(std::map<int, std::string>)] = MAP_INT_STRING;
-    type_map[&typeid(std::map<std::string, int>)] = MAP_STRING_INT;
-    type_map[&typeid(std::map<std::string, double>)] = MAP_STRING_DOUBLE;
-    type_map[&typeid(std::map<std::string, std::string>)] = MAP_STRING_STRING;
-    type_map[&typeid(std::map<std::string, std::vector<double> >)] =
-        MAP_STRING_VECTOR_DOUBLE;
-    type_map[&typeid(std::map<std::string, std::map<int, double> >)] =
-        MAP_STRING_MAP_INT_DOUBLE;
-    type_map[&typeid(std::map<std::string,
-                              std::pair<double, std::map<int, double> > >)] =
-        MAP_STRING_PAIR_DOUBLE_MAP_INT_DOUBLE;
-    type_map[&typeid(std::map<int, std::map<std::string, double> >)] =
-        MAP_INT_MAP_STRING_DOUBLE;
-    type_map[&typeid(
-        std::map<std::string,
-                 std::vector<std::pair<int, std::pair<std::string,
-                                                      std::string> > > >)] =
-        MAP_STRING_VECTOR_PAIR_INT_PAIR_STRING_STRING;
-
-    type_map[&typeid(
-        std::map<std::string,
-                  std::pair<std::string,
-                            std::vector<double> > >)] =
-        MAP_STRING_PAIR_STRING_VECTOR_DOUBLE;
-    
-    type_map[&typeid(std::map<std::string, std::map<std::string,int> >)] =
-        MAP_STRING_MAP_STRING_INT;
-    
-    type_map[&typeid(std::list<std::pair<int, int> >)] = LIST_PAIR_INT_INT;
-    
-    type_map[&typeid(
-        std::vector<std::pair<std::pair<double, double>,
-                              std::map<std::string, double> > > )] =
-        VECTOR_PAIR_PAIR_DOUBLE_DOUBLE_MAP_STRING_DOUBLE;
-
-  }
-
-  const std::type_info* ti = &v.type();
-  if (type_map.count(ti) == 0) {
-    throw ValueError(std::string("unsupported backend type ") + ti->name());
-  }
-  return type_map[ti];
+  // sqlite keeps strings of any length in TEXT columns
+  if (v.type() == typeid(std::string)) {
+    return STRING;
+  }
+  return DbTypeOf(v, std::vector<int>());
 }
 
 }  // namespace cyclus
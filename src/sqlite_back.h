@@ -4,6 +4,7 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "query_backend.h"
 #include "sqlite_db.h"
@@ -38,6 +39,32 @@ class SqliteBack: public FullBackend {
 
   virtual QueryResult Query(std::string table, std::vector<Cond>* conds);
 
+  /// Selects only the requested columns in SQL.
+  virtual QueryResult Query(std::string table,
+                            const std::vector<std::string>& cols,
+                            std::vector<Cond>* conds);
+
+  /// Steps the underlying sqlite statement only as rows are requested.
+  virtual QueryCursor::Ptr Cursor(std::string table, std::vector<Cond>* conds);
+
+  virtual QueryCursor::Ptr Cursor(std::string table,
+                                  const std::vector<std::string>& cols,
+                                  std::vector<Cond>* conds);
+
+  /// Reads scalar and string columns straight into their typed vectors.
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       std::vector<Cond>* conds);
+
+  virtual ColumnarResult QueryColumnar(std::string table,
+                                       const std::vector<std::string>& cols,
+                                       std::vector<Cond>* conds);
+
+  /// Runs the aggregation as a GROUP BY query in sqlite.
+  virtual QueryResult Aggregate(std::string table,
+                                const std::vector<std::string>& group_by,
+                                const std::vector<Agg>& aggs,
+                                std::vector<Cond>* conds);
+
   virtual std::map<std::string, DbTypes> ColumnTypes(std::string table);
 
   virtual std::set<std::string> Tables();
@@ -47,6 +74,77 @@ class SqliteBack: public FullBackend {
   SqliteDb& db();
 
  private:
+  /// The temp tables holding the IN sets of one statement, which are handed
+  /// back to the backend for reuse when this is destroyed.  It must thus
+  /// outlive the statement.
+  class TempSets {
+   public:
+    TempSets(SqliteBack* back) : back_(back) {}
+
+    ~TempSets();
+
+    std::vector<std::string> names;
+
+   private:
+    SqliteBack* back_;
+  };
+
+  /// A cursor that reads rows from a prepared SELECT statement on demand.
+  class StmtCursor : public QueryCursor {
+   public:
+    StmtCursor(SqliteBack* back) : temps_(back), back_(back), done_(false) {}
+
+    virtual bool Next(QueryResult* batch, int n);
+
+    /// the temp tables of stmt_, declared first so that they outlive it
+    TempSets temps_;
+    SqlStatement::Ptr stmt_;
+    QueryResult info_;
+
+   private:
+    SqliteBack* back_;
+    bool done_;
+  };
+
+  /// Prepares and binds the SELECT statement for a query, setting the fields
+  /// and types of the result in q and adding the temp tables it reads to
+  /// temps.
+  SqlStatement::Ptr Select(std::string table,
+                           const std::vector<std::string>& cols,
+                           std::vector<Cond>* conds,
+                           QueryResult* q,
+                           TempSets* temps);
+
+  /// Returns the WHERE clause for conds, with a placeholder for each value.
+  /// IN sets not bound (see BoundSets) are loaded into a temp table instead.
+  /// The temp tables are added to temps.
+  std::string Where(std::vector<Cond>* conds, TempSets* temps);
+
+  /// Returns whether each of conds has its values bound as parameters.
+  /// Other conditions always are; an IN set is unless it is larger than
+  /// kMaxBoundOperands or would take the parameters of the whole statement
+  /// past kMaxBoundParams, in which case it goes to a temp table.
+  std::vector<bool> BoundSets(const std::vector<Cond>& conds);
+
+  /// Binds the values of conds to the placeholders of the WHERE clause.
+  void BindConds(std::vector<Cond>* conds, SqlStatement::Ptr stmt);
+
+  /// Fills a temp table with vals in its single column "v" and returns its
+  /// name.  An emptied temp table is reused if there is one, so temp tables
+  /// are only created as more IN sets are in use at once.
+  std::string TempSet(const std::vector<boost::spirit::hold_any>& vals);
+
+  /// Empties the temp tables in names for reuse by TempSet.  No statement
+  /// reading them may still be alive.
+  void ReleaseTemps(const std::vector<std::string>& names);
+
+  /// The largest IN set bound as individual parameters.
+  static const int kMaxBoundOperands = 500;
+
+  /// The most parameters bound to one statement; 999 is the smallest
+  /// SQLITE_MAX_VARIABLE_NUMBER in the wild.
+  static const int kMaxBoundParams = 999;
+
   void Bind(boost::spirit::hold_any v, DbTypes type, SqlStatement::Ptr stmt, int index);
 
   QueryResult GetTableInfo(std::string table);
@@ -77,6 +175,12 @@ class SqliteBack: public FullBackend {
   /// Stores the database's path+name, declared during construction.
   std::string path_;
 
+  /// Number of temp tables created for IN conditions so far.
+  int ntemp_;
+
+  /// Empty temp tables free for reuse by TempSet.
+  std::vector<std::string> free_temps_;
+
   /// table names already existing (created) in the sqlite db.
   std::set<std::string> tbl_names_;
 
@@ -20,6 +20,35 @@ namespace cyclus {
 /// }
 ///
 /// @endcode
+///
+/// Archetypes whose Tick and Tock only touch the agent's own state, e.g. its
+/// ResBuf inventories and the resources in them, and record Datums, may
+/// declare them thread-safe:
+///
+/// @code
+///
+/// #pragma cyclus note {"thread_safe": true}
+///
+/// @endcode
+///
+/// When the Timer runs on more than one thread (see Timer::set_nthreads), it
+/// may then run them concurrently with those of other thread-safe agents.
+/// Such agents may create, split, absorb, transmute and decay resources, but
+/// must not trade, build or decommission agents, or schedule anything from
+/// Tick and Tock, and must hold PyneDataLock around any calls into pyne of
+/// their own.  Resources and compositions they create get the same ids as
+/// in a serial run: an agent about to take its first id waits until the
+/// agents before it have finished (see TaskTurns), so agents that create
+/// resources gain less from running concurrently.  Python archetypes are
+/// never run concurrently.
+///
+/// With concurrent exchanges (see Timer::set_concurrent_exchanges), the same
+/// holds for the requests, bids and preference adjustments of thread-safe
+/// traders, which may also have their capacity converters called from
+/// several threads at once.  Their parents still adjust preferences one at
+/// a time.  Converters must not create resources or
+/// compositions.  Bids must only read the requests they are given, e.g.
+/// with find rather than operator[].
 class TimeListener: virtual public Ider {
  public:
   /// Simulation agents do their beginning-of-timestep activities in the Tick
@@ -33,6 +62,13 @@ class TimeListener: virtual public Ider {
   ///
   /// @param time is the current simulation timestep
   virtual void Tock() = 0;
+
+  /// Returns the next timestep at which the agent needs its Tick and Tock,
+  /// for simulations that skip quiescent timesteps (see
+  /// Timer::set_skip_quiescent).  Timesteps before it may be skipped if no
+  /// other agent wakes up and nothing was requested in the last exchange.
+  /// The default, 0, wakes the agent every timestep.
+  virtual int NextWakeup() { return 0; }
 };
 
 }  // namespace cyclus
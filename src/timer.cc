@@ -1,13 +1,18 @@
 // Implements the Timer class
 #include "timer.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
 #include "agent.h"
+#include "dynamic_module.h"
+#include "env.h"
 #include "error.h"
 #include "logger.h"
 #include "pyhooks.h"
+#include "recorder.h"
 #include "sim_init.h"
 
 
@@ -18,14 +23,33 @@ void Timer::RunSim() {
                   << 0 << " to end=" << si_.duration;
   CLOG(LEV_INFO1) << "Beginning simulation";
 
+  if (!phases_.enabled()) {
+    if (!Env::GetEnv("CYCLUS_PHASE_TIMINGS").empty())
+      phases_.RecordTo(ctx_);
+    std::string trace = Env::GetEnv("CYCLUS_TRACE");
+    if (!trace.empty())
+      phases_.TraceTo(trace);
+  }
+
+  last_checkpoint_ = time_;
+  last_checkpoint_wall_ = std::chrono::steady_clock::now();
+
   ExchangeManager<Material> matl_manager(ctx_);
   ExchangeManager<Product> genrsrc_manager(ctx_);
   while (time_ < si_.duration) {
     CLOG(LEV_INFO1) << "Current time: " << time_;
+    phases_.Step(time_);
 
-    if (want_snapshot_) {
+    bool checkpoint = CheckpointDue();
+    if (want_snapshot_ || checkpoint) {
+      PhaseScope p(&phases_, "Snapshot");
       want_snapshot_ = false;
-      SimInit::Snapshot(ctx_);
+      SimInit::Snapshot(ctx_, snaps_);
+    }
+    if (checkpoint) {
+      PhaseScope p(&phases_, "Checkpoint");
+      CLOG(LEV_INFO2) << "Checkpointing at time: " << time_;
+      ctx_->rec_->FlushAsync();
     }
 
     // run through phases
@@ -36,10 +60,14 @@ void Timer::RunSim() {
     DoResEx(&matl_manager, &genrsrc_manager);
     CLOG(LEV_INFO2) << "Beginning Tock for time: " << time_;
     DoTock();
+    DoInventories();
     DoDecom();
 
 #ifdef CYCLUS_WITH_PYTHON
-    EventLoop();
+    if (PY_EVENT_CONSUMERS) {
+      PhaseScope p(&phases_, "EventLoop");
+      EventLoop();
+    }
 #endif
 
     time_++;
@@ -47,6 +75,16 @@ void Timer::RunSim() {
     if (want_kill_) {
       break;
     }
+
+    if (skip_quiescent_) {
+      int next = NextActiveTime(!matl_manager.empty() ||
+                                !genrsrc_manager.empty());
+      if (next > time_) {
+        CLOG(LEV_INFO2) << "Skipping quiescent times " << time_ << " to "
+                        << next - 1;
+        time_ = next;
+      }
+    }
   }
 
   ctx_->NewDatum("Finish")
@@ -54,83 +92,335 @@ void Timer::RunSim() {
       ->AddVal("EndTime", time_-1)
       ->Record();
 
-  SimInit::Snapshot(ctx_);  // always do a snapshot at the end of every simulation
+  {
+    PhaseScope p(&phases_, "Snapshot");
+    SimInit::Snapshot(ctx_, snaps_);  // always do a snapshot at the end of every simulation
+  }
+  phases_.Close();
+}
+
+bool Timer::CheckpointDue() {
+  std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  bool due = checkpoint_steps_ > 0 &&
+             time_ - last_checkpoint_ >= checkpoint_steps_;
+  if (checkpoint_minutes_ > 0) {
+    std::chrono::duration<double> wall = now - last_checkpoint_wall_;
+    due = due || wall.count() >= checkpoint_minutes_ * 60;
+  }
+  if (due) {
+    last_checkpoint_ = time_;
+    last_checkpoint_wall_ = now;
+  }
+  return due;
 }
 
 void Timer::DoBuild() {
+  PhaseScope p(&phases_, "Build");
   // build queued agents
-  std::vector<std::pair<std::string, Agent*> > build_list = build_queue_[time_];
+  std::vector<Event> build_list;
+  PopDue(&builds_, &build_list);
+  std::vector<Agent*> built;
   for (int i = 0; i < build_list.size(); ++i) {
-    Agent* m = ctx_->CreateAgent<Agent>(build_list[i].first);
-    Agent* parent = build_list[i].second;
-    CLOG(LEV_INFO3) << "Building a " << build_list[i].first
-                    << " from parent " << build_list[i].second;
-    m->Build(parent);
-    if (parent != NULL) {
-      parent->BuildNotify(m);
-    } else {
-      CLOG(LEV_DEBUG1) << "Hey! Listen! Built an Agent without a Parent.";
+    built.clear();
+    ctx_->CreateAgents(build_list[i].proto, build_list[i].count, &built);
+    Agent* parent = build_list[i].agent;
+    CLOG(LEV_INFO3) << "Building " << build_list[i].count << " "
+                    << build_list[i].proto << " from parent "
+                    << build_list[i].agent;
+    for (int j = 0; j < built.size(); ++j) {
+      Agent* m = built[j];
+      m->Build(parent);
+      if (parent != NULL) {
+        parent->BuildNotify(m);
+      } else {
+        CLOG(LEV_DEBUG1) << "Hey! Listen! Built an Agent without a Parent.";
+      }
     }
   }
 }
 
 void Timer::DoTick() {
-  for (std::map<int, TimeListener*>::iterator agent = tickers_.begin();
-       agent != tickers_.end();
-       agent++) {
-    agent->second->Tick();
-  }
+  PhaseScope p(&phases_, "Tick");
+  Notify(false);
 }
 
 void Timer::DoResEx(ExchangeManager<Material>* matmgr,
                     ExchangeManager<Product>* genmgr) {
-  matmgr->Execute();
-  genmgr->Execute();
+  ExchangeThreads threads;
+  ExchangeThreads* run_on = NULL;
+  if (concurrent_exchanges_ && nthreads_ > 1) {
+    SafeTraders(&threads.safe);
+    if (threads.safe.size() > 1) {
+      if (pool_ == NULL)
+        pool_ = new ThreadPool(nthreads_);
+      threads.pool = pool_;
+      threads.rec = ctx_->rec_;
+      run_on = &threads;
+    }
+  }
+
+  {
+    PhaseScope p(&phases_, "MaterialExchange");
+    matmgr->Execute(run_on);
+  }
+  {
+    PhaseScope p(&phases_, "ProductExchange");
+    genmgr->Execute(run_on);
+  }
 }
 
 void Timer::DoTock() {
-  for (std::map<int, TimeListener*>::iterator agent = tickers_.begin();
-       agent != tickers_.end();
-       agent++) {
-    agent->second->Tock();
-  }
-
-  if (si_.explicit_inventory || si_.explicit_inventory_compact) {
-    std::set<Agent*> ags = ctx_->agent_list_;
-    std::set<Agent*>::iterator it;
-    for (it = ags.begin(); it != ags.end(); ++it) {
-      Agent* a = *it;
-      if (a->enter_time() == -1) {
-        continue; // skip agents that aren't alive
+  PhaseScope p(&phases_, "Tock");
+  Notify(true);
+}
+
+int Timer::NextActiveTime(bool traded) {
+  if (traded || want_snapshot_ || si_.explicit_inventory ||
+      si_.explicit_inventory_compact) {
+    return time_;
+  }
+
+  int next = si_.duration;
+  if (!builds_.empty())
+    next = std::min(next, builds_.top().time);
+  if (!decoms_.empty())
+    next = std::min(next, decoms_.top().time);
+  for (int i = 0; i < tickers_.slots() && next > time_; ++i) {
+    TimeListener* tl = tickers_.slot(i);
+    if (tl != NULL) {
+      next = std::min(next, tl->NextWakeup());
+    }
+  }
+  return std::max(next, time_);
+}
+
+void Timer::Notify(bool tock) {
+  std::vector<TimeListener*> batch;
+  tickers_.Compact();
+  // agents may register listeners with lower ids while ticking
+  SlotMap<TimeListener>::Walk w(&tickers_);
+  for (int i = 0; i < tickers_.slots(); ++i) {
+    TimeListener* agent = tickers_.slot(i);
+    if (agent == NULL) {
+      continue;
+    } else if (nthreads_ > 1 &&
+               safe_tickers_.Get(tickers_.slot_id(i)) != NULL) {
+      batch.push_back(agent);
+      continue;
+    }
+    NotifyBatch(&batch, tock);
+    if (tock) {
+      agent->Tock();
+    } else {
+      agent->Tick();
+    }
+  }
+  NotifyBatch(&batch, tock);
+}
+
+namespace {
+
+/// Ticks or tocks one agent of a batch, staging the Datums it records.
+struct NotifyTask {
+  std::vector<TimeListener*>* agents;
+  std::vector<DatumList>* staged;
+  Recorder* rec;
+  bool tock;
+
+  void operator()(int i) {
+    rec->Stage(&(*staged)[i]);
+    try {
+      if (tock) {
+        (*agents)[i]->Tock();
+      } else {
+        (*agents)[i]->Tick();
+      }
+    } catch (...) {
+      rec->Unstage();
+      throw;
+    }
+    rec->Unstage();
+  }
+};
+
+}  // namespace
+
+void Timer::NotifyBatch(std::vector<TimeListener*>* batch, bool tock) {
+  if (batch->size() < 2) {
+    for (int i = 0; i < batch->size(); ++i) {
+      if (tock) {
+        (*batch)[i]->Tock();
+      } else {
+        (*batch)[i]->Tick();
       }
-      RecordInventories(a);
     }
+    batch->clear();
+    return;
+  }
+
+  if (pool_ == NULL)
+    pool_ = new ThreadPool(nthreads_);
+  std::vector<DatumList> staged(batch->size());
+  NotifyTask task = {batch, &staged, ctx_->rec_, tock};
+  try {
+    pool_->RunInTurn(batch->size(), task);
+  } catch (...) {
+    for (int i = 0; i < staged.size(); ++i)
+      ctx_->rec_->Discard(&staged[i]);
+    throw;
+  }
+  for (int i = 0; i < staged.size(); ++i)
+    ctx_->rec_->Commit(&staged[i]);
+  batch->clear();
+}
+
+bool Timer::ThreadSafe(Agent* a) {
+  if (a == NULL)
+    return false;
+  std::string spec = a->spec();
+  std::map<std::string, bool>::iterator it = safe_specs_.find(spec);
+  if (it != safe_specs_.end() && !spec.empty())
+    return it->second;
+
+  Json::Value notes = a->annotations();
+  bool safe = notes.isObject() && notes.get("thread_safe", false).asBool() &&
+              !DynamicModule::IsPython(spec);
+  if (!spec.empty())
+    safe_specs_[spec] = safe;
+  return safe;
+}
+
+void Timer::SafeTraders(std::set<Trader*>* safe) {
+  const std::vector<Trader*>& traders = ctx_->traders();
+  for (int i = 0; i < traders.size(); ++i) {
+    Agent* a = traders[i]->manager();
+    while (a != NULL && ThreadSafe(a)) {
+      a = a->parent();
+    }
+    if (a == NULL && traders[i]->manager() != NULL)
+      safe->insert(traders[i]);
   }
 }
 
+void Timer::DoInventories() {
+  if (!si_.explicit_inventory && !si_.explicit_inventory_compact) {
+    return;
+  }
+
+  PhaseScope p(&phases_, "Inventories");
+  std::map<int, InvRecords> records;
+  std::vector<Agent*> ags = ctx_->agent_list_.items();
+  for (int i = 0; i < ags.size(); ++i) {
+    Agent* a = ags[i];
+    if (a->enter_time() == -1) {
+      continue; // skip agents that aren't alive
+    }
+    RecordInventories(a, &inv_records_[a->id()], &records[a->id()]);
+  }
+  inv_records_.swap(records);  // forget agents that are gone
+}
+
+void Timer::RecordInventories(Agent* a, InvRecords* last, InvRecords* cur) {
+  // lazily decayed materials change without their ids changing
+  bool reuse = si_.decay != "lazy";
 
-void Timer::RecordInventories(Agent* a) {
   Inventories invs = a->SnapshotInv();
   Inventories::iterator it2;
   for (it2 = invs.begin(); it2 != invs.end(); ++it2) {
     std::string name = it2->first;
-    std::vector<Resource::Ptr> mats = it2->second;
+    std::vector<Resource::Ptr>& mats = it2->second;
     if (mats.empty() || ResCast<Material>(mats[0]) == NULL) {
       continue; // skip non-material inventories
     }
 
+    InvRecord& rec = (*cur)[name];
+    for (int i = 0; i < mats.size(); i++) {
+      rec.key.ids.push_back(mats[i]->state_id());
+      rec.key.ids.push_back(mats[i]->qual_id());
+      rec.key.qtys.push_back(mats[i]->quantity());
+    }
+
+    InvRecords::iterator prev = last->find(name);
+    if (reuse && prev != last->end() && prev->second.key == rec.key) {
+      rec.since = prev->second.since;
+      rec.mass.swap(prev->second.mass);
+      rec.qty = prev->second.qty;
+      if (si_.explicit_inventory_incremental) {
+        ctx_->NewDatum("ExplicitInventoryUnchanged")
+            ->AddVal("AgentId", a->id())
+            ->AddVal("Time", time_)
+            ->AddVal("InventoryName", name)
+            ->AddVal("Since", rec.since)
+            ->Record();
+      } else {
+        RecordInventory(a, name, rec.mass, rec.qty);
+      }
+      continue;
+    }
+
+    rec.since = time_;
+    AggregateInventory(mats, &rec.mass, &rec.qty);
+    RecordInventory(a, name, rec.mass, rec.qty);
+  }
+}
+
+void Timer::AggregateInventory(const std::vector<Resource::Ptr>& mats,
+                               CompMap* mass, double* qty) {
+  mass->clear();
+  *qty = 0;
+  if (si_.decay == "lazy") {
+    // reading the compositions would decay the agent's materials, so
+    // combine decayed copies instead
     Material::Ptr m = ResCast<Material>(mats[0]->Clone());
     for (int i = 1; i < mats.size(); i++) {
       m->Absorb(ResCast<Material>(mats[i]->Clone()));
     }
-    RecordInventory(a, name, m);
+    *mass = m->comp()->mass();
+    *qty = m->quantity();
+    return;
+  }
+
+  // sum the quantities of runs of materials sharing a composition, which
+  // is common for materials made from the same recipe
+  std::vector<std::pair<Composition::Ptr, double> > parts;
+  for (int i = 0; i < mats.size(); i++) {
+    Material::Ptr m = ResCast<Material>(mats[i]);
+    Composition::Ptr c = m->comp();
+    if (parts.empty() || parts.back().first != c) {
+      parts.push_back(std::make_pair(c, 0.0));
+    }
+    parts.back().second += m->quantity();
+  }
+
+  if (parts.size() == 1) {
+    *mass = parts[0].first->mass();
+    *qty = parts[0].second;
+    return;
+  }
+
+  for (int i = 0; i < parts.size(); i++) {
+    const CompMap& v = parts[i].first->mass();
+    double sum = compmath::Sum(v);
+    *qty += parts[i].second;
+    if (sum == 0) {
+      continue;
+    }
+    double mult = parts[i].second / sum;
+    CompMap::iterator hint = mass->begin();
+    CompMap::const_iterator it;
+    for (it = v.begin(); it != v.end(); ++it) {
+      hint = mass->insert(hint, std::make_pair(it->first, 0.0));
+      hint->second += it->second * mult;
+    }
   }
 }
 
-void Timer::RecordInventory(Agent* a, std::string name, Material::Ptr m) {
+void Timer::RecordInventory(Agent* a, std::string name, const CompMap& mass,
+                            double qty) {
   if (si_.explicit_inventory) {
-    CompMap c = m->comp()->mass();
-    compmath::Normalize(&c, m->quantity());
+    CompMap c = mass;
+    compmath::Normalize(&c, qty);
     CompMap::iterator it;
     for (it = c.begin(); it != c.end(); ++it) {
       ctx_->NewDatum("ExplicitInventory")
@@ -144,43 +434,101 @@ void Timer::RecordInventory(Agent* a, std::string name, Material::Ptr m) {
   }
 
   if (si_.explicit_inventory_compact) {
-    CompMap c = m->comp()->mass();
+    CompMap c = mass;
     compmath::Normalize(&c, 1);
     ctx_->NewDatum("ExplicitInventoryCompact")
         ->AddVal("AgentId", a->id())
         ->AddVal("Time", time_)
         ->AddVal("InventoryName", name)
-        ->AddVal("Quantity", m->quantity())
+        ->AddVal("Quantity", qty)
         ->AddVal("Composition", c)
         ->Record();
   }
 }
 
 void Timer::DoDecom() {
-  // decommission queued agents
-  std::vector<Agent*> decom_list = decom_queue_[time_];
-  for (int i = 0; i < decom_list.size(); ++i) {
-    Agent* m = decom_list[i];
-    if (m->parent() != NULL) {
-      m->parent()->DecomNotify(m);
+  PhaseScope p(&phases_, "Decom");
+  // decommission queued agents, including any queued for now meanwhile
+  std::vector<Event> due;
+  PopDue(&decoms_, &due);
+  while (!due.empty()) {
+    std::vector<Agent*> decom_list;
+    for (int i = 0; i < due.size(); ++i) {
+      if (TakeDecom(due[i]))
+        decom_list.push_back(due[i].agent);
+    }
+    for (int i = 0; i < decom_list.size(); ++i) {
+      Agent* m = decom_list[i];
+      if (pending_decoms_.count(m) > 0) {
+        continue;  // rescheduled by an earlier decommissioning
+      }
+      if (m->parent() != NULL) {
+        m->parent()->DecomNotify(m);
+      }
+      m->Decommission();
+    }
+    due.clear();
+    PopDue(&decoms_, &due);
+  }
+}
+
+void Timer::PopDue(EventQueue* q, std::vector<Event>* due) {
+  while (!q->empty() && q->top().time <= time_) {
+    if (q->top().time == time_) {
+      due->push_back(q->top());
+    } else if (q == &decoms_) {
+      TakeDecom(q->top());
     }
-    m->Decommission();
+    q->pop();
   }
 }
 
+bool Timer::TakeDecom(const Event& e) {
+  std::unordered_map<Agent*, unsigned long>::iterator it =
+      pending_decoms_.find(e.agent);
+  if (it == pending_decoms_.end() || it->second != e.seq)
+    return false;
+  pending_decoms_.erase(it);
+  return true;
+}
+
 void Timer::RegisterTimeListener(TimeListener* agent) {
-  tickers_[agent->id()] = agent;
+  tickers_.Insert(agent->id(), agent);
+  if (ThreadSafe(dynamic_cast<Agent*>(agent)))
+    safe_tickers_.Insert(agent->id(), agent);
 }
 
 void Timer::UnregisterTimeListener(TimeListener* tl) {
-  tickers_.erase(tl->id());
+  tickers_.Erase(tl->id(), tl);
+  safe_tickers_.Erase(tl->id(), tl);
+}
+
+void Timer::set_nthreads(int n) {
+  nthreads_ = n < 1 ? 1 : n;
+  delete pool_;
+  pool_ = NULL;
+}
+
+void Timer::set_differential_snapshots(int full_every) {
+  delete snaps_;
+  snaps_ = full_every < 0 ? NULL : new SnapshotHistory(full_every);
 }
 
-void Timer::SchedBuild(Agent* parent, std::string proto_name, int t) {
+void Timer::set_checkpoint_interval(int steps, double minutes) {
+  checkpoint_steps_ = steps < 0 ? 0 : steps;
+  checkpoint_minutes_ = minutes < 0 ? 0 : minutes;
+}
+
+void Timer::SchedBuild(Agent* parent, std::string proto_name, int t,
+                       int count) {
   if (t <= time_) {
     throw ValueError("Cannot schedule build for t < [current-time]");
   }
-  build_queue_[t].push_back(std::make_pair(proto_name, parent));
+  if (count < 1) {
+    throw ValueError("Cannot schedule a build of fewer than 1 agent");
+  }
+  Event e = {t, next_seq_++, parent, proto_name, count};
+  builds_.push(e);
 }
 
 void Timer::SchedDecom(Agent* m, int t) {
@@ -191,27 +539,16 @@ void Timer::SchedDecom(Agent* m, int t) {
   // It is possible that a single agent may be scheduled for decommissioning
   // multiple times. If this happens, we cannot just add it to the queue again
   // - the duplicate entries will result in a double delete attempt and
-  // segfaults and otherwise bad things.  Remove previous decommissionings
-  // before scheduling this new one.
-  std::map<int, std::vector<Agent*> >::iterator it;
-  bool done = false;
-  for (it = decom_queue_.begin(); it != decom_queue_.end(); ++it) {
-    int t = it->first;
-    std::vector<Agent*> ags = it->second;
-    for (int i = 0; i < ags.size(); i++) {
-      if (ags[i] == m) {
-        CLOG(LEV_WARN) << "scheduled over previous decommissioning of " << m->id();
-        decom_queue_[t].erase(decom_queue_[t].begin()+i);
-        done = true;
-        break;
-      }
-    }
-    if (done) {
-      break;
-    }
+  // segfaults and otherwise bad things.  Only the latest decommissioning of
+  // each agent is pending; earlier ones stay queued but are skipped.
+  Event e = {t, next_seq_++, m, "", 1};
+  std::pair<std::unordered_map<Agent*, unsigned long>::iterator, bool> ins =
+      pending_decoms_.insert(std::make_pair(m, e.seq));
+  if (!ins.second) {
+    CLOG(LEV_WARN) << "scheduled over previous decommissioning of " << m->id();
+    ins.first->second = e.seq;
   }
-
-  decom_queue_[t].push_back(m);
+  decoms_.push(e);
 }
 
 int Timer::time() {
@@ -220,8 +557,14 @@ int Timer::time() {
 
 void Timer::Reset() {
   tickers_.clear();
-  build_queue_.clear();
-  decom_queue_.clear();
+  safe_tickers_.clear();
+  safe_specs_.clear();
+  builds_ = EventQueue();
+  decoms_ = EventQueue();
+  pending_decoms_.clear();
+  if (snaps_ != NULL) {
+    *snaps_ = SnapshotHistory(snaps_->full_every);
+  }
   si_ = SimInfo(0);
 }
 
@@ -244,6 +587,35 @@ int Timer::dur() {
   return si_.duration;
 }
 
-Timer::Timer() : time_(0), si_(0), want_snapshot_(false), want_kill_(false) {}
+Timer::Timer()
+    : time_(0),
+      si_(0),
+      want_snapshot_(false),
+      want_kill_(false),
+      nthreads_(1),
+      pool_(NULL),
+      skip_quiescent_(!Env::GetEnv("CYCLUS_SKIP_QUIESCENT").empty()),
+      concurrent_exchanges_(
+          !Env::GetEnv("CYCLUS_CONCURRENT_EXCHANGES").empty()),
+      snaps_(NULL),
+      checkpoint_steps_(0),
+      checkpoint_minutes_(0),
+      last_checkpoint_(0),
+      next_seq_(0) {
+  std::string n = Env::GetEnv("CYCLUS_THREADS");
+  if (!n.empty())
+    set_nthreads(std::atoi(n.c_str()));
+  n = Env::GetEnv("CYCLUS_DIFF_SNAPSHOTS");
+  if (!n.empty())
+    set_differential_snapshots(std::atoi(n.c_str()));
+  set_checkpoint_interval(
+      std::atoi(Env::GetEnv("CYCLUS_CHECKPOINT_STEPS").c_str()),
+      std::atof(Env::GetEnv("CYCLUS_CHECKPOINT_MINUTES").c_str()));
+}
+
+Timer::~Timer() {
+  delete pool_;
+  delete snaps_;
+}
 
 }  // namespace cyclus
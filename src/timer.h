@@ -1,6 +1,10 @@
 #ifndef CYCLUS_SRC_TIMER_H_
 #define CYCLUS_SRC_TIMER_H_
 
+#include <chrono>
+#include <queue>
+#include <set>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -11,12 +15,16 @@
 #include "infile_tree.h"
 #include "time_listener.h"
 #include "comp_math.h"
+#include "parallel.h"
+#include "phase_timer.h"
+#include "slot_map.h"
 
 class SimInitTest;
 
 namespace cyclus {
 
 class Agent;
+struct SnapshotHistory;
 
 /// Controls simulation timestepping and inter-timestep phases.
 class Timer {
@@ -24,6 +32,8 @@ class Timer {
  public:
   Timer();
 
+  ~Timer();
+
   /// Sets intial time-related parameters for the simulation.
   ///
   /// @param ctx simulation context
@@ -36,7 +46,10 @@ class Timer {
   void RunSim();
 
   /// Registers an agent to receive tick/tock notifications every timestep.
-  /// Agents should register from their Deploy method.
+  /// Agents should register from their Deploy method.  Agents whose
+  /// annotations set "thread_safe" to true, e.g. with
+  /// `#pragma cyclus note {"thread_safe": true}`, may have their Tick and
+  /// Tock run concurrently with those of other such agents (see DoTick).
   void RegisterTimeListener(TimeListener* agent);
 
   /// Removes an agent from receiving tick/tock notifications.
@@ -44,12 +57,14 @@ class Timer {
   void UnregisterTimeListener(TimeListener* tl);
 
 
-  /// Schedules the named prototype to be built for the specified parent at
-  /// timestep t.
-  void SchedBuild(Agent* parent, std::string proto_name, int t);
+  /// Schedules count agents of the named prototype to be built for the
+  /// specified parent at timestep t.  Throws a ValueError if count is not
+  /// positive.
+  void SchedBuild(Agent* parent, std::string proto_name, int t,
+                  int count = 1);
 
   /// Schedules the given Agent to be decommissioned at the specified
-  /// timestep t.
+  /// timestep t, replacing any decommissioning scheduled for it before.
   void SchedDecom(Agent* m, int time);
 
   /// Schedules a snapshot of simulation state to output database to occur at
@@ -69,12 +84,74 @@ class Timer {
   /// @return the duration, in months
   int dur();
 
+  /// Returns the timer measuring the phases of each timestep.  Phase timing
+  /// is turned on by the CYCLUS_PHASE_TIMINGS (record the PhaseTimings
+  /// table) and CYCLUS_TRACE (write a Chrome trace to the given path)
+  /// environment variables, or by configuring the timer before RunSim.
+  PhaseTimer* phase_timer() { return &phases_; }
+
+  /// Sets the number of threads that run the Tick and Tock of thread-safe
+  /// agents, and that query thread-safe traders with concurrent exchanges
+  /// (see set_concurrent_exchanges).  This is 1 unless the CYCLUS_THREADS
+  /// environment variable is set; with 1, all agents tick and tock one at a
+  /// time.  The output does not depend on the number of threads.
+  void set_nthreads(int n);
+
+  /// Turns skipping of quiescent timesteps on or off; it is off unless the
+  /// CYCLUS_SKIP_QUIESCENT environment variable is set.  When on, after each
+  /// timestep the timer jumps to the earliest of the next scheduled build or
+  /// decommissioning and the agents' TimeListener::NextWakeup, provided that
+  /// nothing was requested in the exchanges just run, no snapshot is wanted
+  /// and inventories are not being recorded every timestep.  Materials
+  /// decayed lazily catch up when their composition is next used.
+  void set_skip_quiescent(bool skip) { skip_quiescent_ = skip; }
+
+  /// Makes the snapshots taken during the simulation differential (see
+  /// SimInit::Snapshot), with every full_every-th one still recording every
+  /// agent, or only the first if full_every is 0.  A negative full_every
+  /// makes every snapshot full again, which is the default unless the
+  /// CYCLUS_DIFF_SNAPSHOTS environment variable is set to full_every.
+  void set_differential_snapshots(int full_every);
+
+  /// Takes a checkpoint every steps timesteps or every minutes of wall time,
+  /// whichever comes first, with 0 turning either off.  Checkpoints are off
+  /// unless the CYCLUS_CHECKPOINT_STEPS or CYCLUS_CHECKPOINT_MINUTES
+  /// environment variables are set.  A checkpoint is a snapshot taken at the
+  /// start of a timestep, after which everything recorded so far is written
+  /// to the backends on a background thread (see Recorder::FlushAsync), so
+  /// that a simulation that dies can be restarted from it.
+  void set_checkpoint_interval(int steps, double minutes);
+
+  /// Turns concurrent resource exchanges on or off; they are off unless the
+  /// CYCLUS_CONCURRENT_EXCHANGES environment variable is set.  When on, and
+  /// there is more than one thread, each exchange queries consecutive
+  /// thread-safe traders for their requests, bids and preference adjustments
+  /// concurrently, and translates the arcs between thread-safe traders
+  /// concurrently (see ExchangeThreads).  A trader is thread-safe here if
+  /// its agent and all of that agent's parents are (see
+  /// RegisterTimeListener).  The material exchange is still run to the end,
+  /// trades included, before the product exchange starts, and the results of
+  /// the queries are put together in trader order, so the trades and the
+  /// output are the same as with serial exchanges.  Resources and
+  /// compositions that thread-safe traders create while being queried get
+  /// the same ids too, since the traders take ids in turn (see
+  /// TimeListener).
+  void set_concurrent_exchanges(bool concurrent) {
+    concurrent_exchanges_ = concurrent;
+  }
+
  private:
-  /// builds all agents queued for the current timestep.
+  /// builds all agents queued for the current timestep, cloning the agents
+  /// of each scheduled batch together.
   void DoBuild();
 
   /// sends the tick signal to all of the agents receiving time
-  /// notifications.
+  /// notifications, in agent id order.  Consecutive thread-safe agents tick
+  /// concurrently, with the Datums they record staged per agent and then
+  /// recorded in agent id order, and take resource and composition ids in
+  /// agent id order (see TimeListener), so output is the same as when
+  /// ticking one at a time.  Other agents tick alone, after every agent
+  /// before them.
   void DoTick();
 
   /// Runs the resource exchange process for all traders.
@@ -82,15 +159,120 @@ class Timer {
                ExchangeManager<Product>* genmgr);
 
   /// sends the tock signal to all of the agents receiving time
-  /// notifications.
+  /// notifications, in the same way as DoTick.
   void DoTock();
 
-  void RecordInventories(Agent* a);
-  void RecordInventory(Agent* a, std::string name, Material::Ptr m);
+  /// Returns the next timestep at which anything can happen, which is the
+  /// current one unless the simulation is quiescent.
+  ///
+  /// @param traded false if nothing was requested in the last exchanges
+  int NextActiveTime(bool traded);
+
+  /// Returns true, and starts the next checkpoint interval, if a checkpoint
+  /// is due at the current timestep.
+  bool CheckpointDue();
+
+  /// Ticks or tocks the registered agents.
+  void Notify(bool tock);
+
+  /// Ticks or tocks a run of thread-safe agents and empties it.
+  void NotifyBatch(std::vector<TimeListener*>* batch, bool tock);
+
+  /// Returns true if the agent's annotations declare it thread-safe and it
+  /// is not a Python archetype, whose methods need the GIL.
+  bool ThreadSafe(Agent* a);
+
+  /// Adds the traders whose agents and all their parents are thread-safe to
+  /// safe.
+  void SafeTraders(std::set<Trader*>* safe);
+
+  /// records the material inventories of all live agents, if requested.
+  void DoInventories();
+
+  /// Identifies the state of the materials of an inventory: their state and
+  /// quality ids and quantities.  Any change to a material changes one of
+  /// them, so an inventory with the same key as when it was last recorded
+  /// still holds the same material.
+  struct InvKey {
+    std::vector<int> ids;
+    std::vector<double> qtys;
+
+    bool operator==(const InvKey& other) const {
+      return ids == other.ids && qtys == other.qtys;
+    }
+  };
+
+  /// The aggregated material of an inventory as last recorded.
+  struct InvRecord {
+    InvKey key;
+    /// the timestep it was recorded
+    int since;
+    CompMap mass;
+    double qty;
+  };
+
+  typedef std::map<std::string, InvRecord> InvRecords;
+
+  /// Records the material inventories of an agent, aggregating again only
+  /// those that changed since they were last recorded.
+  ///
+  /// @param last the inventories as last recorded, from which unchanged ones
+  /// are moved to cur
+  /// @param cur receives the inventories as recorded now
+  void RecordInventories(Agent* a, InvRecords* last, InvRecords* cur);
+
+  /// Sums the materials of an inventory into mass and qty without creating
+  /// any resources or compositions, except in lazy decay mode.
+  ///
+  /// @param mats the materials, which must not be empty
+  /// @param mass receives the mass composition of their sum, not
+  /// necessarily normalized
+  /// @param qty receives their total quantity
+  void AggregateInventory(const std::vector<Resource::Ptr>& mats,
+                          CompMap* mass, double* qty);
+
+  /// Records the inventory rows for an aggregated material.
+  ///
+  /// @param mass the mass composition of the material, not necessarily
+  /// normalized
+  /// @param qty the quantity of the material
+  void RecordInventory(Agent* a, std::string name, const CompMap& mass,
+                       double qty);
 
   /// decommissions all agents queued for the current timestep.
   void DoDecom();
 
+  /// A build or decommissioning scheduled for a timestep.  Events of the
+  /// same timestep happen in the order they were scheduled.
+  struct Event {
+    int time;
+    unsigned long seq;
+    /// the parent to build for, or the agent to decommission
+    Agent* agent;
+    /// the prototype to build
+    std::string proto;
+    /// the number of agents to build
+    int count;
+  };
+
+  /// Orders the earliest event first in an EventQueue.
+  struct LaterEvent {
+    bool operator()(const Event& a, const Event& b) const {
+      return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+    }
+  };
+
+  typedef std::priority_queue<Event, std::vector<Event>, LaterEvent>
+      EventQueue;
+
+  /// Moves the events of the current timestep from q to due, in order,
+  /// dropping events of earlier timesteps.
+  void PopDue(EventQueue* q, std::vector<Event>* due);
+
+  /// Returns true, and forgets it, if e is the pending decommissioning of
+  /// its agent rather than one that was scheduled over.
+  bool TakeDecom(const Event& e);
+
   Context* ctx_;
 
   /// The current time, measured in months from when the simulation
@@ -102,14 +284,48 @@ class Timer {
   bool want_snapshot_;
   bool want_kill_;
 
+  PhaseTimer phases_;
+
   /// Concrete agents that desire to receive tick and tock notifications
-  std::map<int, TimeListener*> tickers_;
+  SlotMap<TimeListener> tickers_;
+
+  /// the tickers declared thread-safe
+  SlotMap<TimeListener> safe_tickers_;
+
+  /// whether the agents of each archetype spec are thread-safe
+  std::map<std::string, bool> safe_specs_;
+
+  int nthreads_;
+
+  /// runs thread-safe tickers and traders, started when first needed
+  ThreadPool* pool_;
+
+  bool skip_quiescent_;
+
+  bool concurrent_exchanges_;
+
+  /// the agent states of past snapshots, or NULL for full snapshots
+  SnapshotHistory* snaps_;
+
+  int checkpoint_steps_;
+  double checkpoint_minutes_;
+
+  /// the timestep and wall time of the last checkpoint
+  int last_checkpoint_;
+  std::chrono::steady_clock::time_point last_checkpoint_wall_;
+
+  EventQueue builds_;
+
+  /// decommissionings, including those scheduled over, which are skipped
+  EventQueue decoms_;
+
+  /// the inventories of each agent as last recorded, by agent id
+  std::map<int, InvRecords> inv_records_;
 
-  // std::map<time,std::vector<std::pair<prototype, parent> > >
-  std::map<int, std::vector<std::pair<std::string, Agent*> > > build_queue_;
+  /// the seq of the pending decommissioning of each agent
+  std::unordered_map<Agent*, unsigned long> pending_decoms_;
 
-  // std::map<time,std::vector<config> >
-  std::map<int, std::vector<Agent*> > decom_queue_;
+  unsigned long next_seq_;
 };
 
 }  // namespace cyclus
@@ -17,7 +17,9 @@ double MatQuery::mass(Nuc nuc) {
 }
 
 double MatQuery::moles(Nuc nuc) {
-  return mass(nuc) / (pyne::atomic_mass(nuc) * units::g);
+  double m = mass(nuc);
+  std::lock_guard<std::mutex> lock(PyneDataLock());
+  return m / (pyne::atomic_mass(nuc) * units::g);
 }
 
 double MatQuery::mass_frac(Nuc nuc) {
@@ -0,0 +1,117 @@
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "col_log_back.h"
+#include "error.h"
+#include "recorder.h"
+#include "tools.h"
+
+static const int kCols = ITEM_TIME | ITEM_NAME | ITEM_MASS | ITEM_PROPS;
+
+TEST(ColLogBackTests, RoundTrip) {
+  FileDeleter fd("roundtrip.cyclog");
+  cyclus::ColLogBack b("roundtrip.cyclog", 16);
+  cyclus::Recorder r(false);
+  r.RegisterBackend(&b);
+  RecordItems(&r, 0, 100, kCols);
+  r.NewDatum("Info")->AddVal("Flag", true)->AddVal("Seed", -3)->Record();
+  r.Flush();
+
+  std::map<std::string, cyclus::DbTypes> types = b.ColumnTypes("Items");
+  EXPECT_EQ(cyclus::INT, types["Id"]);
+  EXPECT_EQ(cyclus::VL_STRING, types["Name"]);
+  EXPECT_EQ(cyclus::MAP_STRING_DOUBLE, types["Props"]);
+  EXPECT_EQ(2, b.Tables().size());
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("Time", "==", 5));
+  conds.push_back(cyclus::Cond("Name", "==", std::string("odd")));
+  cyclus::QueryResult qr = b.Query("Items", &conds);
+  ASSERT_EQ(5, qr.rows.size());
+  EXPECT_EQ(51, qr.GetVal<int>("Id", 0));
+  EXPECT_EQ(59, qr.GetVal<int>("Id", 4));
+  EXPECT_DOUBLE_EQ(
+      25.5, (qr.GetVal<std::map<std::string, double> >("Props", 0)["mass"]));
+
+  std::vector<std::string> cols;
+  cols.push_back("Mass");
+  cols.push_back("Id");
+  cols.push_back("Mass");
+  qr = b.Query("Items", cols, &conds);
+  ASSERT_EQ(3, qr.fields.size());
+  EXPECT_DOUBLE_EQ(27.5, qr.rows[2][2].cast<double>());
+
+  qr = b.Query("Info", NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_TRUE(qr.GetVal<bool>("Flag"));
+  EXPECT_EQ(-3, qr.GetVal<int>("Seed"));
+  EXPECT_THROW(b.Query("Nope", NULL), cyclus::KeyError);
+  r.Close();
+}
+
+TEST(ColLogBackTests, ReopenAndCursor) {
+  FileDeleter fd("reopen.cyclog");
+  {
+    cyclus::ColLogBack b("reopen.cyclog", 16);
+    cyclus::Recorder r(false);
+    r.RegisterBackend(&b);
+    RecordItems(&r, 0, 40, kCols);
+    r.Close();
+  }
+  {
+    cyclus::ColLogBack b("reopen.cyclog", 16);
+    cyclus::Recorder r(false);
+    r.RegisterBackend(&b);
+    RecordItems(&r, 40, 50, kCols);
+    r.Close();
+  }
+
+  cyclus::ColLogReader rd("reopen.cyclog");
+  EXPECT_EQ(4, rd.nsegments());
+  std::vector<cyclus::Cond> conds(1, cyclus::Cond("Id", ">=", 30));
+  std::vector<std::string> cols(1, "Id");
+  cyclus::QueryCursor::Ptr c = rd.Cursor("Items", cols, &conds);
+  cyclus::QueryResult batch;
+  std::vector<int> ids;
+  while (c->Next(&batch, 7)) {
+    EXPECT_LE(batch.rows.size(), 7);
+    for (int i = 0; i < batch.rows.size(); ++i)
+      ids.push_back(batch.rows[i][0].cast<int>());
+  }
+  ASSERT_EQ(20, ids.size());
+  EXPECT_EQ(30, ids.front());
+  EXPECT_EQ(49, ids.back());
+
+  cyclus::ColumnarResult cr = rd.QueryColumnar("Items", NULL);
+  EXPECT_EQ(50, cr.nrows());
+  EXPECT_EQ("odd", cr.Column<std::string>("Name")[49]);
+}
+
+TEST(ColLogBackTests, PartialSegment) {
+  FileDeleter fd("partial.cyclog");
+  size_t size;
+  {
+    cyclus::ColLogBack b("partial.cyclog", 10);
+    cyclus::Recorder r(false);
+    r.RegisterBackend(&b);
+    RecordItems(&r, 0, 25, kCols);
+    r.Flush();
+    std::ifstream f("partial.cyclog", std::ios::binary | std::ios::ate);
+    size = f.tellg();
+    r.Close();
+    b.Close();
+    // simulate a crash by dropping the footer and part of the last segment
+    ASSERT_EQ(0, truncate("partial.cyclog", size - 5));
+  }
+
+  cyclus::ColLogReader rd("partial.cyclog");
+  EXPECT_EQ(2, rd.nsegments());
+  EXPECT_EQ(20, rd.Query("Items", NULL).rows.size());
+  EXPECT_THROW(cyclus::ColLogReader("nonexistent.cyclog"), cyclus::IOError);
+}
@@ -109,6 +109,29 @@ TEST_F(ContextTests, CreateAgent) {
   EXPECT_EQ(6, DonutShop::destruct_count);
 }
 
+TEST_F(ContextTests, GetAgent) {
+  Timer ti;
+  Recorder rec;
+  Context* ctx = new Context(&ti, &rec);
+
+  Agent* m1 = new DonutShop(ctx, "old fashion");
+  ctx->AddPrototype("dunkin donuts", m1);
+  std::vector<Agent*> shops;
+  ctx->CreateAgents("dunkin donuts", 3, &shops);
+  ASSERT_EQ(3, shops.size());
+
+  EXPECT_EQ(m1, ctx->GetAgent(m1->id()));
+  for (int i = 0; i < shops.size(); ++i) {
+    EXPECT_EQ(shops[i], ctx->GetAgent(shops[i]->id()));
+  }
+  int id = shops[1]->id();
+  ctx->DelAgent(shops[1]);
+  EXPECT_THROW(ctx->GetAgent(id), cyclus::KeyError);
+  EXPECT_EQ(shops[2], ctx->GetAgent(shops[2]->id()));
+
+  delete ctx;
+}
+
 TEST_F(ContextTests, DoubleAgentNameThrow) {
   Timer ti;
   Recorder rec;
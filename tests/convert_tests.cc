@@ -0,0 +1,74 @@
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "col_log_back.h"
+#include "convert.h"
+#include "error.h"
+#include "hdf5_back.h"
+#include "recorder.h"
+#include "sqlite_back.h"
+#include "tools.h"
+
+namespace {
+
+void RecordTables(cyclus::RecBackend* b) {
+  cyclus::Recorder rec(false);
+  cyclus::Recorder* r = &rec;
+  r->RegisterBackend(b);
+  RecordItems(r, 0, 50, ITEM_NAME | ITEM_MASS);
+  for (int t = 0; t < 30; ++t) {
+    std::vector<double> v(2, t);
+    r->NewDatum("Steps")->AddVal("Time", t)->AddVal("Vals", v)->Record();
+  }
+  r->NewDatum("Info")->AddVal("Seed", 7)->Record();
+  r->Close();
+}
+
+void CheckItems(cyclus::QueryableBackend* b) {
+  cyclus::QueryResult qr = b->Query("Items", NULL);
+  ASSERT_EQ(50, qr.rows.size());
+  EXPECT_EQ(49, qr.GetVal<int>("Id", 49));
+  EXPECT_EQ("odd", qr.GetVal<std::string>("Name", 49));
+  EXPECT_DOUBLE_EQ(24.5, qr.GetVal<double>("Mass", 49));
+  EXPECT_EQ(7, b->Query("Info", NULL).GetVal<int>("Seed"));
+}
+
+}  // namespace
+
+TEST(ConvertTests, SqliteToColLog) {
+  FileDeleter fin("convert_in.sqlite");
+  FileDeleter fout("convert_out.cyclog");
+  cyclus::SqliteBack in("convert_in.sqlite");
+  RecordTables(&in);
+
+  cyclus::ColLogBack out("convert_out.cyclog", 8);
+  std::set<std::string> tables;
+  tables.insert("Items");
+  tables.insert("Info");
+  cyclus::Convert(&in, &out, tables, 3, 7);
+  EXPECT_EQ(2, out.Tables().size());
+  CheckItems(&out);
+
+  tables.insert("Nope");
+  EXPECT_THROW(cyclus::Convert(&in, &out, tables), cyclus::KeyError);
+}
+
+TEST(ConvertTests, ColLogToHdf5) {
+  FileDeleter fin("convert_in.cyclog");
+  FileDeleter fout("convert_out.h5");
+  cyclus::ColLogBack in("convert_in.cyclog");
+  RecordTables(&in);
+
+  cyclus::Hdf5Back out("convert_out.h5");
+  cyclus::Convert(&in, &out, 4, 16);
+  EXPECT_EQ(3, out.Tables().size());
+  CheckItems(&out);
+  cyclus::QueryResult qr = out.Query("Steps", NULL);
+  ASSERT_EQ(30, qr.rows.size());
+  EXPECT_DOUBLE_EQ(29, qr.GetVal<std::vector<double> >("Vals", 29)[1]);
+  out.Close();
+}
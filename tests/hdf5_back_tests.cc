@@ -1,5 +1,6 @@
-#include <string>
 #include <iostream>
+#include <map>
+#include <string>
 
 #include <gtest/gtest.h>
 
@@ -254,3 +255,296 @@ TEST(Hdf5BackTest, Tables) {
   EXPECT_LE(1, tabs.size());
   EXPECT_EQ(1, tabs.count("IntTable"));
 }
+
+TEST(Hdf5BackTest, QueryChunks) {
+  using std::vector;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  using cyclus::Cond;
+  FileDeleter fd(path);
+
+  // spans several table chunks, with the condition on a late column
+  int n = 2500;
+  Recorder m;
+  Hdf5Back back(path);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Chunked")
+        ->AddVal("id", i)
+        ->AddVal("name", std::string(i % 2 == 0 ? "even" : "odd"))
+        ->AddVal("time", i / 10)
+        ->Record();
+  }
+  m.Close();
+
+  cyclus::QueryResult qr = back.Query("Chunked", NULL);
+  ASSERT_EQ(n, qr.rows.size());
+  EXPECT_EQ(1234, qr.GetVal<int>("id", 1234));
+  EXPECT_EQ("even", qr.GetVal<std::string>("name", 1234));
+
+  vector<Cond> conds;
+  conds.push_back(Cond("time", ">=", 200));
+  conds.push_back(Cond("name", "==", std::string("odd")));
+  qr = back.Query("Chunked", &conds);
+  ASSERT_EQ(250, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    EXPECT_EQ(2001 + 2 * i, qr.GetVal<int>("id", i));
+    EXPECT_EQ("odd", qr.GetVal<std::string>("name", i));
+  }
+}
+
+TEST(Hdf5BackTest, QueryColumns) {
+  using std::vector;
+  using std::string;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  using cyclus::Cond;
+  FileDeleter fd(path);
+
+  Recorder m;
+  Hdf5Back back(path);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < 10; ++i) {
+    m.NewDatum("Proj")
+        ->AddVal("id", i)
+        ->AddVal("name", string(i % 2 == 0 ? "even" : "odd"))
+        ->AddVal("qty", 0.5 * i)
+        ->Record();
+  }
+  m.Close();
+
+  // the condition is on a column that is not requested
+  vector<string> cols;
+  cols.push_back("qty");
+  cols.push_back("id");
+  vector<Cond> conds;
+  conds.push_back(Cond("name", "==", string("odd")));
+  cyclus::QueryResult qr = back.Query("Proj", cols, &conds);
+  ASSERT_EQ(2, qr.fields.size());
+  EXPECT_EQ("qty", qr.fields[0]);
+  EXPECT_EQ("id", qr.fields[1]);
+  EXPECT_EQ(cyclus::DOUBLE, qr.types[0]);
+  EXPECT_EQ(cyclus::INT, qr.types[1]);
+  ASSERT_EQ(5, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    ASSERT_EQ(2, qr.rows[i].size());
+    EXPECT_EQ(2 * i + 1, qr.GetVal<int>("id", i));
+    EXPECT_DOUBLE_EQ(0.5 * (2 * i + 1), qr.GetVal<double>("qty", i));
+  }
+
+  cols.push_back("nope");
+  EXPECT_THROW(back.Query("Proj", cols, NULL), cyclus::KeyError);
+}
+
+TEST(Hdf5BackTest, Cursor) {
+  using std::vector;
+  using std::string;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  using cyclus::Cond;
+  using cyclus::QueryCursor;
+  FileDeleter fd(path);
+
+  // batches that straddle the table chunks
+  int n = 2500;
+  Recorder m;
+  Hdf5Back back(path);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Streamed")
+        ->AddVal("id", i)
+        ->AddVal("name", string(i % 2 == 0 ? "even" : "odd"))
+        ->Record();
+  }
+  m.Close();
+
+  cyclus::QueryResult batch;
+  QueryCursor::Ptr c = back.Cursor("Streamed", NULL);
+  int nrows = 0;
+  int nbatches = 0;
+  while (c->Next(&batch, 300)) {
+    ASSERT_GE(300, batch.rows.size());
+    ASSERT_EQ(3, batch.fields.size());
+    for (int i = 0; i < batch.rows.size(); ++i)
+      EXPECT_EQ(nrows + i, batch.GetVal<int>("id", i));
+    nrows += batch.rows.size();
+    ++nbatches;
+  }
+  EXPECT_EQ(n, nrows);
+  EXPECT_EQ(9, nbatches);
+  EXPECT_TRUE(batch.rows.empty());
+  EXPECT_FALSE(c->Next(&batch, 300));
+
+  vector<string> cols(1, "id");
+  vector<Cond>* conds = new vector<Cond>();
+  conds->push_back(Cond("name", "==", string("odd")));
+  c = back.Cursor("Streamed", cols, conds);
+  delete conds;  // cursors do not reference the caller's conditions
+  nrows = 0;
+  while (c->Next(&batch, 1000)) {
+    ASSERT_EQ(1, batch.fields.size());
+    for (int i = 0; i < batch.rows.size(); ++i)
+      EXPECT_EQ(2 * (nrows + i) + 1, batch.GetVal<int>("id", i));
+    nrows += batch.rows.size();
+  }
+  EXPECT_EQ(n / 2, nrows);
+}
+
+TEST(Hdf5BackTest, QueryColumnar) {
+  using std::vector;
+  using std::string;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  using cyclus::Cond;
+  FileDeleter fd(path);
+
+  int n = 2500;
+  Recorder m;
+  Hdf5Back back(path);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Cols")
+        ->AddVal("id", i)
+        ->AddVal("name", string(i % 2 == 0 ? "even" : "odd"))
+        ->AddVal("qty", 0.5 * i)
+        ->Record();
+  }
+  m.Close();
+
+  vector<Cond> conds;
+  conds.push_back(Cond("name", "==", string("odd")));
+  cyclus::ColumnarResult cr = back.QueryColumnar("Cols", &conds);
+  ASSERT_EQ(n / 2, cr.nrows());
+  vector<int>& ids = cr.Column<int>("id");
+  vector<double>& qty = cr.Column<double>("qty");
+  for (int i = 0; i < cr.nrows(); ++i) {
+    EXPECT_EQ(2 * i + 1, ids[i]);
+    EXPECT_DOUBLE_EQ(0.5 * (2 * i + 1), qty[i]);
+  }
+  EXPECT_EQ("odd", cr.GetVal<string>("name", 7));
+}
+
+TEST(Hdf5BackTest, Aggregate) {
+  using std::map;
+  using std::vector;
+  using std::string;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  using cyclus::Agg;
+  using cyclus::Cond;
+  FileDeleter fd(path);
+
+  // spans several table chunks, grouped on fixed and variable length columns
+  int n = 2500;
+  Recorder m;
+  Hdf5Back back(path);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < n; ++i) {
+    m.NewDatum("Trans")
+        ->AddVal("Time", i / 1000)
+        ->AddVal("Commodity", string(i % 3 == 0 ? "uox" : "mox"))
+        ->AddVal("Quantity", 1.0 * i)
+        ->Record();
+  }
+  m.Close();
+
+  vector<string> group_by;
+  group_by.push_back("Commodity");
+  group_by.push_back("Time");
+  vector<Agg> aggs;
+  aggs.push_back(Agg("COUNT", "Commodity"));
+  aggs.push_back(Agg("SUM", "Quantity"));
+  aggs.push_back(Agg("MIN", "Quantity"));
+  aggs.push_back(Agg("MAX", "Quantity"));
+  vector<Cond> conds;
+  conds.push_back(Cond("Quantity", "<", 2000.0));
+  cyclus::QueryResult qr = back.Aggregate("Trans", group_by, aggs, &conds);
+  ASSERT_EQ(6, qr.fields.size());
+  ASSERT_EQ(4, qr.rows.size());
+  map<string, vector<double> > obs;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    string k = qr.GetVal<string>("Commodity", i) +
+               std::to_string(qr.GetVal<int>("Time", i));
+    obs[k].push_back(qr.GetVal<int>("COUNT(Commodity)", i));
+    obs[k].push_back(qr.GetVal<double>("SUM(Quantity)", i));
+    obs[k].push_back(qr.GetVal<double>("MIN(Quantity)", i));
+    obs[k].push_back(qr.GetVal<double>("MAX(Quantity)", i));
+  }
+  for (map<string, vector<double> >::iterator it = obs.begin();
+       it != obs.end(); ++it) {
+    bool uox = it->first.substr(0, 3) == "uox";
+    int t = it->first[3] - '0';
+    double count = 0;
+    double sum = 0;
+    double lo = 1e9;
+    double hi = -1;
+    for (int i = 1000 * t; i < 1000 * (t + 1); ++i) {
+      if ((i % 3 == 0) != uox)
+        continue;
+      ++count;
+      sum += i;
+      lo = std::min(lo, 1.0 * i);
+      hi = std::max(hi, 1.0 * i);
+    }
+    EXPECT_EQ(count, it->second[0]) << it->first;
+    EXPECT_DOUBLE_EQ(sum, it->second[1]) << it->first;
+    EXPECT_DOUBLE_EQ(lo, it->second[2]) << it->first;
+    EXPECT_DOUBLE_EQ(hi, it->second[3]) << it->first;
+  }
+
+  // whole-table aggregates, including of an empty selection
+  aggs.clear();
+  aggs.push_back(Agg("COUNT", "Time"));
+  aggs.push_back(Agg("MAX", "Time"));
+  qr = back.Aggregate("Trans", vector<string>(), aggs, NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(n, qr.GetVal<int>("COUNT(Time)"));
+  EXPECT_EQ(2, qr.GetVal<int>("MAX(Time)"));
+  conds[0] = Cond("Time", ">", 5);
+  qr = back.Aggregate("Trans", vector<string>(), aggs, &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(0, qr.GetVal<int>("COUNT(Time)"));
+}
+
+TEST(Hdf5BackTest, InListBetween) {
+  using std::set;
+  using std::vector;
+  using std::string;
+  using cyclus::Recorder;
+  using cyclus::Hdf5Back;
+  using cyclus::Cond;
+  FileDeleter fd(path);
+
+  Recorder m;
+  Hdf5Back back(path);
+  m.RegisterBackend(&back);
+  for (int i = 0; i < 2500; ++i) {
+    m.NewDatum("Res")
+        ->AddVal("ResourceId", i)
+        ->AddVal("Commodity", string(i % 3 == 0 ? "uox" : "mox"))
+        ->AddVal("Quantity", 1.0 * i)
+        ->Record();
+  }
+  m.Close();
+
+  set<int> ids;
+  ids.insert(2400);
+  ids.insert(7);
+  ids.insert(5000);
+  vector<Cond> conds;
+  conds.push_back(Cond("ResourceId", "IN", ids));
+  cyclus::QueryResult qr = back.Query("Res", &conds);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(7, qr.GetVal<int>("ResourceId", 0));
+  EXPECT_EQ(2400, qr.GetVal<int>("ResourceId", 1));
+
+  conds[0] = Cond("Quantity", "BETWEEN", std::make_pair(100.0, 199.0));
+  set<string> commods;
+  commods.insert("uox");
+  conds.push_back(Cond("Commodity", "IN", commods));
+  qr = back.Query("Res", &conds);
+  ASSERT_EQ(33, qr.rows.size());  // multiples of 3 in [100, 199]
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    EXPECT_EQ(0, qr.GetVal<int>("ResourceId", i) % 3);
+  }
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include "mem_back.h"
+#include "recorder.h"
+#include "sqlite_back.h"
+
+class MemBackTests : public ::testing::Test {
+ public:
+  virtual void SetUp() {
+    r.RegisterBackend(&b);
+    for (int i = 0; i < 10; ++i) {
+      r.NewDatum("Items")
+          ->AddVal("Id", i)
+          ->AddVal("Name", std::string(i % 2 == 0 ? "even" : "odd"))
+          ->AddVal("Mass", 0.5 * i)
+          ->Record();
+    }
+    std::vector<int> v(2, 7);
+    r.NewDatum("Misc")->AddVal("Vec", v)->AddVal("Flag", true)->Record();
+    r.Flush();
+  }
+
+  virtual void TearDown() { r.Close(); }
+
+  cyclus::MemBack b;
+  cyclus::Recorder r;
+};
+
+TEST_F(MemBackTests, Query) {
+  using cyclus::Cond;
+  EXPECT_EQ(10, b.nrows("Items"));
+  EXPECT_EQ(0, b.nrows("Nope"));
+  EXPECT_EQ(2, b.Tables().size());
+  EXPECT_THROW(b.Query("Nope", NULL), cyclus::KeyError);
+
+  std::map<std::string, cyclus::DbTypes> types = b.ColumnTypes("Items");
+  EXPECT_EQ(cyclus::INT, types["Id"]);
+  EXPECT_EQ(cyclus::VL_STRING, types["Name"]);
+  EXPECT_EQ(cyclus::DOUBLE, types["Mass"]);
+  EXPECT_EQ(cyclus::VECTOR_INT, b.ColumnTypes("Misc")["Vec"]);
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("Name", "==", std::string("odd")));
+  conds.push_back(Cond("Mass", ">", 1.0));
+  cyclus::QueryResult qr = b.Query("Items", &conds);
+  ASSERT_EQ(4, qr.rows.size());
+  EXPECT_EQ(3, qr.GetVal<int>("Id", 0));
+  EXPECT_EQ(9, qr.GetVal<int>("Id", 3));
+
+  std::vector<std::string> cols;
+  cols.push_back("Mass");
+  cols.push_back("Id");
+  cols.push_back("Mass");
+  qr = b.Query("Items", cols, &conds);
+  ASSERT_EQ(3, qr.fields.size());
+  EXPECT_DOUBLE_EQ(1.5, qr.rows[0][2].cast<double>());
+
+  cols.pop_back();
+  cyclus::ColumnarResult cr = b.QueryColumnar("Items", cols, &conds);
+  ASSERT_EQ(4, cr.nrows());
+  EXPECT_EQ(7, cr.Column<int>("Id")[2]);
+
+  std::vector<Cond> bad(1, Cond("Vec", "==", std::vector<int>(2, 7)));
+  EXPECT_THROW(b.Query("Misc", &bad), cyclus::ValueError);
+  qr = b.Query("Misc", NULL);
+  EXPECT_EQ(7, qr.GetVal<std::vector<int> >("Vec")[1]);
+}
+
+TEST_F(MemBackTests, Export) {
+  cyclus::SqliteBack sq(":memory:");
+  b.Export(&sq);
+  std::vector<cyclus::Cond> conds(1, cyclus::Cond("Id", ">=", 8));
+  cyclus::QueryResult qr = sq.Query("Items", &conds);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ("even", qr.GetVal<std::string>("Name", 0));
+  EXPECT_DOUBLE_EQ(4.5, qr.GetVal<double>("Mass", 1));
+  EXPECT_EQ(cyclus::VECTOR_INT, sq.ColumnTypes("Misc")["Vec"]);
+  sq.Close();
+}
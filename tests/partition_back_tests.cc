@@ -0,0 +1,92 @@
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "partition_back.h"
+#include "recorder.h"
+#include "tools.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const char kDir[] = "partitions_test";
+
+class DirDeleter {
+ public:
+  DirDeleter(std::string path) : path_(path) { fs::remove_all(path_); }
+  ~DirDeleter() { fs::remove_all(path_); }
+
+ private:
+  std::string path_;
+};
+
+}  // namespace
+
+TEST(PartitionBackTests, WindowsAndPruning) {
+  DirDeleter dd(kDir);
+  cyclus::PartitionBack b(kDir, ".sqlite", 3, 4);
+  cyclus::Recorder r(false);
+  r.RegisterBackend(&b);
+  RecordItems(&r, 0, 100, ITEM_TIME | ITEM_MASS);
+  r.NewDatum("Info")->AddVal("Seed", 7)->Record();
+  r.Flush();
+
+  // times 0-9 in windows of 3, plus one partition for Info
+  EXPECT_EQ(5, b.npartitions());
+  EXPECT_EQ("Items.3.sqlite", b.file(1));
+  EXPECT_EQ("Info.sqlite", b.file(4));
+  EXPECT_TRUE(fs::exists(fs::path(kDir) / "manifest.txt"));
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("Time", ">=", 2));
+  conds.push_back(cyclus::Cond("Time", "<", 4));
+  EXPECT_EQ(2, b.Partitions("Items", &conds).size());
+  cyclus::QueryResult qr = b.Query("Items", &conds);
+  ASSERT_EQ(20, qr.rows.size());
+  EXPECT_EQ(20, qr.GetVal<int>("Id", 0));
+  EXPECT_EQ(39, qr.GetVal<int>("Id", 19));
+
+  conds.push_back(cyclus::Cond("Time", ">", 100));
+  EXPECT_EQ(0, b.Partitions("Items", &conds).size());
+  EXPECT_EQ(0, b.Query("Items", &conds).rows.size());
+
+  cyclus::ColumnarResult cr = b.QueryColumnar("Items", NULL);
+  EXPECT_EQ(100, cr.nrows());
+  EXPECT_EQ(99, cr.Column<int>("Id")[99]);
+  EXPECT_EQ(7, b.Query("Info", NULL).GetVal<int>("Seed"));
+  EXPECT_THROW(b.Query("Nope", NULL), cyclus::KeyError);
+  r.Close();
+}
+
+TEST(PartitionBackTests, ReopenAndCursor) {
+  DirDeleter dd(kDir);
+  {
+    cyclus::PartitionBack b(kDir, ".sqlite", 5);
+    cyclus::Recorder r(false);
+    r.RegisterBackend(&b);
+    RecordItems(&r, 0, 60, ITEM_TIME | ITEM_MASS);
+    r.Close();
+  }
+  EXPECT_THROW(cyclus::PartitionBack(kDir, ".sqlite", 10), cyclus::ValueError);
+
+  cyclus::PartitionBack b(kDir, ".sqlite", 5);
+  EXPECT_EQ(2, b.npartitions());
+  EXPECT_EQ(1, b.Tables().size());
+  std::vector<std::string> cols(1, "Id");
+  std::vector<cyclus::Cond> conds(1, cyclus::Cond("Id", ">=", 45));
+  cyclus::QueryCursor::Ptr c = b.Cursor("Items", cols, &conds);
+  cyclus::QueryResult batch;
+  std::vector<int> ids;
+  while (c->Next(&batch, 4)) {
+    for (int i = 0; i < batch.rows.size(); ++i)
+      ids.push_back(batch.rows[i][0].cast<int>());
+  }
+  ASSERT_EQ(15, ids.size());
+  EXPECT_EQ(45, ids.front());
+  EXPECT_EQ(59, ids.back());
+  EXPECT_THROW(cyclus::PartitionBack(kDir, ".csv"), cyclus::ValueError);
+}
@@ -0,0 +1,64 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "phase_timer.h"
+
+#include "tools.h"
+
+TEST(PhaseTimerTests, DisabledIsNoop) {
+  cyclus::PhaseTimer pt;
+  EXPECT_FALSE(pt.enabled());
+  {
+    cyclus::PhaseScope p(&pt, "Tick");
+  }
+  {
+    cyclus::PhaseScope p(NULL, "Tick");
+  }
+  EXPECT_TRUE(pt.totals().empty());
+}
+
+TEST(PhaseTimerTests, NestedTotals) {
+  FileDeleter fd("phase_timer_trace.json");
+  cyclus::PhaseTimer pt;
+  pt.TraceTo("phase_timer_trace.json");
+  ASSERT_TRUE(pt.enabled());
+
+  pt.Step(3);
+  {
+    cyclus::PhaseScope ex(&pt, "MaterialExchange");
+    for (int i = 0; i < 2; ++i) {
+      cyclus::PhaseScope s(&pt, "Solve");
+    }
+  }
+  EXPECT_EQ(2, pt.totals().size());
+  EXPECT_EQ(1, pt.totals().count("MaterialExchange"));
+  EXPECT_EQ(1, pt.totals().count("MaterialExchange/Solve"));
+  EXPECT_LE(pt.totals().find("MaterialExchange/Solve")->second,
+            pt.totals().find("MaterialExchange")->second);
+  EXPECT_THROW(pt.End(), cyclus::StateError);
+
+  pt.Step(4);
+  EXPECT_TRUE(pt.totals().empty());
+  pt.Close();
+  EXPECT_FALSE(pt.enabled());
+
+  std::ifstream f("phase_timer_trace.json");
+  std::stringstream ss;
+  ss << f.rdbuf();
+  std::string trace = ss.str();
+  EXPECT_EQ('[', trace[0]);
+  EXPECT_EQ("]\n", trace.substr(trace.size() - 2));
+  EXPECT_NE(std::string::npos, trace.find("\"name\": \"Solve\""));
+  EXPECT_NE(std::string::npos,
+            trace.find("\"phase\": \"MaterialExchange/Solve\""));
+  EXPECT_NE(std::string::npos, trace.find("\"time\": 3"));
+}
+
+TEST(PhaseTimerTests, BadTracePath) {
+  cyclus::PhaseTimer pt;
+  EXPECT_THROW(pt.TraceTo("no/such/dir/trace.json"), cyclus::IOError);
+}
@@ -3,7 +3,9 @@
 #include <gtest/gtest.h>
 
 #include "blob.h"
+#include "caching_back.h"
 #include "query_backend.h"
+#include "recorder.h"
 
 template <typename T>
 inline bool NotCmpCond(T* x, cyclus::Cond* cond) {
@@ -57,6 +59,44 @@ TEST(QueryBackendTest, CmpCondOps) {
   EXPECT_PRED2(NotCmpCond<int>, &y, &cond);
 }
 
+TEST(QueryBackendTest, CmpCondInBetween) {
+  using cyclus::Cond;
+  using cyclus::CmpCond;
+
+  int x = 42;
+  int y = 43;
+  int z = 44;
+  Cond cond;
+
+  std::set<int> vals;
+  vals.insert(44);
+  vals.insert(42);
+  cond = Cond("x", "IN", vals);
+  EXPECT_PRED2(CmpCond<int>, &x, &cond);
+  EXPECT_PRED2(NotCmpCond<int>, &y, &cond);
+  EXPECT_PRED2(CmpCond<int>, &z, &cond);
+  std::vector<boost::spirit::hold_any> ops = cyclus::CondOperands(cond);
+  ASSERT_EQ(2, ops.size());
+  EXPECT_EQ(42, ops[0].cast<int>());
+  EXPECT_EQ(44, ops[1].cast<int>());
+
+  cond = Cond("x", "BETWEEN", std::make_pair(43, 44));
+  EXPECT_PRED2(NotCmpCond<int>, &x, &cond);
+  EXPECT_PRED2(CmpCond<int>, &y, &cond);
+  EXPECT_PRED2(CmpCond<int>, &z, &cond);
+  ASSERT_EQ(2, cyclus::CondOperands(cond).size());
+
+  std::string s = "mox";
+  std::set<std::string> strs;
+  strs.insert("mox");
+  cond = Cond("s", "IN", strs);
+  EXPECT_PRED2(CmpCond<std::string>, &s, &cond);
+
+  cond = Cond("x", "IN", std::vector<int>(1, 42));
+  EXPECT_THROW(cyclus::CondOperands(cond), cyclus::ValueError);
+  EXPECT_THROW(Cond("x", "LIKE", 42), cyclus::ValueError);
+}
+
 TEST(QueryBackendTest, CmpCondFloat) {
   using cyclus::Cond;
   using cyclus::CmpCond;
@@ -128,3 +168,198 @@ TEST(QueryBackendTest, CmpConds) {
   EXPECT_PRED2(CmpConds<int>, &x, &conds);
   EXPECT_PRED2(NotCmpConds<int>, &y, &conds);
 }
+
+TEST(QueryBackendTest, ColumnarResult) {
+  using std::string;
+  using std::vector;
+  using cyclus::ColumnarResult;
+  using cyclus::QueryResult;
+  using cyclus::QueryRow;
+  using boost::spirit::hold_any;
+
+  QueryResult qr;
+  qr.fields.push_back("id");
+  qr.fields.push_back("name");
+  qr.fields.push_back("qty");
+  qr.fields.push_back("blob");
+  qr.types.push_back(cyclus::INT);
+  qr.types.push_back(cyclus::STRING);
+  qr.types.push_back(cyclus::DOUBLE);
+  qr.types.push_back(cyclus::BLOB);
+  for (int i = 0; i < 3; ++i) {
+    QueryRow r;
+    r.push_back(hold_any(i));
+    r.push_back(hold_any(string(i % 2 == 0 ? "even" : "odd")));
+    r.push_back(hold_any(1.5 * i));
+    r.push_back(hold_any(cyclus::Blob("x")));
+    qr.rows.push_back(r);
+  }
+
+  ColumnarResult cr;
+  cr.Append(qr);
+  ASSERT_EQ(3, cr.nrows());
+  EXPECT_EQ(2, cr.FieldIndex("qty"));
+  EXPECT_THROW(cr.FieldIndex("nope"), cyclus::KeyError);
+
+  vector<int>& ids = cr.Column<int>("id");
+  ASSERT_EQ(3, ids.size());
+  EXPECT_EQ(2, ids[2]);
+  EXPECT_DOUBLE_EQ(3.0, cr.Column<double>(2)[2]);
+  EXPECT_EQ("odd", cr.GetVal<string>("name", 1));
+  EXPECT_EQ("x", cr.GetVal<cyclus::Blob>("blob", 1).str());
+  EXPECT_THROW(cr.Column<double>("id"), cyclus::ValueError);
+  EXPECT_THROW(cr.GetVal<int>("id", 3), cyclus::KeyError);
+  EXPECT_THROW(cr.AddColumn("id", cyclus::INT), cyclus::ValueError);
+
+  // copies are deep
+  ColumnarResult cp = cr;
+  cp.Column<int>("id")[0] = 42;
+  EXPECT_EQ(0, cr.GetVal<int>("id", 0));
+  EXPECT_EQ(42, cp.GetVal<int>("id", 0));
+}
+
+// A backend without native cursors, projection or aggregation.
+class FixedBackend : public cyclus::QueryableBackend {
+ public:
+  FixedBackend() : nqueries(0) {
+    qr.fields.push_back("Time");
+    qr.fields.push_back("Commodity");
+    qr.fields.push_back("Quantity");
+    qr.types.push_back(cyclus::INT);
+    qr.types.push_back(cyclus::STRING);
+    qr.types.push_back(cyclus::DOUBLE);
+    for (int i = 0; i < 30; ++i) {
+      cyclus::QueryRow r;
+      r.push_back(boost::spirit::hold_any(i / 10));
+      r.push_back(boost::spirit::hold_any(std::string(i % 3 ? "mox" : "uox")));
+      r.push_back(boost::spirit::hold_any(1.0 * i));
+      qr.rows.push_back(r);
+    }
+  }
+
+  using cyclus::QueryableBackend::Query;
+
+  virtual cyclus::QueryResult Query(std::string table,
+                                    std::vector<cyclus::Cond>* conds) {
+    ++nqueries;
+    cyclus::QueryResult rtn = qr;
+    if (conds != NULL) {
+      rtn.rows.clear();
+      for (int i = 0; i < qr.rows.size(); ++i) {
+        int t = qr.rows[i][0].cast<int>();
+        std::vector<cyclus::Cond*> c;
+        for (int j = 0; j < conds->size(); ++j)
+          c.push_back(&(*conds)[j]);
+        if (cyclus::CmpConds<int>(&t, &c))
+          rtn.rows.push_back(qr.rows[i]);
+      }
+    }
+    return rtn;
+  }
+
+  virtual std::map<std::string, cyclus::DbTypes> ColumnTypes(
+      std::string table) {
+    std::map<std::string, cyclus::DbTypes> rtn;
+    for (int j = 0; j < qr.fields.size(); ++j)
+      rtn[qr.fields[j]] = qr.types[j];
+    return rtn;
+  }
+
+  virtual std::list<cyclus::ColumnInfo> Schema(std::string table) {
+    return std::list<cyclus::ColumnInfo>();
+  }
+
+  virtual std::set<std::string> Tables() { return std::set<std::string>(); }
+
+  cyclus::QueryResult qr;
+  int nqueries;
+};
+
+TEST(QueryBackendTest, DefaultAggregate) {
+  using std::string;
+  using std::vector;
+  using cyclus::Agg;
+  using cyclus::Cond;
+
+  FixedBackend b;
+  vector<string> group_by(1, "Commodity");
+  group_by.push_back("Time");
+  vector<Agg> aggs;
+  aggs.push_back(Agg("SUM", "Quantity"));
+  aggs.push_back(Agg("COUNT", "Commodity"));
+  aggs.push_back(Agg("MAX", "Time"));
+  vector<Cond> conds(1, Cond("Time", "<", 2));
+  cyclus::QueryResult qr = b.Aggregate("T", group_by, aggs, &conds);
+  ASSERT_EQ(5, qr.fields.size());
+  ASSERT_EQ(4, qr.rows.size());
+
+  // the default orders groups by value
+  EXPECT_EQ("mox", qr.GetVal<string>("Commodity", 0));
+  EXPECT_EQ(0, qr.GetVal<int>("Time", 0));
+  EXPECT_DOUBLE_EQ(1 + 2 + 4 + 5 + 7 + 8, qr.GetVal<double>("SUM(Quantity)", 0));
+  EXPECT_EQ(6, qr.GetVal<int>("COUNT(Commodity)", 0));
+  EXPECT_EQ("uox", qr.GetVal<string>("Commodity", 3));
+  EXPECT_EQ(1, qr.GetVal<int>("MAX(Time)", 3));
+  EXPECT_DOUBLE_EQ(12 + 15 + 18, qr.GetVal<double>("SUM(Quantity)", 3));
+
+  qr = b.Aggregate("T", vector<string>(), aggs, NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(30, qr.GetVal<int>("COUNT(Commodity)"));
+  EXPECT_DOUBLE_EQ(435, qr.GetVal<double>("SUM(Quantity)"));
+
+  vector<string> cols(2, "Time");
+  qr = b.Query("T", cols, NULL);
+  EXPECT_EQ(2, qr.GetVal<int>("Time", 25));
+  EXPECT_EQ(2, qr.rows[25][1].cast<int>());
+}
+
+TEST(QueryBackendTest, CachingBackend) {
+  using std::string;
+  using std::vector;
+  using cyclus::Cond;
+
+  FixedBackend fb;
+  cyclus::CachingBackend b(&fb);
+  vector<Cond> conds(1, Cond("Time", "<", 2));
+  EXPECT_EQ(20, b.Query("T", &conds).rows.size());
+  EXPECT_EQ(20, b.Query("T", &conds).rows.size());
+  EXPECT_EQ(30, b.Query("T", NULL).rows.size());
+  EXPECT_EQ(2, fb.nqueries);
+  EXPECT_EQ(1, b.hits());
+  EXPECT_EQ(2, b.misses());
+
+  // different condition values, columns and tables are cached separately
+  conds[0] = Cond("Time", "<", 1);
+  EXPECT_EQ(10, b.Query("T", &conds).rows.size());
+  vector<string> cols(1, "Quantity");
+  EXPECT_EQ(1, b.Query("T", cols, &conds).fields.size());
+  b.Query("U", &conds);
+  EXPECT_EQ(5, fb.nqueries);
+
+  // columnar results are cached in columnar form
+  EXPECT_EQ(10, b.QueryColumnar("T", cols, &conds).nrows());
+  cyclus::ColumnarResult cr = b.QueryColumnar("T", cols, &conds);
+  EXPECT_EQ(6, fb.nqueries);
+  ASSERT_EQ(10, cr.nrows());
+  EXPECT_EQ("Quantity", cr.fields()[0]);
+
+  // new data for a table drops only its results
+  fb.qr.rows.pop_back();
+  cyclus::Recorder r;
+  r.RegisterBackend(&b);
+  r.NewDatum("T")->AddVal("Time", 3)->Record();
+  r.Flush();
+  EXPECT_EQ(29, b.Query("T", NULL).rows.size());
+  b.Query("U", &conds);
+  EXPECT_EQ(7, fb.nqueries);
+
+  // results are evicted least recently used first to stay under the cap
+  cyclus::CachingBackend small(&fb, b.bytes() / 3);
+  small.Query("T", NULL);
+  small.Query("T", &conds);
+  small.Query("T", &conds);
+  small.Query("T", NULL);
+  EXPECT_EQ(1, small.hits());
+  EXPECT_GE(b.bytes() / 3, small.bytes());
+  r.Close();
+}
@@ -1,5 +1,8 @@
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "parallel.h"
 #include "rec_backend.h"
 #include "recorder.h"
 
@@ -216,6 +219,113 @@ TEST(RecorderTest, Datum_addVal) {
   EXPECT_EQ(d, back.data.back());
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+struct StageTask {
+  cyclus::Recorder* rec;
+  std::vector<cyclus::DatumList>* staged;
+
+  void operator()(int i) {
+    rec->Stage(&(*staged)[i]);
+    for (int j = 0; j < 3; ++j)
+      rec->NewDatum("Staged")->AddVal("Task", i)->AddVal("Row", j)->Record();
+    rec->Unstage();
+  }
+};
+
+TEST(RecorderTest, StageAndCommit) {
+  using cyclus::Recorder;
+  TestBack back;
+  Recorder m;
+  m.RegisterBackend(&back);
+
+  std::vector<cyclus::DatumList> staged(8);
+  StageTask task = {&m, &staged};
+  cyclus::ThreadPool pool(4);
+  pool.Run(4, task);
+  pool.Run(staged.size(), task);
+  for (int i = 0; i < staged.size(); ++i) {
+    ASSERT_EQ(i < 4 ? 6 : 3, staged[i].size());
+    m.Discard(&staged[i]);
+  }
+  pool.Run(staged.size(), task);
+  m.NewDatum("Direct")->AddVal("Task", -1)->Record();
+  for (int i = 0; i < staged.size(); ++i)
+    m.Commit(&staged[i]);
+  EXPECT_TRUE(staged[0].empty());
+  m.Close();
+
+  ASSERT_EQ(25, back.data.size());
+  EXPECT_EQ("Direct", back.data[0]->title());
+  for (int k = 1; k < back.data.size(); ++k) {
+    cyclus::Datum::Vals vals = back.data[k]->vals();
+    ASSERT_EQ(3, vals.size());
+    EXPECT_STREQ("SimId", vals[0].first);
+    EXPECT_EQ((k - 1) / 3, vals[1].second.cast<int>());
+    EXPECT_EQ((k - 1) % 3, vals[2].second.cast<int>());
+  }
+
+  m.Stage(&staged[0]);
+  m.NewDatum("Dropped")->Record();
+  m.Unstage();
+  m.Discard(&staged[0]);
+  EXPECT_TRUE(staged[0].empty());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+class FailBack : public TestBack {
+ public:
+  virtual void Notify(cyclus::DatumList data) {
+    throw cyclus::IOError("disk full");
+  }
+};
+
+class ThrowBack : public TestBack {
+ public:
+  virtual void Notify(cyclus::DatumList data) { throw 1; }
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(RecorderTest, FlushAsync) {
+  using cyclus::Recorder;
+  TestBack back;
+
+  Recorder m;
+  m.set_dump_count(2);
+  m.RegisterBackend(&back);
+
+  m.NewDatum("First")->Record();
+  m.FlushAsync();
+  m.NewDatum("Second")->Record();
+  m.NewDatum("Third")->Record();
+
+  // filling the second buffer waited for the background flush
+  EXPECT_EQ(2, back.notify_count);
+  EXPECT_EQ(2, back.flush_count);
+  EXPECT_TRUE(back.flushed);
+  EXPECT_EQ("Second", back.data[0]->title());
+
+  m.NewDatum("Fourth")->Record();
+  m.FlushAsync();
+  m.Close();
+  EXPECT_EQ(3, back.notify_count);
+  EXPECT_EQ("Fourth", back.data[0]->title());
+
+  FailBack fail;
+  Recorder f;
+  f.RegisterBackend(&fail);
+  f.NewDatum("Lost")->Record();
+  f.FlushAsync();
+  EXPECT_THROW(f.Flush(), cyclus::IOError);
+  f.Close();
+
+  ThrowBack thrower;
+  Recorder t;
+  t.RegisterBackend(&thrower);
+  t.NewDatum("Lost")->Record();
+  t.FlushAsync();
+  EXPECT_THROW(t.Flush(), cyclus::IOError);
+  t.Close();
+}
 
 //
 // Raw Recorder Test
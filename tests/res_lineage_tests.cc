@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include "res_lineage.h"
+#include "sqlite_back.h"
+
+namespace {
+
+void RecordRes(cyclus::Recorder* r, int id, int p1, int p2, int qual, int t,
+               double qty, std::string type = "Material") {
+  r->NewDatum("Resources")
+      ->AddVal("ResourceId", id)
+      ->AddVal("ObjId", id)
+      ->AddVal("Type", type)
+      ->AddVal("TimeCreated", t)
+      ->AddVal("Quantity", qty)
+      ->AddVal("Units", std::string("kg"))
+      ->AddVal("QualId", qual)
+      ->AddVal("Parent1", p1)
+      ->AddVal("Parent2", p2)
+      ->Record();
+}
+
+void RecordTrans(cyclus::Recorder* r, int t, int sender, int receiver,
+                 int resid) {
+  r->NewDatum("Transactions")
+      ->AddVal("TransactionId", resid)
+      ->AddVal("SenderId", sender)
+      ->AddVal("ReceiverId", receiver)
+      ->AddVal("ResourceId", resid)
+      ->AddVal("Commodity", std::string("fuel"))
+      ->AddVal("Time", t)
+      ->Record();
+}
+
+void RecordComp(cyclus::Recorder* r, int qual, int nuc, double frac) {
+  r->NewDatum("Compositions")
+      ->AddVal("QualId", qual)
+      ->AddVal("NucId", nuc)
+      ->AddVal("MassFrac", frac)
+      ->Record();
+}
+
+}  // namespace
+
+class ResLineageTests : public ::testing::Test {
+ public:
+  virtual void SetUp() {
+    b = new cyclus::SqliteBack(":memory:");
+    r.RegisterBackend(b);
+
+    // 1 is split into 2 and 3, then 3 absorbs 5 to become 4; resource 5 is
+    // recorded before 4 and product 6 shares a quality id with material 1
+    RecordRes(&r, 1, 0, 0, 10, 0, 10.0);
+    RecordRes(&r, 2, 1, 0, 10, 1, 4.0);
+    RecordRes(&r, 3, 1, 0, 10, 1, 6.0);
+    RecordRes(&r, 5, 0, 0, 11, 1, 2.0);
+    RecordRes(&r, 4, 3, 5, 12, 2, 8.0);
+    RecordRes(&r, 6, 0, 0, 10, 2, 1.0, "Product");
+    RecordComp(&r, 10, 922350000, 1.0);
+    RecordComp(&r, 10, 922380000, 3.0);
+    RecordComp(&r, 11, 942390000, 1.0);
+    RecordComp(&r, 12, 922350000, 0.5);
+    RecordComp(&r, 12, 942390000, 0.5);
+    RecordTrans(&r, 1, 7, 8, 2);
+    RecordTrans(&r, 3, 7, 9, 6);
+    RecordTrans(&r, 2, 7, 8, 4);
+    r.Flush();
+  }
+
+  virtual void TearDown() {
+    r.Close();
+    delete b;
+  }
+  cyclus::SqliteBack* b;
+  cyclus::Recorder r;
+};
+
+TEST_F(ResLineageTests, Lineage) {
+  cyclus::ResLineage lin(b, 2);
+  ASSERT_EQ(6, lin.size());
+  EXPECT_TRUE(lin.Has(5));
+  EXPECT_FALSE(lin.Has(42));
+  EXPECT_DOUBLE_EQ(8.0, lin.Quantity(4));
+  EXPECT_EQ(12, lin.QualId(4));
+  EXPECT_EQ(2, lin.TimeCreated(4));
+  EXPECT_FALSE(lin.IsMaterial(6));
+  EXPECT_THROW(lin.Quantity(42), cyclus::KeyError);
+
+  std::vector<int> ids = lin.Parents(4);
+  ASSERT_EQ(2, ids.size());
+  EXPECT_EQ(3, ids[0]);
+  EXPECT_EQ(5, ids[1]);
+  EXPECT_EQ(0, lin.Parents(1).size());
+
+  ids = lin.Ancestors(4);
+  ASSERT_EQ(3, ids.size());
+  EXPECT_EQ(1, ids[0]);
+  EXPECT_EQ(3, ids[1]);
+  EXPECT_EQ(5, ids[2]);
+
+  ids = lin.Children(1);
+  ASSERT_EQ(2, ids.size());
+  EXPECT_EQ(2, ids[0]);
+  EXPECT_EQ(3, ids[1]);
+
+  ids = lin.Descendants(1);
+  ASSERT_EQ(3, ids.size());
+  EXPECT_EQ(2, ids[0]);
+  EXPECT_EQ(3, ids[1]);
+  EXPECT_EQ(4, ids[2]);
+  EXPECT_EQ(0, lin.Descendants(6).size());
+}
+
+TEST_F(ResLineageTests, Flow) {
+  cyclus::ResLineage lin(b);
+  std::map<int, double> fracs = lin.MassFracs(10);
+  ASSERT_EQ(2, fracs.size());
+  EXPECT_DOUBLE_EQ(0.25, fracs[922350000]);
+  EXPECT_EQ(0, lin.MassFracs(99).size());
+
+  std::map<int, double> flow = lin.Flow(7, 8, 0, 1);
+  ASSERT_EQ(2, flow.size());
+  EXPECT_DOUBLE_EQ(1.0, flow[922350000]);
+  EXPECT_DOUBLE_EQ(3.0, flow[922380000]);
+
+  // the product sent to agent 9 carries no nuclides
+  flow = lin.Flow(7, -1, 0, 10);
+  ASSERT_EQ(3, flow.size());
+  EXPECT_DOUBLE_EQ(5.0, flow[922350000]);
+  EXPECT_DOUBLE_EQ(3.0, flow[922380000]);
+  EXPECT_DOUBLE_EQ(4.0, flow[942390000]);
+
+  EXPECT_EQ(0, lin.Flow(8, 7, 0, 10).size());
+  EXPECT_EQ(0, lin.Flow(-1, 9, 0, 10).size());
+}
+
+TEST_F(ResLineageTests, SimId) {
+  // a second simulation in the same backend reuses resource and quality ids
+  cyclus::Recorder other;
+  other.RegisterBackend(b);
+  RecordRes(&other, 1, 0, 0, 10, 0, 99.0);
+  RecordRes(&other, 7, 1, 0, 10, 1, 99.0);
+  RecordComp(&other, 10, 10010000, 1.0);
+  RecordTrans(&other, 1, 7, 8, 7);
+  other.Close();
+
+  cyclus::ResLineage all(b);
+  EXPECT_EQ(8, all.size());
+
+  cyclus::ResLineage lin(b, r.sim_id());
+  ASSERT_EQ(6, lin.size());
+  EXPECT_FALSE(lin.Has(7));
+  EXPECT_DOUBLE_EQ(10.0, lin.Quantity(1));
+  EXPECT_EQ(2, lin.MassFracs(10).size());
+  EXPECT_EQ(2, lin.Flow(7, 8, 0, 1).size());
+
+  cyclus::ResLineage mine(b, other.sim_id(), 1);
+  ASSERT_EQ(2, mine.size());
+  EXPECT_DOUBLE_EQ(99.0, mine.Quantity(1));
+  EXPECT_EQ(1, mine.MassFracs(10).size());
+}
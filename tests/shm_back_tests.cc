@@ -0,0 +1,97 @@
+#include <unistd.h>
+
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "recorder.h"
+#include "shm_back.h"
+#include "tools.h"
+
+namespace {
+
+std::string RingName(const std::string& test) {
+  std::stringstream ss;
+  ss << "/cyclus_test_" << test << "_" << getpid();
+  return ss.str();
+}
+
+}  // namespace
+
+TEST(ShmBackTests, PublishAndRead) {
+  std::string name = RingName("read");
+  cyclus::ShmBack b(name);
+  cyclus::ShmReader all(name);
+  cyclus::ShmReader items(name);
+  items.Subscribe("Items");
+
+  cyclus::Recorder r(false);
+  r.set_dump_count(25);
+  r.RegisterBackend(&b);
+  RecordItems(&r, 0, 50, ITEM_NAME | ITEM_STEPS);
+  r.Flush();
+
+  std::string table;
+  cyclus::ColumnarResult rows;
+  int nitems = 0;
+  int ninfo = 0;
+  while (all.Next(&table, &rows)) {
+    if (table == "Items") {
+      EXPECT_EQ(nitems, rows.Column<int>("Id")[0]);
+      nitems += rows.nrows();
+    } else {
+      ninfo += rows.nrows();
+    }
+  }
+  EXPECT_EQ(50, nitems);
+  EXPECT_EQ(5, ninfo);
+  EXPECT_FALSE(all.closed());
+
+  nitems = 0;
+  while (items.Next(&table, &rows)) {
+    EXPECT_EQ("Items", table);
+    nitems += rows.nrows();
+  }
+  EXPECT_EQ(50, nitems);
+  EXPECT_EQ("odd", rows.Column<std::string>("Name")[rows.nrows() - 1]);
+
+  r.Close();
+  b.Close();
+  EXPECT_TRUE(all.closed());
+  EXPECT_THROW(cyclus::ShmReader gone(name), cyclus::IOError);
+}
+
+TEST(ShmBackTests, SlowReaderSkipsAhead) {
+  std::string name = RingName("slow");
+  cyclus::ShmBack b(name, 4096);
+  cyclus::ShmReader slow(name);
+
+  cyclus::Recorder r(false);
+  r.set_dump_count(10);
+  r.RegisterBackend(&b);
+  RecordItems(&r, 0, 2000, ITEM_NAME | ITEM_STEPS);
+  r.Flush();
+
+  // the writer never waited, so the oldest records are gone
+  std::string table;
+  cyclus::ColumnarResult rows;
+  int last = -1;
+  int nitems = 0;
+  while (slow.Next(&table, &rows)) {
+    if (table != "Items")
+      continue;
+    EXPECT_LT(last, rows.Column<int>("Id")[0]);
+    last = rows.Column<int>("Id")[rows.nrows() - 1];
+    nitems += rows.nrows();
+  }
+  EXPECT_EQ(1, slow.overruns());
+  EXPECT_EQ(1999, last);
+  EXPECT_LT(nitems, 2000);
+
+  cyclus::ShmReader late(name, true);
+  EXPECT_TRUE(late.Next(&table, &rows));
+  EXPECT_EQ(0, b.dropped());
+  r.Close();
+}
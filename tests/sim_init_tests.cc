@@ -160,15 +160,41 @@ class SimInitTest : public ::testing::Test {
   int transid(cy::Context* ctx) { return ctx->trans_id_; }
 
   cy::SimInfo siminfo(cy::Context* ctx) { return ctx->si_; }
-  std::set<Agent*> agent_list(cy::Context* ctx) { return ctx->agent_list_; }
-  std::map<int, cy::TimeListener*> tickers(cy::Timer* ti) { return ti->tickers_; }
+  std::set<Agent*> agent_list(cy::Context* ctx) {
+    const std::vector<Agent*>& agents = ctx->agent_list_.items();
+    return std::set<Agent*>(agents.begin(), agents.end());
+  }
+  std::map<int, cy::TimeListener*> tickers(cy::Timer* ti) {
+    std::map<int, cy::TimeListener*> m;
+    for (int i = 0; i < ti->tickers_.slots(); ++i) {
+      if (ti->tickers_.slot(i) != NULL)
+        m[ti->tickers_.slot_id(i)] = ti->tickers_.slot(i);
+    }
+    return m;
+  }
 
   std::map<int, std::vector<std::pair<std::string, Agent*> > >
   build_queue(cy::Timer* ti) {
-    return ti->build_queue_;
+    std::map<int, std::vector<std::pair<std::string, Agent*> > > queue;
+    cy::Timer::EventQueue q = ti->builds_;
+    for (; !q.empty(); q.pop()) {
+      for (int i = 0; i < q.top().count; ++i) {
+        queue[q.top().time].push_back(
+            std::make_pair(q.top().proto, q.top().agent));
+      }
+    }
+    return queue;
   }
   std::map<int, std::vector<Agent*> > decom_queue(cy::Timer* ti) {
-    return ti->decom_queue_;
+    std::map<int, std::vector<Agent*> > queue;
+    cy::Timer::EventQueue q = ti->decoms_;
+    for (; !q.empty(); q.pop()) {
+      if (ti->pending_decoms_.count(q.top().agent) > 0 &&
+          ti->pending_decoms_[q.top().agent] == q.top().seq) {
+        queue[q.top().time].push_back(q.top().agent);
+      }
+    }
+    return queue;
   }
 
   cy::Context* ctx;
@@ -440,3 +466,45 @@ TEST_F(SimInitTest, RestartSimInfo) {
   EXPECT_EQ("restart", info.parent_type);
   EXPECT_EQ(2, info.branch_time);
 }
+
+TEST_F(SimInitTest, RestartDifferentialSnapshots) {
+  // every tick asks for a snapshot, but the agents' state never changes
+  // after they are built
+  ti.set_differential_snapshots(0);
+  cy::PyStart();
+  ti.RunSim();
+  rec.Flush();
+
+  std::vector<cy::Cond> conds;
+  conds.push_back(cy::Cond("SimTime", "==", 4));
+  cy::QueryResult qr = b->Query("AgentStateUnchanged", &conds);
+  std::map<int, int> since;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    since[qr.GetVal<int>("AgentId", i)] = qr.GetVal<int>("Since", i);
+  }
+  // built at 2 and recorded at 3; the agent built at 3 is recorded at 4
+  ASSERT_EQ(1, since.size());
+  int id = since.begin()->first;
+  EXPECT_EQ(3, since[id]);
+
+  conds.push_back(cy::Cond("AgentId", "==", id));
+  qr = b->Query("AgentState_Inver_InverInfo", &conds);
+  EXPECT_EQ(0, qr.rows.size());
+
+  cy::SimInit si;
+  si.Restart(b, rec.sim_id(), 4);
+  std::set<Agent*> init_agents = agent_list(si.context());
+  cy::PyStop();
+
+  Inver* init_agent = NULL;
+  std::set<Agent*>::iterator it;
+  for (it = init_agents.begin(); it != init_agents.end(); ++it) {
+    if ((*it)->id() == id) {
+      init_agent = dynamic_cast<Inver*>(*it);
+    }
+  }
+  ASSERT_TRUE(init_agent != NULL);
+  EXPECT_EQ(23, init_agent->val1);
+  EXPECT_EQ(1, init_agent->buf1.count());
+  EXPECT_EQ(2, init_agent->buf2.count());
+}
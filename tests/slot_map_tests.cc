@@ -0,0 +1,108 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "error.h"
+#include "slot_map.h"
+
+using cyclus::SlotMap;
+
+TEST(SlotMapTests, InsertGetErase) {
+  int a, b, c;
+  SlotMap<int> m;
+  EXPECT_TRUE(m.empty());
+  m.Insert(3, &a);
+  m.Insert(7, &b);
+  m.Insert(9, &c);
+  EXPECT_EQ(3, m.size());
+  EXPECT_EQ(&b, m.Get(7));
+  EXPECT_EQ(NULL, m.Get(5));
+  EXPECT_EQ(NULL, m.Get(100));
+
+  EXPECT_NO_THROW(m.Insert(7, &b));
+  EXPECT_THROW(m.Insert(7, &c), cyclus::KeyError);
+  EXPECT_THROW(m.Insert(-1, &c), cyclus::ValueError);
+
+  EXPECT_EQ(0, m.Erase(7, &a));
+  EXPECT_EQ(1, m.Erase(7, &b));
+  EXPECT_EQ(0, m.Erase(7, &b));
+  EXPECT_EQ(NULL, m.Get(7));
+  EXPECT_EQ(2, m.size());
+  EXPECT_EQ(3, m.slots());
+  EXPECT_EQ(NULL, m.slot(1));
+  EXPECT_EQ(9, m.slot_id(2));
+
+  m.Compact();
+  EXPECT_EQ(2, m.slots());
+  EXPECT_EQ(&c, m.slot(1));
+  EXPECT_EQ(&c, m.Get(9));
+
+  m.clear();
+  EXPECT_TRUE(m.empty());
+  EXPECT_EQ(NULL, m.Get(3));
+}
+
+TEST(SlotMapTests, IdOrder) {
+  int x[6];
+  SlotMap<int> m;
+  m.Insert(4, &x[4]);
+  m.Insert(1, &x[1]);
+  m.Insert(5, &x[5]);
+  m.Erase(4, &x[4]);
+  m.Insert(2, &x[2]);
+  m.Insert(0, &x[0]);
+
+  const std::vector<int*>& items = m.items();
+  ASSERT_EQ(4, items.size());
+  EXPECT_EQ(&x[0], items[0]);
+  EXPECT_EQ(&x[1], items[1]);
+  EXPECT_EQ(&x[2], items[2]);
+  EXPECT_EQ(&x[5], items[3]);
+  for (int i = 0; i < m.slots(); ++i) {
+    EXPECT_EQ(m.slot(i), m.Get(m.slot_id(i)));
+  }
+}
+
+TEST(SlotMapTests, InsertDuringWalk) {
+  int x[8];
+  SlotMap<int> m;
+  m.Insert(2, &x[2]);
+  m.Insert(4, &x[4]);
+  m.Insert(6, &x[6]);
+
+  std::vector<int*> seen;
+  {
+    SlotMap<int>::Walk w(&m);
+    for (int i = 0; i < m.slots(); ++i) {
+      int* v = m.slot(i);
+      if (v == NULL) {
+        continue;
+      }
+      seen.push_back(v);
+      if (v == &x[4]) {
+        // a lower id is kept aside, a greater one is walked
+        m.Erase(2, &x[2]);
+        m.Insert(1, &x[1]);
+        m.Insert(5, &x[5]);
+        m.Insert(7, &x[7]);
+        EXPECT_EQ(&x[1], m.Get(1));
+        EXPECT_EQ(5, m.size());
+        EXPECT_EQ(1, m.Erase(5, &x[5]));
+        m.Compact();
+      }
+    }
+  }
+  ASSERT_EQ(4, seen.size());
+  EXPECT_EQ(&x[2], seen[0]);
+  EXPECT_EQ(&x[4], seen[1]);
+  EXPECT_EQ(&x[6], seen[2]);
+  EXPECT_EQ(&x[7], seen[3]);
+
+  const std::vector<int*>& items = m.items();
+  ASSERT_EQ(4, items.size());
+  EXPECT_EQ(&x[1], items[0]);
+  EXPECT_EQ(&x[4], items[1]);
+  EXPECT_EQ(&x[6], items[2]);
+  EXPECT_EQ(&x[7], items[3]);
+  EXPECT_EQ(&x[1], m.Get(1));
+}
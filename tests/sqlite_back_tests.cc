@@ -548,6 +548,306 @@ TEST_F(SqliteBackTests, Tables) {
   EXPECT_EQ(1, tabs.count("IntTable"));
 }
 
+TEST_F(SqliteBackTests, QueryColumns) {
+  using std::vector;
+  using std::string;
+  using cyclus::Cond;
+  FileDeleter fd(path);
+
+  for (int i = 0; i < 10; ++i) {
+    r.NewDatum("Proj")
+        ->AddVal("id", i)
+        ->AddVal("name", string(i % 2 == 0 ? "even" : "odd"))
+        ->AddVal("qty", 0.5 * i)
+        ->Record();
+  }
+  r.Close();
+
+  vector<string> cols;
+  cols.push_back("qty");
+  cols.push_back("id");
+  vector<Cond> conds;
+  conds.push_back(Cond("name", "==", string("odd")));
+  cyclus::QueryResult qr = b->Query("Proj", cols, &conds);
+  ASSERT_EQ(2, qr.fields.size());
+  EXPECT_EQ("qty", qr.fields[0]);
+  EXPECT_EQ("id", qr.fields[1]);
+  EXPECT_EQ(cyclus::DOUBLE, qr.types[0]);
+  EXPECT_EQ(cyclus::INT, qr.types[1]);
+  ASSERT_EQ(5, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    ASSERT_EQ(2, qr.rows[i].size());
+    EXPECT_EQ(2 * i + 1, qr.GetVal<int>("id", i));
+    EXPECT_DOUBLE_EQ(0.5 * (2 * i + 1), qr.GetVal<double>("qty", i));
+  }
+
+  cols.push_back("nope");
+  EXPECT_THROW(b->Query("Proj", cols, NULL), cyclus::KeyError);
+}
+
+TEST_F(SqliteBackTests, Cursor) {
+  using std::vector;
+  using std::string;
+  using cyclus::Cond;
+  using cyclus::QueryCursor;
+  FileDeleter fd(path);
+
+  int n = 25;
+  for (int i = 0; i < n; ++i) {
+    r.NewDatum("Streamed")
+        ->AddVal("id", i)
+        ->AddVal("name", string(i % 2 == 0 ? "even" : "odd"))
+        ->Record();
+  }
+  r.Close();
+
+  cyclus::QueryResult batch;
+  QueryCursor::Ptr c = b->Cursor("Streamed", NULL);
+  int nrows = 0;
+  int nbatches = 0;
+  while (c->Next(&batch, 10)) {
+    ASSERT_GE(10, batch.rows.size());
+    for (int i = 0; i < batch.rows.size(); ++i)
+      EXPECT_EQ(nrows + i, batch.GetVal<int>("id", i));
+    nrows += batch.rows.size();
+    ++nbatches;
+  }
+  EXPECT_EQ(n, nrows);
+  EXPECT_EQ(3, nbatches);
+
+  vector<string> cols(1, "id");
+  vector<Cond> conds;
+  conds.push_back(Cond("name", "==", string("odd")));
+  c = b->Cursor("Streamed", cols, &conds);
+  ASSERT_TRUE(c->Next(&batch, 100));
+  ASSERT_EQ(1, batch.fields.size());
+  EXPECT_EQ(12, batch.rows.size());
+  EXPECT_EQ(23, batch.GetVal<int>("id", 11));
+  EXPECT_FALSE(c->Next(&batch, 100));
+  EXPECT_THROW(c->Next(&batch, 0), cyclus::ValueError);
+}
+
+TEST_F(SqliteBackTests, QueryColumnar) {
+  using std::vector;
+  using std::string;
+  using cyclus::Cond;
+  FileDeleter fd(path);
+
+  for (int i = 0; i < 10; ++i) {
+    r.NewDatum("Cols")
+        ->AddVal("id", i)
+        ->AddVal("name", string(i % 2 == 0 ? "even" : "odd"))
+        ->AddVal("qty", 0.5 * i)
+        ->AddVal("flag", i % 3 == 0)
+        ->Record();
+  }
+  r.Close();
+
+  vector<Cond> conds;
+  conds.push_back(Cond("id", ">=", 4));
+  cyclus::ColumnarResult cr = b->QueryColumnar("Cols", &conds);
+  ASSERT_EQ(6, cr.nrows());
+  ASSERT_EQ(5, cr.fields().size());  // injects simid
+  vector<int>& ids = cr.Column<int>("id");
+  vector<double>& qty = cr.Column<double>("qty");
+  vector<string>& names = cr.Column<string>("name");
+  for (int i = 0; i < cr.nrows(); ++i) {
+    EXPECT_EQ(i + 4, ids[i]);
+    EXPECT_DOUBLE_EQ(0.5 * (i + 4), qty[i]);
+    EXPECT_EQ(i % 2 == 0 ? "even" : "odd", names[i]);
+    EXPECT_EQ((i + 4) % 3 == 0, cr.GetVal<bool>("flag", i));
+  }
+
+  vector<string> cols(1, "qty");
+  cr = b->QueryColumnar("Cols", cols, NULL);
+  ASSERT_EQ(1, cr.fields().size());
+  EXPECT_EQ(10, cr.Column<double>(0).size());
+}
+
+TEST_F(SqliteBackTests, Aggregate) {
+  using std::map;
+  using std::vector;
+  using std::string;
+  using cyclus::Agg;
+  using cyclus::Cond;
+  FileDeleter fd(path);
+
+  for (int i = 0; i < 30; ++i) {
+    r.NewDatum("Trans")
+        ->AddVal("Time", i / 10)
+        ->AddVal("Commodity", string(i % 3 == 0 ? "uox" : "mox"))
+        ->AddVal("Quantity", 1.0 * i)
+        ->Record();
+  }
+  r.Close();
+
+  vector<string> group_by;
+  group_by.push_back("Time");
+  group_by.push_back("Commodity");
+  vector<Agg> aggs;
+  aggs.push_back(Agg("COUNT", "Quantity"));
+  aggs.push_back(Agg("SUM", "Quantity"));
+  aggs.push_back(Agg("MAX", "Time"));
+  vector<Cond> conds;
+  conds.push_back(Cond("Time", ">=", 1));
+  cyclus::QueryResult qr = b->Aggregate("Trans", group_by, aggs, &conds);
+  ASSERT_EQ(5, qr.fields.size());
+  EXPECT_EQ("SUM(Quantity)", qr.fields[3]);
+  EXPECT_EQ(cyclus::INT, qr.types[2]);
+  EXPECT_EQ(cyclus::DOUBLE, qr.types[3]);
+  EXPECT_EQ(cyclus::INT, qr.types[4]);
+  ASSERT_EQ(4, qr.rows.size());
+  map<string, double> sums;
+  map<string, int> counts;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    string k = boost::lexical_cast<string>(qr.GetVal<int>("Time", i)) +
+               qr.GetVal<string>("Commodity", i);
+    sums[k] = qr.GetVal<double>("SUM(Quantity)", i);
+    counts[k] = qr.GetVal<int>("COUNT(Quantity)", i);
+    EXPECT_EQ(qr.GetVal<int>("Time", i), qr.GetVal<int>("MAX(Time)", i));
+  }
+  EXPECT_DOUBLE_EQ(12 + 15 + 18, sums["1uox"]);
+  EXPECT_DOUBLE_EQ(10 + 11 + 13 + 14 + 16 + 17 + 19, sums["1mox"]);
+  EXPECT_EQ(3, counts["2uox"]);
+  EXPECT_EQ(7, counts["2mox"]);
+
+  // whole-table aggregates
+  aggs.clear();
+  aggs.push_back(Agg("MIN", "Quantity"));
+  aggs.push_back(Agg("COUNT", "Commodity"));
+  qr = b->Aggregate("Trans", vector<string>(), aggs, NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_DOUBLE_EQ(0.0, qr.GetVal<double>("MIN(Quantity)"));
+  EXPECT_EQ(30, qr.GetVal<int>("COUNT(Commodity)"));
+
+  aggs.push_back(Agg("SUM", "Commodity"));
+  EXPECT_THROW(b->Aggregate("Trans", group_by, aggs, NULL), cyclus::ValueError);
+  EXPECT_THROW(Agg("AVG", "Quantity"), cyclus::ValueError);
+}
+
+TEST_F(SqliteBackTests, InListBetween) {
+  using std::set;
+  using std::vector;
+  using std::string;
+  using cyclus::Cond;
+  FileDeleter fd(path);
+
+  for (int i = 0; i < 1000; ++i) {
+    r.NewDatum("Res")
+        ->AddVal("ResourceId", i)
+        ->AddVal("Commodity", string(i % 3 == 0 ? "uox" : "mox"))
+        ->AddVal("Quantity", 1.0 * i)
+        ->Record();
+  }
+  r.Close();
+
+  set<int> ids;
+  ids.insert(7);
+  ids.insert(3);
+  ids.insert(5000);
+  vector<Cond> conds;
+  conds.push_back(Cond("ResourceId", "IN", ids));
+  cyclus::QueryResult qr = b->Query("Res", &conds);
+  ASSERT_EQ(2, qr.rows.size());
+
+  // more values than are bound as parameters, mixed with other conditions
+  ids.clear();
+  for (int i = 0; i < 2000; i += 2) {
+    ids.insert(i);
+  }
+  conds[0] = Cond("ResourceId", "IN", ids);
+  conds.push_back(Cond("Quantity", "BETWEEN", std::make_pair(100.0, 199.0)));
+  set<string> commods;
+  commods.insert("uox");
+  conds.push_back(Cond("Commodity", "IN", commods));
+  qr = b->Query("Res", &conds);
+  ASSERT_EQ(17, qr.rows.size());  // multiples of 6 in [100, 199]
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    EXPECT_EQ(0, qr.GetVal<int>("ResourceId", i) % 6);
+  }
+
+  conds.clear();
+  conds.push_back(Cond("ResourceId", "IN", set<int>()));
+  EXPECT_EQ(0, b->Query("Res", &conds).rows.size());
+}
+
+TEST_F(SqliteBackTests, InListTempTablesReused) {
+  using std::set;
+  using std::vector;
+  using cyclus::Cond;
+
+  for (int i = 0; i < 1000; ++i) {
+    r.NewDatum("Res")
+        ->AddVal("ResourceId", i)
+        ->AddVal("Quantity", 1.0 * i)
+        ->Record();
+  }
+  r.Close();
+
+  set<int> ids;
+  for (int i = 0; i < 1000; i += 2) {
+    ids.insert(i);
+  }
+  ids.insert(5000);
+  vector<Cond> conds;
+  conds.push_back(Cond("ResourceId", "IN", ids));
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(500, b->Query("Res", &conds).rows.size());
+    EXPECT_EQ(500, b->QueryColumnar("Res", &conds).nrows());
+  }
+
+  // an open cursor keeps its temp table, so a query meanwhile uses another
+  cyclus::QueryCursor::Ptr c = b->Cursor("Res", &conds);
+  cyclus::QueryResult batch;
+  ASSERT_TRUE(c->Next(&batch, 10));
+  EXPECT_EQ(500, b->Query("Res", &conds).rows.size());
+  int n = batch.rows.size();
+  while (c->Next(&batch, 100)) {
+    n += batch.rows.size();
+  }
+  EXPECT_EQ(500, n);
+  c.reset();
+  EXPECT_EQ(500, b->Query("Res", &conds).rows.size());
+
+  cyclus::SqlStatement::Ptr stmt = b->db().Prepare(
+      "SELECT COUNT(*) FROM sqlite_temp_master WHERE type='table';");
+  ASSERT_TRUE(stmt->Step());
+  EXPECT_EQ(2, stmt->GetInt(0));
+}
+
+TEST_F(SqliteBackTests, InListsShareParamLimit) {
+  using std::set;
+  using std::vector;
+  using cyclus::Cond;
+
+  for (int i = 0; i < 1000; ++i) {
+    r.NewDatum("Res")
+        ->AddVal("ResourceId", i)
+        ->AddVal("Quantity", 1.0 * (i % 10))
+        ->Record();
+  }
+  r.Close();
+
+  // each set fits on its own, but both together with the third condition
+  // take more than 999 parameters, so the second goes to a temp table
+  set<int> ids;
+  set<double> qtys;
+  for (int i = 0; i < 500; ++i) {
+    ids.insert(2 * i);
+    qtys.insert(0.5 * i);
+  }
+  vector<Cond> conds;
+  conds.push_back(Cond("ResourceId", "IN", ids));
+  conds.push_back(Cond("Quantity", "IN", qtys));
+  conds.push_back(Cond("ResourceId", "<", 100));
+  EXPECT_EQ(50, b->Query("Res", &conds).rows.size());
+
+  cyclus::SqlStatement::Ptr stmt = b->db().Prepare(
+      "SELECT COUNT(*) FROM sqlite_temp_master WHERE type='table';");
+  ASSERT_TRUE(stmt->Step());
+  EXPECT_EQ(1, stmt->GetInt(0));
+}
+
 TEST_F(SqliteBackTests, ListPairIntInt) {
   std::list<std::pair<int, int> > l;
   l.push_back(std::make_pair(4, 2));
@@ -565,3 +865,16 @@ TEST_F(SqliteBackTests, ListPairIntInt) {
   EXPECT_EQ(std::make_pair(4, 2), l.front());
   EXPECT_EQ(std::make_pair(5, 3), l.back());
 }
+
+TEST_F(SqliteBackTests, Pairs) {
+  r.NewDatum("foo")
+      ->AddVal("ints", std::make_pair(4, 2))
+      ->AddVal("doubles", std::make_pair(0.5, 1.5))
+      ->Record();
+
+  r.Close();
+  cyclus::QueryResult qr = b->Query("foo", NULL);
+  EXPECT_EQ(std::make_pair(4, 2), (qr.GetVal<std::pair<int, int> >("ints")));
+  EXPECT_EQ(std::make_pair(0.5, 1.5),
+            (qr.GetVal<std::pair<double, double> >("doubles")));
+}
@@ -1,14 +1,16 @@
 """Tests for cyclus wrappers"""
 import os
+import shutil
 import subprocess
 from functools import wraps
 
 import nose
-from nose.tools import assert_equal, assert_less
+from nose.tools import assert_equal, assert_less, assert_raises
 
 from cyclus import lib
+from cyclus import typesystem as ts
 
-from tools import libcyclus_setup, dbtest
+from tools import libcyclus_setup, dbtest, safe_call, INPUT
 
 
 setup = libcyclus_setup
@@ -43,6 +45,159 @@ def test_conds_comp(db, fname, backend):
     for row in df['MassFrac']:
         assert_less(row, 0.00720000001)
 
+@dbtest
+def test_conds_in_between(db, fname, backend):
+    df = db.query("Compositions")
+    qualids = sorted(set(df['QualId']))[:2]
+    obs = db.query("Compositions", [('QualId', 'IN', qualids)])
+    assert_equal(df['QualId'].isin(qualids).sum(), len(obs))
+    obs = db.query("Compositions", [('MassFrac', 'BETWEEN', (0.0, 0.0072))])
+    exp = df[(df['MassFrac'] >= 0.0) & (df['MassFrac'] <= 0.0072)]
+    assert_equal(len(exp), len(obs))
+
+@dbtest
+def test_conds_unsupported_type(db, fname, backend):
+    simid = db.query("AgentEntry")['SimId'][0]
+    with assert_raises(ValueError) as cm:
+        db.query("AgentEntry", [('SimId', 'BETWEEN', (simid, simid))])
+    assert 'SimId' in str(cm.exception)
+    assert 'UUID' in str(cm.exception)
+
+@dbtest
+def test_cursor_comp(db, fname, backend):
+    conds = [('NucId', '==', 922350000)]
+    exp = db.query("Compositions", conds, cols=['QualId', 'MassFrac'])
+    batches = list(db.cursor("Compositions", conds, cols=['QualId', 'MassFrac'],
+                             batch_size=2))
+    assert_less(0, len(batches))
+    for df in batches:
+        assert_less(len(df), 3)
+        assert_equal(['QualId', 'MassFrac'], list(df.columns))
+    assert_equal(len(exp), sum(len(df) for df in batches))
+
+@dbtest
+def test_aggregate_comp(db, fname, backend):
+    df = db.query("Compositions")
+    obs = db.aggregate("Compositions", ['NucId'],
+                       [('COUNT', 'MassFrac'), ('SUM', 'MassFrac')])
+    assert_equal(len(df['NucId'].unique()), len(obs))
+    for _, row in obs.iterrows():
+        sel = df[df['NucId'] == row['NucId']]
+        assert_equal(len(sel), row['COUNT(MassFrac)'])
+        assert_less(abs(sel['MassFrac'].sum() - row['SUM(MassFrac)']), 1e-10)
+
+@dbtest
+def test_caching_backend(db, fname, backend):
+    cache = lib.CachingBackend(db)
+    exp = db.query("AgentEntry")
+    obs = cache.query("AgentEntry")
+    obs = cache.query("AgentEntry")
+    assert_equal(len(exp), len(obs))
+    assert_equal(1, cache.hits)
+    assert_equal(1, cache.misses)
+    assert_less(0, cache.nbytes)
+    cache.invalidate("AgentEntry")
+    assert_equal(0, cache.nbytes)
+
+def test_mem_back():
+    back = lib.MemBack()
+    rec = lib.Recorder(inject_sim_id=False)
+    rec.register_backend(back)
+    for i in range(4):
+        d = rec.new_datum("Items")
+        d.add_val("Id", i, type=ts.INT)
+        d.record()
+    rec.flush()
+    assert_equal(4, back.nrows("Items"))
+    obs = back.query("Items", [("Id", ">", 1)])
+    assert_equal([2, 3], list(obs['Id']))
+    assert_equal('int64', str(obs['Id'].dtype))
+    rec.close()
+
+def test_events_state():
+    from cyclus import events
+    events.STATE = object()
+    assert lib.py_event_consumers()
+    events.STATE = None
+    assert not lib.py_event_consumers()
+    assert events.STATE is None
+
+def test_col_log_back():
+    fname = 'test_col_log.cyclog'
+    if os.path.exists(fname):
+        os.remove(fname)
+    back = lib.ColLogBack(fname, seg_rows=3)
+    rec = lib.Recorder(inject_sim_id=False)
+    rec.register_backend(back)
+    for i in range(10):
+        d = rec.new_datum("Items")
+        d.add_val("Id", i, type=ts.INT)
+        d.record()
+    rec.flush()
+    obs = back.query("Items", [("Id", ">=", 8)])
+    assert_equal([8, 9], list(obs['Id']))
+    rec.close()
+    back.close()
+    os.remove(fname)
+
+def test_partition_back():
+    dname = 'test_partitions'
+    if os.path.exists(dname):
+        shutil.rmtree(dname)
+    back = lib.PartitionBack(dname, window=5)
+    rec = lib.Recorder(inject_sim_id=False)
+    rec.register_backend(back)
+    for i in range(10):
+        d = rec.new_datum("Items")
+        d.add_val("Time", i, type=ts.INT)
+        d.record()
+    rec.flush()
+    assert_equal(2, back.npartitions)
+    obs = back.query("Items", [("Time", ">=", 8)])
+    assert_equal([8, 9], list(obs['Time']))
+    rec.close()
+    back.close()
+    shutil.rmtree(dname)
+
+@dbtest
+def test_lineage(db, fname, backend):
+    lin = lib.ResLineage(db)
+    res = db.query("Resources")
+    assert_equal(len(res), len(lin))
+    for _, row in res.iterrows():
+        rid = row['ResourceId']
+        assert_equal(row['QualId'], lin.qual_id(rid))
+        for p in lin.parents(rid):
+            assert_less(p, rid)
+            if p not in lin:
+                continue  # untracked parent
+            assert rid in lin.descendants(p)
+            assert p in lin.ancestors(rid)
+    trans = db.query("Transactions")
+    mats = set(res[res['Type'] == 'Material']['ResourceId'])
+    exp = sum(lin.quantity(r) for r in trans['ResourceId'] if r in mats)
+    assert_less(abs(exp - sum(lin.flow().values())), 1e-6 * max(exp, 1.0))
+
+def test_lineage_simid():
+    fname = 'test_lineage_simid.sqlite'
+    if os.path.exists(fname):
+        os.remove(fname)
+    for _ in range(2):
+        safe_call(['cyclus', '-o' + fname,
+                   os.path.join(INPUT, 'inventory.xml')])
+    db = lib.SqliteBack(fname)
+    res = db.query("Resources")
+    simids = sorted(set(res['SimId']))
+    assert_equal(2, len(simids))
+    for simid in simids:
+        lin = lib.ResLineage(db, simid=simid)
+        exp = res[res['SimId'] == simid]
+        assert_equal(len(exp), len(lin))
+        for _, row in exp.iterrows():
+            assert_equal(row['QualId'], lin.qual_id(row['ResourceId']))
+    db.close()
+    os.remove(fname)
+
 @dbtest
 def test_schema(db, fname, backend):
     schema = db.schema("AgentEntry")
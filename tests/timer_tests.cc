@@ -1,9 +1,17 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+
 #include <gtest/gtest.h>
 
+#include "comp_math.h"
 #include "context.h"
+#include "env.h"
 #include "facility.h"
 #include "greedy_preconditioner.h"
 #include "greedy_solver.h"
+#include "material.h"
 #include "pyhooks.h"
 #include "recorder.h"
 #include "timer.h"
@@ -37,6 +45,93 @@ class Dier : public cyclus::Facility {
 
 int Dier::decom_count = 0;
 
+class Retiree : public cyclus::Facility {
+ public:
+  Retiree(cyclus::Context* ctx) : cyclus::Facility(ctx) {}
+  virtual ~Retiree() {}
+
+  virtual cyclus::Agent* Clone() { return new Retiree(context()); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+  virtual void Decommission() {
+    decom_times.push_back(context()->time());
+  }
+
+  void Tick() {}
+  void Tock() {}
+  static std::vector<int> decom_times;
+};
+
+std::vector<int> Retiree::decom_times;
+
+class Sleeper : public cyclus::Facility {
+ public:
+  Sleeper(cyclus::Context* ctx) : cyclus::Facility(ctx) {}
+  virtual ~Sleeper() {}
+
+  virtual cyclus::Agent* Clone() { return new Sleeper(context()); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+  virtual int NextWakeup() { return (context()->time() / 10 + 1) * 10; }
+
+  void Tick() { tick_times.push_back(context()->time()); }
+  void Tock() {}
+  std::vector<int> tick_times;
+};
+
+class Holder : public cyclus::Facility {
+ public:
+  Holder(cyclus::Context* ctx) : cyclus::Facility(ctx) {}
+  virtual ~Holder() {}
+
+  virtual cyclus::Agent* Clone() { return new Holder(context()); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() {
+    cyclus::Inventories invs;
+    invs["store"] = inv;
+    return invs;
+  }
+
+  void Tick() {
+    cyclus::CompMap v;
+    v[922350000] = context()->time() == 0 ? 1 : 2;
+    v[922380000] = 10 - v[922350000];
+    if (context()->time() % 2 == 0) {
+      inv.push_back(cyclus::Material::Create(
+          this, 1, cyclus::Composition::CreateFromMass(v)));
+    }
+  }
+  void Tock() {}
+  std::vector<cyclus::Resource::Ptr> inv;
+};
+
+class Mixer : public cyclus::Facility {
+ public:
+  Mixer(cyclus::Context* ctx) : cyclus::Facility(ctx) {}
+  virtual ~Mixer() {}
+
+  virtual cyclus::Agent* Clone() { return new Mixer(context()); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() {
+    cyclus::Inventories invs;
+    invs["store"] = inv;
+    return invs;
+  }
+
+  void Tick() {
+    if (context()->time() > 0) {
+      return;
+    }
+    for (int i = 0; i < parts.size(); ++i) {
+      inv.push_back(cyclus::Material::Create(this, parts[i].second,
+                                             parts[i].first));
+    }
+  }
+  void Tock() {}
+  std::vector<std::pair<cyclus::Composition::Ptr, double> > parts;
+  std::vector<cyclus::Resource::Ptr> inv;
+};
+
 class Termer : public cyclus::Facility {
  public:
   Termer(cyclus::Context* ctx) : cyclus::Facility(ctx) {}
@@ -64,6 +159,33 @@ class Snapper : public cyclus::Facility {
   bool snap;
 };
 
+class Counter : public cyclus::Facility {
+ public:
+  Counter(cyclus::Context* ctx, bool safe)
+      : cyclus::Facility(ctx), safe(safe), ticks(0) {}
+  virtual ~Counter() {}
+
+  virtual cyclus::Agent* Clone() { return new Counter(context(), safe); }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+  virtual Json::Value annotations() {
+    Json::Value root(Json::objectValue);
+    root["thread_safe"] = safe;
+    return root;
+  }
+
+  void Tick() {
+    ticks++;
+    context()->NewDatum("Ticks")
+        ->AddVal("AgentId", id())
+        ->AddVal("Time", context()->time())
+        ->Record();
+  }
+  void Tock() {}
+  bool safe;
+  int ticks;
+};
+
 TEST(TimerTests, BareSim) {
   cyclus::PyStart();
   cyclus::Recorder rec;
@@ -149,6 +271,452 @@ TEST(TimerTests, CustomSnapshot) {
   cyclus::PyStop();
 }
 
+class SafeHolder : public Holder {
+ public:
+  SafeHolder(cyclus::Context* ctx) : Holder(ctx) {}
+  virtual ~SafeHolder() {}
+
+  virtual cyclus::Agent* Clone() { return new SafeHolder(context()); }
+  virtual Json::Value annotations() {
+    Json::Value root(Json::objectValue);
+    root["thread_safe"] = true;
+    return root;
+  }
+
+  void Tick() {
+    Holder::Tick();
+    cyclus::Material::Ptr m = cyclus::ResCast<cyclus::Material>(inv.back());
+    inv.push_back(m->ExtractQty(0.5));
+    m->Decay(context()->time() + 12);
+  }
+};
+
+TEST(TimerTests, CheckpointInterval) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(10));
+  ti.set_checkpoint_interval(4, 0);
+
+  Snapper* turtle = new Snapper(&ctx);
+  turtle->Build(NULL);
+
+  ti.RunSim();
+  rec.Close();
+
+  cyclus::QueryResult qr = b.Query("Snapshots", NULL);
+  ASSERT_EQ(3, qr.rows.size());
+  EXPECT_EQ(4, qr.GetVal<int>("Time", 0));
+  EXPECT_EQ(8, qr.GetVal<int>("Time", 1));
+  EXPECT_EQ(10, qr.GetVal<int>("Time", 2));
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, PhaseTimings) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(4));
+  ti.phase_timer()->RecordTo(&ctx);
+  ti.RunSim();
+  rec.Close();
+  EXPECT_FALSE(ti.phase_timer()->enabled());
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("Phase", "==", std::string("Tick")));
+  cyclus::QueryResult qr = b.Query("PhaseTimings", &conds);
+  ASSERT_EQ(4, qr.rows.size());
+  EXPECT_EQ(3, qr.GetVal<int>("Time", 3));
+  EXPECT_LE(0, qr.GetVal<double>("Seconds", 3));
+
+  conds[0] = cyclus::Cond("Phase", "==", std::string("Snapshot"));
+  EXPECT_EQ(1, b.Query("PhaseTimings", &conds).rows.size());
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, ThreadSafeTicks) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(3));
+  ti.set_nthreads(4);
+  std::vector<Counter*> counters;
+  for (int i = 0; i < 10; ++i) {
+    Counter* c = new Counter(&ctx, i != 4);
+    c->Build(NULL);
+    counters.push_back(c);
+  }
+  ti.RunSim();
+  rec.Close();
+
+  cyclus::QueryResult qr = b.Query("Ticks", NULL);
+  ASSERT_EQ(30, qr.rows.size());
+  for (int t = 0; t < 3; ++t) {
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_EQ(t, qr.GetVal<int>("Time", 10 * t + i));
+      EXPECT_EQ(counters[i]->id(), qr.GetVal<int>("AgentId", 10 * t + i));
+    }
+  }
+  EXPECT_EQ(3, counters[0]->ticks);
+  cyclus::PyStop();
+}
+
+// Returns the rows of a table as strings, without the SimId.  The non-zero
+// values of the int columns in bases are counted from their base, so that
+// the ids of simulations run one after another can be compared.
+std::vector<std::string> Rows(cyclus::SqliteBack* b, std::string table,
+                              const std::map<std::string, int>& bases) {
+  cyclus::QueryResult qr = b->Query(table, NULL);
+  std::vector<std::string> rows;
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    std::stringstream ss;
+    for (int j = 0; j < qr.fields.size(); ++j) {
+      std::string f = qr.fields[j];
+      if (f == "SimId") {
+        continue;
+      } else if (qr.types[j] == cyclus::INT) {
+        int v = qr.GetVal<int>(f, i);
+        std::map<std::string, int>::const_iterator it = bases.find(f);
+        ss << (v != 0 && it != bases.end() ? v - it->second : v) << " ";
+      } else if (qr.types[j] == cyclus::DOUBLE) {
+        ss << qr.GetVal<double>(f, i) << " ";
+      } else if (qr.types[j] == cyclus::STRING ||
+                 qr.types[j] == cyclus::VL_STRING) {
+        ss << qr.GetVal<std::string>(f, i) << " ";
+      }
+    }
+    rows.push_back(ss.str());
+  }
+  return rows;
+}
+
+// Runs holders that create, split and decay materials on nthreads threads
+// and returns the Resources and Compositions tables, with the ids counted
+// from the first ones taken.
+std::vector<std::string> HoldResources(int nthreads,
+                                       std::vector<int>* inv_sizes) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(3));
+  ti.set_nthreads(nthreads);
+  std::vector<SafeHolder*> holders;
+  for (int i = 0; i < 8; ++i) {
+    SafeHolder* h = new SafeHolder(&ctx);
+    h->Build(NULL);
+    holders.push_back(h);
+  }
+
+  cyclus::CompMap v;
+  v[922350000] = 1;
+  cyclus::Composition::Ptr first = cyclus::Composition::CreateFromMass(v);
+  cyclus::Material::Ptr m = cyclus::Material::CreateUntracked(1, first);
+  std::map<std::string, int> bases;
+  bases["ResourceId"] = m->state_id();
+  bases["ObjId"] = m->obj_id();
+  bases["Parent1"] = m->state_id();
+  bases["Parent2"] = m->state_id();
+  bases["QualId"] = first->id();
+
+  ti.RunSim();
+  rec.Close();
+
+  for (int i = 0; i < holders.size(); ++i) {
+    inv_sizes->push_back(holders[i]->inv.size());
+  }
+  std::vector<std::string> rows = Rows(&b, "Resources", bases);
+  std::vector<std::string> comps = Rows(&b, "Compositions", bases);
+  rows.insert(rows.end(), comps.begin(), comps.end());
+  cyclus::PyStop();
+  return rows;
+}
+
+TEST(TimerTests, ThreadSafeResources) {
+  cyclus::Env::SetNucDataPath();
+  std::vector<int> serial_invs;
+  std::vector<int> invs;
+  std::vector<std::string> serial = HoldResources(1, &serial_invs);
+  std::vector<std::string> rows = HoldResources(4, &invs);
+
+  // the ids are taken in agent order, as when ticking one at a time
+  EXPECT_EQ(std::vector<int>(8, 5), invs);
+  EXPECT_EQ(serial_invs, invs);
+  EXPECT_LT(8 * 7, rows.size());
+  EXPECT_TRUE(serial == rows);
+}
+
+TEST(TimerTests, BatchBuild) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(4));
+  ctx.AddPrototype("retiree", new Retiree(&ctx));
+  ctx.SchedBuild(NULL, "retiree", 2, 5);
+  ctx.SchedBuild(NULL, "retiree", 2);
+  EXPECT_THROW(ctx.SchedBuild(NULL, "retiree", 2, 0), cyclus::ValueError);
+
+  ti.RunSim();
+  rec.Close();
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("EnterTime", "==", 2));
+  cyclus::QueryResult qr = b.Query("AgentEntry", &conds);
+  EXPECT_EQ(6, qr.rows.size());
+
+  qr = b.Query("BuildSchedule", NULL);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(5, qr.GetVal<int>("Count", 0));
+  EXPECT_EQ(1, qr.GetVal<int>("Count", 1));
+  cyclus::PyStop();
+}
+
+class Plant : public cyclus::Facility {
+ public:
+  Plant(cyclus::Context* ctx, cyclus::Composition::Ptr c, double size,
+        bool safe)
+      : cyclus::Facility(ctx), comp(c), size(size), safe(safe), fuel(0) {}
+  virtual ~Plant() {}
+
+  virtual cyclus::Agent* Clone() {
+    return new Plant(context(), comp, size, safe);
+  }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+  virtual Json::Value annotations() {
+    Json::Value root(Json::objectValue);
+    root["thread_safe"] = safe;
+    return root;
+  }
+
+  void Tick() {}
+  void Tock() {}
+
+  virtual std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
+      GetMatlRequests() {
+    cyclus::RequestPortfolio<cyclus::Material>::Ptr port(
+        new cyclus::RequestPortfolio<cyclus::Material>());
+    port->AddRequest(cyclus::Material::CreateUntracked(size, comp), this,
+                     "fuel", size);
+    std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr> ports;
+    ports.insert(port);
+    return ports;
+  }
+
+  virtual void AcceptMatlTrades(
+      const std::vector<std::pair<cyclus::Trade<cyclus::Material>,
+                                  cyclus::Material::Ptr> >& responses) {
+    for (int i = 0; i < responses.size(); ++i) {
+      fuel += responses[i].second->quantity();
+    }
+  }
+
+  // bids the power made from the fuel bought in the same timestep
+  virtual std::set<cyclus::BidPortfolio<cyclus::Product>::Ptr>
+      GetProductBids(
+          cyclus::CommodMap<cyclus::Product>::type& commod_requests) {
+    std::set<cyclus::BidPortfolio<cyclus::Product>::Ptr> ports;
+    cyclus::CommodMap<cyclus::Product>::type::iterator it =
+        commod_requests.find("power");
+    if (fuel <= 0 || it == commod_requests.end()) {
+      return ports;
+    }
+    std::vector<cyclus::Request<cyclus::Product>*>& reqs = it->second;
+    cyclus::BidPortfolio<cyclus::Product>::Ptr port(
+        new cyclus::BidPortfolio<cyclus::Product>());
+    for (int i = 0; i < reqs.size(); ++i) {
+      port->AddBid(reqs[i], cyclus::Product::CreateUntracked(10 * fuel, "MW"),
+                   this, false, size + 0.1 * i);
+    }
+    port->AddConstraint(
+        cyclus::CapacityConstraint<cyclus::Product>(10 * fuel));
+    ports.insert(port);
+    return ports;
+  }
+
+  virtual void GetProductTrades(
+      const std::vector<cyclus::Trade<cyclus::Product> >& trades,
+      std::vector<std::pair<cyclus::Trade<cyclus::Product>,
+                            cyclus::Product::Ptr> >& responses) {
+    for (int i = 0; i < trades.size(); ++i) {
+      fuel -= trades[i].amt / 10;
+      responses.push_back(std::make_pair(
+          trades[i], cyclus::Product::Create(this, trades[i].amt, "MW")));
+    }
+  }
+
+  cyclus::Composition::Ptr comp;
+  double size;
+  bool safe;
+  double fuel;
+};
+
+class Mine : public cyclus::Facility {
+ public:
+  Mine(cyclus::Context* ctx, cyclus::Composition::Ptr c, double capacity)
+      : cyclus::Facility(ctx), comp(c), capacity(capacity), sold(0) {}
+  virtual ~Mine() {}
+
+  virtual cyclus::Agent* Clone() {
+    return new Mine(context(), comp, capacity);
+  }
+  virtual void InitInv(cyclus::Inventories& inv) {}
+  virtual cyclus::Inventories SnapshotInv() { return cyclus::Inventories(); }
+  virtual Json::Value annotations() {
+    Json::Value root(Json::objectValue);
+    root["thread_safe"] = true;
+    return root;
+  }
+
+  void Tick() { sold = 0; }
+  void Tock() {}
+
+  virtual std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr>
+      GetMatlBids(
+          cyclus::CommodMap<cyclus::Material>::type& commod_requests) {
+    std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> ports;
+    cyclus::CommodMap<cyclus::Material>::type::iterator it =
+        commod_requests.find("fuel");
+    if (it == commod_requests.end()) {
+      return ports;
+    }
+    std::vector<cyclus::Request<cyclus::Material>*>& reqs = it->second;
+    cyclus::BidPortfolio<cyclus::Material>::Ptr port(
+        new cyclus::BidPortfolio<cyclus::Material>());
+    for (int i = 0; i < reqs.size(); ++i) {
+      double qty = reqs[i]->target()->quantity();
+      port->AddBid(reqs[i], cyclus::Material::CreateUntracked(qty, comp), this,
+                   false, reqs[i]->preference() + capacity / 100);
+    }
+    port->AddConstraint(
+        cyclus::CapacityConstraint<cyclus::Material>(capacity));
+    ports.insert(port);
+    return ports;
+  }
+
+  virtual void GetMatlTrades(
+      const std::vector<cyclus::Trade<cyclus::Material> >& trades,
+      std::vector<std::pair<cyclus::Trade<cyclus::Material>,
+                            cyclus::Material::Ptr> >& responses) {
+    for (int i = 0; i < trades.size(); ++i) {
+      sold += trades[i].amt;
+      responses.push_back(std::make_pair(
+          trades[i], cyclus::Material::Create(this, trades[i].amt, comp)));
+    }
+  }
+
+  // asks for power in proportion to the fuel sold in the same timestep
+  virtual std::set<cyclus::RequestPortfolio<cyclus::Product>::Ptr>
+      GetProductRequests() {
+    std::set<cyclus::RequestPortfolio<cyclus::Product>::Ptr> ports;
+    if (sold <= 0) {
+      return ports;
+    }
+    cyclus::RequestPortfolio<cyclus::Product>::Ptr port(
+        new cyclus::RequestPortfolio<cyclus::Product>());
+    port->AddRequest(cyclus::Product::CreateUntracked(3 * sold, "MW"), this,
+                     "power", capacity);
+    ports.insert(port);
+    return ports;
+  }
+
+  cyclus::Composition::Ptr comp;
+  double capacity;
+  double sold;
+};
+
+// Runs plants that buy fuel from mines and sell power back to them, and
+// returns the transactions, with agent ids counted from the first agent.
+// Trades are executed in the order of the traders' addresses, which differ
+// between simulations, so the transactions are sorted and identified by the
+// quantity traded rather than by resource and transaction ids.
+std::vector<std::string> TradePower(bool concurrent) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(4));
+  ti.set_nthreads(4);
+  ti.set_concurrent_exchanges(concurrent);
+  cyclus::CompMap v;
+  v[922350000] = 5;
+  v[922380000] = 95;
+  cyclus::Composition::Ptr comp = cyclus::Composition::CreateFromMass(v);
+  int first = -1;
+  for (int i = 0; i < 9; ++i) {
+    cyclus::Facility* f;
+    if (i % 3 == 2) {
+      f = new Mine(&ctx, comp, 3 + i);
+    } else {
+      f = new Plant(&ctx, comp, 1 + i, i != 4);
+    }
+    f->Build(NULL);
+    if (first < 0) {
+      first = f->id();
+    }
+  }
+  ti.RunSim();
+  rec.Close();
+
+  std::map<int, double> qtys;
+  cyclus::QueryResult qr = b.Query("Resources", NULL);
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    qtys[qr.GetVal<int>("ResourceId", i)] = qr.GetVal<double>("Quantity", i);
+  }
+
+  std::vector<std::string> trans;
+  qr = b.Query("Transactions", NULL);
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    std::stringstream ss;
+    ss << qr.GetVal<int>("Time", i) << " "
+       << qr.GetVal<int>("SenderId", i) - first << " "
+       << qr.GetVal<int>("ReceiverId", i) - first << " "
+       << qr.GetVal<std::string>("Commodity", i) << " "
+       << qtys[qr.GetVal<int>("ResourceId", i)];
+    trans.push_back(ss.str());
+  }
+  std::sort(trans.begin(), trans.end());
+  cyclus::PyStop();
+  return trans;
+}
+
+TEST(TimerTests, ConcurrentExchanges) {
+  std::vector<std::string> serial = TradePower(false);
+  std::vector<std::string> concurrent = TradePower(true);
+
+  int power = 0;
+  for (int i = 0; i < serial.size(); ++i) {
+    if (serial[i].find(" power ") != std::string::npos) {
+      power++;
+    }
+  }
+  EXPECT_LT(0, power);
+  EXPECT_LT(power, serial.size());
+  EXPECT_TRUE(serial == concurrent);
+}
+
 TEST(TimerTests, NullParentDecomNoSegfault) {
   cyclus::PyStart();
   cyclus::Recorder rec;
@@ -182,3 +750,163 @@ TEST(TimerTests, DoubleDecom) {
   EXPECT_EQ(1, Dier::decom_count);
   cyclus::PyStop();
 }
+
+TEST(TimerTests, RescheduleDecom) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(5));
+
+  Retiree* early = new Retiree(&ctx);
+  early->Build(NULL);
+  Retiree* late = new Retiree(&ctx);
+  late->Build(NULL);
+  ctx.SchedDecom(late, 1);
+  ctx.SchedDecom(early, 2);
+  ctx.SchedDecom(late, 3);
+  ctx.SchedDecom(early, 1);
+
+  Retiree::decom_times.clear();
+  ti.RunSim();
+  ASSERT_EQ(2, Retiree::decom_times.size());
+  EXPECT_EQ(1, Retiree::decom_times[0]);
+  EXPECT_EQ(3, Retiree::decom_times[1]);
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, SkipQuiescent) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  ti.Initialize(&ctx, cyclus::SimInfo(45));
+  ti.set_skip_quiescent(true);
+  Sleeper* s = new Sleeper(&ctx);
+  s->Build(NULL);
+  Sleeper* retiring = new Sleeper(&ctx);
+  retiring->Build(NULL);
+  ctx.SchedDecom(retiring, 25);
+  ti.RunSim();
+  rec.Close();
+
+  int want[] = {0, 10, 20, 25, 30, 40};
+  ASSERT_EQ(6, s->tick_times.size());
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(want[i], s->tick_times[i]);
+  }
+
+  cyclus::QueryResult qr = b.Query("Finish", NULL);
+  EXPECT_EQ(44, qr.GetVal<int>("EndTime"));
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, IncrementalInventory) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  cyclus::SimInfo si(4);
+  si.explicit_inventory = true;
+  si.explicit_inventory_incremental = true;
+  ti.Initialize(&ctx, si);
+  Holder* h = new Holder(&ctx);
+  h->Build(NULL);
+  ti.RunSim();
+  rec.Close();
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("NucId", "==", 922350000));
+  cyclus::QueryResult qr = b.Query("ExplicitInventory", &conds);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(0, qr.GetVal<int>("Time", 0));
+  EXPECT_DOUBLE_EQ(0.1, qr.GetVal<double>("Quantity", 0));
+  EXPECT_EQ(2, qr.GetVal<int>("Time", 1));
+  EXPECT_NEAR(0.1 + 0.2, qr.GetVal<double>("Quantity", 1), 1e-9);
+
+  qr = b.Query("ExplicitInventoryUnchanged", NULL);
+  ASSERT_EQ(2, qr.rows.size());
+  EXPECT_EQ(1, qr.GetVal<int>("Time", 0));
+  EXPECT_EQ(0, qr.GetVal<int>("Since", 0));
+  EXPECT_EQ(3, qr.GetVal<int>("Time", 1));
+  EXPECT_EQ(2, qr.GetVal<int>("Since", 1));
+  cyclus::PyStop();
+}
+
+TEST(TimerTests, MixedInventory) {
+  cyclus::PyStart();
+  cyclus::Recorder rec;
+  cyclus::Timer ti;
+  cyclus::Context ctx(&ti, &rec);
+  cyclus::SqliteBack b(path);
+  rec.RegisterBackend(&b);
+
+  cyclus::SimInfo si(2);
+  si.explicit_inventory = true;
+  si.explicit_inventory_compact = true;
+  ti.Initialize(&ctx, si);
+
+  cyclus::CompMap v;
+  v[922350000] = 1;
+  v[922380000] = 9;
+  cyclus::Composition::Ptr leu = cyclus::Composition::CreateFromMass(v);
+  v.clear();
+  v[942390000] = 1;
+  v[922380000] = 1;
+  cyclus::Composition::Ptr mox = cyclus::Composition::CreateFromMass(v);
+  v.clear();
+  v[10010000] = 2;
+  v[80160000] = 16;
+  cyclus::Composition::Ptr water = cyclus::Composition::CreateFromMass(v);
+
+  // runs of a shared composition, a repeated one and unnormalized ones
+  Mixer* m = new Mixer(&ctx);
+  m->parts.push_back(std::make_pair(leu, 2.0));
+  m->parts.push_back(std::make_pair(leu, 2.0));
+  m->parts.push_back(std::make_pair(mox, 0.5));
+  m->parts.push_back(std::make_pair(leu, 1.0));
+  m->parts.push_back(std::make_pair(water, 3.0));
+  m->Build(NULL);
+
+  // what cloning and absorbing the inventory's materials records
+  cyclus::Material::Ptr want =
+      cyclus::Material::CreateUntracked(m->parts[0].second, m->parts[0].first);
+  for (int i = 1; i < m->parts.size(); ++i) {
+    want->Absorb(cyclus::Material::CreateUntracked(m->parts[i].second,
+                                                   m->parts[i].first));
+  }
+  cyclus::CompMap mass = want->comp()->mass();
+  cyclus::compmath::Normalize(&mass, want->quantity());
+
+  ti.RunSim();
+  rec.Close();
+
+  std::vector<cyclus::Cond> conds;
+  conds.push_back(cyclus::Cond("Time", "==", 0));
+  cyclus::QueryResult qr = b.Query("ExplicitInventory", &conds);
+  ASSERT_EQ(mass.size(), qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    int nuc = qr.GetVal<int>("NucId", i);
+    ASSERT_EQ(1, mass.count(nuc));
+    EXPECT_NEAR(mass[nuc], qr.GetVal<double>("Quantity", i), 1e-9);
+  }
+
+  qr = b.Query("ExplicitInventoryCompact", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_NEAR(want->quantity(), qr.GetVal<double>("Quantity"), 1e-9);
+  cyclus::CompMap got = qr.GetVal<cyclus::CompMap>("Composition");
+  cyclus::compmath::Normalize(&mass, 1);
+  ASSERT_EQ(mass.size(), got.size());
+  cyclus::CompMap::iterator it;
+  for (it = mass.begin(); it != mass.end(); ++it) {
+    EXPECT_NEAR(it->second, got[it->first], 1e-9);
+  }
+  cyclus::PyStop();
+}
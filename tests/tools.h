@@ -1,8 +1,13 @@
 #ifndef CYCLUS_TESTS_TOOLS_H_
 #define CYCLUS_TESTS_TOOLS_H_
 
+#include <map>
+#include <string>
+
 #include "boost/filesystem.hpp"
 
+#include "recorder.h"
+
 class FileDeleter {
  public:
   FileDeleter(std::string path) {
@@ -20,4 +25,37 @@ class FileDeleter {
   std::string path_;
 };
 
+/// The columns RecordItems records in the "Items" table besides Id, and
+/// ITEM_STEPS to also record an "Info" row with the Step every 10 items.
+enum ItemCols {
+  ITEM_TIME = 1,
+  ITEM_NAME = 2,
+  ITEM_MASS = 4,
+  ITEM_PROPS = 8,
+  ITEM_STEPS = 16,
+};
+
+/// Records rows for ids in [begin, end) in an "Items" table, with the
+/// columns in cols: Time id / 10, Name "even" or "odd", Mass 0.5 * id and
+/// Props a map of "mass" to the Mass.  Used to fill backends under test.
+inline void RecordItems(cyclus::Recorder* r, int begin, int end, int cols) {
+  for (int i = begin; i < end; ++i) {
+    cyclus::Datum* d = r->NewDatum("Items")->AddVal("Id", i);
+    if (cols & ITEM_TIME)
+      d->AddVal("Time", i / 10);
+    if (cols & ITEM_NAME)
+      d->AddVal("Name", std::string(i % 2 == 0 ? "even" : "odd"));
+    if (cols & ITEM_MASS)
+      d->AddVal("Mass", 0.5 * i);
+    if (cols & ITEM_PROPS) {
+      std::map<std::string, double> m;
+      m["mass"] = 0.5 * i;
+      d->AddVal("Props", m);
+    }
+    d->Record();
+    if ((cols & ITEM_STEPS) && i % 10 == 0)
+      r->NewDatum("Info")->AddVal("Step", i)->Record();
+  }
+}
+
 #endif  // CYCLUS_TESTS_TOOLS_H_